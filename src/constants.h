@@ -8,6 +8,7 @@
 #include <string>
 
 const std::string MAIN = "Camera";
+const std::string LUMA = "Luma"; // Y plane of the camera frames, only fed when frames are taken in YUV
 const std::string GRAYSCALE = "Grayscale";
 const std::string NEGATIVE = "Negative";
 const std::string BLUR = "Blur";
@@ -16,5 +17,8 @@ const std::string SOBEL_Y = "Sobel Y";
 const std::string MAGNITUDE = "Magnitude";
 const std::string QUANTIZED = "Quantized";
 const std::string CARTOONIZE = "Cartoonize";
+const std::string MOTION = "Motion";
+const std::string BACKGROUND = "Background";
+const std::string DENOISE = "Denoise";
 
 #endif //VISION_CPP_CONSTANTS_H
@@ -2,31 +2,43 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <opencv2/opencv.hpp>
+#include <random>
+#include <set>
 #include <thread>
-#include <unordered_map>
+#include <vector>
 
 #include "constants.h"
-#include "utils/camera/camera.h"
-#include "tasks/greyscale.h"
-#include "tasks/negative.h"
-#include "tasks/blur.h"
-#include "tasks/sobel.h"
-#include "tasks/magnitude.h"
-#include "tasks/quantize.h"
-#include "tasks/cartoonize.h"
-
-void fetch_frame(Camera &camera, WatchChannel<cv::Mat> &outputChannel, bool &isRunning) {
-    while (isRunning) {
-        cv::Mat frame;
-        camera.read(frame);
-        if (frame.empty()) {
-            std::cout << "Fetch: " << "Failed to capture frame." << std::endl;
-            continue;
-        }
-        outputChannel.write(frame);
-    }
+#include "pipeline/pipeline.h"
+#include "pipeline/stream.h"
+#include "utils/display/compositor.h"
+#include "utils/governor/quality_governor.h"
+#include "utils/memory/frame_allocator.h"
+#include "utils/params/filter_parameters.h"
+#include "utils/params/parameter_console.h"
+#include "utils/metrics/metrics.h"
+#include "utils/options/options.h"
+#include "utils/recording/frame_recorder.h"
+#include "utils/runtime/runtime.h"
+#include "utils/simd/dispatch.h"
+#include "utils/sink/sink_factory.h"
+#include "utils/stats/perf_counters.h"
+#include "utils/stats/process_usage.h"
+#include "utils/stream/stream_server.h"
+#include "utils/trace/trace.h"
+#include "utils/source/source_factory.h"
+
+volatile std::sig_atomic_t interrupted = 0; // set by SIGINT/SIGTERM to end a headless run
+
+void handle_interrupt(int) {
+    interrupted = 1;
 }
 
 int display_channel(WatchChannel<cv::Mat> &watchChannel, const std::string &window_name) {
@@ -41,205 +53,724 @@ int display_channel(WatchChannel<cv::Mat> &watchChannel, const std::string &wind
     return 0;
 }
 
-void
-create_channel(std::unordered_map<std::string, WatchChannel<cv::Mat> *> &channels, const std::string &channel_name) {
-    if (channels.find(channel_name) != channels.end()) {
-        return;
+void stop_task(Pipeline &pipeline, const std::string &task_name, bool has_window) {
+    if (pipeline.stop(task_name) == 0 && has_window) {
+        cv::destroyWindow(task_name);
+    }
+}
+
+void toggle_task(Pipeline &pipeline, const std::string &task_name, bool has_window) {
+    if (pipeline.is_running(task_name)) {
+        stop_task(pipeline, task_name, has_window);
+    } else {
+        pipeline.start(task_name);
+    }
+}
+
+/**
+ * Returns the name an output of a stream is shown (and served) under: the plain name with a single stream,
+ * prefixed by the index of the stream otherwise.
+ */
+std::string stream_label(const std::vector<std::unique_ptr<Stream>> &streams, int index, const std::string &name,
+                         const std::string &separator) {
+    if (streams.size() == 1) {
+        return name;
+    }
+    return std::to_string(index) + separator + name;
+}
+
+void toggle_all(std::vector<std::unique_ptr<Stream>> &streams, const std::string &task_name, bool has_window) {
+    for (auto &stream: streams) {
+        // only the first stream has windows of its own
+        toggle_task(stream->get_pipeline(), task_name, has_window && stream->index == 0);
+    }
+}
+
+std::vector<std::unique_ptr<Sink>> open_sinks(Options &options, std::vector<std::unique_ptr<Stream>> &streams) {
+    std::vector<std::unique_ptr<Sink>> sinks;
+    for (auto &sink_option: options.sinks) {
+        if (sink_option.stream < 0 || sink_option.stream >= static_cast<int>(streams.size())) {
+            std::cout << "No stream " << sink_option.stream << " for sink " << sink_option.target << "." << std::endl;
+            continue;
+        }
+        Pipeline &pipeline = streams[sink_option.stream]->get_pipeline();
+        if (sink_option.channel != MAIN) {
+            pipeline.start(sink_option.channel);
+        }
+        std::unique_ptr<Sink> sink = open_sink(sink_option.target, options);
+        if (!sink) {
+            continue;
+        }
+        sink->name = stream_label(streams, sink_option.stream, sink_option.channel, ": ") + " -> " + sink->name;
+        sink->attach(*pipeline.get_channel(sink_option.channel));
+        sinks.push_back(std::move(sink));
+    }
+    return sinks;
+}
+
+/**
+ * Shows the camera and the filters of every stream as the tiles of the mosaic. Under pull evaluation, the filters only
+ * started for other filters have no tile, so that nothing reads them but those filters.
+ */
+void update_mosaic(Compositor &compositor, std::vector<std::unique_ptr<Stream>> &streams, bool pull) {
+    std::vector<std::string> names;
+    std::vector<WatchChannel<cv::Mat> *> channels;
+
+    for (auto &stream: streams) {
+        Pipeline &pipeline = stream->get_pipeline();
+        names.push_back(stream_label(streams, stream->index, MAIN, ": "));
+        channels.push_back(pipeline.get_channel(MAIN));
+
+        // sorted, so that tiles keep their place when other filters are toggled
+        std::map<std::string, Task *> sorted_tasks(pipeline.get_tasks().begin(), pipeline.get_tasks().end());
+        for (auto &pair: sorted_tasks) {
+            if (pull && pipeline.is_intermediate(pair.first)) {
+                continue;
+            }
+            names.push_back(stream_label(streams, stream->index, pair.first, ": "));
+            channels.push_back(pair.second->get_output_channel());
+        }
+    }
+
+    compositor.set_tiles(names, channels);
+    compositor.update();
+}
+
+std::unique_ptr<StreamServer> open_stream_server(Options &options, std::vector<std::unique_ptr<Stream>> &streams) {
+    if (options.stream.empty()) {
+        return nullptr;
+    }
+
+    auto server = std::make_unique<StreamServer>(options.stream, options.stream_quality);
+    for (auto &stream: streams) {
+        Pipeline &pipeline = stream->get_pipeline();
+        server->add_stream(stream_label(streams, stream->index, "camera", "/"), *pipeline.get_channel(MAIN));
+        for (auto &pair: get_filter_names()) {
+            server->add_stream(stream_label(streams, stream->index, pair.first, "/"),
+                               *pipeline.get_channel(pair.second));
+        }
     }
-    channels[channel_name] = new WatchChannel<cv::Mat>();
+    if (server->start() != 0) {
+        return nullptr;
+    }
+    return server;
 }
 
-void stop_task(const std::string &task_name, std::unordered_map<std::string, Task *> &tasks) {
-    tasks[task_name]->set_running(false);
-    tasks.erase(task_name);
-    cv::destroyWindow(task_name);
+std::unique_ptr<MetricsExporter> open_metrics_exporter(Options &options) {
+    if (options.metrics.empty() && options.metrics_listen.empty()) {
+        return nullptr;
+    }
 
-    std::cout << "Stopped " << task_name << std::endl;
+    auto exporter = std::make_unique<MetricsExporter>(options.metrics, options.metrics_listen,
+                                                      options.metrics_interval);
+    if (exporter->start() != 0) {
+        return nullptr;
+    }
+    return exporter;
 }
 
-void start_sobel_tasks(std::unordered_map<std::string, Task *> &tasks,
-                       std::unordered_map<std::string, WatchChannel<cv::Mat> *> &channels) {
-    create_channel(channels, SOBEL_X);
-    auto *sobelXTask = new SobelXTask(*channels[SOBEL_X]);
-    tasks[SOBEL_X] = sobelXTask;
-    sobelXTask->start(*channels[MAIN]);
+void add_stage_metrics(MetricsText &metrics, const MetricLabels &labels, const StageStats &stats) {
+    const LatencySnapshot &latency = stats.latency;
+    metrics.add("filters_stage_running", labels, stats.running ? 1 : 0);
+    metrics.add("filters_stage_fps", labels, stats.fps);
+    metrics.add("filters_stage_frames_total", labels, static_cast<double>(stats.total_frames));
+    metrics.add("filters_stage_stale_total", labels, static_cast<double>(stats.stale_frames));
+    metrics.add("filters_stage_busy_seconds_total", labels, stats.total_frame_time / 1e6);
+    metrics.add("filters_stage_deadline_seconds", labels, stats.deadline / 1e6);
+    metrics.add("filters_stage_deadline_missed_total", labels, static_cast<double>(stats.missed_deadlines));
+    metrics.add("filters_stage_skipped_total", labels, static_cast<double>(stats.skipped_frames));
+    metrics.add("filters_stage_delay_seconds", labels, stats.delay / 1e6);
+    metrics.add("filters_stage_quality_steps", labels, stats.quality);
+    const std::pair<std::string, double> quantiles[] = {{"0.5", 50}, {"0.9", 90}, {"0.99", 99}};
+    for (auto &quantile: quantiles) {
+        MetricLabels quantile_labels = labels;
+        quantile_labels.emplace_back("quantile", quantile.first);
+        metrics.add("filters_stage_latency_seconds", quantile_labels, latency.percentile(quantile.second) / 1e9);
+    }
+    metrics.add("filters_stage_latency_seconds", labels, latency.sum / 1e9, "_sum");
+    metrics.add("filters_stage_latency_seconds", labels, static_cast<double>(latency.count), "_count");
+    metrics.add("filters_stage_latency_max_seconds", labels, latency.max / 1e9);
+    if (stats.counting) {
+        metrics.add("filters_stage_counted_pixels_total", labels, static_cast<double>(stats.counted_pixels));
+        metrics.add("filters_stage_cycles_total", labels, static_cast<double>(stats.counters.cycles));
+        metrics.add("filters_stage_instructions_total", labels, static_cast<double>(stats.counters.instructions));
+        metrics.add("filters_stage_llc_references_total", labels,
+                    static_cast<double>(stats.counters.cache_references));
+        metrics.add("filters_stage_llc_misses_total", labels, static_cast<double>(stats.counters.cache_misses));
+    }
+}
 
-    std::cout << "Started Sobel X" << std::endl;
+void add_staleness_metric(MetricsText &metrics, const MetricLabels &labels, WatchChannel<cv::Mat> &channel,
+                          int64_t now) {
+    int64_t last_write = channel.get_last_write();
+    if (last_write > 0) {
+        metrics.add("filters_channel_staleness_seconds", labels, (now - last_write) / 1e9);
+    }
+}
+
+/**
+ * Renders the metrics of every stream, the runtime and the outputs. Every counter is read from atomics (or from
+ * copies the stages publish), so collecting never takes a lock a stage or a sink holds while processing a frame.
+ */
+std::string collect_metrics(std::vector<std::unique_ptr<Stream>> &streams, Runtime &runtime,
+                            std::vector<std::unique_ptr<Sink>> &sinks, StreamServer *stream_server, double elapsed) {
+    MetricsText metrics;
+    metrics.declare("filters_uptime_seconds", "gauge", "Time since the streams were started.");
+    metrics.declare("filters_stage_running", "gauge", "Whether the stage is running.");
+    metrics.declare("filters_stage_fps", "gauge", "New frames processed by the stage during the last second.");
+    metrics.declare("filters_stage_frames_total", "counter", "New frames processed by the stage.");
+    metrics.declare("filters_stage_stale_total", "counter",
+                    "Stage iterations that found their input unchanged since the previous one.");
+    metrics.declare("filters_stage_busy_seconds_total", "counter", "Time the stage spent processing new frames.");
+    metrics.declare("filters_stage_deadline_seconds", "gauge",
+                    "Time the stage has per frame under deadline scheduling, 0 for none.");
+    metrics.declare("filters_stage_deadline_missed_total", "counter", "New frames finished after their deadline.");
+    metrics.declare("filters_stage_skipped_total", "counter",
+                    "New frames skipped while the deadlines of other stages were at risk, or to save time.");
+    metrics.declare("filters_stage_delay_seconds", "gauge",
+                    "Age of the input of the last new frame when the stage was done with it.");
+    metrics.declare("filters_stage_quality_steps", "gauge",
+                    "Quality steps the governor made the stage take: 1 cheap variant, 2 half resolution, 4 frame "
+                    "skipping, added up.");
+    metrics.declare("filters_stage_latency_seconds", "summary", "Time the stage took per new frame.");
+    metrics.declare("filters_stage_latency_max_seconds", "gauge", "Longest time the stage took for one frame.");
+    metrics.declare("filters_stage_counted_pixels_total", "counter",
+                    "Pixels written by the stage iterations hardware events were counted over.");
+    metrics.declare("filters_stage_cycles_total", "counter", "CPU cycles of the stage thread on new frames.");
+    metrics.declare("filters_stage_instructions_total", "counter", "Instructions of the stage thread on new frames.");
+    metrics.declare("filters_stage_llc_references_total", "counter",
+                    "Last level cache references of the stage thread on new frames.");
+    metrics.declare("filters_stage_llc_misses_total", "counter",
+                    "Last level cache misses of the stage thread on new frames.");
+    metrics.declare("filters_channel_staleness_seconds", "gauge", "Time since the channel was last written.");
+    metrics.declare("filters_runtime_workers", "gauge", "Stage iterations that may run at the same time.");
+    metrics.declare("filters_runtime_stage_runs_total", "counter", "Stage iterations granted a worker slot.");
+    metrics.declare("filters_runtime_busy_seconds_total", "counter", "Time the stages of the stream held a slot.");
+    metrics.declare("filters_runtime_wait_seconds_total", "counter", "Time the stages of the stream waited for a slot.");
+    metrics.declare("filters_thread_budget_cores", "gauge", "Cores the stages divide between their parallel loops.");
+    metrics.declare("filters_thread_budget_stage_threads", "gauge", "OpenMP threads the stage may use.");
+    metrics.declare("filters_thread_budget_stage_cost_cores", "gauge",
+                    "Smoothed CPU time of the stage per second, threads included.");
+    metrics.declare("filters_sink_frames_total", "counter", "Frames consumed by the output.");
+    metrics.declare("filters_sink_dropped_total", "counter", "Frames the output dropped instead of consuming them.");
+    metrics.declare("filters_sink_busy_seconds_total", "counter", "Time the output spent consuming frames.");
+    metrics.declare("filters_stream_server_clients_total", "counter", "Clients that requested a valid stream.");
+    metrics.declare("filters_stream_server_frames_sent_total", "counter", "Frames sent to the stream clients.");
+    metrics.declare("filters_stream_server_frames_skipped_total", "counter",
+                    "Frames stream clients skipped because they were busy sending.");
+
+    metrics.add("filters_uptime_seconds", {}, elapsed);
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    for (auto &stream: streams) {
+        std::string index = std::to_string(stream->index);
+        Pipeline &pipeline = stream->get_pipeline();
+
+        add_stage_metrics(metrics, {{"stream", index}, {"stage", MAIN}}, stream->get_fetch_state().snapshot());
+        add_staleness_metric(metrics, {{"stream", index}, {"channel", MAIN}}, *pipeline.get_source_channel(), now);
+        if (pipeline.has_luma_input()) {
+            add_staleness_metric(metrics, {{"stream", index}, {"channel", LUMA}}, *pipeline.get_luma_channel(), now);
+        }
+        for (auto &pair: pipeline.get_tasks()) {
+            add_stage_metrics(metrics, {{"stream", index}, {"stage", pair.first}}, pair.second->get_stats());
+            add_staleness_metric(metrics, {{"stream", index}, {"channel", pair.first}},
+                                 *pair.second->get_output_channel(), now);
+        }
+    }
+
+    metrics.add("filters_runtime_workers", {}, runtime.get_workers());
+    for (int i = 0; i < runtime.get_stream_count(); i++) {
+        StreamStats stats = runtime.get_stats(i);
+        MetricLabels labels = {{"stream", std::to_string(i)}, {"name", runtime.get_stream_name(i)}};
+        metrics.add("filters_runtime_stage_runs_total", labels, static_cast<double>(stats.stage_runs));
+        metrics.add("filters_runtime_busy_seconds_total", labels, stats.busy_time / 1e6);
+        metrics.add("filters_runtime_wait_seconds_total", labels, stats.wait_time / 1e6);
+    }
+    ThreadBudget *budget = runtime.get_thread_budget();
+    if (budget != nullptr) {
+        // the budget lock is only held briefly between stage iterations, never while a frame is processed
+        metrics.add("filters_thread_budget_cores", {}, budget->get_cores());
+        for (int i = 0; i < budget->get_stage_count(); i++) {
+            std::string name;
+            int stream;
+            budget->get_stage_name(i, name, stream);
+            StageBudget stage_budget = budget->get_budget(i);
+            MetricLabels labels = {{"stream", std::to_string(stream)}, {"stage", name}};
+            metrics.add("filters_thread_budget_stage_threads", labels, stage_budget.active ? stage_budget.width : 0);
+            metrics.add("filters_thread_budget_stage_cost_cores", labels, stage_budget.cost);
+        }
+    }
+
+    std::vector<const Sink *> outputs;
+    for (auto &sink: sinks) {
+        outputs.push_back(sink.get());
+    }
+    if (stream_server != nullptr) {
+        for (const Sink *stream: stream_server->get_streams()) {
+            outputs.push_back(stream);
+        }
+        StreamServerStats stats = stream_server->get_stats();
+        metrics.add("filters_stream_server_clients_total", {}, static_cast<double>(stats.clients_served));
+        metrics.add("filters_stream_server_frames_sent_total", {}, static_cast<double>(stats.frames_sent));
+        metrics.add("filters_stream_server_frames_skipped_total", {}, static_cast<double>(stats.frames_skipped));
+    }
+    for (const Sink *output: outputs) {
+        SinkStats stats = output->get_stats();
+        MetricLabels labels = {{"sink", output->name}};
+        metrics.add("filters_sink_frames_total", labels, static_cast<double>(stats.frames_out));
+        metrics.add("filters_sink_dropped_total", labels, static_cast<double>(stats.frames_dropped));
+        metrics.add("filters_sink_busy_seconds_total", labels, stats.busy_time / 1e6);
+    }
 
-    create_channel(channels, SOBEL_Y);
-    auto *sobelYTask = new SobelYTask(*channels[SOBEL_Y]);
-    tasks[SOBEL_Y] = sobelYTask;
-    sobelYTask->start(*channels[MAIN]);
+    return metrics.str();
+}
 
-    std::cout << "Started Sobel Y" << std::endl;
+void print_stage(const std::string &name, const StageStats &stats, double fps) {
+    const LatencySnapshot &latency = stats.latency;
+    std::cout << name << ": " << fps << " fps, " << stats.total_frames << " new / " << stats.stale_frames
+              << " stale, latency p50 " << latency.percentile(50) / 1000.0 << " us, p90 "
+              << latency.percentile(90) / 1000.0 << " us, p99 " << latency.percentile(99) / 1000.0
+              << " us, max " << latency.max / 1000.0 << " us" << std::endl;
+    if (stats.counted_frames > 0 && stats.counted_pixels > 0) {
+        const PerfSample &counters = stats.counters;
+        auto pixels = static_cast<double>(stats.counted_pixels);
+        std::cout << "  IPC " << (counters.cycles > 0 ? 1.0 * counters.instructions / counters.cycles : 0)
+                  << ", " << counters.cycles / pixels << " cycles/px, " << counters.cache_references / pixels
+                  << " LLC refs/px, " << counters.cache_misses / pixels << " LLC misses/px ("
+                  << (counters.cache_references > 0 ? 100.0 * counters.cache_misses / counters.cache_references : 0)
+                  << "% miss rate)" << std::endl;
+    }
+    if (stats.deadline > 0 || stats.skipped_frames > 0) {
+        std::cout << "  deadline " << stats.deadline / 1000.0 << " ms, " << stats.missed_deadlines << " missed, "
+                  << stats.skipped_frames << " skipped" << std::endl;
+    }
+    if (stats.quality != 0) {
+        std::cout << "  quality lowered:" << ((stats.quality & CHEAP_VARIANT) != 0 ? " cheap variant" : "")
+                  << ((stats.quality & HALF_RESOLUTION) != 0 ? " half resolution" : "")
+                  << ((stats.quality & SKIP_FRAMES) != 0 ? " frame skipping" : "") << ", delay "
+                  << stats.delay / 1000.0 << " ms" << std::endl;
+    }
+}
 
-    create_channel(channels, MAGNITUDE);
-    auto *magnitudeTask = new MagnitudeTask(*channels[MAGNITUDE]);
-    tasks[MAGNITUDE] = magnitudeTask;
-    magnitudeTask->start(*channels[SOBEL_X], *channels[SOBEL_Y]);
+/**
+ * Hands the statistics of the running tasks of every stream to the governor, and applies the quality step it took or
+ * undid, if any.
+ */
+void govern(QualityGovernor &governor, std::vector<std::unique_ptr<Stream>> &streams) {
+    std::vector<GovernedStage> stages;
+    std::vector<Task *> tasks;
+    for (auto &stream: streams) {
+        Pipeline &pipeline = stream->get_pipeline();
+        std::map<std::string, int> indices;
+        for (auto &pair: pipeline.get_tasks()) {
+            GovernedStage stage;
+            stage.name = stream_label(streams, stream->index, pair.first, ": ");
+            stage.stats = pair.second->get_stats();
+            stage.steps = pipeline.get_quality_steps(pair.first);
+            stage.level = get_quality_level(stage.steps, stage.stats.quality);
+            indices[pair.first] = static_cast<int>(stages.size());
+            stages.push_back(stage);
+            tasks.push_back(pair.second);
+        }
+        for (auto &pair: indices) {
+            for (auto &dependency: pipeline.get_dependencies(pair.first)) {
+                auto it = indices.find(dependency);
+                if (it != indices.end()) {
+                    stages[pair.second].inputs.push_back(it->second);
+                }
+            }
+        }
+    }
 
-    std::cout << "Started Magnitude" << std::endl;
+    int changed = governor.update(stages);
+    if (changed >= 0) {
+        tasks[changed]->set_quality(get_quality_mask(stages[changed].steps, stages[changed].level));
+    }
 }
 
-void stop_sobel_tasks(std::unordered_map<std::string, Task *> &tasks) {
-    stop_task(SOBEL_X, tasks);
-    stop_task(SOBEL_Y, tasks);
-    stop_task(MAGNITUDE, tasks);
+void print_summary(Stream &stream, double elapsed) {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Summary of stream " << stream.index << " (" << stream.name << ", " << elapsed << " s)" << std::endl;
+    StageStats fetch_stats = stream.get_fetch_state().snapshot();
+    print_stage(MAIN, fetch_stats, fetch_stats.total_frames / elapsed);
+
+    Pipeline &pipeline = stream.get_pipeline();
+    std::map<std::string, Task *> sorted_tasks(pipeline.get_tasks().begin(), pipeline.get_tasks().end());
+    for (auto &pair: sorted_tasks) {
+        StageStats stats = pair.second->get_stats();
+        print_stage(pair.first, stats, stats.total_frames / elapsed);
+    }
+    if (pipeline.get_idle_count() > 0) {
+        std::cout << pipeline.get_idle_count() << " filters idle at exit: nothing read them" << std::endl;
+    }
+    auto *frame_allocator = dynamic_cast<FrameAllocator *>(pipeline.get_allocator());
+    if (frame_allocator != nullptr) {
+        frame_allocator->report(std::cout, stream.name);
+    }
 }
 
-void start_quantize_task(std::unordered_map<std::string, Task *> &tasks,
-                         std::unordered_map<std::string, WatchChannel<cv::Mat> *> &channels) {
-    channels[QUANTIZED] = new WatchChannel<cv::Mat>();
-    auto *quantizedTask = new QuantizedTask(*channels[QUANTIZED]);
-    tasks[QUANTIZED] = quantizedTask;
-    quantizedTask->start(*channels[MAIN]);
+/**
+ * Toggles random filters on every stream, options.soak times, and checks that the process ends up holding the same
+ * threads and about the same memory as before. Every filter is started and stopped once first, so that what is only
+ * allocated once (parked stages, arenas, OpenMP teams, the allocator's caches) is already in the baseline; both
+ * measurements are taken with only the filters of the command line running.
+ * @return 0 if nothing grew, 1 otherwise.
+ */
+int run_soak(Options &options, std::vector<std::unique_ptr<Stream>> &streams) {
+    const auto SETTLE = std::chrono::milliseconds(500); // lets the frames in flight be released before measuring
+    const int ROUND = 100; // toggles between two returns to the filters of the command line
+    const long long MARGIN = 32LL << 20; // resident memory the allocator may keep on top of the baseline
+
+    std::set<std::string> names;
+    for (auto &pair: get_filter_names()) {
+        names.insert(pair.second);
+    }
+    std::vector<std::string> filters(names.begin(), names.end());
+    // the filters of the command line, with their dependencies
+    std::vector<std::set<std::string>> base;
+    for (auto &stream: streams) {
+        std::set<std::string> running;
+        for (auto &pair: stream->get_pipeline().get_tasks()) {
+            running.insert(pair.first);
+        }
+        base.push_back(running);
+    }
+    auto restore = [&]() {
+        for (auto &stream: streams) {
+            Pipeline &pipeline = stream->get_pipeline();
+            std::vector<std::string> extra;
+            for (auto &pair: pipeline.get_tasks()) {
+                if (base[stream->index].count(pair.first) == 0) {
+                    extra.push_back(pair.first);
+                }
+            }
+            for (auto &name: extra) {
+                pipeline.stop(name);
+            }
+            for (auto &name: base[stream->index]) {
+                pipeline.start(name);
+            }
+        }
+    };
+
+    for (auto &filter: filters) {
+        toggle_all(streams, filter, false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        restore();
+    }
+    std::this_thread::sleep_for(SETTLE);
+    ProcessUsage baseline;
+    if (read_process_usage(baseline) != 0) {
+        std::cout << "Soak: the usage of the process cannot be read on this system." << std::endl;
+        return 1;
+    }
 
-    std::cout << "Started Quantized" << std::endl;
+    std::mt19937_64 random(options.seed);
+    int toggles = 0;
+    for (; toggles < options.soak && !interrupted; toggles++) {
+        toggle_all(streams, filters[random() % filters.size()], false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        if ((toggles + 1) % ROUND == 0) {
+            restore();
+        }
+    }
+    restore();
+    std::this_thread::sleep_for(SETTLE);
+    ProcessUsage usage;
+    read_process_usage(usage);
+
+    long long margin = std::max(MARGIN, baseline.resident_bytes / 10);
+    bool leaked = usage.threads > baseline.threads || usage.resident_bytes > baseline.resident_bytes + margin;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Soak: " << toggles << " toggles, threads " << baseline.threads << " -> " << usage.threads
+              << ", resident " << static_cast<double>(baseline.resident_bytes) / (1 << 20) << " -> "
+              << static_cast<double>(usage.resident_bytes) / (1 << 20) << " MiB"
+              << (leaked ? ": LEAK" : ": flat") << std::endl;
+    return leaked ? 1 : 0;
 }
 
-int main() {
-    Camera camera(0);
-    camera.set_fps(30);
+int run_headless(Options &options, std::vector<std::unique_ptr<Stream>> &streams, Runtime &runtime,
+                 FrameRecorder *recorder) {
+    std::signal(SIGINT, handle_interrupt);
+    std::signal(SIGTERM, handle_interrupt);
+
+    for (auto &stream: streams) {
+        for (auto &filter: options.filters) {
+            stream->get_pipeline().start(filter);
+        }
+    }
+    std::vector<std::unique_ptr<Sink>> sinks = open_sinks(options, streams);
+    std::unique_ptr<StreamServer> stream_server = open_stream_server(options, streams);
+    std::unique_ptr<MetricsExporter> metrics_exporter = open_metrics_exporter(options);
+    std::unique_ptr<QualityGovernor> governor;
+    if (options.governor > 0) {
+        governor = std::make_unique<QualityGovernor>(options.governor, std::cout);
+    }
+    for (auto &stream: streams) {
+        bool camera_sink = std::any_of(options.sinks.begin(), options.sinks.end(), [&](const SinkOption &sink) {
+            return sink.channel == MAIN && sink.stream == stream->index;
+        });
+        stream->get_pipeline().set_colour_required(camera_sink || stream_server != nullptr);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto &stream: streams) {
+        if (options.target_fps > 0) {
+            stream->get_source().set_fps(options.target_fps);
+        }
+        stream->start(options.target_fps, stream->index == 0 ? recorder : nullptr);
+    }
+
+    double elapsed = 0;
+    bool fetching = true;
+    int result = 0;
+    if (options.soak > 0) {
+        result = run_soak(options, streams);
+        fetching = false;
+    }
+    while (fetching && !interrupted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (options.duration > 0 && elapsed >= options.duration) {
+            break;
+        }
+        if (metrics_exporter != nullptr && metrics_exporter->is_due()) {
+            metrics_exporter->publish(collect_metrics(streams, runtime, sinks, stream_server.get(), elapsed));
+        }
+        if (governor != nullptr && governor->is_due()) {
+            govern(*governor, streams);
+        }
+        fetching = false;
+        for (auto &stream: streams) {
+            stream->get_pipeline().update_demand();
+            if (options.max_frames > 0 && stream->get_fetch_state().total_frames >= options.max_frames) {
+                stream->stop();
+            }
+            fetching = fetching || stream->is_fetching();
+        }
+    }
+
+    for (auto &stream: streams) {
+        stream->stop();
+    }
+    for (auto &stream: streams) {
+        for (auto &pair: stream->get_pipeline().get_tasks()) {
+            pair.second->set_running(false);
+            pair.second->join();
+        }
+    }
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto &stream: streams) {
+        print_summary(*stream, elapsed);
+    }
+    runtime.report(std::cout, elapsed);
+    if (streams[0]->get_pipeline().get_executor() != nullptr) {
+        streams[0]->get_pipeline().get_executor()->report(std::cout);
+    }
+    if (governor != nullptr) {
+        governor->report(std::cout);
+    }
+    for (auto &sink: sinks) {
+        sink->stop();
+        sink->report(std::cout);
+    }
+    if (stream_server != nullptr) {
+        stream_server->stop();
+        stream_server->report(std::cout);
+    }
+    if (metrics_exporter != nullptr) {
+        // the final counters, so that a file exporter leaves the totals of the run behind
+        metrics_exporter->publish(collect_metrics(streams, runtime, sinks, stream_server.get(), elapsed));
+        metrics_exporter->stop();
+    }
+    if (recorder != nullptr) {
+        std::cout << "Recorded " << recorder->get_frame_count() << " frames to " << options.record << std::endl;
+    }
+    for (auto &stream: streams) {
+        stream->get_pipeline().stop_all();
+    }
+    if (!options.trace.empty()) {
+        trace_dump(options.trace);
+    }
 
-    std::unordered_map<std::string, WatchChannel<cv::Mat> *> channels;
-    std::unordered_map<std::string, Task *> tasks;
+    return result;
+}
 
-    channels[MAIN] = new WatchChannel<cv::Mat>();
+int run_gui(Options &options, std::vector<std::unique_ptr<Stream>> &streams, Runtime &runtime,
+            FrameRecorder *recorder) {
+    if (!options.mosaic && streams.size() > 1) {
+        std::cout << "Only the first stream is shown in windows mode, use --display mosaic to see every stream."
+                  << std::endl;
+    }
+
+    for (auto &stream: streams) {
+        stream->get_source().set_fps(options.target_fps > 0 ? options.target_fps : 30);
+        stream->get_pipeline().set_colour_required(true); // the camera is always on display
+        for (auto &filter: options.filters) {
+            stream->get_pipeline().start(filter);
+        }
+    }
+    std::vector<std::unique_ptr<Sink>> sinks = open_sinks(options, streams);
+    std::unique_ptr<StreamServer> stream_server = open_stream_server(options, streams);
+    std::unique_ptr<MetricsExporter> metrics_exporter = open_metrics_exporter(options);
+    std::unique_ptr<QualityGovernor> governor;
+    if (options.governor > 0) {
+        governor = std::make_unique<QualityGovernor>(options.governor, std::cout);
+    }
 
     int key_pressed;
-    bool is_camera_enabled = true;
+    for (auto &stream: streams) {
+        stream->start(options.target_fps, stream->index == 0 ? recorder : nullptr);
+    }
+    bool paused = false;
+    auto start = std::chrono::steady_clock::now();
 
-    std::thread fetch_thread(fetch_frame, std::ref(camera), std::ref(*channels[MAIN]), std::ref(is_camera_enabled));
+    Compositor compositor("FiltersCPP", cv::Size(options.display_width, options.display_height), options.display_fps);
+    Pipeline &first_pipeline = streams[0]->get_pipeline();
 
     bool is_running = true;
     while (is_running) {
-        display_channel(*channels[MAIN], MAIN);
+        int wait_time = 1;
+        if (options.mosaic) {
+            update_mosaic(compositor, streams, options.evaluation == "pull");
+            wait_time = compositor.get_wait_time();
+        } else {
+            display_channel(*first_pipeline.get_channel(MAIN), MAIN);
+
+            for (auto &pair: first_pipeline.get_tasks()) {
+                if (options.evaluation == "pull" && first_pipeline.is_intermediate(pair.first)) {
+                    continue;
+                }
+                pair.second->display();
+            }
+        }
+        for (auto &stream: streams) {
+            stream->get_pipeline().update_demand();
+        }
 
-        for (auto &pair: tasks) {
-            pair.second->display();
+        if (metrics_exporter != nullptr && metrics_exporter->is_due()) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            metrics_exporter->publish(collect_metrics(streams, runtime, sinks, stream_server.get(), elapsed));
+        }
+        if (governor != nullptr && governor->is_due()) {
+            govern(*governor, streams);
         }
 
-        key_pressed = cv::waitKey(1);
+        key_pressed = cv::waitKey(wait_time);
         switch (key_pressed) {
             case -1: {
                 break;
             }
             case 98: { // b
                 std::cout << "Key pressed: [B] " << key_pressed << std::endl;
-
-                if (tasks.find(BLUR) == tasks.end()) {
-                    create_channel(channels, BLUR);
-                    auto *blurTask = new BlurTask(*channels[BLUR]);
-                    tasks[BLUR] = blurTask;
-                    blurTask->start(*channels[MAIN]);
-
-                    std::cout << "Started Blur" << std::endl;
-                } else {
-                    tasks.erase(BLUR);
-                    channels.erase(BLUR);
-                    cv::destroyWindow(BLUR);
-
-                    std::cout << "Stopped Blur" << std::endl;
-                }
-
+                toggle_all(streams, BLUR, !options.mosaic);
                 break;
             }
             case 99: { // c
                 std::cout << "Key pressed: [C] " << key_pressed << std::endl;
-
-                if (tasks.find(CARTOONIZE) != tasks.end()) {
-                    stop_task(CARTOONIZE, tasks);
-                } else {
-                    if (tasks.find(MAGNITUDE) == tasks.end()) {
-                        start_sobel_tasks(tasks, channels);
-                    }
-                    if (tasks.find(QUANTIZED) == tasks.end()) {
-                        start_quantize_task(tasks, channels);
-                    }
-
-                    create_channel(channels, CARTOONIZE);
-                    auto *cartoonizeTask = new CartoonizeTask(*channels[CARTOONIZE]);
-                    tasks[CARTOONIZE] = cartoonizeTask;
-                    cartoonizeTask->start(*channels[QUANTIZED], *channels[MAGNITUDE]);
-
-                    std::cout << "Started Cartoonize" << std::endl;
-                }
-
+                toggle_all(streams, CARTOONIZE, !options.mosaic);
                 break;
             }
             case 100: { // d
                 std::cout << "Key pressed: [D] " << key_pressed << std::endl;
 
-                if (is_camera_enabled) {
-                    is_camera_enabled = false;
-                    fetch_thread.join();
-                    std::cout << "Paused camera" << std::endl;
-                } else {
-                    is_camera_enabled = true;
-                    fetch_thread = std::thread(fetch_frame, std::ref(camera), std::ref(*channels[MAIN]), std::ref(is_camera_enabled));
-                    std::cout << "Resumed camera" << std::endl;
+                for (auto &stream: streams) {
+                    if (paused) {
+                        stream->start(options.target_fps, stream->index == 0 ? recorder : nullptr);
+                    } else {
+                        stream->stop();
+                    }
                 }
+                paused = !paused;
+                std::cout << (paused ? "Paused camera" : "Resumed camera") << std::endl;
 
                 break;
             }
             case 102: { // f
                 std::cout << "Key pressed: [F] " << key_pressed << std::endl;
-                for (auto &pair: tasks) {
-                    std::cout << pair.first << ": " << pair.second->get_state().fps_counter << " fps ("
-                              << pair.second->get_state().frame_time << "ms )" << std::endl;
+                std::cout << std::fixed << std::setprecision(2);
+                for (auto &stream: streams) {
+                    for (auto &pair: stream->get_pipeline().get_tasks()) {
+                        StageStats stats = pair.second->get_stats();
+                        print_stage(stream_label(streams, stream->index, pair.first, ": "), stats, stats.fps);
+                    }
+                    auto *frame_allocator = dynamic_cast<FrameAllocator *>(stream->get_pipeline().get_allocator());
+                    if (frame_allocator != nullptr) {
+                        frame_allocator->report(std::cout, stream->name);
+                    }
+                }
+                runtime.report(std::cout,
+                               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                if (first_pipeline.get_executor() != nullptr) {
+                    first_pipeline.get_executor()->report(std::cout);
+                }
+                if (governor != nullptr) {
+                    governor->report(std::cout);
+                }
+                std::cout << "Parameters:" << std::endl;
+                get_filter_parameters().describe(std::cout);
+                for (auto &sink: sinks) {
+                    sink->report(std::cout);
+                }
+                if (stream_server != nullptr) {
+                    stream_server->report(std::cout);
                 }
                 break;
             }
-            case 103: { // g
-                std::cout << "Key pressed: [G] " << key_pressed << std::endl;
-
-                if (tasks.find(GRAYSCALE) == tasks.end()) {
-                    create_channel(channels, GRAYSCALE);
-                    auto *grayscaleTask = new GrayscaleTask(*channels[GRAYSCALE]);
-                    tasks[GRAYSCALE] = grayscaleTask;
-                    grayscaleTask->start(*channels[MAIN]);
-
-                    std::cout << "Started Grayscale" << std::endl;
+            case 116: { // t
+                std::cout << "Key pressed: [T] " << key_pressed << std::endl;
+                if (!options.trace.empty()) {
+                    trace_dump(options.trace);
                 } else {
-                    stop_task(GRAYSCALE, tasks);
+                    std::cout << "Tracing is off, start with --trace <path>." << std::endl;
                 }
-
+                break;
+            }
+            case 103: { // g
+                std::cout << "Key pressed: [G] " << key_pressed << std::endl;
+                toggle_all(streams, GRAYSCALE, !options.mosaic);
+                break;
+            }
+            case 101: { // e
+                std::cout << "Key pressed: [E] " << key_pressed << std::endl;
+                toggle_all(streams, BACKGROUND, !options.mosaic);
+                break;
+            }
+            case 109: { // m
+                std::cout << "Key pressed: [M] " << key_pressed << std::endl;
+                toggle_all(streams, MOTION, !options.mosaic);
+                break;
+            }
+            case 114: { // r
+                std::cout << "Key pressed: [R] " << key_pressed << std::endl;
+                toggle_all(streams, DENOISE, !options.mosaic);
                 break;
             }
             case 110: { // n
                 std::cout << "Key pressed: [N] " << key_pressed << std::endl;
-
-                if (tasks.find(NEGATIVE) == tasks.end()) {
-                    create_channel(channels, NEGATIVE);
-                    auto *negativeTask = new NegativeTask(*channels[NEGATIVE]);
-                    tasks[NEGATIVE] = negativeTask;
-                    negativeTask->start(*channels[MAIN]);
-
-                    std::cout << "Started Negative" << std::endl;
-                } else {
-                    stop_task(NEGATIVE, tasks);
-                }
-
+                toggle_all(streams, NEGATIVE, !options.mosaic);
                 break;
             }
             case 113: { // q
                 std::cout << "Key pressed: [Q] " << key_pressed << std::endl;
-
-                if (tasks.find(QUANTIZED) == tasks.end()) {
-                    start_quantize_task(tasks, channels);
-                } else {
-                    stop_task(QUANTIZED, tasks);
-                }
-
+                toggle_all(streams, QUANTIZED, !options.mosaic);
                 break;
             }
             case 115: { // s
                 std::cout << "Key pressed: [S] " << key_pressed << std::endl;
 
-                if (tasks.find(SOBEL_X) == tasks.end()) {
-                    start_sobel_tasks(tasks, channels);
-                } else {
-                    stop_sobel_tasks(tasks);
+                for (auto &stream: streams) {
+                    Pipeline &pipeline = stream->get_pipeline();
+                    bool has_window = !options.mosaic && stream->index == 0;
+                    if (!pipeline.is_running(SOBEL_X)) {
+                        pipeline.start(MAGNITUDE);
+                    } else {
+                        stop_task(pipeline, SOBEL_X, has_window);
+                        stop_task(pipeline, SOBEL_Y, has_window);
+                        stop_task(pipeline, MAGNITUDE, has_window);
+                    }
                 }
 
                 break;
@@ -253,5 +784,110 @@ int main() {
         }
     }
 
+    for (auto &stream: streams) {
+        stream->stop();
+    }
+    if (metrics_exporter != nullptr) {
+        metrics_exporter->stop();
+    }
+    for (auto &sink: sinks) {
+        sink->stop();
+    }
+    if (stream_server != nullptr) {
+        stream_server->stop();
+    }
+    for (auto &stream: streams) {
+        stream->get_pipeline().stop_all();
+    }
+    if (!options.trace.empty()) {
+        trace_dump(options.trace);
+    }
+
     return 0;
 }
+
+int main(int argc, char **argv) {
+    Options options;
+    int result = parse_options(argc, argv, options);
+    if (result != 0) {
+        print_usage(argv[0]);
+        return result > 0 ? 0 : 1;
+    }
+    if (options.sources.empty()) {
+        options.sources.emplace_back("0");
+    }
+    trace_enable(!options.trace.empty());
+    perf_counters_enable(options.perf_counters);
+    init_kernels(); // picks and logs the instruction set of the filters before any stage starts
+    for (auto &assignment: options.params) {
+        if (get_filter_parameters().apply(assignment) != 0) {
+            return 1;
+        }
+    }
+    ParameterConsole console(get_filter_parameters());
+    if (options.control) {
+        console.start();
+    }
+
+    // one runtime for every stream, so that their tasks share the cores fairly instead of fighting over them
+    Runtime runtime(options.workers);
+    runtime.set_deadline_scheduling(options.schedule == "edf");
+    if (options.schedule == "edf" && options.deadlines.empty()) {
+        std::cout << "No --deadline set: every stage is scheduled fairly." << std::endl;
+    }
+    // declared before the streams, so that they outlive every frame the streams hold
+    std::vector<std::unique_ptr<FrameAllocator>> frame_allocators;
+    // and the executor, which the coroutines of the tasks must not outlive
+    std::unique_ptr<StageExecutor> executor;
+    if (options.stages == "coroutines") {
+        executor = std::make_unique<StageExecutor>(options.executor_threads);
+        if (options.schedule == "edf" || options.workers > 0) {
+            std::cout << "Coroutine stages do not take worker slots, --schedule edf and --workers do not apply to "
+                      << "them: the " << executor->get_threads() << " threads of the executor bound them." << std::endl;
+        }
+        if (!options.thread_budget || options.budget_cores > 0 || options.pin_stages) {
+            std::cout << "Coroutine stages have no thread budget, --thread-budget and --pin-stages do not apply to "
+                      << "them: every executor thread runs OpenMP teams of an equal share of the cores." << std::endl;
+        }
+    }
+    // and one thread budget, so that the OpenMP teams of the stages divide the cores instead of each taking them all
+    std::unique_ptr<ThreadBudget> thread_budget;
+    if (options.thread_budget && executor == nullptr) {
+        thread_budget = std::make_unique<ThreadBudget>(options.budget_cores, options.pin_stages);
+        runtime.set_thread_budget(thread_budget.get());
+    } else if (options.pin_stages && executor == nullptr) {
+        std::cout << "--pin-stages requires the thread budget, ignored." << std::endl;
+    }
+    std::vector<std::unique_ptr<Stream>> streams;
+    for (auto &spec: options.sources) {
+        std::unique_ptr<FrameSource> source = open_source(spec, options);
+        if (options.yuv) {
+            source->set_native(true);
+        }
+        int index = static_cast<int>(streams.size());
+        streams.push_back(std::make_unique<Stream>(index, spec, std::move(source), options.yuv, &runtime));
+        if (options.frame_allocator == "arena") {
+            frame_allocators.push_back(std::make_unique<FrameAllocator>(options.huge_pages));
+            streams.back()->get_pipeline().set_allocator(frame_allocators.back().get());
+        }
+        streams.back()->get_pipeline().set_warm_stages(options.warm_stages);
+        streams.back()->get_pipeline().set_executor(executor.get());
+        streams.back()->get_pipeline().set_pull(options.evaluation == "pull");
+        for (auto &pair: options.deadlines) {
+            streams.back()->get_pipeline().set_deadline(pair.first, std::llround(pair.second * 1000));
+        }
+    }
+
+    std::unique_ptr<FrameRecorder> recorder;
+    if (!options.record.empty()) {
+        recorder = std::make_unique<FrameRecorder>(options.record);
+        if (!recorder->is_open()) {
+            return 1;
+        }
+    }
+
+    if (options.headless) {
+        return run_headless(options, streams, runtime, recorder.get());
+    }
+    return run_gui(options, streams, runtime, recorder.get());
+}
@@ -0,0 +1,673 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_PIPELINE_H
+#define VISION_CPP_PIPELINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "../constants.h"
+#include "../utils/watch_channel.h"
+#include "../utils/runtime/runtime.h"
+#include "../utils/history/frame_history.h"
+#include "../tasks/task.h"
+#include "../tasks/greyscale.h"
+#include "../tasks/negative.h"
+#include "../tasks/blur.h"
+#include "../tasks/sobel.h"
+#include "../tasks/magnitude.h"
+#include "../tasks/quantize.h"
+#include "../tasks/cartoonize.h"
+#include "../tasks/motion.h"
+#include "../tasks/background.h"
+#include "../tasks/denoise.h"
+
+/**
+ * The tasks each task reads the output of, and starts first.
+ */
+static const std::unordered_map<std::string, std::vector<std::string>> TASK_DEPENDENCIES = {
+        {MAGNITUDE,  {SOBEL_X,   SOBEL_Y}},
+        {CARTOONIZE, {MAGNITUDE, QUANTIZED}},
+        {MOTION,     {GRAYSCALE}},
+};
+
+/**
+ * The quality steps each task can take under load, in the order the quality governor takes them (see QualityStep).
+ * Only the tasks with a cheaper variant have CHEAP_VARIANT; the tasks that keep state across frames at the size of
+ * their input (a background model, the history of a channel) cannot run at half resolution. Tasks that are not listed
+ * have DEFAULT_QUALITY_STEPS.
+ */
+static const std::unordered_map<std::string, std::vector<QualityStep>> TASK_QUALITY_STEPS = {
+        {BLUR,       {CHEAP_VARIANT, HALF_RESOLUTION, SKIP_FRAMES}},
+        {MAGNITUDE,  {CHEAP_VARIANT, HALF_RESOLUTION, SKIP_FRAMES}},
+        {MOTION,     {SKIP_FRAMES}},
+        {BACKGROUND, {SKIP_FRAMES}},
+        {DENOISE,    {SKIP_FRAMES}},
+};
+static const std::vector<QualityStep> DEFAULT_QUALITY_STEPS = {HALF_RESOLUTION, SKIP_FRAMES};
+
+static const std::chrono::milliseconds DEMAND_TIMEOUT(1000); // how long a request keeps a task running when pulled
+
+/**
+ * A class that owns the channels and tasks of one filter graph.
+ * Tasks are started by name, and any task they depend on (e.g. Magnitude needs Sobel X and Y) is started first.
+ * Temporal tasks (motion, denoise) read the previous frames of their input from the history of its channel, which
+ * the pipeline creates the first time it is needed and shares between the tasks reading that channel.
+ * The pipeline has no knowledge of how the outputs are consumed, so it can be driven by the GUI or headlessly.
+ * Stopping a task joins its thread and frees it, along with the last frame of its output; with warm stages, the task
+ * is parked instead, keeping its thread and state, and starting it again resumes it. Channels and histories live as
+ * long as the pipeline, so that sinks and streams attached to them survive their task being toggled.
+ * Under pull evaluation, tasks only process a frame when their output is requested (by a display, a sink or a task
+ * reading it), and update_demand parks the tasks nobody reads and releases their last frame, so that they use no CPU
+ * and no memory until they are read again. Tasks started only because another task reads them are intermediates.
+ * Under deadline scheduling, a task has the deadline set for it, or the tightest one of the tasks that read its output,
+ * so that the whole path to an output with a deadline is scheduled ahead of the other tasks.
+ * With luma input, the grayscale and edge tasks read the LUMA channel (the Y plane of YUV frames) instead of MAIN,
+ * and the source only needs to convert frames to BGR while a task, or an output registered with
+ * set_colour_required, reads MAIN.
+ */
+class Pipeline {
+public:
+    /**
+     * A constructor that creates an empty pipeline with only the MAIN (camera) and LUMA channels.
+     * @param luma_input Whether the grayscale and edge tasks read the LUMA channel instead of MAIN.
+     * @param runtime The runtime the tasks take their slots from, or nullptr for tasks that run freely.
+     * @param stream The index of the stream the pipeline belongs to, in the runtime.
+     */
+    explicit Pipeline(bool luma_input = false, Runtime *runtime = nullptr, int stream = 0);
+
+    /**
+     * A destructor that stops every task, and frees the histories and the channels.
+     */
+    ~Pipeline();
+
+    /**
+     * A function that returns the channel with the given name, creating it if it does not exist yet.
+     * @param channel_name The name of the channel.
+     * @return A pointer to the channel.
+     */
+    WatchChannel<cv::Mat> *get_channel(const std::string &channel_name);
+
+    /**
+     * A function that returns the MAIN channel. Unlike get_channel, it is safe to call from the fetch thread.
+     * @return A pointer to the MAIN channel.
+     */
+    WatchChannel<cv::Mat> *get_source_channel();
+
+    /**
+     * A function that returns the LUMA channel. Unlike get_channel, it is safe to call from the fetch thread.
+     * @return A pointer to the LUMA channel.
+     */
+    WatchChannel<cv::Mat> *get_luma_channel();
+
+    /**
+     * A function that tells whether the grayscale and edge tasks read the LUMA channel.
+     * @return true with luma input, false otherwise.
+     */
+    bool has_luma_input() const;
+
+    /**
+     * A function that tells whether anything reads BGR frames from MAIN. Safe to call from the fetch thread.
+     * Without luma input, every task reads MAIN and this is always true.
+     * @return true if the source must feed MAIN, false otherwise.
+     */
+    bool needs_colour() const;
+
+    /**
+     * A function that registers whether something outside the pipeline (a window, a sink, a stream) reads MAIN.
+     * @param required true if MAIN is read outside the pipeline.
+     */
+    void set_colour_required(bool required);
+
+    /**
+     * A function that sets the allocator of the frames of the pipeline: the tasks started afterwards, and the
+     * fetch thread of the stream, allocate their frames with it.
+     * @param frame_allocator The allocator (see frame_allocator.h), or nullptr for OpenCV's default.
+     */
+    void set_allocator(cv::MatAllocator *frame_allocator);
+
+    /**
+     * A function that returns the allocator of the frames of the pipeline.
+     * @return The allocator, or nullptr for OpenCV's default.
+     */
+    cv::MatAllocator *get_allocator() const;
+
+    /**
+     * A function that sets whether stopped tasks are parked (kept warm, for an instant restart) or freed.
+     * Tasks already parked stay so until they are started again or the pipeline is stopped.
+     * @param warm true to park stopped tasks, false to free them.
+     */
+    void set_warm_stages(bool warm);
+
+    /**
+     * A function that makes the tasks started afterwards run as coroutines on an executor (see StageExecutor) rather
+     * than on a thread each.
+     * @param stage_executor The executor, or nullptr for a thread per task.
+     */
+    void set_executor(StageExecutor *stage_executor);
+
+    /**
+     * A function that returns the executor the tasks run on.
+     * @return The executor, or nullptr for a thread per task.
+     */
+    StageExecutor *get_executor() const;
+
+    /**
+     * A function that sets whether the tasks started afterwards only work on demand (pull evaluation), rather than on
+     * every frame of their input.
+     * @param pull_evaluation true for pull evaluation.
+     */
+    void set_pull(bool pull_evaluation);
+
+    /**
+     * A function that parks the running tasks nobody reads, and resumes the ones read again, under pull evaluation. A
+     * task is read when a sink consumes its output, its output was requested within DEMAND_TIMEOUT, or a task that is
+     * read depends on it. Call it regularly, e.g. from the main loop; it does nothing without pull evaluation.
+     */
+    void update_demand();
+
+    /**
+     * A function that tells whether a running task was only started because other tasks read it (e.g. Sobel X for
+     * Magnitude), rather than for itself.
+     * @param task_name The name of the task.
+     * @return true for an intermediate task.
+     */
+    bool is_intermediate(const std::string &task_name) const;
+
+    /**
+     * A function that returns the number of running tasks parked because nobody reads them, under pull evaluation.
+     * @return The number of idle tasks.
+     */
+    int get_idle_count() const;
+
+    /**
+     * A function that returns the number of parked tasks.
+     * @return The number of tasks that were stopped warm and not started again.
+     */
+    int get_parked_count() const;
+
+    /**
+     * A function that sets the deadline of a task under deadline scheduling (see Runtime), for the tasks started
+     * afterwards. The tasks it depends on get the same deadline, unless they have a tighter one.
+     * @param task_name The name of the task, or an empty name for every task without a deadline of its own.
+     * @param deadline The time the task has per frame from the write of its input, in microseconds, 0 for none.
+     */
+    void set_deadline(const std::string &task_name, long long deadline);
+
+    /**
+     * A function that returns the deadline a task is started with.
+     * @param task_name The name of the task.
+     * @return The time the task has per frame, in microseconds, 0 for none.
+     */
+    long long get_deadline(const std::string &task_name);
+
+    /**
+     * A function that returns the quality steps a task can take under load, see TASK_QUALITY_STEPS.
+     * @param task_name The name of the task.
+     * @return The steps, in the order they are taken.
+     */
+    const std::vector<QualityStep> &get_quality_steps(const std::string &task_name) const;
+
+    /**
+     * A function that returns the names of the tasks whose output a task reads.
+     * @param task_name The name of the task.
+     * @return The names, empty for a task that reads the source.
+     */
+    std::vector<std::string> get_dependencies(const std::string &task_name) const;
+
+    /**
+     * A function that returns the history of the channel with the given name, creating it (and the channel) if it
+     * does not exist yet. The history only records frames while a task has acquired it.
+     * @param channel_name The name of the channel.
+     * @return A pointer to the history of the channel.
+     */
+    FrameHistory *get_history(const std::string &channel_name);
+
+    /**
+     * A function that tells whether a task with the given name is currently running.
+     * @param task_name The name of the task.
+     * @return true if the task is running, false otherwise.
+     */
+    bool is_running(const std::string &task_name);
+
+    /**
+     * A function that starts the task with the given name, along with the tasks it depends on.
+     * Starting a task that is already running does nothing, and a parked one is resumed.
+     * @param task_name The name of the task (one of the names in constants.h).
+     * @return 0 if the task is running, -1 if the name is unknown.
+     */
+    int start(const std::string &task_name);
+
+    /**
+     * A function that stops the task with the given name. Tasks depending on it are left running.
+     * Without warm stages, this waits for the thread of the task to return, and frees the task.
+     * @param task_name The name of the task.
+     * @return 0 if the task was stopped, -1 if it was not running.
+     */
+    int stop(const std::string &task_name);
+
+    /**
+     * A function that stops every running and parked task, waits for their threads to return, and frees them.
+     */
+    void stop_all();
+
+    /**
+     * A function that returns the running tasks, keyed by name.
+     * @return A reference to the map of running tasks.
+     */
+    std::unordered_map<std::string, Task *> &get_tasks();
+
+private:
+    /**
+     * A function that registers a new task under its name and attaches it to the runtime and the allocator, before it
+     * is started.
+     * @param task The task.
+     */
+    void add_task(Task *task);
+
+    /**
+     * A function that starts a task and the tasks it depends on, see start, without making it one started for itself.
+     * @param task_name The name of the task.
+     * @return 0 if the task is running, -1 if the name is unknown.
+     */
+    int start_task(const std::string &task_name);
+
+    /**
+     * A function that starts the tasks a task depends on, e.g. Sobel X and Y for Magnitude.
+     * @param task_name The name of the task.
+     */
+    void start_dependencies(const std::string &task_name);
+
+    /**
+     * A function that stops a task, waits for its thread and frees it, along with the last frame of its output.
+     * @param task The task, no longer registered.
+     */
+    void free_task(Task *task);
+
+    /**
+     * A function that returns the channel a task reads its frames from: LUMA for the tasks that only need
+     * luminance when the pipeline has luma input, MAIN otherwise.
+     * @param task_name The name of the task.
+     * @return A pointer to the input channel.
+     */
+    WatchChannel<cv::Mat> *get_input_channel(const std::string &task_name);
+
+    /**
+     * A function that recomputes whether MAIN is read, after a task was started, stopped, parked or resumed.
+     */
+    void update_colour_needed();
+
+    std::unordered_map<std::string, WatchChannel<cv::Mat> *> channels; // channels of the graph, keyed by name
+    std::unordered_map<std::string, Task *> tasks; // running tasks, keyed by name
+    std::unordered_map<std::string, Task *> parked; // tasks stopped warm, keyed by name
+    std::unordered_set<std::string> started; // running tasks started for themselves, not only for other tasks
+    std::unordered_set<std::string> idle; // running tasks parked because nobody reads them, under pull evaluation
+    std::unordered_map<std::string, FrameHistory *> histories; // histories of the channels, keyed by channel name
+    std::unordered_map<std::string, long long> deadlines; // deadlines set for tasks, in microseconds, keyed by name
+    long long default_deadline = 0; // deadline of the tasks without one of their own, in microseconds
+    WatchChannel<cv::Mat> *source_channel; // the MAIN channel
+    WatchChannel<cv::Mat> *luma_channel; // the LUMA channel
+    bool luma_input; // grayscale and edge tasks read LUMA instead of MAIN
+    Runtime *runtime; // runtime the tasks take their slots from, may be nullptr
+    int stream; // index of the stream in the runtime
+    cv::MatAllocator *allocator = nullptr; // allocator of the frames of the tasks, may be nullptr
+    StageExecutor *executor = nullptr; // executor the tasks run on, nullptr for a thread per task
+    bool colour_required = false; // MAIN is read outside the pipeline
+    bool warm_stages = false; // stopped tasks are parked instead of freed
+    bool pull = false; // tasks only work when their output is requested
+    std::atomic<bool> colour_needed; // MAIN is read by a task or outside the pipeline
+};
+
+Pipeline::Pipeline(bool luma_input, Runtime *runtime, int stream)
+        : luma_input(luma_input), runtime(runtime), stream(stream), colour_needed(!luma_input) {
+    source_channel = new WatchChannel<cv::Mat>();
+    luma_channel = new WatchChannel<cv::Mat>();
+    channels[MAIN] = source_channel;
+    channels[LUMA] = luma_channel;
+}
+
+Pipeline::~Pipeline() {
+    stop_all();
+    // histories first: they unsubscribe from their channel
+    for (auto &pair: histories) {
+        delete pair.second;
+    }
+    for (auto &pair: channels) {
+        delete pair.second;
+    }
+}
+
+WatchChannel<cv::Mat> *Pipeline::get_channel(const std::string &channel_name) {
+    if (channels.find(channel_name) == channels.end()) {
+        channels[channel_name] = new WatchChannel<cv::Mat>();
+    }
+    return channels[channel_name];
+}
+
+WatchChannel<cv::Mat> *Pipeline::get_source_channel() {
+    return source_channel;
+}
+
+WatchChannel<cv::Mat> *Pipeline::get_luma_channel() {
+    return luma_channel;
+}
+
+bool Pipeline::has_luma_input() const {
+    return luma_input;
+}
+
+bool Pipeline::needs_colour() const {
+    return colour_needed;
+}
+
+void Pipeline::set_colour_required(bool required) {
+    colour_required = required;
+    update_colour_needed();
+}
+
+void Pipeline::set_allocator(cv::MatAllocator *frame_allocator) {
+    allocator = frame_allocator;
+}
+
+cv::MatAllocator *Pipeline::get_allocator() const {
+    return allocator;
+}
+
+void Pipeline::set_warm_stages(bool warm) {
+    warm_stages = warm;
+}
+
+void Pipeline::set_executor(StageExecutor *stage_executor) {
+    executor = stage_executor;
+}
+
+StageExecutor *Pipeline::get_executor() const {
+    return executor;
+}
+
+void Pipeline::set_pull(bool pull_evaluation) {
+    pull = pull_evaluation;
+}
+
+void Pipeline::update_demand() {
+    if (!pull) {
+        return;
+    }
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    std::unordered_set<std::string> read;
+    for (auto &pair: tasks) {
+        WatchChannel<cv::Mat> *output = pair.second->get_output_channel();
+        if (output->is_requested() ||
+            now - output->get_last_request() < std::chrono::nanoseconds(DEMAND_TIMEOUT).count()) {
+            read.insert(pair.first);
+        }
+    }
+    // the tasks a read task depends on are read too, even while it is parked and requests nothing
+    std::vector<std::string> pending(read.begin(), read.end());
+    while (!pending.empty()) {
+        std::string task_name = pending.back();
+        pending.pop_back();
+        for (auto &dependency: get_dependencies(task_name)) {
+            if (is_running(dependency) && read.insert(dependency).second) {
+                pending.push_back(dependency);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (auto &pair: tasks) {
+        bool is_idle = idle.count(pair.first) > 0;
+        if (read.count(pair.first) > 0 && is_idle) {
+            idle.erase(pair.first);
+            pair.second->resume();
+            changed = true;
+        } else if (read.count(pair.first) == 0 && !is_idle) {
+            idle.insert(pair.first);
+            pair.second->idle();
+            // nobody reads the last frame either
+            pair.second->get_output_channel()->clear();
+            changed = true;
+        }
+    }
+    if (changed) {
+        update_colour_needed();
+    }
+}
+
+bool Pipeline::is_intermediate(const std::string &task_name) const {
+    return tasks.find(task_name) != tasks.end() && started.find(task_name) == started.end();
+}
+
+int Pipeline::get_idle_count() const {
+    return static_cast<int>(idle.size());
+}
+
+int Pipeline::get_parked_count() const {
+    return static_cast<int>(parked.size());
+}
+
+void Pipeline::set_deadline(const std::string &task_name, long long deadline) {
+    if (task_name.empty()) {
+        default_deadline = deadline;
+    } else {
+        deadlines[task_name] = deadline;
+    }
+}
+
+long long Pipeline::get_deadline(const std::string &task_name) {
+    auto it = deadlines.find(task_name);
+    long long deadline = it != deadlines.end() ? it->second : default_deadline;
+    for (auto &pair: TASK_DEPENDENCIES) {
+        if (std::find(pair.second.begin(), pair.second.end(), task_name) == pair.second.end()) {
+            continue;
+        }
+        long long inherited = get_deadline(pair.first);
+        if (inherited > 0 && (deadline == 0 || inherited < deadline)) {
+            deadline = inherited;
+        }
+    }
+    return deadline;
+}
+
+const std::vector<QualityStep> &Pipeline::get_quality_steps(const std::string &task_name) const {
+    auto it = TASK_QUALITY_STEPS.find(task_name);
+    return it != TASK_QUALITY_STEPS.end() ? it->second : DEFAULT_QUALITY_STEPS;
+}
+
+std::vector<std::string> Pipeline::get_dependencies(const std::string &task_name) const {
+    auto it = TASK_DEPENDENCIES.find(task_name);
+    return it != TASK_DEPENDENCIES.end() ? it->second : std::vector<std::string>();
+}
+
+FrameHistory *Pipeline::get_history(const std::string &channel_name) {
+    if (histories.find(channel_name) == histories.end()) {
+        histories[channel_name] = new FrameHistory(*get_channel(channel_name));
+    }
+    return histories[channel_name];
+}
+
+void Pipeline::add_task(Task *task) {
+    task->set_runtime(runtime, stream);
+    task->set_allocator(allocator);
+    task->set_deadline(get_deadline(task->name));
+    task->set_executor(executor);
+    task->set_pull(pull);
+    tasks[task->name] = task;
+    // requested once, so that it is not parked before anything had a chance to read it
+    task->get_output_channel()->request();
+}
+
+void Pipeline::start_dependencies(const std::string &task_name) {
+    auto it = TASK_DEPENDENCIES.find(task_name);
+    if (it == TASK_DEPENDENCIES.end()) {
+        return;
+    }
+    for (auto &dependency: it->second) {
+        start_task(dependency);
+    }
+}
+
+void Pipeline::free_task(Task *task) {
+    WatchChannel<cv::Mat> *output = task->get_output_channel();
+    delete task; // stops and joins the thread
+    output->clear();
+}
+
+WatchChannel<cv::Mat> *Pipeline::get_input_channel(const std::string &task_name) {
+    if (luma_input && (task_name == GRAYSCALE || task_name == SOBEL_X || task_name == SOBEL_Y)) {
+        return luma_channel;
+    }
+    return source_channel;
+}
+
+void Pipeline::update_colour_needed() {
+    bool needed = !luma_input || colour_required;
+    for (auto &pair: tasks) {
+        if (idle.count(pair.first) > 0) {
+            continue;
+        }
+        needed = needed || pair.first == NEGATIVE || pair.first == BLUR || pair.first == QUANTIZED ||
+                 pair.first == BACKGROUND || pair.first == DENOISE;
+    }
+    colour_needed = needed;
+}
+
+bool Pipeline::is_running(const std::string &task_name) {
+    return tasks.find(task_name) != tasks.end();
+}
+
+int Pipeline::start(const std::string &task_name) {
+    int result = start_task(task_name);
+    if (result == 0) {
+        started.insert(task_name);
+    }
+    return result;
+}
+
+int Pipeline::start_task(const std::string &task_name) {
+    if (is_running(task_name)) {
+        return 0;
+    }
+    start_dependencies(task_name);
+
+    auto parked_task = parked.find(task_name);
+    if (parked_task != parked.end()) {
+        tasks[task_name] = parked_task->second;
+        parked.erase(parked_task);
+        tasks[task_name]->get_output_channel()->request();
+        tasks[task_name]->resume();
+        update_colour_needed();
+        std::cout << "Resumed " << task_name << std::endl;
+        return 0;
+    }
+
+    if (task_name == GRAYSCALE) {
+        auto *grayscaleTask = new GrayscaleTask(*get_channel(GRAYSCALE));
+        add_task(grayscaleTask);
+        grayscaleTask->start(*get_input_channel(GRAYSCALE));
+    } else if (task_name == NEGATIVE) {
+        auto *negativeTask = new NegativeTask(*get_channel(NEGATIVE));
+        add_task(negativeTask);
+        negativeTask->start(*get_channel(MAIN));
+    } else if (task_name == BLUR) {
+        auto *blurTask = new BlurTask(*get_channel(BLUR));
+        add_task(blurTask);
+        blurTask->start(*get_channel(MAIN));
+    } else if (task_name == SOBEL_X) {
+        auto *sobelXTask = new SobelXTask(*get_channel(SOBEL_X));
+        add_task(sobelXTask);
+        sobelXTask->start(*get_input_channel(SOBEL_X));
+    } else if (task_name == SOBEL_Y) {
+        auto *sobelYTask = new SobelYTask(*get_channel(SOBEL_Y));
+        add_task(sobelYTask);
+        sobelYTask->start(*get_input_channel(SOBEL_Y));
+    } else if (task_name == MAGNITUDE) {
+        auto *magnitudeTask = new MagnitudeTask(*get_channel(MAGNITUDE));
+        add_task(magnitudeTask);
+        magnitudeTask->start(*get_channel(SOBEL_X), *get_channel(SOBEL_Y));
+    } else if (task_name == QUANTIZED) {
+        auto *quantizedTask = new QuantizedTask(*get_channel(QUANTIZED));
+        add_task(quantizedTask);
+        quantizedTask->start(*get_channel(MAIN));
+    } else if (task_name == CARTOONIZE) {
+        auto *cartoonizeTask = new CartoonizeTask(*get_channel(CARTOONIZE));
+        add_task(cartoonizeTask);
+        cartoonizeTask->start(*get_channel(QUANTIZED), *get_channel(MAGNITUDE));
+    } else if (task_name == MOTION) {
+        auto *motionTask = new MotionTask(*get_channel(MOTION));
+        add_task(motionTask);
+        motionTask->start(*get_channel(GRAYSCALE), *get_history(GRAYSCALE));
+    } else if (task_name == BACKGROUND) {
+        auto *backgroundTask = new BackgroundTask(*get_channel(BACKGROUND));
+        add_task(backgroundTask);
+        backgroundTask->start(*get_channel(MAIN));
+    } else if (task_name == DENOISE) {
+        auto *denoiseTask = new DenoiseTask(*get_channel(DENOISE));
+        add_task(denoiseTask);
+        denoiseTask->start(*get_channel(MAIN), *get_history(MAIN));
+    } else {
+        std::cout << "Unknown task " << task_name << std::endl;
+        return -1;
+    }
+
+    update_colour_needed();
+    std::cout << "Started " << task_name << std::endl;
+    return 0;
+}
+
+int Pipeline::stop(const std::string &task_name) {
+    if (!is_running(task_name)) {
+        return -1;
+    }
+    Task *task = tasks[task_name];
+    tasks.erase(task_name);
+    started.erase(task_name);
+    idle.erase(task_name);
+    update_colour_needed();
+    if (warm_stages) {
+        task->park();
+        parked[task_name] = task;
+    } else {
+        free_task(task);
+    }
+
+    std::cout << "Stopped " << task_name << std::endl;
+    return 0;
+}
+
+void Pipeline::stop_all() {
+    // every thread is told to stop before any is waited for, so that they wind down together
+    for (auto &pair: tasks) {
+        pair.second->set_running(false);
+    }
+    for (auto &pair: parked) {
+        pair.second->set_running(false);
+    }
+    for (auto &pair: tasks) {
+        free_task(pair.second);
+    }
+    for (auto &pair: parked) {
+        free_task(pair.second);
+    }
+    tasks.clear();
+    parked.clear();
+    started.clear();
+    idle.clear();
+    update_colour_needed();
+}
+
+std::unordered_map<std::string, Task *> &Pipeline::get_tasks() {
+    return tasks;
+}
+
+#endif //VISION_CPP_PIPELINE_H
@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_STREAM_H
+#define VISION_CPP_STREAM_H
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+#include "pipeline.h"
+#include "../utils/memory/frame_allocator.h"
+#include "../utils/recording/frame_recorder.h"
+#include "../utils/runtime/runtime.h"
+#include "../utils/source/frame_source.h"
+#include "../utils/source/yuv.h"
+#include "../utils/trace/trace.h"
+
+/**
+ * A function that fetches frames from a source into the MAIN (and LUMA) channels of a pipeline, until it is stopped
+ * or the source ends.
+ * @param source The source of the frames.
+ * @param pipeline The pipeline fed by the source.
+ * @param fetchState The state of the fetch loop, also counting the frames fetched.
+ * @param target_fps The fetch rate in frames per second, 0 for as fast as possible.
+ * @param recorder A recorder every frame is written to, or nullptr.
+ * @param name The name of the stream, for the trace.
+ */
+void fetch_frame(FrameSource &source, Pipeline &pipeline, ProcessorState &fetchState, int target_fps,
+                 FrameRecorder *recorder, const std::string &name) {
+    trace_set_thread_name("Fetch " + name);
+    set_thread_allocator(pipeline.get_allocator());
+    auto period = std::chrono::microseconds(target_fps > 0 ? 1000000 / target_fps : 0);
+    auto next_frame = std::chrono::steady_clock::now();
+
+    while (fetchState.running) {
+        if (target_fps > 0) {
+            std::this_thread::sleep_until(next_frame);
+            // do not try to catch up in a burst if the source fell behind
+            next_frame = std::max(next_frame + period, std::chrono::steady_clock::now());
+        }
+
+        TRACE_SCOPE("fetch", fetchState.total_frames + 1);
+        auto frame_start = std::chrono::steady_clock::now();
+        cv::Mat frame;
+        {
+            TRACE_SCOPE("read source");
+            source.read(frame);
+        }
+        if (frame.empty()) {
+            if (source.end_of_stream()) {
+                std::cout << "Fetch: " << "End of stream." << std::endl;
+                fetchState.running = false;
+                return;
+            }
+            std::cout << "Fetch: " << "Failed to capture frame." << std::endl;
+            continue;
+        }
+        PixelFormat format = source.get_format();
+        if (recorder != nullptr) {
+            auto timestamp = std::chrono::steady_clock::now().time_since_epoch();
+            recorder->write(frame, std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp).count(), format);
+        }
+        if (pipeline.has_luma_input()) {
+            // a view into the frame for planar layouts, so grayscale and edges get their input for free
+            cv::Mat luma;
+            luma_view(frame, format, luma);
+            pipeline.get_luma_channel()->write(luma);
+        }
+        if (pipeline.needs_colour()) {
+            cv::Mat bgr;
+            to_bgr(frame, format, bgr);
+            pipeline.get_source_channel()->write(bgr);
+        }
+
+        auto duration = std::chrono::steady_clock::now() - frame_start;
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        fetchState.frame_time = micros;
+        fetchState.total_frame_time += micros;
+        fetchState.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        fetchState.total_frames++;
+    }
+}
+
+/**
+ * A class that ties one input source to its own filter graph: the source, the pipeline it feeds, and the thread
+ * fetching its frames. Several streams can share one runtime, which schedules their tasks fairly.
+ */
+class Stream {
+public:
+    /**
+     * A constructor that creates the pipeline of the stream and registers it with the runtime.
+     * @param index The index of the stream, in the order the sources were given.
+     * @param name The name of the stream (e.g. its source specification).
+     * @param source The source of the frames.
+     * @param luma_input Whether the grayscale and edge tasks read the Y plane of the frames (see Pipeline).
+     * @param runtime The runtime shared by the streams, or nullptr for tasks that run freely.
+     */
+    explicit Stream(int index, const std::string &name, std::unique_ptr<FrameSource> source, bool luma_input,
+                    Runtime *runtime);
+
+    /**
+     * A destructor that stops fetching frames and stops every task of the stream.
+     */
+    ~Stream();
+
+    /**
+     * A function that starts fetching frames on a thread of its own.
+     * @param target_fps The fetch rate in frames per second, 0 for as fast as possible.
+     * @param recorder A recorder every frame is written to, or nullptr.
+     */
+    void start(int target_fps, FrameRecorder *recorder);
+
+    /**
+     * A function that stops fetching frames and waits for the fetch thread. Tasks keep running.
+     */
+    void stop();
+
+    /**
+     * A function that tells whether frames are being fetched, i.e. the stream was started and its source did not end.
+     * @return true while frames are fetched, false otherwise.
+     */
+    bool is_fetching() const;
+
+    /**
+     * A function that returns the source of the stream.
+     * @return A reference to the source.
+     */
+    FrameSource &get_source();
+
+    /**
+     * A function that returns the pipeline of the stream.
+     * @return A reference to the pipeline.
+     */
+    Pipeline &get_pipeline();
+
+    /**
+     * A function that returns the state of the fetch loop, which counts the frames fetched.
+     * @return A reference to the state of the fetch loop.
+     */
+    ProcessorState &get_fetch_state();
+
+    /**
+     * The index of the stream, in the order the sources were given.
+     */
+    int index;
+
+    /**
+     * The name of the stream.
+     */
+    std::string name;
+
+private:
+    std::unique_ptr<FrameSource> source; // source of the frames
+    Pipeline pipeline; // filter graph fed by the source
+    ProcessorState fetchState; // state of the fetch loop
+    std::thread fetchThread; // thread running the fetch loop
+};
+
+Stream::Stream(int index, const std::string &name, std::unique_ptr<FrameSource> source, bool luma_input,
+               Runtime *runtime)
+        : index(index), name(name), source(std::move(source)),
+          pipeline(luma_input, runtime, runtime != nullptr ? runtime->add_stream(name) : 0) {
+    fetchState.running = false;
+}
+
+Stream::~Stream() {
+    stop();
+    pipeline.stop_all();
+}
+
+void Stream::start(int target_fps, FrameRecorder *recorder) {
+    if (fetchThread.joinable()) {
+        if (fetchState.running) {
+            return;
+        }
+        // the source ended on its own, the thread is done
+        fetchThread.join();
+    }
+    fetchState.running = true;
+    fetchState.reset();
+    fetchThread = std::thread(fetch_frame, std::ref(*source), std::ref(pipeline), std::ref(fetchState), target_fps,
+                              recorder, std::cref(name));
+}
+
+void Stream::stop() {
+    fetchState.running = false;
+    if (fetchThread.joinable()) {
+        fetchThread.join();
+    }
+}
+
+bool Stream::is_fetching() const {
+    return fetchState.running;
+}
+
+FrameSource &Stream::get_source() {
+    return *source;
+}
+
+Pipeline &Stream::get_pipeline() {
+    return pipeline;
+}
+
+ProcessorState &Stream::get_fetch_state() {
+    return fetchState;
+}
+
+#endif //VISION_CPP_STREAM_H
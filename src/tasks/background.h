@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_BACKGROUND_H
+#define VISION_CPP_BACKGROUND_H
+
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include "../utils/watch_channel.h"
+#include "../utils/processor/processor.h"
+#include "../utils/filters.h"
+#include "../utils/params/filter_parameters.h"
+#include "task.h"
+#include "../constants.h"
+
+void background_task(ParameterBlock<ThresholdParameters>::Reader &parameters, cv::Mat &model, uint64_t &model_version,
+                     WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel) {
+    cv::Mat frame;
+    uint64_t version;
+    inputChannel.read(frame, version);
+    // a frame seen twice would weigh twice in the model
+    if (frame.empty() || version == model_version) {
+        return;
+    }
+    model_version = version;
+
+    cv::Mat background;
+    // the shift only changes how fast the model follows the frames, so the model is kept when it changes
+    background_update(frame, model, background, parameters.get().value);
+    outputChannel.write(background);
+}
+
+StageTask background_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                             ProcessorState &processorState) {
+    Processor processor(BACKGROUND, &processorState);
+
+    // the model lives as long as the task: restarting the task starts a new one
+    cv::Mat model;
+    uint64_t model_version = 0;
+    ParameterBlock<ThresholdParameters>::Reader parameters(get_filter_parameters().background);
+    processor.register_callback([&parameters, &model, &model_version](WatchChannel<cv::Mat> &input,
+                                                                      WatchChannel<cv::Mat> &output) {
+        background_task(parameters, model, model_version, input, output);
+    });
+    co_await processor.run(inputChannel, outputChannel);
+}
+
+class BackgroundTask : public Task {
+public:
+    explicit BackgroundTask(WatchChannel<cv::Mat> &outputChannel) : Task(BACKGROUND, outputChannel) {}
+
+    void start(WatchChannel<cv::Mat> &input) {
+        launch(background_process(input, *outputChannel, processorState));
+    }
+};
+
+#endif //VISION_CPP_BACKGROUND_H
@@ -9,25 +9,38 @@
 #include "../utils/watch_channel.h"
 #include "../utils/filters.h"
 #include "../utils/processor/processor.h"
+#include "../utils/params/filter_parameters.h"
 
-void blur_task(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel) {
+static const std::vector<int> CHEAP_BLUR_KERNEL = {1, 2, 1}; // the kernel of the cheap variant (see CHEAP_VARIANT)
+
+void blur_task(ParameterBlock<BlurParameters>::Reader &parameters, bool cheap, WatchChannel<cv::Mat> &inputChannel,
+               WatchChannel<cv::Mat> &outputChannel) {
     cv::Mat frame;
     inputChannel.read(frame);
     if (frame.empty()) {
         return;
     }
 
+    const BlurParameters &blur = parameters.get();
     cv::Mat blur_frame;
-    blur5x5(frame, blur_frame);
+    if (cheap && blur.kernel.size() > CHEAP_BLUR_KERNEL.size()) {
+        apply_kernel(frame, blur_frame, CHEAP_BLUR_KERNEL, 1);
+    } else {
+        apply_kernel(frame, blur_frame, blur.kernel, blur.kernel_offset);
+    }
     outputChannel.write(blur_frame);
 }
 
-void blur_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
-                  ProcessorState &processorState) {
+StageTask blur_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                       ProcessorState &processorState) {
     Processor processor("Blur", &processorState);
 
-    processor.register_callback(blur_task);
-    processor.start(inputChannel, outputChannel);
+    ParameterBlock<BlurParameters>::Reader parameters(get_filter_parameters().blur);
+    processor.register_callback([&parameters, &processorState](WatchChannel<cv::Mat> &input,
+                                                               WatchChannel<cv::Mat> &output) {
+        blur_task(parameters, (processorState.quality & CHEAP_VARIANT) != 0, input, output);
+    });
+    co_await processor.run(inputChannel, outputChannel);
 }
 
 class BlurTask : public Task {
@@ -35,8 +48,7 @@ public:
     explicit BlurTask(WatchChannel<cv::Mat> &outputChannel) : Task(BLUR, outputChannel) {}
 
     void start(WatchChannel<cv::Mat> &input) {
-        processorThread = std::thread(blur_process, std::ref(input), std::ref(*outputChannel),
-                                      std::ref(processorState));
+        launch(blur_process(input, *outputChannel, processorState));
     }
 };
 
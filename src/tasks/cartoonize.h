@@ -10,11 +10,12 @@
 #include "../utils/watch_channel.h"
 #include "../utils/processor/processor.h"
 #include "../utils/filters.h"
+#include "../utils/params/filter_parameters.h"
 #include "task.h"
 #include "../constants.h"
 
-void cartoonize_task(WatchChannel<cv::Mat> &quantized_input, WatchChannel<cv::Mat> &magnitude_input,
-                     WatchChannel<cv::Mat> &output_channel) {
+void cartoonize_task(ParameterBlock<ThresholdParameters>::Reader &parameters, WatchChannel<cv::Mat> &quantized_input,
+                     WatchChannel<cv::Mat> &magnitude_input, WatchChannel<cv::Mat> &output_channel) {
     cv::Mat quantized_frame, magnitude_frame;
 
     quantized_input.read(quantized_frame);
@@ -24,16 +25,20 @@ void cartoonize_task(WatchChannel<cv::Mat> &quantized_input, WatchChannel<cv::Ma
         return;
     }
     cv::Mat output_frame;
-    cartoonize(quantized_frame, magnitude_frame, output_frame, 15);
+    cartoonize(quantized_frame, magnitude_frame, output_frame, parameters.get().value);
     output_channel.write(output_frame);
 }
 
-void cartoonize_process(WatchChannel<cv::Mat> &input_channel_1, WatchChannel<cv::Mat> &input_channel_2,
-                        WatchChannel<cv::Mat> &output_channel, ProcessorState &processorState) {
-    DualInputProcessor processor("", &processorState);
+StageTask cartoonize_process(WatchChannel<cv::Mat> &input_channel_1, WatchChannel<cv::Mat> &input_channel_2,
+                             WatchChannel<cv::Mat> &output_channel, ProcessorState &processorState) {
+    DualInputProcessor processor(CARTOONIZE, &processorState);
 
-    processor.register_callback(cartoonize_task);
-    processor.start(input_channel_1, input_channel_2, output_channel);
+    ParameterBlock<ThresholdParameters>::Reader parameters(get_filter_parameters().cartoonize);
+    processor.register_callback([&parameters](WatchChannel<cv::Mat> &quantized, WatchChannel<cv::Mat> &magnitude,
+                                              WatchChannel<cv::Mat> &output) {
+        cartoonize_task(parameters, quantized, magnitude, output);
+    });
+    co_await processor.run(input_channel_1, input_channel_2, output_channel);
 }
 
 class CartoonizeTask : public Task {
@@ -41,8 +46,7 @@ public:
     explicit CartoonizeTask(WatchChannel<cv::Mat> &outputChannel) : Task(CARTOONIZE, outputChannel) {}
 
     void start(WatchChannel<cv::Mat> &quantized_input, WatchChannel<cv::Mat> &magnitude_input) {
-        processorThread = std::thread(cartoonize_process, std::ref(quantized_input), std::ref(magnitude_input),
-                                      std::ref(*outputChannel), std::ref(processorState));
+        launch(cartoonize_process(quantized_input, magnitude_input, *outputChannel, processorState));
     }
 };
 
@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_DENOISE_H
+#define VISION_CPP_DENOISE_H
+
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include <vector>
+#include "../utils/watch_channel.h"
+#include "../utils/processor/processor.h"
+#include "../utils/history/frame_history.h"
+#include "../utils/filters.h"
+#include "../utils/params/filter_parameters.h"
+#include "task.h"
+#include "../constants.h"
+
+void denoise_task(ParameterBlock<DenoiseParameters>::Reader &parameters, FrameHistory &history, int &depth,
+                  WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel) {
+    cv::Mat frame;
+    uint64_t version;
+    inputChannel.read(frame, version);
+    if (frame.empty()) {
+        return;
+    }
+
+    const DenoiseParameters &denoise = parameters.get();
+    if (denoise.frames > depth) {
+        // a deeper history: the ring grows now, and fills with the next frames
+        history.reserve(denoise.frames);
+        depth = denoise.frames;
+    }
+
+    // the first frames average fewer frames, and frames from before a change of resolution are left out
+    std::vector<cv::Mat> previous;
+    history.get_previous(version, denoise.frames - 1, previous);
+    previous.erase(std::remove_if(previous.begin(), previous.end(), [&frame](const cv::Mat &other) {
+        return other.rows != frame.rows || other.cols != frame.cols || other.type() != frame.type();
+    }), previous.end());
+
+    cv::Mat denoised;
+    temporal_denoise(frame, previous, denoised, denoise.threshold);
+    outputChannel.write(denoised);
+}
+
+StageTask denoise_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                          FrameHistory &history, ProcessorState &processorState) {
+    Processor processor(DENOISE, &processorState);
+
+    ParameterBlock<DenoiseParameters>::Reader parameters(get_filter_parameters().denoise);
+    int depth = parameters.get().frames;
+    history.acquire(depth);
+    processor.register_callback([&parameters, &history, &depth](WatchChannel<cv::Mat> &input,
+                                                                WatchChannel<cv::Mat> &output) {
+        denoise_task(parameters, history, depth, input, output);
+    });
+    co_await processor.run(inputChannel, outputChannel);
+    history.release();
+}
+
+class DenoiseTask : public Task {
+public:
+    explicit DenoiseTask(WatchChannel<cv::Mat> &outputChannel) : Task(DENOISE, outputChannel) {}
+
+    void start(WatchChannel<cv::Mat> &input, FrameHistory &history) {
+        launch(denoise_process(input, *outputChannel, history, processorState));
+    }
+};
+
+#endif //VISION_CPP_DENOISE_H
@@ -22,12 +22,12 @@ void grayscale_task(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &
     outputChannel.write(grayscale_frame);
 }
 
-void grayscale_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
-                       ProcessorState &processorState) {
+StageTask grayscale_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                            ProcessorState &processorState) {
     Processor processor("Grayscale", &processorState);
 
     processor.register_callback(grayscale_task);
-    processor.start(inputChannel, outputChannel);
+    co_await processor.run(inputChannel, outputChannel);
 }
 
 class GrayscaleTask : public Task {
@@ -35,8 +35,7 @@ public:
     explicit GrayscaleTask(WatchChannel<cv::Mat> &outputChannel) : Task(GRAYSCALE, outputChannel) {}
 
     void start(WatchChannel<cv::Mat> &input) {
-        processorThread = std::thread(grayscale_process, std::ref(input), std::ref(*outputChannel),
-                                      std::ref(processorState));
+        launch(grayscale_process(input, *outputChannel, processorState));
     }
 };
 
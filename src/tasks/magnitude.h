@@ -9,7 +9,7 @@
 #include "../utils/watch_channel.h"
 #include "../utils/processor/processor.h"
 
-void magnitude_task(WatchChannel<cv::Mat> &input_channel_1, WatchChannel<cv::Mat> &input_channel_2,
+void magnitude_task(bool cheap, WatchChannel<cv::Mat> &input_channel_1, WatchChannel<cv::Mat> &input_channel_2,
                     WatchChannel<cv::Mat> &output_channel) {
     cv::Mat input_frame_1, input_frame_2;
 
@@ -20,16 +20,23 @@ void magnitude_task(WatchChannel<cv::Mat> &input_channel_1, WatchChannel<cv::Mat
         return;
     }
     cv::Mat output_frame;
-    magnitude(input_frame_1, input_frame_2, output_frame);
+    if (cheap) {
+        magnitude_l1(input_frame_1, input_frame_2, output_frame);
+    } else {
+        magnitude(input_frame_1, input_frame_2, output_frame);
+    }
     output_channel.write(output_frame);
 }
 
-void magnitude_process(WatchChannel<cv::Mat> &input_channel_1, WatchChannel<cv::Mat> &input_channel_2,
-                       WatchChannel<cv::Mat> &output_channel, ProcessorState &processorState) {
+StageTask magnitude_process(WatchChannel<cv::Mat> &input_channel_1, WatchChannel<cv::Mat> &input_channel_2,
+                            WatchChannel<cv::Mat> &output_channel, ProcessorState &processorState) {
     DualInputProcessor processor("Magnitude", &processorState);
 
-    processor.register_callback(magnitude_task);
-    processor.start(input_channel_1, input_channel_2, output_channel);
+    processor.register_callback([&processorState](WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2,
+                                                  WatchChannel<cv::Mat> &output) {
+        magnitude_task((processorState.quality & CHEAP_VARIANT) != 0, input_1, input_2, output);
+    });
+    co_await processor.run(input_channel_1, input_channel_2, output_channel);
 }
 
 class MagnitudeTask : public Task {
@@ -37,8 +44,7 @@ public:
     explicit MagnitudeTask(WatchChannel<cv::Mat> &outputChannel) : Task(MAGNITUDE, outputChannel) {}
 
     void start(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2) {
-        processorThread = std::thread(magnitude_process, std::ref(input_1), std::ref(input_2), std::ref(*outputChannel),
-                                      std::ref(processorState));
+        launch(magnitude_process(input_1, input_2, *outputChannel, processorState));
     }
 };
 
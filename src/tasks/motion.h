@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_MOTION_H
+#define VISION_CPP_MOTION_H
+
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include <vector>
+#include "../utils/watch_channel.h"
+#include "../utils/processor/processor.h"
+#include "../utils/history/frame_history.h"
+#include "../utils/filters.h"
+#include "../utils/params/filter_parameters.h"
+#include "task.h"
+#include "../constants.h"
+
+void motion_task(ParameterBlock<ThresholdParameters>::Reader &parameters, FrameHistory &history,
+                 WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel) {
+    cv::Mat frame;
+    uint64_t version;
+    inputChannel.read(frame, version);
+    if (frame.empty()) {
+        return;
+    }
+
+    // nothing to compare with on the first frame, nor after the source changed resolution
+    std::vector<cv::Mat> previous;
+    if (history.get_previous(version, 1, previous) == 0 || previous[0].rows != frame.rows ||
+        previous[0].cols != frame.cols || previous[0].type() != frame.type()) {
+        return;
+    }
+
+    cv::Mat mask;
+    motion_mask(frame, previous[0], mask, parameters.get().value);
+    outputChannel.write(mask);
+}
+
+StageTask motion_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                         FrameHistory &history, ProcessorState &processorState) {
+    Processor processor(MOTION, &processorState);
+
+    ParameterBlock<ThresholdParameters>::Reader parameters(get_filter_parameters().motion);
+    history.acquire(2);
+    processor.register_callback([&parameters, &history](WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output) {
+        motion_task(parameters, history, input, output);
+    });
+    co_await processor.run(inputChannel, outputChannel);
+    history.release();
+}
+
+class MotionTask : public Task {
+public:
+    explicit MotionTask(WatchChannel<cv::Mat> &outputChannel) : Task(MOTION, outputChannel) {}
+
+    void start(WatchChannel<cv::Mat> &input, FrameHistory &history) {
+        launch(motion_process(input, *outputChannel, history, processorState));
+    }
+};
+
+#endif //VISION_CPP_MOTION_H
@@ -22,12 +22,12 @@ void negative_task(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &o
     outputChannel.write(negative_frame);
 }
 
-void negative_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
-                      ProcessorState &processorState) {
+StageTask negative_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                           ProcessorState &processorState) {
     Processor processor("Negative", &processorState);
 
     processor.register_callback(negative_task);
-    processor.start(inputChannel, outputChannel);
+    co_await processor.run(inputChannel, outputChannel);
 }
 
 class NegativeTask : public Task {
@@ -35,8 +35,7 @@ public:
     explicit NegativeTask(WatchChannel<cv::Mat> &outputChannel) : Task(NEGATIVE, outputChannel) {}
 
     void start(WatchChannel<cv::Mat> &input) {
-        processorThread = std::thread(negative_process, std::ref(input), std::ref(*outputChannel),
-                                      std::ref(processorState));
+        launch(negative_process(input, *outputChannel, processorState));
     }
 };
 
@@ -10,27 +10,33 @@
 #include "../utils/watch_channel.h"
 #include "../utils/processor/processor.h"
 #include "../utils/filters.h"
+#include "../utils/params/filter_parameters.h"
 #include "task.h"
 #include "../constants.h"
 
-void quantize_task(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel) {
+void quantize_task(ParameterBlock<QuantizeParameters>::Reader &parameters, WatchChannel<cv::Mat> &inputChannel,
+                   WatchChannel<cv::Mat> &outputChannel) {
     cv::Mat frame;
     inputChannel.read(frame);
     if (frame.empty()) {
         return;
     }
 
+    const QuantizeParameters &quantize_parameters = parameters.get();
     cv::Mat output_frame;
-    quantize(frame, output_frame, 10);
+    quantize(frame, output_frame, quantize_parameters.levels, quantize_parameters.blur);
     outputChannel.write(output_frame);
 }
 
-void quantize_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
-                      ProcessorState &processorState) {
+StageTask quantize_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                           ProcessorState &processorState) {
     Processor processor("Quantize", &processorState);
 
-    processor.register_callback(quantize_task);
-    processor.start(inputChannel, outputChannel);
+    ParameterBlock<QuantizeParameters>::Reader parameters(get_filter_parameters().quantize);
+    processor.register_callback([&parameters](WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output) {
+        quantize_task(parameters, input, output);
+    });
+    co_await processor.run(inputChannel, outputChannel);
 }
 
 class QuantizedTask : public Task {
@@ -38,8 +44,7 @@ public:
     explicit QuantizedTask(WatchChannel<cv::Mat> &outputChannel) : Task(QUANTIZED, outputChannel) {}
 
     void start(WatchChannel<cv::Mat> &input) {
-        processorThread = std::thread(quantize_process, std::ref(input), std::ref(*outputChannel),
-                                      std::ref(processorState));
+        launch(quantize_process(input, *outputChannel, processorState));
     }
 };
 
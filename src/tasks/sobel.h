@@ -21,12 +21,12 @@ void sobel_x_task(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &ou
     outputChannel.write(output);
 }
 
-void sobel_x_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
-                     ProcessorState &processorState) {
+StageTask sobel_x_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                          ProcessorState &processorState) {
     Processor processor("Sobel X", &processorState);
 
     processor.register_callback(sobel_x_task);
-    processor.start(inputChannel, outputChannel);
+    co_await processor.run(inputChannel, outputChannel);
 }
 
 class SobelXTask : public Task {
@@ -34,8 +34,7 @@ public:
     explicit SobelXTask(WatchChannel<cv::Mat> &outputChannel) : Task(SOBEL_X, outputChannel) {}
 
     void start(WatchChannel<cv::Mat> &input) {
-        processorThread = std::thread(sobel_x_process, std::ref(input), std::ref(*outputChannel),
-                                      std::ref(processorState));
+        launch(sobel_x_process(input, *outputChannel, processorState));
     }
 };
 
@@ -50,12 +49,12 @@ void sobel_y_task(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &ou
     outputChannel.write(output);
 }
 
-void sobel_y_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
-                     ProcessorState &processorState) {
+StageTask sobel_y_process(WatchChannel<cv::Mat> &inputChannel, WatchChannel<cv::Mat> &outputChannel,
+                          ProcessorState &processorState) {
     Processor processor("Sobel Y", &processorState);
 
     processor.register_callback(sobel_y_task);
-    processor.start(inputChannel, outputChannel);
+    co_await processor.run(inputChannel, outputChannel);
 }
 
 class SobelYTask : public Task {
@@ -63,8 +62,7 @@ public:
     explicit SobelYTask(WatchChannel<cv::Mat> &outputChannel) : Task(SOBEL_Y, outputChannel) {}
 
     void start(WatchChannel<cv::Mat> &input) {
-        processorThread = std::thread(sobel_y_process, std::ref(input), std::ref(*outputChannel),
-                                      std::ref(processorState));
+        launch(sobel_y_process(input, *outputChannel, processorState));
     }
 };
 
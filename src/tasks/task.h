@@ -5,6 +5,9 @@
 #ifndef VISION_CPP_TASK_H
 #define VISION_CPP_TASK_H
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <opencv2/opencv.hpp>
 #include <utility>
@@ -14,6 +17,8 @@
 /**
  * A class that represents a task that can process images from watch channel(s) and send them to another watch channel.
  * It can register a callback function that defines how the images are processed and start the processing loop.
+ * The processing loop is the coroutine of a process function, run on a thread of the task's own or, with an executor,
+ * as a coroutine that only holds a thread while it processes a frame.
  */
 class Task {
 public:
@@ -25,26 +30,87 @@ public:
     Task(std::string name, WatchChannel<cv::Mat> &outputChannel);
 
     /**
-     * A destructor that destroys the Task object.
+     * A destructor that stops the processor and waits for its thread to return.
      */
     virtual ~Task();
 
     /**
-     * A function that can change the running status of the processor.
+     * A function that can change the running status of the processor. Stopping it also wakes it up if it is parked.
      * @param value A boolean value that indicates whether the processor should be running or not.
      */
     void set_running(bool value);
 
     /**
-     * A function to display its most recent output frame.
+     * A function that parks the processor of a stopped task: its thread and state are kept, but it stops iterating
+     * until resumed, and then starts with fresh statistics.
+     */
+    void park();
+
+    /**
+     * A function that parks the processor of a running task that nothing reads: it stops iterating until resumed,
+     * and its statistics carry on.
+     */
+    void idle();
+
+    /**
+     * A function that resumes a parked or idle processor.
+     */
+    void resume();
+
+    /**
+     * A function that waits for the processing loop to return, once the task has been told to stop.
+     */
+    void join();
+
+    /**
+     * A function that makes the processor take a slot from a runtime for every iteration. Must be called before start.
+     * @param runtime The runtime shared by the streams, or nullptr to run freely.
+     * @param stream The index of the stream the task belongs to, in the runtime.
+     */
+    void set_runtime(Runtime *runtime, int stream);
+
+    /**
+     * A function that makes the processor allocate its frames with the given allocator. Must be called before start.
+     * @param allocator The allocator of the pipeline, or nullptr for OpenCV's default.
+     */
+    void set_allocator(cv::MatAllocator *allocator);
+
+    /**
+     * A function that sets the time the processor has per frame under deadline scheduling (see Runtime).
+     * @param deadline The time from the write of its input, in microseconds, or 0 for a stage without a deadline.
+     */
+    void set_deadline(long long deadline);
+
+    /**
+     * A function that sets the quality steps the processor applies from its next frame (see QualityStep).
+     * @param quality The steps, as a bit mask, 0 for full quality.
+     */
+    void set_quality(int quality);
+
+    /**
+     * A function that makes the processor only work when its output is requested (see ProcessorState::pull). Must be
+     * called before start.
+     * @param pull true for pull evaluation, false to process every frame.
+     */
+    void set_pull(bool pull);
+
+    /**
+     * A function that makes the task run as a coroutine on an executor instead of a thread of its own. Must be called
+     * before start.
+     * @param executor The executor, or nullptr for a thread of its own.
+     */
+    void set_executor(StageExecutor *executor);
+
+    /**
+     * A function to display its most recent output frame. It requests the next one, for pull evaluation.
      */
     int display();
 
     /**
-     * A function that returns the state of the processor.
-     * @return A ProcessorState object that stores the state of the processor.
+     * A function that returns a consistent copy of the statistics of the processor. Safe to call from any thread.
+     * @return A StageStats object with the counters and the latency distribution of the processor.
      */
-    ProcessorState get_state();
+    StageStats get_stats();
 
     /**
      * A function that returns the output channel of the processor.
@@ -57,14 +123,34 @@ public:
      */
     std::string name;
 protected:
+    /**
+     * A function that runs the coroutine of the process function: on the executor if there is one, on a new thread
+     * otherwise.
+     * @param process The coroutine, not started.
+     */
+    void launch(StageTask process);
+
     WatchChannel<cv::Mat> *outputChannel; // output channel of the processor
     ProcessorState processorState; // state of the processor
-    std::thread processorThread; // thread that runs the processing loop
+    std::thread processorThread; // thread that runs the processing loop, without an executor
+    /**
+     * A structure that tells join when the coroutine ended. It is shared with the on_done function of the coroutine,
+     * which may still be running on an executor thread when join returns and the task is destroyed.
+     */
+    struct Completion {
+        std::mutex mutex; // protects done
+        std::condition_variable condition; // notified when the coroutine ends
+        bool done = false; // whether the coroutine ended
+    };
+
+    StageTask stage; // coroutine of the process function, destroyed by join once it ended
+    std::shared_ptr<Completion> completion; // completion of the coroutine, nullptr if it was never started
 };
 
 int Task::display() {
     cv::Mat frame;
     outputChannel->read(frame);
+    outputChannel->request();
 
     if (frame.empty()) {
         return -1;
@@ -84,18 +170,87 @@ Task::Task(std::string name, WatchChannel<cv::Mat> &outputChannel) {
 }
 
 void Task::set_running(bool value) {
-    processorState.running = value;
+    if (value) {
+        processorState.running = true;
+    } else {
+        processorState.stop();
+    }
+}
+
+void Task::park() {
+    processorState.set_parked(true, true);
+}
+
+void Task::idle() {
+    processorState.set_parked(true, false);
+}
+
+void Task::resume() {
+    processorState.set_parked(false, false);
+}
+
+void Task::join() {
+    if (processorThread.joinable()) {
+        processorThread.join();
+    }
+    if (completion != nullptr) {
+        std::unique_lock<std::mutex> lock(completion->mutex);
+        completion->condition.wait(lock, [this] { return completion->done; });
+    }
+    // suspended at its final point: the frame can go, even if on_done has not returned yet
+    stage = StageTask();
+    completion = nullptr;
+}
+
+void Task::launch(StageTask process) {
+    stage = std::move(process);
+    completion = std::make_shared<Completion>();
+    stage.set_on_done([completion = completion] {
+        std::lock_guard<std::mutex> lock(completion->mutex);
+        completion->done = true;
+        completion->condition.notify_all();
+    });
+    if (processorState.executor != nullptr) {
+        processorState.executor->schedule(stage.get_handle());
+    } else {
+        processorThread = std::thread([this] { stage.get_handle().resume(); });
+    }
+}
+
+void Task::set_runtime(Runtime *runtime, int stream) {
+    processorState.runtime = runtime;
+    processorState.stream = stream;
+}
+
+void Task::set_allocator(cv::MatAllocator *allocator) {
+    processorState.allocator = allocator;
+}
+
+void Task::set_deadline(long long deadline) {
+    processorState.deadline = deadline;
+}
+
+void Task::set_quality(int quality) {
+    processorState.quality = quality;
+}
+
+void Task::set_pull(bool pull) {
+    processorState.pull = pull;
+}
+
+void Task::set_executor(StageExecutor *executor) {
+    processorState.executor = executor;
 }
 
-ProcessorState Task::get_state() {
-    return processorState;
+StageStats Task::get_stats() {
+    return processorState.snapshot();
 }
 
 
 Task::~Task() {
-    std::cout << "Destroying task " << name << std::endl;
-    cv::destroyWindow(name);
-    processorState.running = false;
+    // the window, if any, is closed by whoever opened it: there may be no GUI at all
+    set_running(false);
+    join();
 }
 
 #endif //VISION_CPP_TASK_H
@@ -0,0 +1,707 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+// Benchmarks every function of filters.h and kernels.h across resolutions, channel counts, OpenMP thread counts and
+// the instruction sets the kernels are compiled for (--isa, see simd/dispatch.h; by default the one picked at startup).
+// Inputs are synthetic frames (the "busy" scene), so every run measures the same pixels. Each case runs until it
+// has been timed for --min-time seconds, and reports its throughput in megapixels per second and the bytes it
+// moves per pixel. Results are printed as a table and can be written as JSON, to diff runs between releases, and
+// compared with the JSON of a previous run: a case slower than its baseline by more than --margin fails the run.
+//     bench [--filters <list>] [--resolutions <list>] [--channels <list>] [--threads <list>] [--isa <list>|all]
+//           [--input <source>] [--min-time <s>] [--json <path>] [--baseline <path> [--margin <percent>]]
+//
+// With --verify, nothing is timed: every case is checked against its scalar reference (reference.h) at every
+// thread count and with every supported instruction set, and, with --golden, against the outputs a previous build saved with --save-golden. Outputs must
+// match exactly, unless the case declares a tolerance. The run fails if any output differs, so an optimised
+// rewrite is accepted only once it reproduces the behaviour of the code it replaces, on synthetic and recorded frames:
+//     bench --verify [--isa <list>] [--golden <dir>] [--save-golden <dir>] [--input synthetic:<scene>|replay:<path>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "../utils/filters.h"
+#include "../utils/kernels.h"
+#include "../utils/recording/replay_source.h"
+#include "../utils/simd/dispatch.h"
+#include "../utils/source/synthetic_source.h"
+#include "reference.h"
+
+/**
+ * The frames a case can read. Gradients, magnitude and quantized frames are computed once per resolution and
+ * channel count, from the synthetic frame, and so are the previous frames of the temporal filters: the frame moved
+ * right by 2 and 4 pixels.
+ */
+struct BenchInputs {
+    cv::Mat frame;
+    cv::Mat previous;
+    cv::Mat older;
+    cv::Mat sobel_x;
+    cv::Mat sobel_y;
+    cv::Mat magnitude;
+    cv::Mat quantized;
+};
+
+/**
+ * One benchmarked function.
+ */
+struct BenchCase {
+    std::string name; // name of the function
+    std::vector<int> channels; // channel counts of the input frame the function supports
+    std::vector<cv::Mat BenchInputs::*> reads; // the inputs the function reads
+    int intermediate_passes; // full frames written and read back inside the function (e.g. separable kernels)
+    std::function<void(BenchInputs &inputs, cv::Mat &output)> run; // runs the function once
+    std::function<void(BenchInputs &inputs, cv::Mat &output)> reference; // runs the scalar reference
+    int tolerance; // largest difference allowed between a pixel and its reference, 0 for an exact match
+};
+
+/**
+ * The result of one case at one resolution, channel count, thread count and instruction set.
+ */
+struct BenchResult {
+    std::string name;
+    cv::Size size;
+    int channels;
+    int threads;
+    std::string isa;
+    long long iterations;
+    double mean_ms;
+    double min_ms;
+    double median_ms;
+    double megapixels_per_second;
+    double bytes_per_pixel;
+    double gigabytes_per_second;
+};
+
+/**
+ * The outcome of comparing an output with the expected one.
+ */
+struct Comparison {
+    bool same_shape = false; // whether the sizes and types match
+    double max_difference = 0; // largest difference between two pixels
+    long long mismatched = 0; // values (pixel channels) that differ at all
+};
+
+static std::vector<int> KERNEL_3 = {1, 2, 1};
+static std::vector<int> KERNEL_5 = {2, 4, 6, 4, 2};
+static std::vector<int> SOBEL = {-1, 0, +1};
+
+static std::vector<BenchCase> make_cases() {
+    // an output of the right type, for the kernels that write into a pre-allocated frame
+    auto prepare = [](const cv::Mat &input, cv::Mat &output) {
+        if (output.size() != input.size() || output.type() != input.type()) {
+            output = cv::Mat::zeros(input.rows, input.cols, input.type());
+        }
+    };
+
+    return {
+            {"grayscale", {3}, {&BenchInputs::frame}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { grayscale(in.frame, out); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_grayscale(in.frame, out); }, 1},
+            {"negative", {1, 3}, {&BenchInputs::frame}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { negative(in.frame, out); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_negative(in.frame, out); }, 0},
+            {"blur5x5", {1, 3}, {&BenchInputs::frame}, 1,
+                    [](BenchInputs &in, cv::Mat &out) { blur5x5(in.frame, out); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_kernel(in.frame, out, KERNEL_5, 2); }, 0},
+            {"sobel_x", {1, 3}, {&BenchInputs::frame}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { sobel_x(in.frame, out); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_partial_kernel_col(in.frame, out, SOBEL, 1); }, 0},
+            {"sobel_y", {1, 3}, {&BenchInputs::frame}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { sobel_y(in.frame, out); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_partial_kernel_row(in.frame, out, SOBEL, 1); }, 0},
+            {"magnitude", {1, 3}, {&BenchInputs::sobel_x, &BenchInputs::sobel_y}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { magnitude(in.sobel_x, in.sobel_y, out); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_magnitude(in.sobel_x, in.sobel_y, out); }, 0},
+            {"magnitude_l1", {1, 3}, {&BenchInputs::sobel_x, &BenchInputs::sobel_y}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { magnitude_l1(in.sobel_x, in.sobel_y, out); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_magnitude_l1(in.sobel_x, in.sobel_y, out); }, 0},
+            {"quantize", {3}, {&BenchInputs::frame}, 1,
+                    [](BenchInputs &in, cv::Mat &out) {
+                        cv::Mat input = in.frame; // quantize replaces its input with the blurred frame
+                        quantize(input, out, 8);
+                    },
+                    [](BenchInputs &in, cv::Mat &out) { reference_quantize(in.frame, out, 8); }, 0},
+            {"cartoonize", {3}, {&BenchInputs::quantized, &BenchInputs::magnitude}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { cartoonize(in.quantized, in.magnitude, out, 50); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_cartoonize(in.quantized, in.magnitude, out, 50); }, 0},
+            {"motion_mask", {1}, {&BenchInputs::frame, &BenchInputs::previous}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { motion_mask(in.frame, in.previous, out, 25); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_motion_mask(in.frame, in.previous, out, 25); }, 0},
+            {"background_update", {1, 3}, {&BenchInputs::frame}, 0,
+                    [](BenchInputs &in, cv::Mat &out) {
+                        // a fresh model each run, so that every run computes the same output; only the second
+                        // update is a steady-state one
+                        cv::Mat model;
+                        background_update(in.previous, model, out, 5);
+                        background_update(in.frame, model, out, 5);
+                    },
+                    [](BenchInputs &in, cv::Mat &out) { reference_background({in.previous, in.frame}, out, 5); }, 0},
+            {"temporal_denoise", {1, 3}, {&BenchInputs::frame, &BenchInputs::previous, &BenchInputs::older}, 0,
+                    [](BenchInputs &in, cv::Mat &out) { temporal_denoise(in.frame, {in.previous, in.older}, out, 20); },
+                    [](BenchInputs &in, cv::Mat &out) {
+                        reference_temporal_denoise(in.frame, {in.previous, in.older}, out, 20);
+                    }, 0},
+            {"apply_partial_kernel_row", {1, 3}, {&BenchInputs::frame}, 0,
+                    [prepare](BenchInputs &in, cv::Mat &out) {
+                        prepare(in.frame, out);
+                        apply_partial_kernel_row(in.frame, out, KERNEL_3, 1);
+                    },
+                    [](BenchInputs &in, cv::Mat &out) { reference_partial_kernel_row(in.frame, out, KERNEL_3, 1); }, 0},
+            {"apply_partial_kernel_col", {1, 3}, {&BenchInputs::frame}, 0,
+                    [prepare](BenchInputs &in, cv::Mat &out) {
+                        prepare(in.frame, out);
+                        apply_partial_kernel_col(in.frame, out, KERNEL_3, 1);
+                    },
+                    [](BenchInputs &in, cv::Mat &out) { reference_partial_kernel_col(in.frame, out, KERNEL_3, 1); }, 0},
+            {"apply_kernel", {1, 3}, {&BenchInputs::frame}, 1,
+                    [](BenchInputs &in, cv::Mat &out) { apply_kernel(in.frame, out, KERNEL_5, 2); },
+                    [](BenchInputs &in, cv::Mat &out) { reference_kernel(in.frame, out, KERNEL_5, 2); }, 0},
+    };
+}
+
+/**
+ * Reads the frame the inputs are made from: the first frame of a synthetic scene at the given size, or the first frame
+ * of a raw recording, scaled to it.
+ * @return 0 on success, -1 if the source is unknown or the recording can't be read.
+ */
+static int read_source_frame(const std::string &input, cv::Size size, cv::Mat &frame) {
+    if (input.starts_with("synthetic:")) {
+        SyntheticSource source(input.substr(10), size, 0);
+        return source.read(frame);
+    }
+    if (input.starts_with("replay:")) {
+        ReplaySource source(input.substr(7), false, false);
+        if (source.read(frame) != 0) {
+            std::cout << "Failed to read a frame from " << input.substr(7) << "." << std::endl;
+            return -1;
+        }
+        if (frame.size() != size) {
+            cv::resize(frame, frame, size, 0, 0, cv::INTER_AREA);
+        }
+        return 0;
+    }
+    std::cout << "Unknown input: " << input << std::endl;
+    return -1;
+}
+
+/**
+ * Returns a frame moved right by the given number of pixels, the left column repeated.
+ */
+static cv::Mat shift_frame(const cv::Mat &frame, int offset) {
+    cv::Mat shifted;
+    cv::copyMakeBorder(frame(cv::Rect(0, 0, frame.cols - offset, frame.rows)), shifted, 0, 0, offset, 0,
+                       cv::BORDER_REPLICATE);
+    return shifted;
+}
+
+static BenchInputs make_inputs(const cv::Mat &source_frame, int channels) {
+    BenchInputs inputs;
+    inputs.frame = source_frame.clone();
+    if (channels == 1) {
+        cv::cvtColor(inputs.frame, inputs.frame, cv::COLOR_BGR2GRAY);
+    }
+    inputs.previous = shift_frame(inputs.frame, 2);
+    inputs.older = shift_frame(inputs.frame, 4);
+
+    sobel_x(inputs.frame, inputs.sobel_x);
+    sobel_y(inputs.frame, inputs.sobel_y);
+    magnitude(inputs.sobel_x, inputs.sobel_y, inputs.magnitude);
+    if (channels == 3) {
+        cv::Mat input = inputs.frame;
+        quantize(input, inputs.quantized, 8);
+    }
+    return inputs;
+}
+
+static BenchResult run_case(BenchCase &bench_case, BenchInputs &inputs, int threads, double min_time) {
+    cv::Mat output;
+    bench_case.run(inputs, output); // warm-up: allocations, page faults, OpenMP pool
+
+    std::vector<double> times;
+    double total = 0;
+    while (total < min_time || times.size() < 3) {
+        auto start = std::chrono::steady_clock::now();
+        bench_case.run(inputs, output);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        times.push_back(elapsed);
+        total += elapsed;
+    }
+    std::sort(times.begin(), times.end());
+
+    double pixels = static_cast<double>(inputs.frame.total());
+    double bytes = static_cast<double>(output.total() * output.elemSize());
+    for (auto input: bench_case.reads) {
+        const cv::Mat &mat = inputs.*input;
+        bytes += static_cast<double>(mat.total() * mat.elemSize());
+    }
+    bytes += 2.0 * bench_case.intermediate_passes * static_cast<double>(inputs.frame.total() * inputs.frame.elemSize());
+
+    BenchResult result;
+    result.name = bench_case.name;
+    result.size = inputs.frame.size();
+    result.channels = inputs.frame.channels();
+    result.threads = threads;
+    result.isa = isa_name(get_isa());
+    result.iterations = static_cast<long long>(times.size());
+    result.mean_ms = total / static_cast<double>(times.size()) * 1000;
+    result.min_ms = times.front() * 1000;
+    result.median_ms = times[times.size() / 2] * 1000;
+    result.megapixels_per_second = pixels / (result.median_ms / 1000) / 1e6;
+    result.bytes_per_pixel = bytes / pixels;
+    result.gigabytes_per_second = bytes / (result.median_ms / 1000) / 1e9;
+    return result;
+}
+
+static Comparison compare(const cv::Mat &output, const cv::Mat &expected) {
+    Comparison comparison;
+    if (output.size() != expected.size() || output.type() != expected.type()) {
+        return comparison;
+    }
+    comparison.same_shape = true;
+    cv::Mat difference;
+    cv::absdiff(output, expected, difference);
+    comparison.max_difference = cv::norm(difference, cv::NORM_INF);
+    comparison.mismatched = cv::countNonZero(difference.reshape(1));
+    return comparison;
+}
+
+static std::string golden_path(const std::string &directory, const std::string &name, const cv::Mat &input) {
+    std::stringstream path;
+    path << directory << "/" << name << "_" << input.cols << "x" << input.rows << "_" << input.channels() << ".mat";
+    return path.str();
+}
+
+/**
+ * Writes a matrix as its rows, columns and type (32-bit integers) followed by its pixels, row by row.
+ */
+static int write_golden(const std::string &path, const cv::Mat &mat) {
+    std::ofstream file(path, std::ios::binary);
+    int32_t header[3] = {mat.rows, mat.cols, mat.type()};
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (int row = 0; row < mat.rows; row++) {
+        file.write(reinterpret_cast<const char *>(mat.ptr(row)), static_cast<std::streamsize>(mat.cols * mat.elemSize()));
+    }
+    if (!file) {
+        std::cout << "Failed to write " << path << "." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+static int read_golden(const std::string &path, cv::Mat &mat) {
+    std::ifstream file(path, std::ios::binary);
+    int32_t header[3];
+    if (!file.read(reinterpret_cast<char *>(header), sizeof(header))) {
+        return -1;
+    }
+    mat.create(header[0], header[1], header[2]);
+    for (int row = 0; row < mat.rows; row++) {
+        if (!file.read(reinterpret_cast<char *>(mat.ptr(row)), static_cast<std::streamsize>(mat.cols * mat.elemSize()))) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void print_comparison(const BenchCase &bench_case, const cv::Mat &input, const std::string &variant,
+                             const Comparison &comparison, bool passed) {
+    std::stringstream size_name;
+    size_name << input.cols << "x" << input.rows;
+    std::cout << std::left << std::setw(26) << bench_case.name << std::setw(11) << size_name.str() << std::setw(4)
+              << input.channels() << std::setw(22) << variant << std::right;
+    if (!comparison.same_shape) {
+        std::cout << std::setw(10) << "-" << std::setw(12) << "-" << "  FAIL (size or type differs)" << std::endl;
+        return;
+    }
+    std::cout << std::setw(10) << comparison.max_difference << std::setw(12) << comparison.mismatched
+              << (passed ? "  ok" : "  FAIL") << std::endl;
+}
+
+/**
+ * Checks every selected case against its reference at every thread count and instruction set, and against the
+ * golden outputs.
+ * @return The number of failed comparisons.
+ */
+static int verify_case(BenchCase &bench_case, BenchInputs &inputs, const std::vector<int> &thread_counts,
+                       const std::vector<Isa> &isas, const std::string &golden, const std::string &save_golden) {
+    int failures = 0;
+    cv::Mat expected;
+    bench_case.reference(inputs, expected);
+
+    cv::Mat first_output;
+    for (Isa isa: isas) {
+        set_isa(isa);
+        for (int threads: thread_counts) {
+#ifdef _OPENMP
+            omp_set_num_threads(threads);
+#endif
+            cv::Mat output;
+            bench_case.run(inputs, output);
+            Comparison comparison = compare(output, expected);
+            bool passed = comparison.same_shape && comparison.max_difference <= bench_case.tolerance;
+            std::string variant = "reference/" + std::string(isa_name(isa)) + "/" + std::to_string(threads) + "t";
+            print_comparison(bench_case, inputs.frame, variant, comparison, passed);
+            failures += passed ? 0 : 1;
+            if (first_output.empty()) {
+                first_output = output;
+            }
+        }
+    }
+
+    if (!golden.empty()) {
+        cv::Mat golden_output;
+        std::string path = golden_path(golden, bench_case.name, inputs.frame);
+        if (read_golden(path, golden_output) != 0) {
+            std::cout << "No golden output " << path << ", skipped." << std::endl;
+        } else {
+            // golden outputs were produced by the code under test itself, so they must match exactly
+            Comparison comparison = compare(first_output, golden_output);
+            bool passed = comparison.same_shape && comparison.max_difference == 0;
+            print_comparison(bench_case, inputs.frame, "golden", comparison, passed);
+            failures += passed ? 0 : 1;
+        }
+    }
+    if (!save_golden.empty() && write_golden(golden_path(save_golden, bench_case.name, inputs.frame), first_output) != 0) {
+        failures++;
+    }
+    return failures;
+}
+
+/**
+ * Reads the median times of a JSON file written with --json, keyed by case, size, channels, threads and instruction
+ * set. Files written before instruction sets were recorded count as "baseline".
+ * The file is read line by line, since write_json writes one result per line.
+ * Fails if the file cannot be read or holds no result, so that a mistyped path does not pass every case.
+ */
+static int read_baseline(const std::string &path, std::map<std::string, double> &baseline) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cout << "Failed to read " << path << "." << std::endl;
+        return -1;
+    }
+
+    auto field = [](const std::string &line, const std::string &key) {
+        size_t start = line.find("\"" + key + "\": ");
+        if (start == std::string::npos) {
+            return std::string();
+        }
+        start += key.size() + 4;
+        size_t end = line.find_first_of(",}", start);
+        std::string value = line.substr(start, end - start);
+        value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+        return value;
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string median = field(line, "median_ms");
+        if (median.empty()) {
+            continue;
+        }
+        std::string isa = field(line, "isa");
+        std::string key = field(line, "name") + " " + field(line, "width") + "x" + field(line, "height") + " " +
+                          field(line, "channels") + " " + field(line, "threads") + " " + (isa.empty() ? "baseline" : isa);
+        try {
+            baseline[key] = std::stod(median);
+        } catch (const std::exception &) {
+            std::cout << "Invalid median in " << path << ": " << median << std::endl;
+            return -1;
+        }
+    }
+    if (baseline.empty()) {
+        std::cout << "No results in " << path << "." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+static std::string baseline_key(const BenchResult &result) {
+    std::stringstream key;
+    key << result.name << " " << result.size.width << "x" << result.size.height << " " << result.channels << " "
+        << result.threads << " " << result.isa;
+    return key.str();
+}
+
+static int write_json(const std::string &path, const std::vector<BenchResult> &results, double min_time) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cout << "Failed to write " << path << "." << std::endl;
+        return -1;
+    }
+
+    file << std::fixed << std::setprecision(4);
+    file << "{\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef _OPENMP
+    file << "  \"openmp\": true,\n";
+#else
+    file << "  \"openmp\": false,\n";
+#endif
+    file << "  \"min_time\": " << min_time << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        file << "    {\"name\": \"" << r.name << "\", \"width\": " << r.size.width << ", \"height\": " << r.size.height
+             << ", \"channels\": " << r.channels << ", \"threads\": " << r.threads << ", \"isa\": \"" << r.isa
+             << "\", \"iterations\": "
+             << r.iterations << ", \"mean_ms\": " << r.mean_ms << ", \"min_ms\": " << r.min_ms
+             << ", \"median_ms\": " << r.median_ms << ", \"megapixels_per_second\": " << r.megapixels_per_second
+             << ", \"bytes_per_pixel\": " << r.bytes_per_pixel << ", \"gigabytes_per_second\": "
+             << r.gigabytes_per_second << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return 0;
+}
+
+static std::vector<std::string> split(const std::string &value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static int parse_resolution(const std::string &name, cv::Size &size) {
+    if (name == "vga") {
+        size = cv::Size(640, 480);
+    } else if (name == "720p") {
+        size = cv::Size(1280, 720);
+    } else if (name == "1080p") {
+        size = cv::Size(1920, 1080);
+    } else if (name == "4k") {
+        size = cv::Size(3840, 2160);
+    } else if (name == "8k") {
+        size = cv::Size(7680, 4320);
+    } else if (name.find('x') != std::string::npos) {
+        size = cv::Size(std::stoi(name.substr(0, name.find('x'))), std::stoi(name.substr(name.find('x') + 1)));
+    } else {
+        std::cout << "Unknown resolution: " << name << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+static void print_usage(const std::string &program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << "  --filters <list>      Functions to run (default: all)" << std::endl
+              << "  --resolutions <list>  vga, 720p, 1080p, 4k, 8k or WxH (default: all five, or vga, 1080p and" << std::endl
+              << "                        an odd 333x199 with --verify)" << std::endl
+              << "  --channels <list>     Channel counts of the input: 1, 3 (default: both)" << std::endl
+              << "  --threads <list>      OpenMP thread counts (default: 1 and every hardware thread)" << std::endl
+              << "  --isa <list>|all      Kernel instruction sets: baseline, sse4, avx2, avx512 (default: the one" << std::endl
+              << "                        picked at startup, or all the supported ones with --verify)" << std::endl
+              << "  --input <source>      synthetic:<scene> or replay:<raw recording> (default: synthetic:busy)" << std::endl
+              << "  --min-time <s>        Time spent on each case (default: 0.5)" << std::endl
+              << "  --json <path>         Write the results as JSON" << std::endl
+              << "  --baseline <path>     Fail if a case is slower than in this JSON by more than the margin" << std::endl
+              << "  --margin <percent>    Slowdown allowed against the baseline (default: 10)" << std::endl
+              << "  --verify              Check outputs against the scalar references instead of timing" << std::endl
+              << "  --golden <dir>        With --verify, also check outputs against the ones saved in <dir>" << std::endl
+              << "  --save-golden <dir>   With --verify, save the outputs to <dir>" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> filters;
+    std::vector<std::string> resolutions;
+    std::vector<int> channel_counts = {1, 3};
+    int hardware_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> thread_counts = {1};
+    if (hardware_threads > 1) {
+        thread_counts.push_back(hardware_threads);
+    }
+    std::string input = "synthetic:busy";
+    double min_time = 0.5;
+    std::string json_path;
+    std::string baseline_path;
+    double margin = 10;
+    bool verify = false;
+    std::string golden;
+    std::string save_golden;
+    std::vector<Isa> isas;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--verify") {
+            verify = true;
+            continue;
+        }
+        if (arg == "-h" || arg == "--help" || i + 1 >= argc) {
+            print_usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--filters") {
+                filters = split(value);
+            } else if (arg == "--resolutions") {
+                resolutions = split(value);
+            } else if (arg == "--channels") {
+                channel_counts.clear();
+                for (auto &item: split(value)) {
+                    channel_counts.push_back(std::stoi(item));
+                }
+            } else if (arg == "--threads") {
+                thread_counts.clear();
+                for (auto &item: split(value)) {
+                    thread_counts.push_back(std::max(1, std::stoi(item)));
+                }
+            } else if (arg == "--isa") {
+                std::vector<Isa> supported = supported_isas();
+                isas = value == "all" ? supported : std::vector<Isa>();
+                for (auto &item: value == "all" ? std::vector<std::string>() : split(value)) {
+                    Isa isa;
+                    if (parse_isa(item, isa) != 0) {
+                        std::cout << "Unknown instruction set: " << item << std::endl;
+                        return 1;
+                    }
+                    if (std::find(supported.begin(), supported.end(), isa) == supported.end()) {
+                        std::cout << "Instruction set " << item << " is not supported by this CPU or build." << std::endl;
+                        return 1;
+                    }
+                    isas.push_back(isa);
+                }
+            } else if (arg == "--input") {
+                input = value;
+            } else if (arg == "--min-time") {
+                min_time = std::stod(value);
+            } else if (arg == "--json") {
+                json_path = value;
+            } else if (arg == "--baseline") {
+                baseline_path = value;
+            } else if (arg == "--margin") {
+                margin = std::stod(value);
+            } else if (arg == "--golden") {
+                golden = value;
+            } else if (arg == "--save-golden") {
+                save_golden = value;
+            } else {
+                std::cout << "Unknown option: " << arg << std::endl;
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception &) {
+            std::cout << "Invalid value for " << arg << ": " << value << std::endl;
+            return 1;
+        }
+    }
+    if (resolutions.empty()) {
+        // an odd size leaves a remainder after any vector width, so that the tails of vectorised loops are checked
+        resolutions = verify ? std::vector<std::string>{"vga", "1080p", "333x199"} :
+                      std::vector<std::string>{"vga", "720p", "1080p", "4k", "8k"};
+    }
+    init_kernels();
+    if (isas.empty()) {
+        isas = verify ? supported_isas() : std::vector<Isa>{get_isa()};
+    }
+    std::map<std::string, double> baseline;
+    if (!baseline_path.empty() && read_baseline(baseline_path, baseline) != 0) {
+        return 1;
+    }
+    std::error_code error;
+    if (!save_golden.empty() && !std::filesystem::is_directory(save_golden) &&
+        !std::filesystem::create_directories(save_golden, error)) {
+        std::cout << "Failed to create " << save_golden << ": " << error.message() << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchCase> cases = make_cases();
+    std::vector<BenchResult> results;
+    int failures = 0;
+    int compared = 0; // cases found in the baseline
+    std::cout << std::fixed << std::setprecision(2);
+    if (verify) {
+        std::cout << std::left << std::setw(26) << "function" << std::setw(11) << "size" << std::setw(4) << "ch"
+                  << std::setw(22) << "against" << std::right << std::setw(10) << "max diff" << std::setw(12)
+                  << "mismatched" << std::endl;
+    } else {
+        std::cout << std::left << std::setw(26) << "function" << std::setw(11) << "size" << std::setw(4) << "ch"
+                  << std::setw(4) << "thr" << std::setw(9) << "isa" << std::right << std::setw(11) << "median ms" << std::setw(11) << "MP/s"
+                  << std::setw(9) << "B/px" << std::setw(9) << "GB/s" << std::endl;
+    }
+
+    for (auto &resolution: resolutions) {
+        cv::Size size;
+        if (parse_resolution(resolution, size) != 0) {
+            return 1;
+        }
+        cv::Mat source_frame;
+        if (read_source_frame(input, size, source_frame) != 0) {
+            return 1;
+        }
+        for (int channels: channel_counts) {
+            BenchInputs inputs = make_inputs(source_frame, channels);
+            for (auto &bench_case: cases) {
+                if (!filters.empty() && std::find(filters.begin(), filters.end(), bench_case.name) == filters.end()) {
+                    continue;
+                }
+                if (std::find(bench_case.channels.begin(), bench_case.channels.end(), channels) ==
+                    bench_case.channels.end()) {
+                    continue;
+                }
+                if (verify) {
+                    failures += verify_case(bench_case, inputs, thread_counts, isas, golden, save_golden);
+                    continue;
+                }
+                for (Isa isa: isas) {
+                    set_isa(isa);
+                    for (int threads: thread_counts) {
+#ifdef _OPENMP
+                        omp_set_num_threads(threads);
+#endif
+                        BenchResult result = run_case(bench_case, inputs, threads, min_time);
+                        std::stringstream size_name;
+                        size_name << result.size.width << "x" << result.size.height;
+                        std::cout << std::left << std::setw(26) << result.name << std::setw(11) << size_name.str()
+                                  << std::setw(4) << result.channels << std::setw(4) << result.threads << std::setw(9)
+                                  << result.isa << std::right << std::setw(11) << result.median_ms << std::setw(11)
+                                  << result.megapixels_per_second << std::setw(9) << result.bytes_per_pixel
+                                  << std::setw(9) << result.gigabytes_per_second;
+                        auto it = baseline.find(baseline_key(result));
+                        if (it != baseline.end()) {
+                            double change = (result.median_ms / it->second - 1) * 100;
+                            bool slower = change > margin;
+                            std::cout << "  " << std::showpos << change << std::noshowpos << "%"
+                                      << (slower ? " SLOWER" : "");
+                            failures += slower ? 1 : 0;
+                            compared++;
+                        }
+                        std::cout << std::endl;
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+    }
+
+    if (!json_path.empty() && write_json(json_path, results, min_time) != 0) {
+        return 1;
+    }
+    if (!baseline.empty() && compared == 0) {
+        std::cout << "None of the cases run are in the baseline " << baseline_path << "." << std::endl;
+        return 1;
+    }
+    if (failures > 0) {
+        std::cout << failures << (verify ? " outputs differ" : " cases slower than the baseline") << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_REFERENCE_H
+#define VISION_CPP_REFERENCE_H
+
+#include <cmath>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Scalar reference implementations of the functions of filters.h and kernels.h, for bench --verify.
+// They are written for clarity rather than speed (single-threaded, one pixel and one channel at a time, plain pointer
+// arithmetic), and spell out every rounding, saturation and border rule of the original functions, so that any
+// rewrite of those (vectorised, fused, reordered for OpenMP) can be checked against them pixel by pixel.
+// Keep them unoptimised: they are only useful as long as they stay obviously correct.
+
+/**
+ * Returns the index of the neighbour of a pixel, with the borders reflected without repeating the edge pixel
+ * (-1 -> 1, max -> max - 2), like get_valid_index.
+ * @param index The index of the pixel.
+ * @param offset The offset of the neighbour.
+ * @param max The number of pixels along the axis.
+ * @return The index of the neighbour, within [0, max).
+ */
+int reference_reflect(int index, int offset, int max) {
+    int result = index + offset;
+    if (result < 0) {
+        return -result;
+    }
+    if (result >= max) {
+        return 2 * max - result - 1;
+    }
+    return result;
+}
+
+/**
+ * Reference of grayscale for 3-channel frames: the BT.601 weights in 14-bit fixed point, rounded, which is how
+ * OpenCV converts 8-bit BGR. A single-channel frame is passed through.
+ */
+void reference_grayscale(const cv::Mat &input, cv::Mat &output) {
+    if (input.channels() == 1) {
+        output = input.clone();
+        return;
+    }
+    output = cv::Mat::zeros(input.rows, input.cols, CV_8UC1);
+    for (int row = 0; row < input.rows; row++) {
+        const uchar *input_row = input.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int col = 0; col < input.cols; col++) {
+            const uchar *pixel = input_row + col * 3;
+            output_row[col] = static_cast<uchar>((pixel[0] * 1868 + pixel[1] * 9617 + pixel[2] * 4899 + (1 << 13)) >> 14);
+        }
+    }
+}
+
+/**
+ * Reference of negative: every value subtracted from 255.
+ */
+void reference_negative(const cv::Mat &input, cv::Mat &output) {
+    output = cv::Mat::zeros(input.rows, input.cols, input.type());
+    for (int row = 0; row < input.rows; row++) {
+        const uchar *input_row = input.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int i = 0; i < input.cols * input.channels(); i++) {
+            output_row[i] = static_cast<uchar>(255 - input_row[i]);
+        }
+    }
+}
+
+/**
+ * Normalises the weighted sum of a partial kernel like the cv::Vec arithmetic of the kernels does: multiplied by the
+ * reciprocal of the sum of the weights (1 if they sum to 0), rounded to the nearest integer, then saturated to 8 bits.
+ */
+uchar reference_normalise(int sum, int kernel_sum) {
+    int scaled = cvRound(sum * (1.0 / kernel_sum));
+    return static_cast<uchar>(std::min(255, std::max(0, scaled)));
+}
+
+/**
+ * Reference of apply_partial_kernel_row: a vertical 1D convolution with reflected borders.
+ */
+void reference_partial_kernel_row(const cv::Mat &input, cv::Mat &output, const std::vector<int> &kernel,
+                                  int kernel_offset) {
+    int kernel_sum = 0;
+    for (int weight: kernel) {
+        kernel_sum += weight;
+    }
+    if (kernel_sum == 0) {
+        kernel_sum = 1;
+    }
+
+    int channels = input.channels();
+    output = cv::Mat::zeros(input.rows, input.cols, input.type());
+    for (int row = 0; row < input.rows; row++) {
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int col = 0; col < input.cols; col++) {
+            for (int channel = 0; channel < channels; channel++) {
+                int sum = 0;
+                for (int tap = -kernel_offset; tap <= kernel_offset; tap++) {
+                    const uchar *source_row = input.ptr<uchar>(reference_reflect(row, tap, input.rows));
+                    sum += source_row[col * channels + channel] * kernel[tap + kernel_offset];
+                }
+                output_row[col * channels + channel] = reference_normalise(sum, kernel_sum);
+            }
+        }
+    }
+}
+
+/**
+ * Reference of apply_partial_kernel_col: a horizontal 1D convolution with reflected borders.
+ */
+void reference_partial_kernel_col(const cv::Mat &input, cv::Mat &output, const std::vector<int> &kernel,
+                                  int kernel_offset) {
+    int kernel_sum = 0;
+    for (int weight: kernel) {
+        kernel_sum += weight;
+    }
+    if (kernel_sum == 0) {
+        kernel_sum = 1;
+    }
+
+    int channels = input.channels();
+    output = cv::Mat::zeros(input.rows, input.cols, input.type());
+    for (int row = 0; row < input.rows; row++) {
+        const uchar *input_row = input.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int col = 0; col < input.cols; col++) {
+            for (int channel = 0; channel < channels; channel++) {
+                int sum = 0;
+                for (int tap = -kernel_offset; tap <= kernel_offset; tap++) {
+                    int source_col = reference_reflect(col, tap, input.cols);
+                    sum += input_row[source_col * channels + channel] * kernel[tap + kernel_offset];
+                }
+                output_row[col * channels + channel] = reference_normalise(sum, kernel_sum);
+            }
+        }
+    }
+}
+
+/**
+ * Reference of apply_kernel: the row pass, saturated to 8 bits, then the column pass.
+ */
+void reference_kernel(const cv::Mat &input, cv::Mat &output, const std::vector<int> &kernel, int kernel_offset) {
+    cv::Mat intermediate;
+    reference_partial_kernel_row(input, intermediate, kernel, kernel_offset);
+    reference_partial_kernel_col(intermediate, output, kernel, kernel_offset);
+}
+
+/**
+ * Reference of magnitude. Only the first channel of the gradients is used. Single-channel gradients give a
+ * single-channel magnitude, rounded and saturated; 3-channel gradients give a 3-channel magnitude, truncated and
+ * then wrapped to 8 bits, like the 3-channel path of magnitude does.
+ */
+void reference_magnitude(const cv::Mat &gradient_x, const cv::Mat &gradient_y, cv::Mat &output) {
+    bool single = gradient_x.channels() == 1 && gradient_y.channels() == 1;
+    output = cv::Mat::zeros(gradient_x.rows, gradient_x.cols, single ? CV_8UC1 : CV_8UC3);
+    for (int row = 0; row < gradient_x.rows; row++) {
+        const uchar *row_x = gradient_x.ptr<uchar>(row);
+        const uchar *row_y = gradient_y.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int col = 0; col < gradient_x.cols; col++) {
+            int x = row_x[col * gradient_x.channels()];
+            int y = row_y[col * gradient_y.channels()];
+            double length = std::sqrt(static_cast<double>(x * x + y * y));
+            if (single) {
+                output_row[col] = static_cast<uchar>(std::min(255, cvRound(length)));
+            } else {
+                auto value = static_cast<uchar>(static_cast<int>(length) & 0xff);
+                output_row[col * 3] = value;
+                output_row[col * 3 + 1] = value;
+                output_row[col * 3 + 2] = value;
+            }
+        }
+    }
+}
+
+/**
+ * Reference of magnitude_l1: the sum of the first channels of the gradients, saturated, with as many channels as
+ * magnitude gives.
+ */
+void reference_magnitude_l1(const cv::Mat &gradient_x, const cv::Mat &gradient_y, cv::Mat &output) {
+    int channels = gradient_x.channels() == 1 && gradient_y.channels() == 1 ? 1 : 3;
+    output = cv::Mat::zeros(gradient_x.rows, gradient_x.cols, CV_8UC(channels));
+    for (int row = 0; row < gradient_x.rows; row++) {
+        const uchar *row_x = gradient_x.ptr<uchar>(row);
+        const uchar *row_y = gradient_y.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int col = 0; col < gradient_x.cols; col++) {
+            int length = row_x[col * gradient_x.channels()] + row_y[col * gradient_y.channels()];
+            for (int channel = 0; channel < channels; channel++) {
+                output_row[col * channels + channel] = static_cast<uchar>(std::min(255, length));
+            }
+        }
+    }
+}
+
+/**
+ * Reference of quantize: the same Gaussian blur (OpenCV's, it is not under test), then each channel floored to a
+ * multiple of 255 / levels.
+ */
+void reference_quantize(const cv::Mat &input, cv::Mat &output, int levels) {
+    int bins_count = 255 / levels;
+    cv::Mat blurred;
+    cv::GaussianBlur(input, blurred, cv::Size(5, 5), 0);
+
+    output = cv::Mat::zeros(input.rows, input.cols, CV_8UC3);
+    for (int row = 0; row < input.rows; row++) {
+        const uchar *input_row = blurred.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int i = 0; i < input.cols * 3; i++) {
+            output_row[i] = static_cast<uchar>(input_row[i] / bins_count * bins_count);
+        }
+    }
+}
+
+/**
+ * Reference of cartoonize: black where the first channel of the magnitude is above the threshold, the quantized
+ * pixel elsewhere.
+ */
+void reference_cartoonize(const cv::Mat &quantized, const cv::Mat &magnitude, cv::Mat &output, int threshold) {
+    output = cv::Mat::zeros(quantized.rows, quantized.cols, CV_8UC3);
+    for (int row = 0; row < quantized.rows; row++) {
+        const uchar *quantized_row = quantized.ptr<uchar>(row);
+        const uchar *magnitude_row = magnitude.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int col = 0; col < quantized.cols; col++) {
+            bool edge = magnitude_row[col * magnitude.channels()] > threshold;
+            for (int channel = 0; channel < 3; channel++) {
+                output_row[col * 3 + channel] = edge ? 0 : quantized_row[col * 3 + channel];
+            }
+        }
+    }
+}
+
+/**
+ * Reference of motion_mask: 255 where the frames differ by more than the threshold, 0 elsewhere.
+ */
+void reference_motion_mask(const cv::Mat &current, const cv::Mat &previous, cv::Mat &output, int threshold) {
+    output = cv::Mat::zeros(current.rows, current.cols, CV_8UC1);
+    for (int row = 0; row < current.rows; row++) {
+        const uchar *current_row = current.ptr<uchar>(row);
+        const uchar *previous_row = previous.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int col = 0; col < current.cols; col++) {
+            output_row[col] = std::abs(current_row[col] - previous_row[col]) > threshold ? 255 : 0;
+        }
+    }
+}
+
+/**
+ * Reference of background_update on a sequence of frames, from an empty model: the model starts at the first frame
+ * (in 8.8 fixed point), every later frame moves it by 1 / 2^shift of the difference, floored, and the output is the
+ * model after the last frame, rounded to 8 bits.
+ */
+void reference_background(const std::vector<cv::Mat> &frames, cv::Mat &output, int shift) {
+    const cv::Mat &first = frames.front();
+    int width = first.cols * first.channels();
+    std::vector<int> model(static_cast<size_t>(first.rows) * width);
+    for (int row = 0; row < first.rows; row++) {
+        for (int i = 0; i < width; i++) {
+            model[row * width + i] = first.ptr<uchar>(row)[i] * 256;
+        }
+    }
+    for (size_t frame = 1; frame < frames.size(); frame++) {
+        for (int row = 0; row < first.rows; row++) {
+            const uchar *input_row = frames[frame].ptr<uchar>(row);
+            for (int i = 0; i < width; i++) {
+                int &value = model[row * width + i];
+                value += static_cast<int>(std::floor((input_row[i] * 256 - value) / std::pow(2.0, shift)));
+            }
+        }
+    }
+
+    output = cv::Mat::zeros(first.rows, first.cols, first.type());
+    for (int row = 0; row < first.rows; row++) {
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int i = 0; i < width; i++) {
+            output_row[i] = static_cast<uchar>((model[row * width + i] + 128) / 256);
+        }
+    }
+}
+
+/**
+ * Reference of temporal_denoise: the mean of the frame and the previous frames, rounded half up, where every previous
+ * value more than the threshold away from the current one counts as the current one.
+ */
+void reference_temporal_denoise(const cv::Mat &current, const std::vector<cv::Mat> &history, cv::Mat &output,
+                                int threshold) {
+    int frames = static_cast<int>(history.size()) + 1;
+    output = cv::Mat::zeros(current.rows, current.cols, current.type());
+    for (int row = 0; row < current.rows; row++) {
+        const uchar *current_row = current.ptr<uchar>(row);
+        uchar *output_row = output.ptr<uchar>(row);
+        for (int i = 0; i < current.cols * current.channels(); i++) {
+            int sum = current_row[i];
+            for (auto &previous: history) {
+                int value = previous.ptr<uchar>(row)[i];
+                sum += std::abs(value - current_row[i]) > threshold ? current_row[i] : value;
+            }
+            output_row[i] = static_cast<uchar>((sum + frames / 2) / frames);
+        }
+    }
+}
+
+#endif //VISION_CPP_REFERENCE_H
@@ -0,0 +1,157 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+// A minimal client of the stream server, to check a stream locally without a browser or a player.
+// It reads a stream for a while, optionally pretending to be slow, and prints what it received:
+//     stream_client <port | unix:path> <filter>.<mjpg|raw> [seconds] [delay per frame in ms]
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include "../utils/stream/stream_protocol.h"
+
+static int connect_to(const std::string &address) {
+    if (address.starts_with("unix:")) {
+        sockaddr_un socket_address{};
+        socket_address.sun_family = AF_UNIX;
+        std::strncpy(socket_address.sun_path, address.substr(5).c_str(), sizeof(socket_address.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, reinterpret_cast<sockaddr *>(&socket_address), sizeof(socket_address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    sockaddr_in socket_address{};
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socket_address.sin_port = htons(static_cast<uint16_t>(std::stoi(address)));
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, reinterpret_cast<sockaddr *>(&socket_address), sizeof(socket_address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool read_exactly(int fd, void *data, size_t size) {
+    auto *bytes = static_cast<char *>(data);
+    while (size > 0) {
+        ssize_t received = recv(fd, bytes, size, 0);
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= received;
+    }
+    return true;
+}
+
+static bool read_line(int fd, std::string &line) {
+    line.clear();
+    char c;
+    while (read_exactly(fd, &c, 1)) {
+        if (c == '\n') {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+        line.push_back(c);
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <port | unix:path> <filter>.<mjpg|raw> [seconds] [delay ms]"
+                  << std::endl;
+        return 1;
+    }
+    std::string path = argv[2];
+    double seconds = argc > 3 ? std::stod(argv[3]) : 5;
+    int delay = argc > 4 ? std::stoi(argv[4]) : 0;
+    bool raw = path.ends_with(".raw");
+
+    int fd = connect_to(argv[1]);
+    if (fd < 0) {
+        std::cout << "Failed to connect to " << argv[1] << std::endl;
+        return 1;
+    }
+    std::string request = "GET /" + path + " HTTP/1.0\r\n\r\n";
+    send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+
+    std::string line;
+    read_line(fd, line);
+    std::cout << line << std::endl;
+    if (line.find("200") == std::string::npos) {
+        while (read_line(fd, line)) {
+            std::cout << line << std::endl;
+        }
+        return 1;
+    }
+    while (read_line(fd, line) && !line.empty()) {}
+
+    long long frames = 0, bytes = 0, skipped = 0;
+    uint64_t last_sequence = 0;
+    std::string frame_info;
+    std::string payload;
+    auto start = std::chrono::steady_clock::now();
+
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds) {
+        size_t size;
+        if (raw) {
+            RawStreamHeader header{};
+            if (!read_exactly(fd, &header, sizeof(header)) ||
+                std::memcmp(header.magic, STREAM_RAW_MAGIC, sizeof(header.magic)) != 0) {
+                break;
+            }
+            size = header.step * header.rows;
+            if (last_sequence != 0) {
+                skipped += static_cast<long long>(header.sequence - last_sequence - 1);
+            }
+            last_sequence = header.sequence;
+            frame_info = std::to_string(header.cols) + "x" + std::to_string(header.rows) + " type " +
+                         std::to_string(header.type);
+        } else {
+            size = 0;
+            while (read_line(fd, line) && !line.empty()) {
+                if (line.starts_with("Content-Length: ")) {
+                    size = std::stoul(line.substr(16));
+                }
+            }
+            size += 2; // the line break after the image
+            frame_info = "jpeg";
+        }
+
+        payload.resize(size);
+        if (!read_exactly(fd, payload.data(), size)) {
+            break;
+        }
+        frames++;
+        bytes += static_cast<long long>(size);
+
+        if (delay > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << frames << " frames (" << frame_info << "), " << frames / elapsed << " fps, "
+              << bytes / elapsed / 1e6 << " MB/s";
+    if (raw) {
+        std::cout << ", " << skipped << " skipped";
+    }
+    std::cout << std::endl;
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,117 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_BOUNDED_QUEUE_H
+#define VISION_CPP_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/**
+ * A template class that implements a thread-safe first-in first-out queue with a fixed capacity.
+ * Producers never block: pushing into a full queue fails, so that a slow consumer cannot stall the producer.
+ * Consumers block until an item is available or the queue is closed.
+ * @tparam T The type of the items in the queue.
+ */
+template<typename T>
+class BoundedQueue {
+public:
+    /**
+    * A constructor that creates an empty queue.
+    * @param capacity The maximum number of items the queue can hold.
+    */
+    explicit BoundedQueue(size_t capacity);
+
+    /**
+    * Adds an item at the end of the queue, unless it is full or closed.
+    * @param item The item to add.
+    * @return true if the item was added, false if it was dropped.
+    */
+    bool try_push(const T &item);
+
+    /**
+    * Removes the item at the front of the queue, waiting for one if the queue is empty.
+    * @param output A reference to a variable of type T where the item will be stored.
+    * @return true if an item was removed, false if the queue is closed and empty.
+    */
+    bool pop(T &output);
+
+    /**
+    * Closes the queue: pushes fail from now on, and pop returns false once the remaining items are consumed.
+    */
+    void close();
+
+    /**
+    * Returns the number of items currently in the queue.
+    * @return The number of items in the queue.
+    */
+    size_t size();
+
+    /**
+    * Returns the maximum number of items the queue can hold.
+    * @return The capacity of the queue.
+    */
+    size_t get_capacity() const;
+
+private:
+    std::deque<T> items; // The items of the queue, oldest first
+    size_t capacity; // The maximum number of items
+    bool closed = false; // Whether the queue has been closed
+    std::mutex mutex; // The mutex that synchronizes the producers and the consumers
+    std::condition_variable available; // Signalled when an item is added or the queue is closed
+};
+
+template<typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity) {
+    this->capacity = capacity;
+}
+
+template<typename T>
+bool BoundedQueue<T>::try_push(const T &item) {
+    {
+        std::lock_guard<std::mutex> lockGuard(mutex);
+        if (closed || items.size() >= capacity) {
+            return false;
+        }
+        items.push_back(item);
+    }
+    available.notify_one();
+    return true;
+}
+
+template<typename T>
+bool BoundedQueue<T>::pop(T &output) {
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [this] { return closed || !items.empty(); });
+    if (items.empty()) {
+        return false;
+    }
+    output = std::move(items.front());
+    items.pop_front();
+    return true;
+}
+
+template<typename T>
+void BoundedQueue<T>::close() {
+    {
+        std::lock_guard<std::mutex> lockGuard(mutex);
+        closed = true;
+    }
+    available.notify_all();
+}
+
+template<typename T>
+size_t BoundedQueue<T>::size() {
+    std::lock_guard<std::mutex> lockGuard(mutex);
+    return items.size();
+}
+
+template<typename T>
+size_t BoundedQueue<T>::get_capacity() const {
+    return capacity;
+}
+
+#endif //VISION_CPP_BOUNDED_QUEUE_H
@@ -13,6 +13,15 @@ Camera::Camera(int index) {
     }
 }
 
+Camera::Camera(const std::string &path) {
+    this->index = -1;
+    videoCapture.open(path);
+    if (!videoCapture.isOpened()) {
+        std::cout << "Failed to open " << path << "." << std::endl;
+        return;
+    }
+}
+
 Camera::~Camera() {
     videoCapture.release();
 }
@@ -24,8 +33,68 @@ void Camera::set_fps(int fps) {
 int Camera::read(cv::Mat &frame) {
     videoCapture >> frame;
     if (frame.empty()) {
+        if (index < 0) {
+            exhausted = true;
+            return -1;
+        }
         std::cout << "Failed to capture frame." << std::endl;
         return -1;
     }
+
+    format = PixelFormat::BGR;
+    if (native && interpret_native(frame) != 0) {
+        std::cout << "Unsupported native camera layout, falling back to BGR." << std::endl;
+        set_native(false);
+        videoCapture >> frame;
+        return frame.empty() ? -1 : 0;
+    }
     return 0;
 }
+
+bool Camera::end_of_stream() {
+    return exhausted;
+}
+
+void Camera::set_native(bool native) {
+    if (!videoCapture.set(cv::CAP_PROP_CONVERT_RGB, native ? 0 : 1)) {
+        if (native) {
+            std::cout << "The camera cannot deliver raw frames, using BGR." << std::endl;
+        }
+        this->native = false;
+        return;
+    }
+    this->native = native;
+}
+
+PixelFormat Camera::get_format() {
+    return format;
+}
+
+int Camera::interpret_native(cv::Mat &frame) {
+    if (frame.type() == CV_8UC3) {
+        // the backend ignored the request and converted anyway
+        format = PixelFormat::BGR;
+        return 0;
+    }
+
+    int width = static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_WIDTH));
+    int height = static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    size_t bytes = frame.total() * frame.elemSize();
+    if (width <= 0 || height <= 0 || !frame.isContinuous()) {
+        return -1;
+    }
+
+    if (bytes == static_cast<size_t>(width) * height * 2) {
+        frame = frame.reshape(2, height);
+        format = PixelFormat::YUYV;
+        return 0;
+    }
+    if (bytes == static_cast<size_t>(width) * height * 3 / 2) {
+        int fourcc = static_cast<int>(videoCapture.get(cv::CAP_PROP_FOURCC));
+        frame = frame.reshape(1, height * 3 / 2);
+        format = fourcc == cv::VideoWriter::fourcc('I', '4', '2', '0') ||
+                 fourcc == cv::VideoWriter::fourcc('Y', 'U', '1', '2') ? PixelFormat::I420 : PixelFormat::NV12;
+        return 0;
+    }
+    return -1;
+}
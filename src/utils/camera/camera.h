@@ -6,6 +6,8 @@
 #define VISION_CPP_CAMERA_H
 
 #include <opencv2/opencv.hpp>
+#include <string>
+#include "../source/frame_source.h"
 
 /**
  * A class that represents a camera device and provides methods to capture frames from it.
@@ -14,7 +16,7 @@
  * The camera can be used to read frames into a cv::Mat object using the read method.
  * The camera is automatically closed when the object is destroyed.
  */
-class Camera {
+class Camera : public FrameSource {
 public:
     /**
     * A constructor that creates a Camera object and opens the camera device with the given index.
@@ -22,27 +24,63 @@ public:
     */
     explicit Camera(int index);
 
+    /**
+    * A constructor that creates a Camera object and opens the video file (or stream URL) at the given path.
+    * @param path a string that specifies the video file name or stream URL
+    */
+    explicit Camera(const std::string &path);
+
     /**
     * A destructor that releases the camera device and frees any resources associated with it.
     */
-    ~Camera();
+    ~Camera() override;
 
     /**
     * A method that sets the frame rate of the camera device in frames per second.
     * @param fps an integer that specifies the desired frame rate
     */
-    void set_fps(int fps);
+    void set_fps(int fps) override;
 
     /**
     * A method that reads a frame from the camera device and stores it in a cv::Mat object.
     * @param frame a reference to a cv::Mat object where the captured frame will be stored
     * @return 0 if the frame was successfully captured, -1 otherwise
     */
-    int read(cv::Mat &frame);
+    int read(cv::Mat &frame) override;
+
+    /**
+    * A method that tells whether a video file has been read to its end. Camera devices never end.
+    * @return true if the last read failed on a video file, false otherwise
+    */
+    bool end_of_stream() override;
+
+    /**
+    * A method that asks the capture backend for the raw frames of the device (e.g. YUYV or NV12) instead of BGR.
+    * Backends or devices whose raw frames cannot be interpreted (e.g. MJPEG) keep delivering BGR.
+    * @param native true for the native layout, false for BGR
+    */
+    void set_native(bool native) override;
+
+    /**
+    * A method that returns the layout of the last frame read.
+    * @return The pixel layout of the last frame read.
+    */
+    PixelFormat get_format() override;
 
 private:
+    /**
+    * A method that works out the layout of a raw frame from its size, and reshapes it accordingly
+    * (backends hand raw frames out as a single row of bytes).
+    * @param frame the raw frame, reshaped in place
+    * @return 0 if the layout is known, -1 otherwise
+    */
+    int interpret_native(cv::Mat &frame);
+
     cv::VideoCapture videoCapture; // a cv::VideoCapture object that represents the camera device
-    [[maybe_unused]] int index; // an integer that stores the index of the camera device
+    [[maybe_unused]] int index; // an integer that stores the index of the camera device, or -1 for a video file
+    bool exhausted = false; // a boolean that is set once a video file fails to deliver a frame
+    bool native = false; // a boolean that is set while raw frames are requested from the backend
+    PixelFormat format = PixelFormat::BGR; // the layout of the last frame read
 };
 
 
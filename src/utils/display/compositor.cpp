@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "compositor.h"
+
+#include <cmath>
+#include <utility>
+
+const int LABEL_HEIGHT = 20;
+
+Compositor::Compositor(std::string window_name, cv::Size size, int display_fps) {
+    this->window_name = std::move(window_name);
+    this->size = size;
+    this->canvas = cv::Mat::zeros(size.height, size.width, CV_8UC3);
+    this->period = std::chrono::microseconds(1000000 / std::max(1, display_fps));
+    this->next_refresh = std::chrono::steady_clock::now();
+}
+
+Compositor::~Compositor() {
+    if (shown) {
+        cv::destroyWindow(window_name);
+    }
+}
+
+void Compositor::set_tiles(const std::vector<std::string> &names,
+                           const std::vector<WatchChannel<cv::Mat> *> &channels) {
+    bool changed = names.size() != tiles.size();
+    for (size_t i = 0; !changed && i < names.size(); i++) {
+        changed = tiles[i].name != names[i] || tiles[i].channel != channels[i];
+    }
+    if (!changed) {
+        return;
+    }
+
+    tiles.clear();
+    for (size_t i = 0; i < names.size(); i++) {
+        tiles.push_back({names[i], channels[i], 0, cv::Rect()});
+    }
+    layout();
+}
+
+void Compositor::layout() {
+    canvas.setTo(cv::Scalar::all(0));
+    dirty = true;
+    if (tiles.empty()) {
+        return;
+    }
+
+    // the smallest grid that fits every tile, as square as possible
+    int grid_cols = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(tiles.size()))));
+    int grid_rows = (static_cast<int>(tiles.size()) + grid_cols - 1) / grid_cols;
+    int tile_width = size.width / grid_cols;
+    int tile_height = size.height / grid_rows;
+
+    for (size_t i = 0; i < tiles.size(); i++) {
+        int col = static_cast<int>(i) % grid_cols;
+        int row = static_cast<int>(i) / grid_cols;
+        tiles[i].area = cv::Rect(col * tile_width, row * tile_height, tile_width, tile_height);
+        tiles[i].version = 0;
+    }
+}
+
+void Compositor::draw(Tile &tile, const cv::Mat &frame) {
+    // a tile with no room for a row of the frame under its label (too many tiles for the canvas) stays blank
+    if (tile.area.width < 1 || tile.area.height <= LABEL_HEIGHT) {
+        return;
+    }
+    cv::Mat area = canvas(tile.area);
+    area.setTo(cv::Scalar::all(0));
+
+    // keep the aspect ratio of the frame, leaving room for the label
+    int available_height = tile.area.height - LABEL_HEIGHT;
+    double scale = std::min(1.0 * tile.area.width / frame.cols, 1.0 * available_height / frame.rows);
+    cv::Size scaled(std::max(1, static_cast<int>(frame.cols * scale)), std::max(1, static_cast<int>(frame.rows * scale)));
+    cv::Rect target((tile.area.width - scaled.width) / 2, LABEL_HEIGHT + (available_height - scaled.height) / 2,
+                    scaled.width, scaled.height);
+
+    cv::Mat resized;
+    cv::resize(frame, resized, scaled, 0, 0, scale < 1 ? cv::INTER_AREA : cv::INTER_LINEAR);
+    cv::Mat destination = area(target);
+    if (resized.channels() == 1) {
+        cv::cvtColor(resized, destination, cv::COLOR_GRAY2BGR);
+    } else {
+        resized.copyTo(destination);
+    }
+
+    cv::putText(area, tile.name, cv::Point(4, LABEL_HEIGHT - 6), cv::FONT_HERSHEY_SIMPLEX, 0.5,
+                cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+}
+
+bool Compositor::update() {
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_refresh) {
+        return false;
+    }
+    next_refresh = std::max(next_refresh + period, now);
+
+    for (Tile &tile: tiles) {
+        // the tiles on display are what filters evaluated on demand produce for
+        tile.channel->request();
+        if (tile.channel->get_version() == tile.version) {
+            continue;
+        }
+        cv::Mat frame;
+        tile.channel->read(frame, tile.version);
+        if (frame.empty()) {
+            continue;
+        }
+        draw(tile, frame);
+        dirty = true;
+    }
+
+    if (!dirty) {
+        return false;
+    }
+    cv::imshow(window_name, canvas);
+    dirty = false;
+    shown = true;
+    return true;
+}
+
+int Compositor::get_wait_time() const {
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_refresh - std::chrono::steady_clock::now());
+    return std::max(1, static_cast<int>(wait.count()));
+}
@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_COMPOSITOR_H
+#define VISION_CPP_COMPOSITOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../watch_channel.h"
+
+/**
+ * A class that shows several channels as tiles of a single window (a mosaic), instead of one window per channel.
+ * The window is refreshed at a fixed display rate, independently of how fast the filters run, and a tile is only
+ * redrawn (downscaled into the mosaic) when its channel has been written since the last refresh.
+ */
+class Compositor {
+public:
+    /**
+     * A constructor that creates a compositor with no tiles.
+     * @param window_name The name of the window.
+     * @param size The size of the mosaic, in pixels.
+     * @param display_fps The number of times per second the window is refreshed.
+     */
+    explicit Compositor(std::string window_name, cv::Size size, int display_fps);
+
+    /**
+     * A destructor that closes the window.
+     */
+    ~Compositor();
+
+    /**
+     * A method that sets the channels shown in the mosaic. Nothing is redrawn if the tiles did not change.
+     * @param names The names of the channels, used as tile labels.
+     * @param channels The channels, in the same order as the names.
+     */
+    void set_tiles(const std::vector<std::string> &names, const std::vector<WatchChannel<cv::Mat> *> &channels);
+
+    /**
+     * A method that refreshes the window if it is time to, redrawing the tiles whose channel changed. Every refresh
+     * requests a newer frame from every tile (see WatchChannel::request).
+     * @return true if the window was refreshed, false if it was not due or nothing changed.
+     */
+    bool update();
+
+    /**
+     * A method that returns how long the caller can wait (e.g. in cv::waitKey) before the next refresh is due.
+     * @return The time until the next refresh, in milliseconds, at least 1.
+     */
+    int get_wait_time() const;
+
+private:
+    /**
+     * A structure that holds the state of one tile.
+     */
+    struct Tile {
+        std::string name; // label of the tile
+        WatchChannel<cv::Mat> *channel; // channel shown in the tile
+        uint64_t version; // version of the channel last drawn, 0 if never drawn
+        cv::Rect area; // area of the tile in the mosaic
+    };
+
+    void layout();
+
+    void draw(Tile &tile, const cv::Mat &frame);
+
+    std::string window_name; // name of the window
+    cv::Size size; // size of the mosaic
+    cv::Mat canvas; // the mosaic
+    std::vector<Tile> tiles; // the tiles, in display order
+    std::chrono::steady_clock::duration period; // time between two refreshes
+    std::chrono::steady_clock::time_point next_refresh; // when the next refresh is due
+    bool dirty = true; // whether the mosaic changed since it was last shown
+    bool shown = false; // whether the window has been created
+};
+
+#endif //VISION_CPP_COMPOSITOR_H
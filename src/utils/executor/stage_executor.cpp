@@ -0,0 +1,306 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "stage_executor.h"
+#include "../trace/trace.h"
+
+#include <algorithm>
+#include <string>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+void StageExecutor::Wakeup::fire() {
+    if (!fired.exchange(true)) {
+        executor->schedule(handle);
+    }
+}
+
+bool StageExecutor::watch_signal(const std::shared_ptr<Wakeup> &wakeup, StageSignal *signal, uint64_t signal_seen) {
+    std::shared_ptr<Wakeup> shared = wakeup;
+    wakeup->signal_id = signal->add_waker(signal_seen, [shared] { shared->fire(); });
+    return wakeup->signal_id >= 0;
+}
+
+void StageExecutor::unwatch(const std::shared_ptr<Wakeup> &wakeup, StageSignal *signal) {
+    if (wakeup == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(wakeup->mutex);
+    for (auto &pair: wakeup->ids) {
+        pair.first->remove_waker(pair.second);
+    }
+    wakeup->ids.clear();
+    if (wakeup->signal_id >= 0) {
+        signal->remove_waker(wakeup->signal_id);
+        wakeup->signal_id = -1;
+    }
+}
+
+StageExecutor::FrameAwaiter::FrameAwaiter(StageExecutor &executor, WatchChannel<cv::Mat> *first, uint64_t first_seen,
+                                          WatchChannel<cv::Mat> *second, uint64_t second_seen, StageSignal *signal,
+                                          uint64_t signal_seen)
+        : executor(&executor), channels{first, second}, seen{first_seen, second_seen}, signal(signal),
+          signal_seen(signal_seen) {}
+
+bool StageExecutor::FrameAwaiter::await_ready() {
+    for (int i = 0; i < 2; i++) {
+        if (channels[i] != nullptr && channels[i]->get_version() != seen[i]) {
+            return true;
+        }
+    }
+    return signal->get_version() != signal_seen;
+}
+
+void StageExecutor::FrameAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    // the coroutine may be resumed on another thread as soon as a waker is registered: everything it reads in
+    // await_resume is set before, or under the mutex of the wakeup
+    wakeup = std::make_shared<Wakeup>();
+    wakeup->executor = executor;
+    wakeup->handle = handle;
+    std::shared_ptr<Wakeup> shared = wakeup;
+    WatchChannel<cv::Mat> *waited[2] = {channels[0], channels[1]};
+    uint64_t versions[2] = {seen[0], seen[1]};
+    StageSignal *changed = signal;
+    uint64_t changed_seen = signal_seen;
+
+    bool woken = false;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        for (int i = 0; i < 2 && !woken; i++) {
+            if (waited[i] == nullptr) {
+                continue;
+            }
+            int id = waited[i]->add_waker(versions[i], [shared] { shared->fire(); });
+            if (id < 0) {
+                woken = true;
+            } else {
+                shared->ids.emplace_back(waited[i], id);
+            }
+        }
+        woken = woken || !watch_signal(shared, changed, changed_seen);
+    }
+    if (woken) {
+        shared->fire();
+    }
+}
+
+bool StageExecutor::FrameAwaiter::await_resume() {
+    unwatch(wakeup, signal);
+    for (int i = 0; i < 2; i++) {
+        if (channels[i] != nullptr && channels[i]->get_version() != seen[i]) {
+            return true;
+        }
+    }
+    executor->interrupts.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+StageExecutor::RequestAwaiter::RequestAwaiter(StageExecutor &executor, WatchChannel<cv::Mat> *channel,
+                                              StageSignal *signal, uint64_t signal_seen)
+        : executor(&executor), channel(channel), signal(signal), signal_seen(signal_seen) {}
+
+bool StageExecutor::RequestAwaiter::await_ready() {
+    return channel->is_requested() || signal->get_version() != signal_seen;
+}
+
+void StageExecutor::RequestAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    // as in FrameAwaiter::await_suspend, nothing of this awaiter is used once a waker is registered
+    wakeup = std::make_shared<Wakeup>();
+    wakeup->executor = executor;
+    wakeup->handle = handle;
+    std::shared_ptr<Wakeup> shared = wakeup;
+    WatchChannel<cv::Mat> *requested = channel;
+    StageSignal *changed = signal;
+    uint64_t changed_seen = signal_seen;
+
+    bool woken;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        int id = requested->add_request_waker([shared] { shared->fire(); });
+        woken = id < 0;
+        if (!woken) {
+            shared->ids.emplace_back(requested, id);
+        }
+        woken = woken || !watch_signal(shared, changed, changed_seen);
+    }
+    if (woken) {
+        shared->fire();
+    }
+}
+
+bool StageExecutor::RequestAwaiter::await_resume() {
+    unwatch(wakeup, signal);
+    if (channel->is_requested()) {
+        return true;
+    }
+    executor->interrupts.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+StageExecutor::SignalAwaiter::SignalAwaiter(StageExecutor &executor, StageSignal *signal, uint64_t signal_seen)
+        : executor(&executor), signal(signal), signal_seen(signal_seen) {}
+
+bool StageExecutor::SignalAwaiter::await_ready() {
+    return signal->get_version() != signal_seen;
+}
+
+void StageExecutor::SignalAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    wakeup = std::make_shared<Wakeup>();
+    wakeup->executor = executor;
+    wakeup->handle = handle;
+    std::shared_ptr<Wakeup> shared = wakeup;
+    StageSignal *changed = signal;
+    uint64_t changed_seen = signal_seen;
+
+    bool woken;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        woken = !watch_signal(shared, changed, changed_seen);
+    }
+    if (woken) {
+        shared->fire();
+    }
+}
+
+void StageExecutor::SignalAwaiter::await_resume() {
+    unwatch(wakeup, signal);
+}
+
+StageExecutor::SleepAwaiter::SleepAwaiter(StageExecutor &executor, std::chrono::microseconds duration)
+        : executor(&executor), duration(duration) {}
+
+bool StageExecutor::SleepAwaiter::await_ready() {
+    return duration.count() <= 0;
+}
+
+void StageExecutor::SleepAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    auto wakeup = std::make_shared<Wakeup>();
+    wakeup->executor = executor;
+    wakeup->handle = handle;
+    executor->schedule_at(std::chrono::steady_clock::now() + duration, wakeup);
+}
+
+StageExecutor::StageExecutor(int threads) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    // every thread may run a callback at once, so each gets an equal share of the cores for the OpenMP teams of the
+    // callbacks it resumes, instead of a team as wide as the machine (threads x cores threads in all)
+    int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    team_width = std::max(1, cores / threads);
+    for (int i = 0; i < threads; i++) {
+        this->threads.emplace_back(&StageExecutor::run, this, i);
+    }
+}
+
+StageExecutor::~StageExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+void StageExecutor::schedule(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(handle);
+    }
+    condition.notify_one();
+}
+
+void StageExecutor::schedule_at(std::chrono::steady_clock::time_point when, std::shared_ptr<Wakeup> wakeup) {
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        earliest = timers.empty() || when < timers.begin()->first;
+        timers.emplace(when, std::move(wakeup));
+    }
+    // only a new earliest timer changes how long the idle threads should sleep
+    if (earliest) {
+        condition.notify_one();
+    }
+}
+
+StageExecutor::FrameAwaiter StageExecutor::next_frame(WatchChannel<cv::Mat> &channel, uint64_t seen,
+                                                      StageSignal &signal, uint64_t signal_seen) {
+    return {*this, &channel, seen, nullptr, 0, &signal, signal_seen};
+}
+
+StageExecutor::FrameAwaiter StageExecutor::next_frame(WatchChannel<cv::Mat> &first, uint64_t first_seen,
+                                                      WatchChannel<cv::Mat> &second, uint64_t second_seen,
+                                                      StageSignal &signal, uint64_t signal_seen) {
+    return {*this, &first, first_seen, &second, second_seen, &signal, signal_seen};
+}
+
+StageExecutor::RequestAwaiter StageExecutor::next_request(WatchChannel<cv::Mat> &channel, StageSignal &signal,
+                                                         uint64_t signal_seen) {
+    return {*this, &channel, &signal, signal_seen};
+}
+
+StageExecutor::SignalAwaiter StageExecutor::next_change(StageSignal &signal, uint64_t signal_seen) {
+    return {*this, &signal, signal_seen};
+}
+
+StageExecutor::SleepAwaiter StageExecutor::sleep(std::chrono::microseconds duration) {
+    return {*this, duration};
+}
+
+int StageExecutor::get_threads() const {
+    return static_cast<int>(threads.size());
+}
+
+void StageExecutor::report(std::ostream &out) {
+    long long resumed = resumes.load();
+    long long interrupted = interrupts.load();
+    out << "Stage executor: " << threads.size() << " threads (OpenMP teams of " << team_width << "), " << resumed
+        << " resumes, " << interrupted << " waits ended by a park or stop" << std::endl;
+}
+
+void StageExecutor::run(int index) {
+    trace_set_thread_name("Executor " + std::to_string(index));
+#ifdef _OPENMP
+    omp_set_num_threads(team_width);
+#endif
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        while (!timers.empty() && timers.begin()->first <= now) {
+            std::shared_ptr<Wakeup> wakeup = std::move(timers.begin()->second);
+            timers.erase(timers.begin());
+            // fire() would take the mutex again: queue the coroutine directly
+            if (!wakeup->fired.exchange(true)) {
+                ready.push_back(wakeup->handle);
+            }
+        }
+
+        if (!ready.empty()) {
+            std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            if (!ready.empty()) {
+                condition.notify_one();
+            }
+            lock.unlock();
+            resumes.fetch_add(1, std::memory_order_relaxed);
+            handle.resume();
+            lock.lock();
+            continue;
+        }
+        if (stopping) {
+            return;
+        }
+        if (timers.empty()) {
+            condition.wait(lock);
+        } else {
+            // a copy: the timer may be erased by another thread while this one waits
+            auto next_timer = timers.begin()->first;
+            condition.wait_until(lock, next_timer);
+        }
+    }
+}
@@ -0,0 +1,270 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_STAGE_EXECUTOR_H
+#define VISION_CPP_STAGE_EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+#include "../watch_channel.h"
+#include "stage_signal.h"
+
+/**
+ * A class that runs the coroutines of stages (see StageTask and Processor::run) on a small, fixed set of threads.
+ * A stage waiting for its next frame is a suspended coroutine, registered as a waker on its input channels: it holds
+ * no thread and no stack of its own, so hundreds of stages can share a handful of threads. The write that brings the
+ * frame queues the coroutine, and the first free thread resumes it.
+ * Waits also end when the stage is parked, woken up or stopped (see StageSignal), so a stage whose input is never
+ * written again still notices without polling: only sleep arms a timer.
+ * The OpenMP teams of the callbacks are sized so that all the threads running callbacks at once fill the cores.
+ */
+class StageExecutor {
+private:
+    /**
+     * A structure shared by the wakers of one suspension: only the first of them (a write, a request, a change of the
+     * stage, or the timer of a sleep) resumes the coroutine.
+     */
+    struct Wakeup {
+        StageExecutor *executor = nullptr; // executor the coroutine is resumed on
+        std::coroutine_handle<> handle; // the suspended coroutine
+        std::atomic<bool> fired{false}; // whether the coroutine was queued already
+        std::mutex mutex; // held while the wakers are registered, protects ids and signal_id
+        std::vector<std::pair<WatchChannel<cv::Mat> *, int>> ids; // the channels the wakers are registered on
+        int signal_id = -1; // the waker registered on the signal of the stage, -1 for none
+
+        /**
+         * Queues the coroutine, unless another waker did already.
+         */
+        void fire();
+    };
+
+public:
+    /**
+     * A class that suspends a coroutine until one of up to two channels is written past the version it last saw, or
+     * until the stage changes.
+     */
+    class FrameAwaiter {
+    public:
+        FrameAwaiter(StageExecutor &executor, WatchChannel<cv::Mat> *first, uint64_t first_seen,
+                     WatchChannel<cv::Mat> *second, uint64_t second_seen, StageSignal *signal, uint64_t signal_seen);
+
+        bool await_ready();
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        /**
+         * Removes the wakers that did not fire.
+         * @return true if a channel has a new item, false if the wait was ended by a change of the stage.
+         */
+        bool await_resume();
+
+    private:
+        StageExecutor *executor; // executor the coroutine is resumed on
+        WatchChannel<cv::Mat> *channels[2]; // the channels waited for, the second may be nullptr
+        uint64_t seen[2]; // the last version of each channel the coroutine saw
+        StageSignal *signal; // the signal of the stage
+        uint64_t signal_seen; // the last version of the signal the coroutine saw
+        std::shared_ptr<Wakeup> wakeup; // the wakers of the suspension
+    };
+
+    /**
+     * A class that suspends a coroutine until a channel is requested (see WatchChannel::request), or until the stage
+     * changes.
+     */
+    class RequestAwaiter {
+    public:
+        RequestAwaiter(StageExecutor &executor, WatchChannel<cv::Mat> *channel, StageSignal *signal,
+                       uint64_t signal_seen);
+
+        bool await_ready();
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        /**
+         * Removes the wakers that did not fire.
+         * @return true if the channel is requested, false if the wait was ended by a change of the stage.
+         */
+        bool await_resume();
+
+    private:
+        StageExecutor *executor; // executor the coroutine is resumed on
+        WatchChannel<cv::Mat> *channel; // the channel whose request is waited for
+        StageSignal *signal; // the signal of the stage
+        uint64_t signal_seen; // the last version of the signal the coroutine saw
+        std::shared_ptr<Wakeup> wakeup; // the wakers of the suspension
+    };
+
+    /**
+     * A class that suspends a coroutine until the stage changes, e.g. while it is parked.
+     */
+    class SignalAwaiter {
+    public:
+        SignalAwaiter(StageExecutor &executor, StageSignal *signal, uint64_t signal_seen);
+
+        bool await_ready();
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        /**
+         * Removes the waker if it did not fire.
+         */
+        void await_resume();
+
+    private:
+        StageExecutor *executor; // executor the coroutine is resumed on
+        StageSignal *signal; // the signal of the stage
+        uint64_t signal_seen; // the last version of the signal the coroutine saw
+        std::shared_ptr<Wakeup> wakeup; // the waker of the suspension
+    };
+
+    /**
+     * A class that suspends a coroutine for a while, without holding a thread.
+     */
+    class SleepAwaiter {
+    public:
+        SleepAwaiter(StageExecutor &executor, std::chrono::microseconds duration);
+
+        bool await_ready();
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        void await_resume() {}
+
+    private:
+        StageExecutor *executor; // executor the coroutine is resumed on
+        std::chrono::microseconds duration; // how long to sleep
+    };
+
+    /**
+     * A constructor that starts the threads of the executor.
+     * @param threads The number of threads, 0 for one per hardware thread.
+     */
+    explicit StageExecutor(int threads);
+
+    /**
+     * A destructor that stops the threads. Every coroutine must have ended.
+     */
+    ~StageExecutor();
+
+    /**
+     * A method that queues a coroutine, to be resumed by the first free thread.
+     * @param handle The coroutine, suspended.
+     */
+    void schedule(std::coroutine_handle<> handle);
+
+    /**
+     * A method that returns an awaitable that waits until the channel is written past the given version.
+     * @param channel The channel.
+     * @param seen The last version of the channel the coroutine saw.
+     * @param signal The signal of the stage: a change since signal_seen ends the wait.
+     * @param signal_seen The last version of the signal the coroutine saw, read before the state it acts on.
+     * @return The awaitable, which returns true when the channel has a new item.
+     */
+    FrameAwaiter next_frame(WatchChannel<cv::Mat> &channel, uint64_t seen, StageSignal &signal, uint64_t signal_seen);
+
+    /**
+     * A method that returns an awaitable that waits until either channel is written past the version last seen.
+     * @param first The first channel.
+     * @param first_seen The last version of the first channel the coroutine saw.
+     * @param second The second channel.
+     * @param second_seen The last version of the second channel the coroutine saw.
+     * @param signal The signal of the stage: a change since signal_seen ends the wait.
+     * @param signal_seen The last version of the signal the coroutine saw, read before the state it acts on.
+     * @return The awaitable, which returns true when either channel has a new item.
+     */
+    FrameAwaiter next_frame(WatchChannel<cv::Mat> &first, uint64_t first_seen, WatchChannel<cv::Mat> &second,
+                            uint64_t second_seen, StageSignal &signal, uint64_t signal_seen);
+
+    /**
+     * A method that returns an awaitable that waits until a reader requests a newer item from the channel, for a
+     * stage under pull evaluation.
+     * @param channel The channel, the output of the stage.
+     * @param signal The signal of the stage: a change since signal_seen ends the wait.
+     * @param signal_seen The last version of the signal the coroutine saw, read before the state it acts on.
+     * @return The awaitable, which returns true when the channel is requested.
+     */
+    RequestAwaiter next_request(WatchChannel<cv::Mat> &channel, StageSignal &signal, uint64_t signal_seen);
+
+    /**
+     * A method that returns an awaitable that waits until the stage changes, e.g. until a parked stage is woken up or
+     * stopped.
+     * @param signal The signal of the stage.
+     * @param signal_seen The last version of the signal the coroutine saw, read before the state it acts on.
+     * @return The awaitable.
+     */
+    SignalAwaiter next_change(StageSignal &signal, uint64_t signal_seen);
+
+    /**
+     * A method that returns an awaitable that sleeps for a while.
+     * @param duration How long to sleep.
+     * @return The awaitable.
+     */
+    SleepAwaiter sleep(std::chrono::microseconds duration);
+
+    /**
+     * A method that returns the number of threads of the executor.
+     * @return The number of threads.
+     */
+    int get_threads() const;
+
+    /**
+     * A method that prints how many times coroutines were resumed, and how many waits were ended by a change of their
+     * stage rather than by a new item.
+     * @param out The stream to print to.
+     */
+    void report(std::ostream &out);
+
+private:
+    /**
+     * A method that registers the waker of a wakeup on the signal of its stage. The mutex of the wakeup must be held.
+     * @param wakeup The wakeup.
+     * @param signal The signal of the stage.
+     * @param signal_seen The last version of the signal the coroutine saw.
+     * @return false if the signal is already past signal_seen: the waker is then not registered.
+     */
+    static bool watch_signal(const std::shared_ptr<Wakeup> &wakeup, StageSignal *signal, uint64_t signal_seen);
+
+    /**
+     * A method that removes the wakers of a wakeup that did not fire, when its coroutine resumes.
+     * @param wakeup The wakeup, or nullptr if the coroutine did not suspend.
+     * @param signal The signal of the stage.
+     */
+    static void unwatch(const std::shared_ptr<Wakeup> &wakeup, StageSignal *signal);
+
+    /**
+     * A method that queues a wakeup for when its time has come.
+     * @param when When to fire it.
+     * @param wakeup The wakeup.
+     */
+    void schedule_at(std::chrono::steady_clock::time_point when, std::shared_ptr<Wakeup> wakeup);
+
+    /**
+     * The loop of the threads: resumes the queued coroutines, and fires the wakeups whose time has come.
+     * @param index The index of the thread.
+     */
+    void run(int index);
+
+    std::mutex mutex; // protects everything below, except the counters
+    std::condition_variable condition; // signalled when a coroutine is queued, a timer is added, or on stop
+    std::deque<std::coroutine_handle<>> ready; // the coroutines to resume
+    std::multimap<std::chrono::steady_clock::time_point, std::shared_ptr<Wakeup>> timers; // wakeups, by time
+    bool stopping = false; // whether the threads must return
+    std::vector<std::thread> threads; // the threads of the executor
+    int team_width = 1; // OpenMP threads of the parallel regions of the callbacks, set before the threads start
+    std::atomic<long long> resumes{0}; // coroutines resumed
+    std::atomic<long long> interrupts{0}; // waits for an item that were ended by a change of the stage
+};
+
+#endif //VISION_CPP_STAGE_EXECUTOR_H
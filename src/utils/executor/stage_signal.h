@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_STAGE_SIGNAL_H
+#define VISION_CPP_STAGE_SIGNAL_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+
+/**
+ * A class that tells a suspended stage coroutine that its stage changed (it was parked, woken up or stopped, see
+ * ProcessorState), so that it does not sleep through the change until its next frame.
+ * Like a WatchChannel, it has a version incremented by every change, and one-shot wakers called by the next one.
+ */
+class StageSignal {
+public:
+    /**
+     * Returns the number of changes so far, without taking the lock.
+     * @return The version of the signal.
+     */
+    uint64_t get_version() const {
+        return version.load();
+    }
+
+    /**
+     * Records a change, and calls the wakers registered for it.
+     */
+    void notify() {
+        std::map<int, std::function<void()>> woken;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            version.fetch_add(1);
+            woken.swap(wakers);
+        }
+        for (auto &pair: woken) {
+            pair.second();
+        }
+    }
+
+    /**
+     * Registers a function that is called once, by the next change. It must be cheap, like the wakers of a channel.
+     * @param seen_version The last version the caller saw.
+     * @param waker The function to call.
+     * @return An identifier to pass to remove_waker, or -1 if the signal is already past seen_version: the function
+     * is then not registered.
+     */
+    int add_waker(uint64_t seen_version, std::function<void()> waker) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (version.load() != seen_version) {
+            return -1;
+        }
+        int id = next_id++;
+        wakers[id] = std::move(waker);
+        return id;
+    }
+
+    /**
+     * Removes a function registered with add_waker that was not called yet.
+     * @param id The identifier returned by add_waker.
+     */
+    void remove_waker(int id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakers.erase(id);
+    }
+
+private:
+    std::mutex mutex; // protects the wakers, and orders them with the changes
+    std::atomic<uint64_t> version{0}; // the number of changes so far
+    std::map<int, std::function<void()>> wakers; // the functions called by the next change only
+    int next_id = 0; // the identifier of the next waker
+};
+
+#endif //VISION_CPP_STAGE_SIGNAL_H
@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_STAGE_TASK_H
+#define VISION_CPP_STAGE_TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <utility>
+
+/**
+ * A class that holds the coroutine of a stage (see Processor::run and the process functions of the tasks).
+ * The coroutine starts suspended. A task that owns it resumes it once, on a thread of its own or on a StageExecutor,
+ * and is told when it ends through set_on_done. A coroutine can also co_await another StageTask, which then runs
+ * right away and resumes the caller when it ends.
+ * With a thread per stage nothing ever suspends, so the first resume runs the whole stage.
+ */
+class StageTask {
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    /**
+     * A structure that resumes whoever awaited the coroutine when it ends, or calls the function set with set_on_done.
+     */
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        std::coroutine_handle<> await_suspend(Handle handle) noexcept {
+            promise_type &promise = handle.promise();
+            if (promise.continuation) {
+                return promise.continuation;
+            }
+            // the coroutine is suspended from here on, and may be destroyed by whoever on_done wakes up: the function
+            // is moved out of the frame first, and nothing touches the frame after it
+            std::function<void()> on_done = std::move(promise.on_done);
+            if (on_done) {
+                on_done();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    struct promise_type {
+        std::coroutine_handle<> continuation; // coroutine awaiting this one, if any
+        std::function<void()> on_done; // called when a coroutine nobody awaits ends
+
+        StageTask get_return_object() {
+            return StageTask(Handle::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    StageTask() = default;
+
+    explicit StageTask(Handle handle) : handle(handle) {}
+
+    StageTask(StageTask &&other) noexcept: handle(std::exchange(other.handle, nullptr)) {}
+
+    StageTask &operator=(StageTask &&other) noexcept {
+        if (this != &other) {
+            destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    StageTask(const StageTask &) = delete;
+
+    StageTask &operator=(const StageTask &) = delete;
+
+    /**
+     * A destructor that destroys the coroutine. It must not be running: either not started, or ended.
+     */
+    ~StageTask() {
+        destroy();
+    }
+
+    /**
+     * A method that sets the function called, on the thread that ran its last step, when the coroutine ends.
+     * The coroutine is already suspended at its final point when it is called, so the function may let another
+     * thread destroy it; whatever the function needs must therefore not live in the coroutine (or in its owner).
+     * @param on_done The function.
+     */
+    void set_on_done(std::function<void()> on_done) {
+        handle.promise().on_done = std::move(on_done);
+    }
+
+    /**
+     * A method that returns the handle of the coroutine, to resume it.
+     * @return The handle, empty for a default constructed task.
+     */
+    [[nodiscard]] std::coroutine_handle<> get_handle() const {
+        return handle;
+    }
+
+    bool await_ready() noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        handle.promise().continuation = caller;
+        return handle;
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    void destroy() {
+        if (handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+    Handle handle; // the coroutine
+};
+
+#endif //VISION_CPP_STAGE_TASK_H
@@ -9,25 +9,47 @@
 #include "kernels.h"
 
 /**
- * This function converts a color image to grayscale using OpenCV library
+ * This function converts a color image to grayscale with the fixed-point BT.601 weights of OpenCV's BGR2GRAY
  * It takes two parameters: frame (the input image) and output (the output image)
  * It does not return anything
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
+ * A single-channel input (e.g. the Y plane of a YUV frame) already is grayscale, and is passed through without a copy
  * @param frame The input color image
  * @param output The output grayscale image
  */
 void grayscale(cv::Mat &frame, cv::Mat &output) {
-    cv::cvtColor(frame, output, cv::COLOR_BGR2GRAY);
+    TRACE_SCOPE("grayscale");
+    if (frame.channels() == 1) {
+        output = frame;
+        return;
+    }
+    output.create(frame.rows, frame.cols, CV_8UC1);
+
+    const KernelTable &kernels = get_kernels();
+# pragma omp parallel for default(none) shared(kernels, frame, output)
+    for (int row_idx = 0; row_idx < frame.rows; row_idx++) {
+        kernels.bgr_to_gray(frame.ptr<uchar>(row_idx), output.ptr<uchar>(row_idx), frame.cols);
+    }
 }
 
 /**
- * This function creates a negative image by inverting the pixel values using OpenCV library
+ * This function creates a negative image by inverting the pixel values
  * It takes two parameters: input (the input image) and output (the output image)
  * It does not return anything
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
  * @param input The input image
  * @param output The output negative image
  */
 void negative(cv::Mat &input, cv::Mat &output) {
-    cv::bitwise_not(input, output);
+    TRACE_SCOPE("negative");
+    output.create(input.rows, input.cols, input.type());
+    int width = input.cols * input.channels();
+
+    const KernelTable &kernels = get_kernels();
+# pragma omp parallel for default(none) shared(kernels, input, output, width)
+    for (int row_idx = 0; row_idx < input.rows; row_idx++) {
+        kernels.negative(input.ptr<uchar>(row_idx), output.ptr<uchar>(row_idx), width);
+    }
 }
 
 /**
@@ -40,6 +62,7 @@ void negative(cv::Mat &input, cv::Mat &output) {
  * @param kernel The vector of filter coefficients
  */
 void blur5x5(cv::Mat &input, cv::Mat &output) {
+    TRACE_SCOPE("blur5x5");
     std::vector<int> kernel = {2, 4, 6, 4, 2};
     apply_kernel(input, output, kernel, 2);
 }
@@ -54,11 +77,12 @@ void blur5x5(cv::Mat &input, cv::Mat &output) {
  * @param output The output horizontal gradient image
  */
 void sobel_x(cv::Mat &input, cv::Mat &output) {
+    TRACE_SCOPE("sobel_x");
     std::vector<int> kernel_1 = {1, 2, 1};
     std::vector<int> kernel_2 = {-1, 0, +1};
 
 //    cv::Mat intermediate = cv::Mat::zeros(input.rows, input.cols, CV_8UC3);
-    output = cv::Mat::zeros(input.rows, input.cols, CV_8UC3);
+    output = cv::Mat::zeros(input.rows, input.cols, input.type());
 
 //    apply_partial_kernel_row(input, intermediate, kernel_1, 1);
     apply_partial_kernel_col(input, output, kernel_2, 1);
@@ -74,11 +98,12 @@ void sobel_x(cv::Mat &input, cv::Mat &output) {
  * @param output The output vertical gradient image
  */
 void sobel_y(cv::Mat &input, cv::Mat &output) {
+    TRACE_SCOPE("sobel_y");
     std::vector<int> kernel_1 = {-1, 0, +1};
     std::vector<int> kernel_2 = {1, 2, 1};
 
 //    cv::Mat intermediate = cv::Mat::zeros(input.rows, input.cols, CV_8UC3);
-    output = cv::Mat::zeros(input.rows, input.cols, CV_8UC3);
+    output = cv::Mat::zeros(input.rows, input.cols, input.type());
 
     apply_partial_kernel_row(input, output, kernel_1, 1);
 //    apply_partial_kernel_col(intermediate, output, kernel_2, 1);
@@ -89,27 +114,66 @@ void sobel_y(cv::Mat &input, cv::Mat &output) {
  * It takes three parameters: sobel_input_1 (the horizontal gradient image), sobel_input_2 (the vertical gradient image), and output (the output image)
  * It does not return anything
  * It throws an exception if the inputs are not of the same size
- * It uses OpenMP to parallelize the computation for each pixel
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
+ * Only the first channel of the gradients is used; single-channel gradients give a single-channel magnitude
  * @param sobel_input_1 The horizontal gradient image
  * @param sobel_input_2 The vertical gradient image
  * @param output The output magnitude of the gradient image
  */
 void magnitude(cv::Mat &sobel_input_1, cv::Mat &sobel_input_2, cv::Mat &output) {
+    TRACE_SCOPE("magnitude");
     if (sobel_input_1.rows != sobel_input_2.rows || sobel_input_1.cols != sobel_input_2.cols) {
         throw std::invalid_argument("Sobel inputs must be the same size");
     }
 
-    output = cv::Mat::zeros(sobel_input_1.rows, sobel_input_1.cols, CV_8UC3);
+    const KernelTable &kernels = get_kernels();
+    if (sobel_input_1.channels() == 1 && sobel_input_2.channels() == 1) {
+        output.create(sobel_input_1.rows, sobel_input_1.cols, CV_8UC1);
+
+# pragma omp parallel for default(none) shared(kernels, sobel_input_1, sobel_input_2, output)
+        for (int row_idx = 0; row_idx < sobel_input_1.rows; row_idx++) {
+            kernels.magnitude_gray(sobel_input_1.ptr<uchar>(row_idx), sobel_input_2.ptr<uchar>(row_idx),
+                                   output.ptr<uchar>(row_idx), sobel_input_1.cols);
+        }
+        return;
+    }
+
+    output.create(sobel_input_1.rows, sobel_input_1.cols, CV_8UC3);
 
-# pragma omp parallel for default(none) shared(sobel_input_1, sobel_input_2, output)
+# pragma omp parallel for default(none) shared(kernels, sobel_input_1, sobel_input_2, output)
     for (int row_idx = 0; row_idx < sobel_input_1.rows; row_idx++) {
-        for (int col_idx = 0; col_idx < sobel_input_1.cols; col_idx++) {
-            cv::Vec3b pixel_1 = sobel_input_1.at<cv::Vec3b>(row_idx, col_idx);
-            cv::Vec3b pixel_2 = sobel_input_2.at<cv::Vec3b>(row_idx, col_idx);
+        kernels.magnitude_bgr(sobel_input_1.ptr<uchar>(row_idx), sobel_input_1.channels(),
+                              sobel_input_2.ptr<uchar>(row_idx), sobel_input_2.channels(), output.ptr<uchar>(row_idx),
+                              sobel_input_1.cols);
+    }
+}
 
-            int magnitude = std::sqrt(std::pow(pixel_1[0], 2) + std::pow(pixel_2[0], 2));
-            output.at<cv::Vec3b>(row_idx, col_idx) = cv::Vec3b(magnitude, magnitude, magnitude);
-        }
+/**
+ * This function computes the L1 magnitude of the gradient of an image, |x| + |y| saturated to 8 bits, using the
+ * outputs of sobel_x and sobel_y functions
+ * It is a cheaper approximation of magnitude (no square root), which the quality governor switches to under load
+ * It throws an exception if the inputs are not of the same size
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
+ * Only the first channel of the gradients is used; single-channel gradients give a single-channel magnitude
+ * @param sobel_input_1 The horizontal gradient image
+ * @param sobel_input_2 The vertical gradient image
+ * @param output The output magnitude of the gradient image
+ */
+void magnitude_l1(cv::Mat &sobel_input_1, cv::Mat &sobel_input_2, cv::Mat &output) {
+    TRACE_SCOPE("magnitude_l1");
+    if (sobel_input_1.rows != sobel_input_2.rows || sobel_input_1.cols != sobel_input_2.cols) {
+        throw std::invalid_argument("Sobel inputs must be the same size");
+    }
+
+    const KernelTable &kernels = get_kernels();
+    int channels = sobel_input_1.channels() == 1 && sobel_input_2.channels() == 1 ? 1 : 3;
+    output.create(sobel_input_1.rows, sobel_input_1.cols, CV_8UC(channels));
+
+# pragma omp parallel for default(none) shared(kernels, sobel_input_1, sobel_input_2, output, channels)
+    for (int row_idx = 0; row_idx < sobel_input_1.rows; row_idx++) {
+        kernels.magnitude_l1(sobel_input_1.ptr<uchar>(row_idx), sobel_input_1.channels(),
+                             sobel_input_2.ptr<uchar>(row_idx), sobel_input_2.channels(), output.ptr<uchar>(row_idx),
+                             channels, sobel_input_1.cols);
     }
 }
 
@@ -117,16 +181,17 @@ void magnitude(cv::Mat &sobel_input_1, cv::Mat &sobel_input_2, cv::Mat &output)
  * This function quantizes an image into a given number of levels using OpenCV library
  * It takes four parameters: input (the input image), output (the output image), levels (an integer representing the number of levels), and blur (a boolean indicating whether to blur the image before quantization or not)
  * It does not return anything
- * It throws an exception if the levels are less than 2
- * It uses OpenMP to parallelize the computation for each pixel
+ * It throws an exception if the levels are less than 2 or more than 255
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
  * @param input The input image
  * @param output The output quantized image
  * @param levels The number of levels for quantization
  * @param blur A flag indicating whether to blur the image or not before quantization. Default is true.
  */
 void quantize(cv::Mat &input, cv::Mat &output, int levels, bool blur = true) {
-    if (levels < 2) {
-        throw std::invalid_argument("Levels must be greater than 1");
+    TRACE_SCOPE("quantize");
+    if (levels < 2 || levels > 255) {
+        throw std::invalid_argument("Levels must be between 2 and 255");
     }
 
     int bins_count = 255 / levels;
@@ -138,17 +203,12 @@ void quantize(cv::Mat &input, cv::Mat &output, int levels, bool blur = true) {
         input = blurred;
     }
 
-    output = cv::Mat::zeros(input.rows, input.cols, CV_8UC3);
+    output.create(input.rows, input.cols, CV_8UC3);
 
-# pragma omp parallel for default(none) shared(input, output, bins_count)
+    const KernelTable &kernels = get_kernels();
+# pragma omp parallel for default(none) shared(kernels, input, output, bins_count)
     for (int row_idx = 0; row_idx < input.rows; row_idx++) {
-        for (int col_idx = 0; col_idx < input.cols; col_idx++) {
-            cv::Vec3b pixel = input.at<cv::Vec3b>(row_idx, col_idx);
-            for (int channel_idx = 0; channel_idx < 3; channel_idx++) {
-                int quantized = std::round(pixel[channel_idx] / bins_count) * bins_count;
-                output.at<cv::Vec3b>(row_idx, col_idx)[channel_idx] = quantized;
-            }
-        }
+        kernels.quantize(input.ptr<uchar>(row_idx), output.ptr<uchar>(row_idx), input.cols * 3, bins_count);
     }
 }
 
@@ -157,33 +217,137 @@ void quantize(cv::Mat &input, cv::Mat &output, int levels, bool blur = true) {
  * It takes four parameters: quantized_input (the quantized image), magnitude_input (the magnitude of the gradient image), output (the output image), and magnitude_threshold (an integer representing the threshold for edge detection)
  * It does not return anything
  * It throws an exception if the inputs are not of the same size
- * It uses OpenMP to parallelize the computation for each pixel
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
+ * The magnitude may be a single-channel or a 3-channel image; only its first channel is used
  * @param quantized_input The quantized image
  * @param magnitude_input The magnitude of the gradient image
  * @param output The output cartoonized image
  * @param magnitude_threshold The threshold for edge detection
  */
 void cartoonize(cv::Mat &quantized_input, cv::Mat &magnitude_input, cv::Mat &output, int magnitude_threshold) {
+    TRACE_SCOPE("cartoonize");
     if (quantized_input.rows != magnitude_input.rows || quantized_input.cols != magnitude_input.cols) {
         throw std::invalid_argument("Inputs must be the same size");
     }
 
-    output = cv::Mat::zeros(quantized_input.rows, quantized_input.cols, CV_8UC3);
+    output.create(quantized_input.rows, quantized_input.cols, CV_8UC3);
 
-# pragma omp parallel for default(none) shared(quantized_input, magnitude_input, output, magnitude_threshold)
+    const KernelTable &kernels = get_kernels();
+# pragma omp parallel for default(none) shared(kernels, quantized_input, magnitude_input, output, magnitude_threshold)
     for (int row_idx = 0; row_idx < quantized_input.rows; row_idx++) {
-        for (int col_idx = 0; col_idx < quantized_input.cols; col_idx++) {
-            cv::Vec3b quantized_pixel = quantized_input.at<cv::Vec3b>(row_idx, col_idx);
-            cv::Vec3b magnitude_pixel = magnitude_input.at<cv::Vec3b>(row_idx, col_idx);
-
-            int magnitude = magnitude_pixel[0];
-            if (magnitude > magnitude_threshold) {
-                output.at<cv::Vec3b>(row_idx, col_idx) = cv::Vec3b(0, 0, 0);
-            } else {
-                output.at<cv::Vec3b>(row_idx, col_idx) = quantized_pixel;
+        kernels.cartoonize(quantized_input.ptr<uchar>(row_idx), magnitude_input.ptr<uchar>(row_idx),
+                           magnitude_input.channels(), output.ptr<uchar>(row_idx), quantized_input.cols,
+                           magnitude_threshold);
+    }
+}
+
+/**
+ * This function detects motion by differencing a frame with the previous frame of the same stream
+ * It takes four parameters: current (the frame), previous (the previous frame), output (the motion mask), and threshold (the smallest difference that counts as motion)
+ * It does not return anything
+ * It throws an exception if the frames are not single-channel images of the same size
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
+ * @param current The current single-channel frame
+ * @param previous The previous single-channel frame
+ * @param output The output mask, 255 where the frame changed and 0 elsewhere
+ * @param threshold The smallest difference that counts as motion
+ */
+void motion_mask(cv::Mat &current, cv::Mat &previous, cv::Mat &output, int threshold) {
+    TRACE_SCOPE("motion_mask");
+    if (current.channels() != 1 || previous.channels() != 1) {
+        throw std::invalid_argument("Motion frames must be single-channel");
+    }
+    if (current.rows != previous.rows || current.cols != previous.cols) {
+        throw std::invalid_argument("Motion frames must be the same size");
+    }
+
+    output.create(current.rows, current.cols, CV_8UC1);
+
+    const KernelTable &kernels = get_kernels();
+# pragma omp parallel for default(none) shared(kernels, current, previous, output, threshold)
+    for (int row_idx = 0; row_idx < current.rows; row_idx++) {
+        kernels.motion_mask(current.ptr<uchar>(row_idx), previous.ptr<uchar>(row_idx), output.ptr<uchar>(row_idx),
+                            current.cols, threshold);
+    }
+}
+
+/**
+ * This function updates an exponential moving-average background model with a frame and returns the background
+ * It takes four parameters: input (the frame), model (the background model), output (the background), and shift (the weight of the frame, as a power of two)
+ * It does not return anything
+ * The model is kept in 8.8 fixed point (CV_16U, one value per channel); an empty model, or one of another size or type, starts from the frame
+ * It throws an exception if the shift is not between 0 and 8
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
+ * @param input The input frame
+ * @param model The background model, updated in place
+ * @param output The output background image
+ * @param shift The weight of the frame is 1 / 2^shift: larger shifts adapt more slowly
+ */
+void background_update(cv::Mat &input, cv::Mat &model, cv::Mat &output, int shift) {
+    TRACE_SCOPE("background_update");
+    if (shift < 0 || shift > 8) {
+        throw std::invalid_argument("Shift must be between 0 and 8");
+    }
+
+    int width = input.cols * input.channels();
+    if (model.rows != input.rows || model.cols != input.cols || model.type() != CV_16UC(input.channels())) {
+        model.create(input.rows, input.cols, CV_16UC(input.channels()));
+        for (int row_idx = 0; row_idx < input.rows; row_idx++) {
+            const uchar *input_row = input.ptr<uchar>(row_idx);
+            auto *model_row = model.ptr<uint16_t>(row_idx);
+            for (int i = 0; i < width; i++) {
+                model_row[i] = static_cast<uint16_t>(input_row[i] << 8);
             }
         }
     }
+
+    output.create(input.rows, input.cols, input.type());
+
+    const KernelTable &kernels = get_kernels();
+# pragma omp parallel for default(none) shared(kernels, input, model, output, width, shift)
+    for (int row_idx = 0; row_idx < input.rows; row_idx++) {
+        kernels.ema_update(input.ptr<uchar>(row_idx), model.ptr<uint16_t>(row_idx), output.ptr<uchar>(row_idx), width,
+                           shift);
+    }
+}
+
+/**
+ * This function reduces noise by averaging a frame with the previous frames of the same stream
+ * It takes four parameters: current (the frame), history (the previous frames, newest first), output (the denoised frame), and threshold (the largest difference that is averaged)
+ * It does not return anything
+ * Previous values that differ from the current one by more than the threshold are replaced by the current one, so that moving objects do not leave trails
+ * It throws an exception if there are MAX_TEMPORAL_FRAMES previous frames or more, or if they differ from the frame in size or type
+ * It uses OpenMP to parallelize the computation for each row, and the dispatched kernels within a row
+ * @param current The current frame
+ * @param history The previous frames, newest first; may be empty
+ * @param output The output denoised frame
+ * @param threshold The largest difference between a previous value and the current one that is averaged
+ */
+void temporal_denoise(cv::Mat &current, const std::vector<cv::Mat> &history, cv::Mat &output, int threshold) {
+    TRACE_SCOPE("temporal_denoise");
+    int count = static_cast<int>(history.size());
+    if (count >= MAX_TEMPORAL_FRAMES) {
+        throw std::invalid_argument("Too many previous frames");
+    }
+    for (auto &frame: history) {
+        if (frame.rows != current.rows || frame.cols != current.cols || frame.type() != current.type()) {
+            throw std::invalid_argument("Previous frames must be the same size and type");
+        }
+    }
+
+    output.create(current.rows, current.cols, current.type());
+    int width = current.cols * current.channels();
+
+    const KernelTable &kernels = get_kernels();
+# pragma omp parallel for default(none) shared(kernels, current, history, output, count, width, threshold)
+    for (int row_idx = 0; row_idx < current.rows; row_idx++) {
+        const uint8_t *previous[MAX_TEMPORAL_FRAMES];
+        for (int frame = 0; frame < count; frame++) {
+            previous[frame] = history[frame].ptr<uchar>(row_idx);
+        }
+        kernels.temporal_mean(current.ptr<uchar>(row_idx), previous, count, output.ptr<uchar>(row_idx), width,
+                              threshold);
+    }
 }
 
 #endif //VISION_CPP_FILTERS_H
@@ -0,0 +1,172 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "quality_governor.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const std::chrono::milliseconds UPDATE_PERIOD(500); // time between two decisions
+static const double HEADROOM = 0.6; // share of the target the outputs must stay under before a step is undone
+static const int RESTORE_AFTER = 4; // updates with headroom to spare before a step is undone
+static const double SMOOTHING = 0.5; // weight of the latest measurement in the smoothed ones
+
+/**
+ * Returns the name of a quality step, for the log.
+ */
+static const char *describe_step(QualityStep step) {
+    switch (step) {
+        case CHEAP_VARIANT:
+            return "cheap variant";
+        case HALF_RESOLUTION:
+            return "half resolution";
+        case SKIP_FRAMES:
+            return "frame skipping";
+    }
+    return "unknown step";
+}
+
+/**
+ * Rounds a time to a tenth of a millisecond, for the log.
+ */
+static double round_ms(double milliseconds) {
+    return std::round(milliseconds * 10) / 10;
+}
+
+int get_quality_mask(const std::vector<QualityStep> &steps, int level) {
+    int mask = 0;
+    for (int i = 0; i < level && i < static_cast<int>(steps.size()); i++) {
+        mask |= steps[i];
+    }
+    return mask;
+}
+
+int get_quality_level(const std::vector<QualityStep> &steps, int mask) {
+    int level = 0;
+    while (level < static_cast<int>(steps.size()) && (mask & steps[level]) != 0) {
+        level++;
+    }
+    return level;
+}
+
+QualityGovernor::QualityGovernor(double target_delay, std::ostream &log) {
+    this->target_delay = target_delay;
+    this->log = &log;
+    this->next_update = std::chrono::steady_clock::now() + UPDATE_PERIOD;
+}
+
+bool QualityGovernor::is_due() const {
+    return std::chrono::steady_clock::now() >= next_update;
+}
+
+double QualityGovernor::get_path_delay(const std::vector<GovernedStage> &stages, int index,
+                                       const std::vector<double> &delays, std::vector<double> &paths) {
+    if (paths[index] >= 0) {
+        return paths[index];
+    }
+    double slowest_input = 0;
+    for (int input: stages[index].inputs) {
+        slowest_input = std::max(slowest_input, get_path_delay(stages, input, delays, paths));
+    }
+    paths[index] = delays[index] + slowest_input;
+    return paths[index];
+}
+
+int QualityGovernor::update(std::vector<GovernedStage> &stages) {
+    next_update = std::chrono::steady_clock::now() + UPDATE_PERIOD;
+
+    // smoothed, so that a single slow frame does not cost a step; stages that are gone are forgotten
+    std::map<std::string, Measure> updated;
+    std::vector<double> frame_times, delays;
+    for (auto &stage: stages) {
+        Measure measure;
+        auto it = measures.find(stage.name);
+        double frame_time = stage.stats.frame_time / 1000.0;
+        double delay = stage.stats.delay / 1000.0;
+        if (it != measures.end()) {
+            measure.frame_time = SMOOTHING * frame_time + (1 - SMOOTHING) * it->second.frame_time;
+            measure.delay = SMOOTHING * delay + (1 - SMOOTHING) * it->second.delay;
+        } else {
+            measure.frame_time = frame_time;
+            measure.delay = delay;
+        }
+        updated[stage.name] = measure;
+        frame_times.push_back(measure.frame_time);
+        delays.push_back(measure.delay);
+    }
+    measures = std::move(updated);
+
+    std::vector<double> paths(stages.size(), -1);
+    int latest = -1;
+    for (int i = 0; i < static_cast<int>(stages.size()); i++) {
+        double path = get_path_delay(stages, i, delays, paths);
+        if (stages[i].stats.total_frames > 0 && (latest < 0 || path > paths[latest])) {
+            latest = i;
+        }
+    }
+
+    if (latest >= 0 && paths[latest] > target_delay) {
+        calm_periods = 0;
+        // the stage that costs the most on the late path, among those with a step left
+        std::vector<int> path = {latest};
+        std::vector<bool> seen(stages.size(), false);
+        int chosen = -1;
+        while (!path.empty()) {
+            int index = path.back();
+            path.pop_back();
+            if (seen[index]) {
+                continue;
+            }
+            seen[index] = true;
+            path.insert(path.end(), stages[index].inputs.begin(), stages[index].inputs.end());
+            if (stages[index].level < static_cast<int>(stages[index].steps.size()) &&
+                (chosen < 0 || frame_times[index] > frame_times[chosen])) {
+                chosen = index;
+            }
+        }
+        if (chosen < 0) {
+            return -1;
+        }
+        GovernedStage &stage = stages[chosen];
+        *log << "Governor: " << stage.name << " takes " << describe_step(stage.steps[stage.level]) << " ("
+             << stages[latest].name << " delay " << round_ms(paths[latest]) << " ms, over the " << target_delay
+             << " ms target)" << std::endl;
+        stage.level++;
+        taken.push_back(stage.name);
+        steps_taken++;
+        return chosen;
+    }
+
+    if (latest >= 0 && paths[latest] > target_delay * HEADROOM) {
+        calm_periods = 0;
+        return -1;
+    }
+    if (++calm_periods < RESTORE_AFTER) {
+        return -1;
+    }
+    calm_periods = 0;
+    // the last step taken first; steps of stages that were stopped since are dropped
+    while (!taken.empty()) {
+        std::string name = taken.back();
+        taken.pop_back();
+        for (int i = 0; i < static_cast<int>(stages.size()); i++) {
+            GovernedStage &stage = stages[i];
+            if (stage.name != name || stage.level == 0) {
+                continue;
+            }
+            stage.level--;
+            steps_undone++;
+            *log << "Governor: " << stage.name << " drops " << describe_step(stage.steps[stage.level]) << " ("
+                 << round_ms(latest >= 0 ? paths[latest] : 0) << " ms delay at most, under the " << target_delay
+                 << " ms target)" << std::endl;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void QualityGovernor::report(std::ostream &out) const {
+    out << "Governor: " << target_delay << " ms target, " << steps_taken << " quality steps taken, " << steps_undone
+        << " undone" << std::endl;
+}
@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_QUALITY_GOVERNOR_H
+#define VISION_CPP_QUALITY_GOVERNOR_H
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../processor/processor.h"
+
+/**
+ * A stage as the quality governor sees it, see QualityGovernor::update.
+ */
+struct GovernedStage {
+    std::string name; // name of the stage in the decisions logged, unique across the streams
+    StageStats stats; // statistics of the stage, for its frame time and its delay
+    std::vector<QualityStep> steps; // the steps the stage can take, in the order they are taken
+    int level = 0; // how many of the steps are taken, the first ones; updated by update
+    std::vector<int> inputs; // indices of the stages whose output the stage reads
+};
+
+/**
+ * A function that returns the quality steps a stage applies at a level.
+ * @param steps The steps the stage can take, in order.
+ * @param level How many of them are taken.
+ * @return The steps, as a bit mask (see ProcessorState::quality).
+ */
+int get_quality_mask(const std::vector<QualityStep> &steps, int level);
+
+/**
+ * A function that returns the level of a stage that applies some quality steps.
+ * @param steps The steps the stage can take, in order.
+ * @param mask The steps applied, as a bit mask.
+ * @return How many of the steps, the first ones, are applied.
+ */
+int get_quality_level(const std::vector<QualityStep> &steps, int mask);
+
+/**
+ * A class that trades the quality of the stages for latency, to keep the delay of every output under a target.
+ * The delay of an output is the delay of its stage (how old its input was when it was done with it) plus the delay of
+ * the slowest path to that input, so it runs from the write of the source frame to the write of the output.
+ * Every UPDATE_PERIOD, while some output is late, the stage with the longest frame time on its path takes its next
+ * quality step (a cheaper variant, half resolution, then frame skipping); once every output has had HEADROOM of the
+ * target to spare for RESTORE_AFTER periods, the last step taken is undone. One step at a time, so that the effect
+ * of a step is measured before the next. Every decision is logged.
+ */
+class QualityGovernor {
+public:
+    /**
+     * A constructor that creates a governor.
+     * @param target_delay The delay every output should stay under, in milliseconds.
+     * @param log The stream decisions are logged to.
+     */
+    QualityGovernor(double target_delay, std::ostream &log);
+
+    /**
+     * A method that tells whether the period has elapsed since the last update.
+     * @return true if update should be called.
+     */
+    bool is_due() const;
+
+    /**
+     * A method that takes or undoes at most one quality step, given the latest statistics of the stages.
+     * @param stages The running stages of every stream; the level of the stage changed is updated.
+     * @return The index of the stage whose level changed, -1 if none did.
+     */
+    int update(std::vector<GovernedStage> &stages);
+
+    /**
+     * A method that prints the number of steps taken and undone, and the current target.
+     * @param out The stream to print to.
+     */
+    void report(std::ostream &out) const;
+
+private:
+    /**
+     * A structure that holds the smoothed measurements of a stage.
+     */
+    struct Measure {
+        double frame_time = 0; // milliseconds
+        double delay = 0; // milliseconds
+    };
+
+    /**
+     * A method that returns the delay of the slowest path from the source to the output of a stage.
+     * @param stages The stages.
+     * @param index The index of the stage.
+     * @param delays The delays of the stages, smoothed.
+     * @param paths The path delays already computed, negative when not computed yet.
+     * @return The delay of the path, in milliseconds.
+     */
+    static double get_path_delay(const std::vector<GovernedStage> &stages, int index, const std::vector<double> &delays,
+                                 std::vector<double> &paths);
+
+    double target_delay; // milliseconds
+    std::ostream *log; // where decisions are logged
+    std::chrono::steady_clock::time_point next_update; // when update is due
+    std::map<std::string, Measure> measures; // smoothed measurements, by stage name
+    std::vector<std::string> taken; // the names of the stages that took a step, in order, for undoing them
+    int calm_periods = 0; // consecutive updates with HEADROOM to spare
+    long long steps_taken = 0; // quality steps taken
+    long long steps_undone = 0; // quality steps undone
+};
+
+#endif //VISION_CPP_QUALITY_GOVERNOR_H
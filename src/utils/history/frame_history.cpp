@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "frame_history.h"
+
+FrameHistory::FrameHistory(WatchChannel<cv::Mat> &channel) {
+    this->channel = &channel;
+}
+
+FrameHistory::~FrameHistory() {
+    std::lock_guard<std::mutex> users_lock(users_mutex);
+    if (subscription >= 0) {
+        channel->unsubscribe(subscription);
+    }
+}
+
+void FrameHistory::acquire(int depth) {
+    std::lock_guard<std::mutex> users_lock(users_mutex);
+    reserve(depth);
+
+    users++;
+    if (subscription < 0) {
+        subscription = channel->subscribe([this](const cv::Mat &frame) { record(frame); });
+    }
+}
+
+void FrameHistory::release() {
+    std::lock_guard<std::mutex> users_lock(users_mutex);
+    if (users == 0 || --users > 0) {
+        return;
+    }
+    // once unsubscribe returns, record is not running and won't be called again
+    channel->unsubscribe(subscription);
+    subscription = -1;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ring.clear();
+    next = 0;
+}
+
+void FrameHistory::reserve(int depth) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (depth <= static_cast<int>(ring.size())) {
+        return;
+    }
+    // oldest first, so that the slots past the frames kept are the next ones written
+    std::vector<Entry> grown;
+    grown.reserve(depth);
+    for (size_t i = 0; i < ring.size(); i++) {
+        grown.push_back(std::move(ring[(next + i) % ring.size()]));
+    }
+    next = static_cast<int>(grown.size());
+    grown.resize(depth);
+    ring = std::move(grown);
+}
+
+void FrameHistory::record(const cv::Mat &frame) {
+    // channels have a single writer, which calls this right after its write: the version is the one of this frame
+    uint64_t version = channel->get_version();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ring.empty()) {
+        return;
+    }
+    ring[next].version = version;
+    ring[next].frame = frame; // a reference: the old frame of the slot is released here, if nothing else holds it
+    next = (next + 1) % static_cast<int>(ring.size());
+}
+
+int FrameHistory::get_previous(uint64_t version, int count, std::vector<cv::Mat> &frames) {
+    frames.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    int size = static_cast<int>(ring.size());
+    // newest first; the current frame may or may not be recorded yet, and is skipped either way
+    for (int i = 1; i <= size && static_cast<int>(frames.size()) < count; i++) {
+        Entry &entry = ring[(next - i + size) % size];
+        if (entry.version == 0 || entry.frame.empty()) {
+            break;
+        }
+        if (entry.version < version) {
+            frames.push_back(entry.frame);
+        }
+    }
+    return static_cast<int>(frames.size());
+}
+
+int FrameHistory::get_depth() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<int>(ring.size());
+}
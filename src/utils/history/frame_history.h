@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_FRAME_HISTORY_H
+#define VISION_CPP_FRAME_HISTORY_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+#include "../watch_channel.h"
+
+/**
+ * A class that keeps the last frames written to a channel, for the filters that look back in time (motion, temporal
+ * denoise). The frames are not copied: the ring holds references to the frames the writer produced, which stay
+ * alive until they fall out of the ring. This relies on writers putting every frame into a new buffer, as the fetch
+ * thread and every task do.
+ * One history serves every task reading the same channel: each task acquires it with the depth it needs, and the
+ * ring keeps the deepest one. While nobody holds it, the history neither records nor keeps any frame.
+ */
+class FrameHistory {
+public:
+    /**
+     * A constructor that creates an empty history of a channel. Nothing is recorded until the history is acquired.
+     * @param channel The channel whose frames are recorded. Must outlive the history.
+     */
+    explicit FrameHistory(WatchChannel<cv::Mat> &channel);
+
+    /**
+     * A destructor that stops recording.
+     */
+    ~FrameHistory();
+
+    /**
+     * A method that registers a user of the history, and starts recording when it is the first one.
+     * @param depth The number of frames the user needs, the current one included.
+     */
+    void acquire(int depth);
+
+    /**
+     * A method that unregisters a user of the history. When it is the last one, recording stops and the frames are
+     * released.
+     */
+    void release();
+
+    /**
+     * A method that deepens the ring of a history already acquired, for a user that needs more frames than it
+     * acquired it with. The frames kept stay, and the new slots fill with the next frames. The ring never shrinks.
+     * @param depth The number of frames needed, the current one included.
+     */
+    void reserve(int depth);
+
+    /**
+     * A method that returns the frames written to the channel before a given version, newest first.
+     * Only frames written while the history was acquired are known; fewer than count are returned otherwise.
+     * @param version The version of the current frame, as returned by WatchChannel::read.
+     * @param count The number of previous frames wanted.
+     * @param frames A reference to the vector to fill in with references to the frames.
+     * @return The number of frames returned.
+     */
+    int get_previous(uint64_t version, int count, std::vector<cv::Mat> &frames);
+
+    /**
+     * A method that returns the number of frames the history keeps.
+     * @return The depth of the ring, 0 while the history is not acquired.
+     */
+    int get_depth();
+
+private:
+    /**
+     * A method that adds a frame to the ring, dropping the oldest one. Called on the writer's thread.
+     * @param frame The frame written to the channel.
+     */
+    void record(const cv::Mat &frame);
+
+    /**
+     * A structure that holds one frame of the ring.
+     */
+    struct Entry {
+        uint64_t version = 0; // version of the channel the frame was written as, 0 for an empty slot
+        cv::Mat frame; // reference to the frame
+    };
+
+    WatchChannel<cv::Mat> *channel; // channel whose frames are recorded
+    // taken before the subscription lock of the channel, which the writer holds while it calls record: never the other
+    // way round
+    std::mutex users_mutex; // protects users and subscription
+    int users = 0; // number of acquire calls not yet released
+    int subscription = -1; // identifier of the channel subscription, -1 when not recording
+    std::mutex mutex; // protects the ring
+    std::vector<Entry> ring; // the last frames, oldest overwritten first
+    int next = 0; // slot the next frame goes to
+};
+
+#endif //VISION_CPP_FRAME_HISTORY_H
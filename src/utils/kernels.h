@@ -6,6 +6,8 @@
 #define VISION_CPP_KERNELS_H
 
 #include <opencv2/opencv.hpp>
+#include "simd/dispatch.h"
+#include "trace/trace.h"
 
 /**
  * Returns a valid index for accessing an array or matrix element, given an index, an offset and a maximum value.
@@ -28,17 +30,11 @@ int get_valid_index(int index, int offset, int max) {
 }
 
 /**
- * Applies a partial kernel to a row of an input image and stores the result in an output image.
- * The partial kernel is a one-dimensional vector of integers that represents a convolution filter.
- * The function performs a weighted sum of the pixel values in the row and its neighboring rows, using the kernel values as weights.
- * The function also normalizes the result by dividing it by the sum of the kernel values, or by 1 if the sum is zero.
- * The function uses OpenMP directives to parallelize the computation for each row.
- * @param input The input image (a matrix of 3-channel pixels).
- * @param output The output image (a matrix of 3-channel pixels).
+ * Returns the reciprocal of the sum of the kernel values, or 1 if they sum to zero, to normalise weighted sums with.
  * @param kernel The partial kernel (a vector of integers).
- * @param kernel_offset The offset of the kernel from the center of the row. For example, if kernel_offset = 1, then the kernel is applied to the row and its upper neighbor. If kernel_offset = 2, then the kernel is applied to the row and its upper and upper-upper neighbors.
+ * @return 1 / sum, or 1.
  */
-void apply_partial_kernel_row(cv::Mat &input, cv::Mat &output, std::vector<int> &kernel, int kernel_offset) {
+double get_inverse_kernel_sum(const std::vector<int> &kernel) {
     int kernel_sum = 0;
     for (int i: kernel) {
         kernel_sum += i;
@@ -46,27 +42,40 @@ void apply_partial_kernel_row(cv::Mat &input, cv::Mat &output, std::vector<int>
     if (kernel_sum == 0) {
         kernel_sum = 1;
     }
+    return 1.0 / kernel_sum;
+}
 
-#pragma omp parallel for default(none) shared(kernel_offset, input, output, kernel, kernel_sum)
-    for (int row = 0; row < input.rows; row++) {
-        for (int col = 0; col < input.cols; col++) {
-            cv::Vec3i buffer_result = cv::Vec3i{0, 0, 0};
-
-            int kernel_idx = 0;
-            for (int row_offset = -kernel_offset; row_offset <= kernel_offset; row_offset++) {
-                int row_idx = get_valid_index(row, row_offset, input.rows);
-
-                cv::Vec3b current_pixel = input.at<cv::Vec3b>(row_idx, col);
+/**
+ * Applies a partial kernel to a row of an input image and stores the result in an output image.
+ * The partial kernel is a one-dimensional vector of integers that represents a convolution filter.
+ * The function performs a weighted sum of the pixel values in the row and its neighboring rows, using the kernel values as weights.
+ * The function also normalizes the result by dividing it by the sum of the kernel values, or by 1 if the sum is zero.
+ * The function uses OpenMP directives to parallelize the computation for each row, and the kernels of the instruction
+ * set picked at startup (see simd/dispatch.h) within a row.
+ * Both single-channel images (e.g. the luminance plane of a YUV frame) and 3-channel images are supported.
+ * @param input The input image (a matrix of 8-bit pixels).
+ * @param output The output image (a matrix of 8-bit pixels, with as many channels as the input).
+ * @param kernel The partial kernel (a vector of at most MAX_KERNEL_TAPS integers).
+ * @param kernel_offset The offset of the kernel from the center of the row. For example, if kernel_offset = 1, then the kernel is applied to the row and its upper neighbor. If kernel_offset = 2, then the kernel is applied to the row and its upper and upper-upper neighbors.
+ */
+void apply_partial_kernel_row(cv::Mat &input, cv::Mat &output, const std::vector<int> &kernel, int kernel_offset) {
+    TRACE_SCOPE("apply_partial_kernel_row");
+    int taps = 2 * kernel_offset + 1;
+    if (taps > MAX_KERNEL_TAPS || static_cast<int>(kernel.size()) < taps) {
+        throw std::invalid_argument("Partial kernels must have 2 * offset + 1 taps, at most 63");
+    }
 
-                for (int channel_idx = 0; channel_idx < 3; channel_idx++) {
-                    buffer_result[channel_idx] += current_pixel[channel_idx] * kernel[kernel_idx];
-                }
-                kernel_idx++;
-            }
+    const KernelTable &kernels = get_kernels();
+    double inverse_sum = get_inverse_kernel_sum(kernel);
+    int width = input.cols * input.channels();
 
-            cv::Vec3b pixel = buffer_result / kernel_sum;
-            output.at<cv::Vec3b>(row, col) = pixel;
+#pragma omp parallel for default(none) shared(kernels, kernel_offset, taps, input, output, kernel, inverse_sum, width)
+    for (int row = 0; row < input.rows; row++) {
+        const uchar *rows[MAX_KERNEL_TAPS];
+        for (int tap = 0; tap < taps; tap++) {
+            rows[tap] = input.ptr<uchar>(get_valid_index(row, tap - kernel_offset, input.rows));
         }
+        kernels.partial_kernel_row(rows, taps, kernel.data(), inverse_sum, output.ptr<uchar>(row), width);
     }
 }
 
@@ -75,40 +84,27 @@ void apply_partial_kernel_row(cv::Mat &input, cv::Mat &output, std::vector<int>
  * The partial kernel is a one-dimensional vector of integers that represents a convolution filter.
  * The function performs a weighted sum of the pixel values in the column and its neighboring columns, using the kernel values as weights.
  * The function also normalizes the result by dividing it by the sum of the kernel values, or by 1 if the sum is zero.
- * The function uses OpenMP directives to parallelize the computation for each column.
- * @param input The input image (a matrix of 3-channel pixels).
- * @param output The output image (a matrix of 3-channel pixels).
+ * The function uses OpenMP directives to parallelize the computation for each row, and the kernels of the instruction
+ * set picked at startup (see simd/dispatch.h) within a row.
+ * Both single-channel images (e.g. the luminance plane of a YUV frame) and 3-channel images are supported.
+ * @param input The input image (a matrix of 8-bit pixels).
+ * @param output The output image (a matrix of 8-bit pixels, with as many channels as the input).
  * @param kernel The partial kernel (a vector of integers).
  * @param kernel_offset The offset of the kernel from the center of the column. For example, if kernel_offset = 1, then the kernel is applied to the column and its left neighbor. If kernel_offset = 2, then the kernel is applied to the column and its left and left-left neighbors.
  */
-void apply_partial_kernel_col(cv::Mat &input, cv::Mat &output, std::vector<int> &kernel, int kernel_offset) {
-    int kernel_sum = 0;
-    for (int i: kernel) {
-        kernel_sum += i;
+void apply_partial_kernel_col(cv::Mat &input, cv::Mat &output, const std::vector<int> &kernel, int kernel_offset) {
+    TRACE_SCOPE("apply_partial_kernel_col");
+    if (static_cast<int>(kernel.size()) < 2 * kernel_offset + 1) {
+        throw std::invalid_argument("Partial kernels must have 2 * offset + 1 taps");
     }
-    if (kernel_sum == 0) {
-        kernel_sum = 1;
-    }
-
-#pragma omp parallel for default(none) shared(kernel_offset, input, output, kernel, kernel_sum)
-    for (int row = 0; row < input.rows; row++) {
-        for (int col = 0; col < input.cols; col++) {
-            cv::Vec3i buffer_result = cv::Vec3i{0, 0, 0};
-            int kernel_idx = 0;
-
-            for (int col_offset = -kernel_offset; col_offset <= kernel_offset; col_offset++) {
-                int col_idx = get_valid_index(col, col_offset, input.cols);
 
-                cv::Vec3b current_pixel = input.at<cv::Vec3b>(row, col_idx);
-                for (int channel_idx = 0; channel_idx < 3; channel_idx++) {
-                    buffer_result[channel_idx] += current_pixel[channel_idx] * kernel[kernel_idx];
-                }
-                kernel_idx++;
-            }
+    const KernelTable &kernels = get_kernels();
+    double inverse_sum = get_inverse_kernel_sum(kernel);
 
-            cv::Vec3b pixel = buffer_result / kernel_sum;
-            output.at<cv::Vec3b>(row, col) = pixel;
-        }
+#pragma omp parallel for default(none) shared(kernels, kernel_offset, input, output, kernel, inverse_sum)
+    for (int row = 0; row < input.rows; row++) {
+        kernels.partial_kernel_col(input.ptr<uchar>(row), output.ptr<uchar>(row), input.cols, input.channels(),
+                                   kernel.data(), kernel_offset, inverse_sum);
     }
 }
 
@@ -126,9 +122,10 @@ void apply_partial_kernel_col(cv::Mat &input, cv::Mat &output, std::vector<int>
  * @param kernel The kernel to be used for both rows and columns (a vector of integers).
  * @param kernel_offset The offset of the kernel from the center of each pixel. For example, if kernel_offset = 1, then the kernel is a 3x3 matrix. If kernel_offset = 2, then the kernel is a 5x5 matrix.
  */
-void apply_kernel(cv::Mat &input, cv::Mat &output, std::vector<int> &kernel, int kernel_offset) {
-    cv::Mat intermediate = cv::Mat::zeros(input.rows, input.cols, CV_8UC3);
-    output = cv::Mat::zeros(input.rows, input.cols, CV_8UC3);
+void apply_kernel(cv::Mat &input, cv::Mat &output, const std::vector<int> &kernel, int kernel_offset) {
+    TRACE_SCOPE("apply_kernel");
+    cv::Mat intermediate = cv::Mat::zeros(input.rows, input.cols, input.type());
+    output = cv::Mat::zeros(input.rows, input.cols, input.type());
 
     apply_partial_kernel_row(input, intermediate, kernel, kernel_offset);
     apply_partial_kernel_col(intermediate, output, kernel, kernel_offset);
@@ -0,0 +1,283 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "frame_allocator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <string>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const size_t HUGE_PAGE = 2 << 20; // huge page size of x86-64 and most aarch64 kernels
+static const size_t ARENA_SIZE = 64 << 20; // smallest arena mapped at once
+static const size_t SMALL_GRANULARITY = 64 << 10; // smallest block; smaller buffers are left to OpenCV
+static const size_t BLOCK_HEADER = FRAME_ALIGNMENT; // in front of every block, keeps the data aligned
+static const size_t PADDED_ROW_MIN = 256; // shorter rows are not padded: small matrices (kernels, tables) stay continuous
+
+/**
+ * What a block remembers about itself, so that it can be freed without a lookup.
+ */
+struct BlockHeader {
+    size_t size; // size of the block, header included
+    int node; // NUMA node the block belongs to
+};
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * Returns the number of NUMA nodes (the highest node id plus one), 1 where this cannot be told.
+ */
+static int count_nodes() {
+    int nodes = 1;
+#ifdef __linux__
+    std::error_code error;
+    for (auto &entry: std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) == 0 && name.size() > 4 && std::isdigit(static_cast<unsigned char>(name[4]))) {
+            nodes = std::max(nodes, std::atoi(name.c_str() + 4) + 1);
+        }
+    }
+#endif
+    return nodes;
+}
+
+/**
+ * Returns the NUMA node of the CPU the calling thread runs on.
+ */
+static int current_node(int nodes) {
+#ifdef __linux__
+    if (nodes > 1) {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 && static_cast<int>(node) < nodes) {
+            return static_cast<int>(node);
+        }
+    }
+#endif
+    return 0;
+}
+
+FrameAllocator::FrameAllocator(bool huge_pages) {
+    this->huge_pages = huge_pages;
+    this->nodes = count_nodes();
+    this->arenas.resize(nodes);
+    this->stats.nodes = nodes;
+}
+
+FrameAllocator::~FrameAllocator() {
+    for (auto &mapping: mappings) {
+#ifdef __linux__
+        munmap(mapping.first, mapping.second);
+#else
+        std::free(mapping.first);
+#endif
+    }
+}
+
+int FrameAllocator::map_arena(size_t size, int node) const {
+    size_t length = align_up(std::max(size, ARENA_SIZE), HUGE_PAGE);
+    void *memory = nullptr;
+    bool huge = false;
+#ifdef __linux__
+    if (huge_pages) {
+        // the hugetlbfs pool is empty unless the administrator reserved pages (vm.nr_hugepages)
+        memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge = memory != MAP_FAILED;
+    }
+    if (!huge) {
+        // one huge page more than needed, to start the arena on a huge page boundary as transparent huge pages need
+        size_t mapped = length + HUGE_PAGE;
+        void *raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            return -1;
+        }
+        char *start = static_cast<char *>(raw);
+        char *aligned = reinterpret_cast<char *>(align_up(reinterpret_cast<uintptr_t>(start), HUGE_PAGE));
+        if (aligned > start) {
+            munmap(start, aligned - start);
+        }
+        if (start + mapped > aligned + length) {
+            munmap(aligned + length, start + mapped - (aligned + length));
+        }
+        memory = aligned;
+        huge = huge_pages && madvise(memory, length, MADV_HUGEPAGE) == 0;
+    }
+    if (nodes > 1) {
+        // preferred rather than bound: a full node falls back to another instead of failing the allocation
+        unsigned long mask = 1UL << node;
+        syscall(SYS_mbind, memory, length, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+    }
+#else
+    memory = std::aligned_alloc(HUGE_PAGE, length);
+    if (memory == nullptr) {
+        return -1;
+    }
+#endif
+
+    mappings.emplace_back(memory, length);
+    arenas[node].next = static_cast<char *>(memory);
+    arenas[node].end = static_cast<char *>(memory) + length;
+    stats.reserved_bytes += length;
+    stats.huge_page_bytes += huge ? length : 0;
+    return 0;
+}
+
+char *FrameAllocator::take_block(size_t size, int node) const {
+    auto it = free_blocks.find({node, size});
+    if (it != free_blocks.end() && !it->second.empty()) {
+        char *block = it->second.back();
+        it->second.pop_back();
+        stats.reused++;
+        return block;
+    }
+
+    Arena &arena = arenas[node];
+    if (arena.next == nullptr || static_cast<size_t>(arena.end - arena.next) < size) {
+        // the rest of the current arena is left unused: frames come in a few sizes, a smaller one may never come
+        if (map_arena(size, node) != 0) {
+            return nullptr;
+        }
+    }
+    char *block = arena.next;
+    arena.next += size;
+    return block;
+}
+
+cv::UMatData *FrameAllocator::allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                                       cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const {
+    if (data != nullptr || dims <= 0) {
+        // wrapping memory the caller owns: nothing to place
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+    }
+
+    // every row starts on a FRAME_ALIGNMENT boundary, padded if needed, when the caller lets us choose the steps
+    size_t row = CV_ELEM_SIZE(type) * static_cast<size_t>(sizes[dims - 1]);
+    size_t stride = dims >= 2 && step != nullptr && row >= PADDED_ROW_MIN ? align_up(row, FRAME_ALIGNMENT) : row;
+    if (step != nullptr) {
+        step[dims - 1] = CV_ELEM_SIZE(type);
+    }
+    size_t total = dims >= 2 ? stride : row;
+    for (int i = dims - 2; i >= 0; i--) {
+        if (step != nullptr) {
+            step[i] = total;
+        }
+        total *= static_cast<size_t>(sizes[i]);
+    }
+
+    if (total < SMALL_GRANULARITY) {
+        // kernels, tables and thumbnails: not worth a block of their own
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, nullptr, step, flags, usage_flags);
+    }
+    size_t needed = BLOCK_HEADER + total;
+    size_t size = align_up(needed, needed < HUGE_PAGE ? SMALL_GRANULARITY : HUGE_PAGE);
+    int node = current_node(nodes);
+
+    char *block;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        block = take_block(size, node);
+        if (block != nullptr) {
+            stats.live_frames++;
+            stats.allocations++;
+        }
+    }
+    if (block == nullptr) {
+        // out of address space or memory: let OpenCV try (and report the failure the usual way)
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, nullptr, step, flags, usage_flags);
+    }
+
+    auto *header = reinterpret_cast<BlockHeader *>(block);
+    header->size = size;
+    header->node = node;
+
+    auto *u = new cv::UMatData(this);
+    u->data = u->origdata = reinterpret_cast<uchar *>(block + BLOCK_HEADER);
+    u->size = total;
+    return u;
+}
+
+bool FrameAllocator::allocate(cv::UMatData *data, cv::AccessFlag, cv::UMatUsageFlags) const {
+    return data != nullptr;
+}
+
+void FrameAllocator::deallocate(cv::UMatData *data) const {
+    if (data == nullptr) {
+        return;
+    }
+    CV_Assert(data->urefcount == 0);
+    CV_Assert(data->refcount == 0);
+
+    char *block = reinterpret_cast<char *>(data->origdata) - BLOCK_HEADER;
+    auto *header = reinterpret_cast<BlockHeader *>(block);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_blocks[{header->node, header->size}].push_back(block);
+        stats.live_frames--;
+    }
+    delete data;
+}
+
+FrameAllocatorStats FrameAllocator::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void FrameAllocator::report(std::ostream &out, const std::string &name) const {
+    FrameAllocatorStats copy = get_stats();
+    out << std::fixed << std::setprecision(1) << "Frame allocator " << name << ": " << copy.reserved_bytes / 1048576.0
+        << " MiB reserved (" << copy.huge_page_bytes / 1048576.0 << " MiB huge pages) on " << copy.nodes
+        << (copy.nodes == 1 ? " node, " : " nodes, ") << copy.allocations << " frames allocated, " << copy.reused
+        << " recycled, " << copy.live_frames << " alive" << std::endl;
+}
+
+/**
+ * The process-wide default allocator installed by set_thread_allocator: it hands every allocation to the allocator
+ * of the calling thread. The buffers it returns belong to that allocator, which frees them, so it never frees any.
+ */
+class ThreadAllocatorRouter : public cv::MatAllocator {
+public:
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, cv::AccessFlag flags,
+                           cv::UMatUsageFlags usage_flags) const override;
+
+    bool allocate(cv::UMatData *data, cv::AccessFlag, cv::UMatUsageFlags) const override {
+        return data != nullptr;
+    }
+
+    void deallocate(cv::UMatData *data) const override {
+        if (data != nullptr && data->currAllocator != this) {
+            data->currAllocator->deallocate(data);
+        }
+    }
+};
+
+static thread_local cv::MatAllocator *thread_allocator = nullptr;
+
+cv::UMatData *ThreadAllocatorRouter::allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                                              cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const {
+    const cv::MatAllocator *allocator = thread_allocator != nullptr ? thread_allocator : cv::Mat::getStdAllocator();
+    return allocator->allocate(dims, sizes, type, data, step, flags, usage_flags);
+}
+
+void set_thread_allocator(cv::MatAllocator *allocator) {
+    static std::once_flag installed;
+    if (allocator != nullptr) {
+        std::call_once(installed, [] {
+            // never destroyed: frames may still be released while static objects are destroyed at exit
+            cv::Mat::setDefaultAllocator(new ThreadAllocatorRouter());
+        });
+    }
+    thread_allocator = allocator;
+}
@@ -0,0 +1,123 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_FRAME_ALLOCATOR_H
+#define VISION_CPP_FRAME_ALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+
+/**
+ * The alignment of frame buffers and of every row of a 2D frame, in bytes: a cache line, and the width of an
+ * AVX-512 vector.
+ */
+const size_t FRAME_ALIGNMENT = 64;
+
+/**
+ * A structure that holds the counters of a frame allocator.
+ */
+struct FrameAllocatorStats {
+    size_t reserved_bytes = 0; // memory mapped for the arenas
+    size_t huge_page_bytes = 0; // part of it backed by huge pages (hugetlbfs, or transparent huge pages advised)
+    long long live_frames = 0; // buffers currently handed out
+    long long allocations = 0; // buffers handed out since the start
+    long long reused = 0; // of which were recycled from a freed buffer
+    int nodes = 1; // NUMA nodes the arenas are split by
+};
+
+/**
+ * A cv::MatAllocator that carves frame buffers out of large arenas, for the frames of one pipeline.
+ * - Arenas are mapped in 2 MiB multiples, from the hugetlbfs pool when it has pages, and otherwise with transparent
+ *   huge pages requested (madvise), so that a 4K or 8K frame spans a handful of TLB entries instead of thousands.
+ * - Buffers start on a FRAME_ALIGNMENT boundary, and so does every row of a 2D frame: rows of at least 256 bytes
+ *   whose size is not a multiple of it are padded, which makes such frames non-continuous (use ptr(row), not
+ *   data + offset). Common resolutions (VGA to 8K, 1 or 3 channels) need no padding.
+ * - Arenas are split by NUMA node: a buffer comes from the node of the thread that allocates it, i.e. the stage that
+ *   writes the frame, and arenas are bound to their node. On single-node machines this does nothing.
+ * - Freed buffers are kept, per node and size, and handed out again: a pipeline allocates the same few frame sizes
+ *   over and over, so after the first frames no allocation reaches the kernel (nor faults in new pages).
+ * Buffers under 64 KiB (kernels, lookup tables) are left to OpenCV's standard allocator.
+ * Memory is only given back when the allocator is destroyed, so it must outlive every frame it allocated.
+ * Buffers may be freed from any thread. See set_thread_allocator to make it the allocator of a pipeline's threads.
+ */
+class FrameAllocator : public cv::MatAllocator {
+public:
+    /**
+     * A constructor that creates an allocator with no arena yet.
+     * @param huge_pages Whether arenas are backed by huge pages, when the system has them.
+     */
+    explicit FrameAllocator(bool huge_pages = true);
+
+    /**
+     * A destructor that unmaps the arenas. No frame allocated by the allocator may be alive.
+     */
+    ~FrameAllocator() override;
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, cv::AccessFlag flags,
+                           cv::UMatUsageFlags usage_flags) const override;
+
+    bool allocate(cv::UMatData *data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override;
+
+    void deallocate(cv::UMatData *data) const override;
+
+    /**
+     * A method that returns a copy of the counters of the allocator.
+     * @return The counters.
+     */
+    FrameAllocatorStats get_stats() const;
+
+    /**
+     * A method that prints the counters of the allocator.
+     * @param out The stream to print to.
+     * @param name A name for the allocator, e.g. the stream it serves.
+     */
+    void report(std::ostream &out, const std::string &name) const;
+
+private:
+    /**
+     * A structure that holds the bump pointer of the current arena of one node.
+     */
+    struct Arena {
+        char *next = nullptr; // first free byte
+        char *end = nullptr; // end of the arena
+    };
+
+    /**
+     * A method that returns a block of the given size (a multiple of the block granularity) on the given node.
+     * The mutex must be held.
+     * @return The block, nullptr if no memory could be mapped.
+     */
+    char *take_block(size_t size, int node) const;
+
+    /**
+     * A method that maps a new arena of at least the given size on the given node. The mutex must be held.
+     * @return 0 on success, -1 if no memory could be mapped.
+     */
+    int map_arena(size_t size, int node) const;
+
+    bool huge_pages; // whether arenas are backed by huge pages
+    int nodes; // NUMA nodes of the machine
+    mutable std::mutex mutex; // protects everything below
+    mutable std::vector<std::pair<void *, size_t>> mappings; // every arena, to unmap them
+    mutable std::vector<Arena> arenas; // the current arena of every node
+    mutable std::map<std::pair<int, size_t>, std::vector<char *>> free_blocks; // freed blocks, by node and size
+    mutable FrameAllocatorStats stats; // counters
+};
+
+/**
+ * A function that routes the allocations of cv::Mat on the calling thread to the given allocator, e.g. from the
+ * threads of a pipeline. Installs a process-wide default allocator the first time it is called with an allocator:
+ * threads that never call it keep allocating with OpenCV's standard allocator. Frames allocated on a thread can be
+ * freed from any other thread.
+ * @param allocator The allocator, or nullptr for OpenCV's standard allocator.
+ */
+void set_thread_allocator(cv::MatAllocator *allocator);
+
+#endif //VISION_CPP_FRAME_ALLOCATOR_H
@@ -0,0 +1,218 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "metrics.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../net/listener.h"
+
+/**
+ * Escapes a label value: backslashes, double quotes and line breaks must be escaped in the text format.
+ */
+static std::string escape_label(const std::string &value) {
+    std::string escaped;
+    for (char c: value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/**
+ * Formats a value: integers without a fraction (counters can exceed the 6 digits ostream shows by default).
+ */
+static std::string format_value(double value) {
+    if (std::isnan(value)) {
+        return "NaN";
+    }
+    char buffer[32];
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        std::snprintf(buffer, sizeof(buffer), "%.0f", value);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    }
+    return buffer;
+}
+
+void MetricsText::declare(const std::string &name, const std::string &type, const std::string &help) {
+    for (auto &family: families) {
+        if (family.name == name) {
+            return;
+        }
+    }
+    families.push_back({name, type, help, {}});
+}
+
+int MetricsText::add(const std::string &name, const MetricLabels &labels, double value, const std::string &suffix) {
+    for (auto &family: families) {
+        if (family.name != name) {
+            continue;
+        }
+        std::string line = name + suffix;
+        if (!labels.empty()) {
+            line += '{';
+            for (size_t i = 0; i < labels.size(); i++) {
+                line += (i > 0 ? "," : "") + labels[i].first + "=\"" + escape_label(labels[i].second) + '"';
+            }
+            line += '}';
+        }
+        family.samples.push_back(line + ' ' + format_value(value));
+        return 0;
+    }
+    return -1;
+}
+
+std::string MetricsText::str() const {
+    std::ostringstream out;
+    for (auto &family: families) {
+        if (family.samples.empty()) {
+            continue;
+        }
+        out << "# HELP " << family.name << ' ' << family.help << '\n';
+        out << "# TYPE " << family.name << ' ' << family.type << '\n';
+        for (auto &sample: family.samples) {
+            out << sample << '\n';
+        }
+    }
+    return out.str();
+}
+
+MetricsExporter::MetricsExporter(std::string path, std::string address, double interval) {
+    this->path = std::move(path);
+    this->address = std::move(address);
+    this->interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interval));
+    this->next_page = std::chrono::steady_clock::now();
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+int MetricsExporter::start() {
+    if (!address.empty()) {
+        listen_socket = open_listener(address, 4, "metrics endpoint");
+        if (listen_socket < 0) {
+            return -1;
+        }
+    }
+
+    running = true;
+    if (!path.empty()) {
+        writerThread = std::thread(&MetricsExporter::write_loop, this);
+    }
+    if (!address.empty()) {
+        acceptThread = std::thread(&MetricsExporter::accept_loop, this);
+        std::cout << "Serving metrics on " << address << " (GET /metrics)" << std::endl;
+    }
+    return 0;
+}
+
+void MetricsExporter::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lockGuard(mutex);
+        stopped = true;
+    }
+    page_available.notify_all();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+    if (acceptThread.joinable()) {
+        close_listener(listen_socket, address);
+        acceptThread.join();
+    }
+}
+
+bool MetricsExporter::is_due() const {
+    return std::chrono::steady_clock::now() >= next_page;
+}
+
+void MetricsExporter::publish(std::string new_page) {
+    next_page = std::chrono::steady_clock::now() + interval;
+    {
+        std::lock_guard<std::mutex> lockGuard(mutex);
+        page = std::move(new_page);
+        page_written = false;
+    }
+    page_available.notify_one();
+}
+
+void MetricsExporter::write_loop() {
+    std::string temporary_path = path + ".tmp";
+    while (true) {
+        std::string current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            page_available.wait(lock, [this] { return stopped || !page_written; });
+            if (page_written) {
+                return;
+            }
+            current = page;
+            page_written = true;
+        }
+
+        {
+            std::ofstream file(temporary_path, std::ios::trunc);
+            file << current;
+            file.close();
+            if (!file) {
+                std::cout << "Failed to write metrics to " << temporary_path << "." << std::endl;
+                continue;
+            }
+        }
+        if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            std::cout << "Failed to replace " << path << "." << std::endl;
+        }
+    }
+}
+
+void MetricsExporter::accept_loop() {
+    while (running) {
+        int client_socket = accept(listen_socket, nullptr, nullptr);
+        if (client_socket < 0) {
+            continue;
+        }
+        // scrapes are rare and small, so they are served one at a time on this thread
+        serve(client_socket);
+        close(client_socket);
+    }
+}
+
+void MetricsExporter::serve(int client_socket) {
+    timeval timeout{2, 0};
+    setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request = read_request(client_socket);
+
+    std::string response;
+    if (request.starts_with("GET /metrics ") || request.starts_with("GET /metrics?")) {
+        std::string current;
+        {
+            std::lock_guard<std::mutex> lockGuard(mutex);
+            current = page;
+        }
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n"
+                   "Content-Length: " + std::to_string(current.size()) + "\r\n\r\n" + current;
+    } else {
+        response = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n"
+                   "Metrics are served on /metrics\n";
+    }
+    send_all(client_socket, response.data(), response.size());
+}
@@ -0,0 +1,136 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_METRICS_H
+#define VISION_CPP_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * The labels of a sample, as (name, value) pairs, in the order they are printed.
+ */
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * A class that builds a page in the Prometheus text exposition format.
+ * The format requires the samples of a metric to follow its HELP and TYPE lines without interruption, so samples
+ * are grouped by metric, and metrics are printed in the order they were declared, however the samples were added.
+ */
+class MetricsText {
+public:
+    /**
+     * A method that declares a metric. Declaring the same metric again does nothing.
+     * @param name The name of the metric, e.g. "filters_stage_frames_total".
+     * @param type The type of the metric: "counter", "gauge" or "summary".
+     * @param help A one-line description of the metric.
+     */
+    void declare(const std::string &name, const std::string &type, const std::string &help);
+
+    /**
+     * A method that adds a sample to a declared metric.
+     * @param name The name of the metric.
+     * @param labels The labels of the sample.
+     * @param value The value of the sample.
+     * @param suffix A suffix of the sample name, e.g. "_sum" or "_count" for the totals of a summary.
+     * @return 0 if the sample was added, -1 if the metric was not declared.
+     */
+    int add(const std::string &name, const MetricLabels &labels, double value, const std::string &suffix = "");
+
+    /**
+     * A method that returns the page.
+     * @return The metrics in the Prometheus text format.
+     */
+    std::string str() const;
+
+private:
+    /**
+     * A structure that holds a declared metric and the lines of its samples.
+     */
+    struct Family {
+        std::string name; // name of the metric
+        std::string type; // counter, gauge or summary
+        std::string help; // description of the metric
+        std::vector<std::string> samples; // sample lines, without their line breaks
+    };
+
+    std::vector<Family> families; // declared metrics, in declaration order
+};
+
+/**
+ * A class that publishes metrics pages to a file and/or over HTTP, without touching the stages.
+ * The owner renders a page whenever is_due() says so, from counters the stages keep in atomics, and hands it to
+ * publish(). The file is written on the exporter's own thread, atomically (written aside, then renamed), so that a
+ * scraper (e.g. the node exporter textfile collector) never reads half a page. The HTTP endpoint serves the latest
+ * page on GET /metrics from another thread, so a slow scraper delays neither the owner nor the file.
+ */
+class MetricsExporter {
+public:
+    /**
+     * A constructor that creates an exporter that is not started yet.
+     * @param path The file the metrics are written to, empty for none.
+     * @param address A TCP port (bound to 127.0.0.1) or "unix:<path>" to serve the metrics on, empty for none.
+     * @param interval How often a page is due, in seconds.
+     */
+    explicit MetricsExporter(std::string path, std::string address, double interval);
+
+    /**
+     * A destructor that stops the exporter.
+     */
+    ~MetricsExporter();
+
+    /**
+     * A method that starts the file writer and the HTTP endpoint.
+     * @return 0 if the exporter is started, -1 if the endpoint could not listen.
+     */
+    int start();
+
+    /**
+     * A method that writes the last page, if it was not written yet, and stops the exporter.
+     */
+    void stop();
+
+    /**
+     * A method that tells whether the interval has elapsed since the last page was published.
+     * @return true if a new page should be rendered and published.
+     */
+    bool is_due() const;
+
+    /**
+     * A method that replaces the page served and queues it for the file. It does not wait for the file to be written.
+     * @param page The metrics in the Prometheus text format.
+     */
+    void publish(std::string page);
+
+private:
+    void write_loop();
+
+    void accept_loop();
+
+    void serve(int client_socket);
+
+    std::string path; // file the metrics are written to, may be empty
+    std::string address; // TCP port or "unix:<path>" of the endpoint, may be empty
+    std::chrono::steady_clock::duration interval; // time between two pages
+    std::chrono::steady_clock::time_point next_page; // when the next page is due
+
+    std::mutex mutex; // synchronizes the fields below
+    std::condition_variable page_available; // signalled when a page is published or the exporter stops
+    std::string page; // the latest page
+    bool page_written = true; // whether the latest page was written to the file
+    bool stopped = false; // whether the exporter was stopped
+
+    std::atomic<bool> running{false}; // whether the threads are running
+    std::thread writerThread; // the thread writing the file
+    std::thread acceptThread; // the thread serving the endpoint
+    int listen_socket = -1; // the listening socket of the endpoint
+};
+
+#endif //VISION_CPP_METRICS_H
@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "listener.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const std::string UNIX_PREFIX = "unix:";
+const size_t MAX_REQUEST_SIZE = 8192;
+
+bool is_listen_address(const std::string &address) {
+    if (address.starts_with(UNIX_PREFIX)) {
+        return address.size() > UNIX_PREFIX.size();
+    }
+    return !address.empty() && address.size() <= 5 &&
+           std::all_of(address.begin(), address.end(), [](unsigned char c) { return std::isdigit(c) != 0; }) &&
+           std::stoi(address) > 0 && std::stoi(address) <= 65535;
+}
+
+int open_listener(const std::string &address, int backlog, const std::string &name) {
+    if (!is_listen_address(address)) {
+        std::cout << "Invalid address for " << name << ": " << address << "." << std::endl;
+        return -1;
+    }
+
+    int listen_socket;
+    if (address.starts_with(UNIX_PREFIX)) {
+        std::string path = address.substr(UNIX_PREFIX.size());
+        sockaddr_un socket_address{};
+        socket_address.sun_family = AF_UNIX;
+        std::strncpy(socket_address.sun_path, path.c_str(), sizeof(socket_address.sun_path) - 1);
+
+        unlink(path.c_str());
+        listen_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_socket < 0 ||
+            bind(listen_socket, reinterpret_cast<sockaddr *>(&socket_address), sizeof(socket_address)) != 0) {
+            std::cout << "Failed to bind " << name << " to " << path << "." << std::endl;
+            if (listen_socket >= 0) {
+                close(listen_socket);
+            }
+            return -1;
+        }
+    } else {
+        sockaddr_in socket_address{};
+        socket_address.sin_family = AF_INET;
+        socket_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socket_address.sin_port = htons(static_cast<uint16_t>(std::stoi(address)));
+
+        listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if (listen_socket < 0 || setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+            bind(listen_socket, reinterpret_cast<sockaddr *>(&socket_address), sizeof(socket_address)) != 0) {
+            std::cout << "Failed to bind " << name << " to 127.0.0.1:" << address << "." << std::endl;
+            if (listen_socket >= 0) {
+                close(listen_socket);
+            }
+            return -1;
+        }
+    }
+
+    if (listen(listen_socket, backlog) != 0) {
+        std::cout << "Failed to listen on " << address << "." << std::endl;
+        close_listener(listen_socket, address);
+        return -1;
+    }
+    return listen_socket;
+}
+
+void close_listener(int socket, const std::string &address) {
+    shutdown(socket, SHUT_RDWR);
+    close(socket);
+    if (address.starts_with(UNIX_PREFIX)) {
+        unlink(address.substr(UNIX_PREFIX.size()).c_str());
+    }
+}
+
+std::string read_request(int socket) {
+    std::string request;
+    char chunk[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos &&
+           request.size() < MAX_REQUEST_SIZE) {
+        ssize_t received = recv(socket, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            break;
+        }
+        request.append(chunk, received);
+    }
+    return request;
+}
+
+bool send_all(int socket, const void *data, size_t size) {
+    auto *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        ssize_t sent = send(socket, bytes, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_LISTENER_H
+#define VISION_CPP_LISTENER_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Local listening sockets, shared by the stream server and the metrics endpoint.
+ * An address is either a TCP port, bound on the loopback interface only, or "unix:<path>" for a unix socket.
+ */
+
+/**
+ * A function that checks an address given on the command line.
+ * @param address The address, e.g. "8080" or "unix:/tmp/filters.sock".
+ * @return true if it is a port in 1-65535 or a unix socket path.
+ */
+bool is_listen_address(const std::string &address);
+
+/**
+ * A function that creates a socket listening on an address. An existing unix socket file is replaced.
+ * @param address The address, checked with is_listen_address.
+ * @param backlog The number of connections that can wait to be accepted.
+ * @param name The name of the server, for the error messages.
+ * @return The listening socket, -1 on failure.
+ */
+int open_listener(const std::string &address, int backlog, const std::string &name);
+
+/**
+ * A function that closes a listening socket, waking up the thread blocked accepting on it, and removes the socket
+ * file of a unix address.
+ * @param socket The listening socket.
+ * @param address The address it listens on.
+ */
+void close_listener(int socket, const std::string &address);
+
+/**
+ * A function that reads the header of an HTTP request, up to the empty line that ends it (8 KiB at most).
+ * @param socket The socket of the client, with a receive timeout set.
+ * @return The request as received, possibly incomplete if the client closed the connection or timed out.
+ */
+std::string read_request(int socket);
+
+/**
+ * A function that sends a whole buffer, unless the connection fails.
+ * MSG_NOSIGNAL keeps a closed connection from raising SIGPIPE.
+ * @param socket The socket of the client.
+ * @param data The buffer.
+ * @param size The size of the buffer, in bytes.
+ * @return true if everything was sent.
+ */
+bool send_all(int socket, const void *data, size_t size);
+
+#endif //VISION_CPP_LISTENER_H
@@ -0,0 +1,371 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "options.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include "../../constants.h"
+#include "../net/listener.h"
+
+/**
+ * Maps the filter names accepted on the command line to task names.
+ * "sobel" starts the whole edge detection group, since Magnitude depends on both Sobel tasks.
+ */
+static const std::unordered_map<std::string, std::string> FILTER_NAMES = {
+        {"grayscale",  GRAYSCALE},
+        {"negative",   NEGATIVE},
+        {"blur",       BLUR},
+        {"sobel_x",    SOBEL_X},
+        {"sobel_y",    SOBEL_Y},
+        {"sobel",      MAGNITUDE},
+        {"magnitude",  MAGNITUDE},
+        {"quantize",   QUANTIZED},
+        {"cartoonize", CARTOONIZE},
+        {"motion",     MOTION},
+        {"background", BACKGROUND},
+        {"denoise",    DENOISE},
+};
+
+const std::unordered_map<std::string, std::string> &get_filter_names() {
+    return FILTER_NAMES;
+}
+
+static int parse_filters(const std::string &value, Options &options) {
+    std::stringstream stream(value);
+    std::string filter;
+    while (std::getline(stream, filter, ',')) {
+        if (filter.empty()) {
+            continue;
+        }
+        auto it = FILTER_NAMES.find(filter);
+        if (it == FILTER_NAMES.end()) {
+            std::cout << "Unknown filter: " << filter << std::endl;
+            return -1;
+        }
+        options.filters.push_back(it->second);
+    }
+    return 0;
+}
+
+static int parse_sink(const std::string &value, Options &options) {
+    if (value == "null") {
+        return 0;
+    }
+
+    size_t separator = value.find('=');
+    if (separator == std::string::npos) {
+        std::cout << "Sink must be <filter>=<target>: " << value << std::endl;
+        return -1;
+    }
+    std::string filter = value.substr(0, separator);
+    std::string target = value.substr(separator + 1);
+
+    int stream = 0;
+    size_t stream_separator = filter.find('@');
+    if (stream_separator != std::string::npos) {
+        stream = std::stoi(filter.substr(stream_separator + 1));
+        filter = filter.substr(0, stream_separator);
+    }
+
+    std::string channel;
+    if (filter == "camera") {
+        channel = MAIN;
+    } else if (FILTER_NAMES.find(filter) != FILTER_NAMES.end()) {
+        channel = FILTER_NAMES.at(filter);
+    } else {
+        std::cout << "Unknown filter: " << filter << std::endl;
+        return -1;
+    }
+    options.sinks.push_back({channel, target, stream});
+    return 0;
+}
+
+static int parse_deadline(const std::string &value, Options &options) {
+    std::string filter;
+    std::string milliseconds = value;
+    size_t separator = value.find('=');
+    if (separator != std::string::npos) {
+        auto it = FILTER_NAMES.find(value.substr(0, separator));
+        if (it == FILTER_NAMES.end()) {
+            std::cout << "Unknown filter: " << value.substr(0, separator) << std::endl;
+            return -1;
+        }
+        filter = it->second;
+        milliseconds = value.substr(separator + 1);
+    }
+    double deadline = std::stod(milliseconds);
+    if (deadline <= 0) {
+        std::cout << "Deadlines must be positive: " << value << std::endl;
+        return -1;
+    }
+    options.deadlines[filter] = deadline;
+    return 0;
+}
+
+static int parse_size(const std::string &value, int &width, int &height) {
+    size_t separator = value.find('x');
+    if (separator == std::string::npos) {
+        std::cout << "Size must be <width>x<height>: " << value << std::endl;
+        return -1;
+    }
+    width = std::stoi(value.substr(0, separator));
+    height = std::stoi(value.substr(separator + 1));
+    if (width <= 0 || height <= 0) {
+        std::cout << "Size must be positive: " << value << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_listen_address(const std::string &arg, const std::string &value, std::string &address) {
+    if (!is_listen_address(value)) {
+        std::cout << arg << " must be a port (1-65535) or unix:<path>: " << value << std::endl;
+        return -1;
+    }
+    address = value;
+    return 0;
+}
+
+int parse_options(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help") {
+            return 1;
+        }
+        if (arg == "--headless") {
+            options.headless = true;
+            continue;
+        }
+        if (arg == "--loop") {
+            options.loop = true;
+            continue;
+        }
+        if (arg == "--yuv") {
+            options.yuv = true;
+            continue;
+        }
+        if (arg == "--perf-counters") {
+            options.perf_counters = true;
+            continue;
+        }
+        if (arg == "--pin-stages") {
+            options.pin_stages = true;
+            continue;
+        }
+        if (arg == "--no-huge-pages") {
+            options.huge_pages = false;
+            continue;
+        }
+        if (arg == "--control") {
+            options.control = true;
+            continue;
+        }
+        if (arg == "--warm-stages") {
+            options.warm_stages = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cout << "Missing value for " << arg << std::endl;
+            return -1;
+        }
+        std::string value = argv[++i];
+
+        try {
+            if (arg == "--source") {
+                options.sources.push_back(value);
+            } else if (arg == "--workers") {
+                options.workers = std::max(0, std::stoi(value));
+            } else if (arg == "--allocator") {
+                if (value != "opencv" && value != "arena") {
+                    std::cout << "Unknown allocator: " << value << std::endl;
+                    return -1;
+                }
+                options.frame_allocator = value;
+            } else if (arg == "--thread-budget") {
+                options.thread_budget = value != "off";
+                options.budget_cores = value == "off" ? 0 : std::max(0, std::stoi(value));
+            } else if (arg == "--pace") {
+                if (value != "realtime" && value != "unthrottled") {
+                    std::cout << "Unknown pace: " << value << std::endl;
+                    return -1;
+                }
+                options.realtime = value == "realtime";
+            } else if (arg == "--param") {
+                options.params.push_back(value);
+            } else if (arg == "--display") {
+                if (value != "mosaic" && value != "windows") {
+                    std::cout << "Unknown display: " << value << std::endl;
+                    return -1;
+                }
+                options.mosaic = value == "mosaic";
+            } else if (arg == "--display-fps") {
+                options.display_fps = std::max(1, std::stoi(value));
+            } else if (arg == "--display-size") {
+                if (parse_size(value, options.display_width, options.display_height) != 0) {
+                    return -1;
+                }
+            } else if (arg == "--resolution") {
+                if (parse_size(value, options.width, options.height) != 0) {
+                    return -1;
+                }
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (arg == "--record") {
+                options.record = value;
+            } else if (arg == "--filters") {
+                if (parse_filters(value, options) != 0) {
+                    return -1;
+                }
+            } else if (arg == "--sink") {
+                if (parse_sink(value, options) != 0) {
+                    return -1;
+                }
+            } else if (arg == "--sink-queue") {
+                options.sink_queue = std::max(1, std::stoi(value));
+            } else if (arg == "--shm-slots") {
+                options.shm_slots = std::max(2, std::stoi(value));
+            } else if (arg == "--stream") {
+                if (parse_listen_address(arg, value, options.stream) != 0) {
+                    return -1;
+                }
+            } else if (arg == "--stream-quality") {
+                options.stream_quality = std::clamp(std::stoi(value), 0, 100);
+            } else if (arg == "--trace") {
+                options.trace = value;
+            } else if (arg == "--metrics") {
+                options.metrics = value;
+            } else if (arg == "--metrics-listen") {
+                if (parse_listen_address(arg, value, options.metrics_listen) != 0) {
+                    return -1;
+                }
+            } else if (arg == "--metrics-interval") {
+                options.metrics_interval = std::max(0.1, std::stod(value));
+            } else if (arg == "--fps") {
+                options.target_fps = std::stoi(value);
+            } else if (arg == "--duration") {
+                options.duration = std::stod(value);
+            } else if (arg == "--frames") {
+                options.max_frames = std::stoll(value);
+            } else if (arg == "--schedule") {
+                if (value != "fair" && value != "edf") {
+                    std::cout << "Unknown schedule: " << value << std::endl;
+                    return -1;
+                }
+                options.schedule = value;
+            } else if (arg == "--deadline") {
+                if (parse_deadline(value, options) != 0) {
+                    return -1;
+                }
+            } else if (arg == "--stages") {
+                if (value != "threads" && value != "coroutines") {
+                    std::cout << "Unknown stages: " << value << std::endl;
+                    return -1;
+                }
+                options.stages = value;
+            } else if (arg == "--executor-threads") {
+                options.executor_threads = std::max(0, std::stoi(value));
+            } else if (arg == "--evaluation") {
+                if (value != "push" && value != "pull") {
+                    std::cout << "Unknown evaluation: " << value << std::endl;
+                    return -1;
+                }
+                options.evaluation = value;
+            } else if (arg == "--governor") {
+                options.governor = std::max(0.0, std::stod(value));
+            } else if (arg == "--soak") {
+                options.soak = std::max(0, std::stoi(value));
+            } else {
+                std::cout << "Unknown option: " << arg << std::endl;
+                return -1;
+            }
+        } catch (const std::exception &) {
+            std::cout << "Invalid value for " << arg << ": " << value << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void print_usage(const std::string &program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << "  --headless          Run without windows and print a summary at exit" << std::endl
+              << "  --display <mode>    mosaic: all outputs in one window (default), windows: one window each" << std::endl
+              << "  --display-fps <n>   Refresh rate of the mosaic (default: 30)" << std::endl
+              << "  --display-size <WxH> Size of the mosaic (default: 1280x720)" << std::endl
+              << "  --source <src>      Camera index, video file, replay:<recording> or synthetic:<scene>" << std::endl
+              << "                      (default: 0). Scenes: static, gradient, shapes, noise, busy. Can be repeated:" << std::endl
+              << "                      every source is a stream with its own filters, numbered from 0" << std::endl
+              << "  --workers <n>       Filter iterations running at once, shared fairly by the streams" << std::endl
+              << "                      (default: one per hardware thread)" << std::endl
+              << "  --thread-budget <n|off>" << std::endl
+              << "                      Cores the stages divide between their parallel loops, by measured cost" << std::endl
+              << "                      (default: every available core); off: every stage uses all of them" << std::endl
+              << "  --pin-stages        Bind every stage and its threads to its own range of cores (Linux)" << std::endl
+              << "  --allocator <name>  Frame buffers: opencv (default) or arena: per stream, huge-page backed," << std::endl
+              << "                      64-byte aligned rows, on the NUMA node of the stage, recycled" << std::endl
+              << "  --no-huge-pages     Map the arenas with normal pages" << std::endl
+              << "  --resolution <WxH>  Resolution of synthetic frames, up to 7680x4320 (default: 1280x720)" << std::endl
+              << "  --seed <n>          Seed of synthetic frames (default: 0)" << std::endl
+              << "  --pace <mode>       Replay pacing: realtime (default) or unthrottled" << std::endl
+              << "  --loop              Restart a replay from its first frame when it ends" << std::endl
+              << "  --yuv               Take frames in the native YUV layout of the source; grayscale and edges" << std::endl
+              << "                      read the Y plane, BGR is only made for filters that need colour" << std::endl
+              << "  --record <path>     Record every frame of the first source into a raw recording" << std::endl
+              << "  --filters <list>    Comma separated filters to start: grayscale, negative, blur," << std::endl
+              << "                      sobel_x, sobel_y, sobel, magnitude, quantize, cartoonize, motion," << std::endl
+              << "                      background, denoise" << std::endl
+              << "  --param <f>.<p>=<v> Set a filter parameter, e.g. quantize.levels=6, cartoonize.threshold=20," << std::endl
+              << "                      blur.sigma=1.5, blur.weights=1,4,6,4,1. Can be repeated" << std::endl
+              << "  --control           Read parameter changes (the same assignments) from the standard input" << std::endl
+              << "                      while running; they apply from the next frame" << std::endl
+              << "  --stages <mode>     threads: every filter runs on a thread of its own (default); coroutines:" << std::endl
+              << "                      filters are coroutines on a shared executor, and hold no thread while" << std::endl
+              << "                      they wait for a frame" << std::endl
+              << "  --executor-threads <n>" << std::endl
+              << "                      Threads of the executor (default: one per hardware thread)" << std::endl
+              << "  --schedule <mode>   Worker slots: fair between the streams (default), or edf: to the stage" << std::endl
+              << "                      with the earliest deadline; stages without one are throttled while" << std::endl
+              << "                      deadlines are at risk" << std::endl
+              << "  --deadline [<f>=]<ms> Time a filter (and the filters it reads) has per frame with --schedule" << std::endl
+              << "                      edf, from the write of its input; without a filter, for every filter." << std::endl
+              << "                      Can be repeated, e.g. --deadline cartoonize=33" << std::endl
+              << "  --evaluation <mode> push: filters process every frame (default); pull: filters only process a" << std::endl
+              << "                      frame when a window, sink, stream client or filter reads their output," << std::endl
+              << "                      the others are parked, and the filters only started for other filters" << std::endl
+              << "                      are not displayed" << std::endl
+              << "  --governor <ms>     Keep the delay of every output under this target by lowering the quality" << std::endl
+              << "                      of the costliest filters (cheaper variant, half resolution, frame" << std::endl
+              << "                      skipping), and restore it once there is headroom; decisions are logged" << std::endl
+              << "  --warm-stages       Keep stopped filters parked with their thread and state, so that they" << std::endl
+              << "                      restart instantly (default: stopped filters are joined and freed)" << std::endl
+              << "  --sink <sink>       Save a filter (or camera) output: <filter>[@stream]=<video file> or" << std::endl
+              << "                      <filter>=<image pattern, e.g. out/%06d.png> or <filter>=shm:<name>" << std::endl
+              << "                      (shared-memory ring for other processes). Can be repeated. null: none" << std::endl
+              << "  --sink-queue <n>    Frames a sink can queue before dropping (default: 8)" << std::endl
+              << "  --shm-slots <n>     Frames kept in a shared-memory ring (default: 4)" << std::endl
+              << "  --stream <address>  Serve outputs as MJPEG or raw frames on a loopback TCP port or unix:<path>," << std::endl
+              << "                      at /<filter>.mjpg or /<filter>.raw (e.g. /cartoonize.mjpg, /camera.raw)" << std::endl
+              << "  --stream-quality <n> JPEG quality of MJPEG streams (default: 80)" << std::endl
+              << "  --trace <path>      Record a timeline of every stage, written as a Chrome trace at exit" << std::endl
+              << "                      (and on the t key), for chrome://tracing or ui.perfetto.dev" << std::endl
+              << "  --perf-counters     Count cycles, instructions and LLC references/misses of every stage" << std::endl
+              << "                      (Linux perf events, stage threads and their OpenMP teams), reported as IPC and per pixel" << std::endl
+              << "  --metrics <path>    Write fps, latency, drops, staleness and utilisation to this file in" << std::endl
+              << "                      the Prometheus text format, replaced every interval" << std::endl
+              << "  --metrics-listen <port|unix:path>" << std::endl
+              << "                      Serve the same metrics on GET /metrics" << std::endl
+              << "  --metrics-interval <s>" << std::endl
+              << "                      How often the metrics are refreshed (default: 1)" << std::endl
+              << "  --fps <n>           Fetch rate in frames per second (default: as fast as possible)" << std::endl
+              << "  --duration <s>      Stop a headless run after this many seconds" << std::endl
+              << "  --frames <n>        Stop a headless run after this many source frames" << std::endl
+              << "  --soak <n>          Toggle random filters n times (headless), then fail if the thread count" << std::endl
+              << "                      or the resident memory grew" << std::endl;
+}
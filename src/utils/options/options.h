@@ -0,0 +1,282 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_OPTIONS_H
+#define VISION_CPP_OPTIONS_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A structure that tells which channel a sink consumes and where it writes.
+ */
+struct SinkOption {
+    std::string channel; // name of the consumed channel (see constants.h)
+    std::string target; // where the frames go, e.g. a video file name
+    int stream = 0; // index of the stream (source) the channel belongs to
+};
+
+/**
+ * A class that holds the command line options of the application.
+ * Without any option the application opens camera 0 and runs the interactive (windowed) mode.
+ */
+class Options {
+public:
+    /**
+     * Whether to run without any window, printing a throughput/latency summary at exit.
+     */
+    bool headless = false;
+
+    /**
+     * Whether the interactive mode shows every output as a tile of a single window, rather than one window each.
+     */
+    bool mosaic = true;
+
+    /**
+     * The number of times per second the mosaic window is refreshed.
+     */
+    int display_fps = 30;
+
+    /**
+     * The width of the mosaic window, in pixels.
+     */
+    int display_width = 1280;
+
+    /**
+     * The height of the mosaic window, in pixels.
+     */
+    int display_height = 720;
+
+    /**
+     * The input sources: a camera index (e.g. "0"), a video file name / stream URL, "replay:<path>" for a raw
+     * recording made with --record, or "synthetic:<scene>" for generated frames. Every source is an independent
+     * stream with its own filter graph. Empty means camera 0.
+     */
+    std::vector<std::string> sources;
+
+    /**
+     * The number of stage iterations that may run at the same time, shared fairly by all the streams.
+     * 0 means one per hardware thread.
+     */
+    int workers = 0;
+
+    /**
+     * Whether the stages divide the cores between their OpenMP teams (see thread_budget.h), instead of each
+     * starting a team as wide as the machine.
+     */
+    bool thread_budget = true;
+
+    /**
+     * The number of cores the thread budget divides. 0 means every core the process may run on.
+     */
+    int budget_cores = 0;
+
+    /**
+     * Whether every stage, and its OpenMP team, is bound to its own range of cores. Requires the thread budget.
+     */
+    bool pin_stages = false;
+
+    /**
+     * The allocator of the frames of every stream: "opencv" (OpenCV's default) or "arena" (a FrameAllocator per
+     * stream, see frame_allocator.h).
+     */
+    std::string frame_allocator = "opencv";
+
+    /**
+     * Whether the arenas of the frame allocators are backed by huge pages, when the system has them.
+     */
+    bool huge_pages = true;
+
+    /**
+     * The width of generated frames, in pixels.
+     */
+    int width = 1280;
+
+    /**
+     * The height of generated frames, in pixels.
+     */
+    int height = 720;
+
+    /**
+     * The seed of generated frames. The same seed always generates the same frames.
+     */
+    uint64_t seed = 0;
+
+    /**
+     * Whether a replayed recording is paced like it was captured. Otherwise frames are replayed as fast as possible.
+     */
+    bool realtime = true;
+
+    /**
+     * Whether a replayed recording starts again from its first frame once it ends.
+     */
+    bool loop = false;
+
+    /**
+     * Whether frames are taken in the native YUV layout of the source. Grayscale and edge filters then read the
+     * Y plane directly, and frames are only converted to BGR while a filter (or an output) needs colour.
+     */
+    bool yuv = false;
+
+    /**
+     * The path of a raw recording to write every source frame to. Empty means no recording.
+     */
+    std::string record;
+
+    /**
+     * The names of the tasks to start at launch (see constants.h), in the order they were given.
+     */
+    std::vector<std::string> filters;
+
+    /**
+     * The initial parameters of the filters, as <filter>.<parameter>=<value> assignments (see filter_parameters.h).
+     */
+    std::vector<std::string> params;
+
+    /**
+     * Whether parameters can be changed while running, by typing assignments on the standard input.
+     */
+    bool control = false;
+
+    /**
+     * Whether stopped filters keep their thread and state, parked, so that starting them again is instant. Otherwise
+     * a stopped filter's thread is joined and its task and frames freed.
+     */
+    bool warm_stages = false;
+
+    /**
+     * The number of filter toggles of a soak run (headless only), which checks that toggling filters leaks neither
+     * threads nor memory. 0 for a normal run.
+     */
+    int soak = 0;
+
+    /**
+     * Whether worker slots go to the stage with the earliest deadline ("edf") rather than fairly to the streams
+     * ("fair"), see Runtime.
+     */
+    std::string schedule = "fair";
+
+    /**
+     * The deadlines of the filters under deadline scheduling, in milliseconds, by task name; an empty name for every
+     * filter without one of its own.
+     */
+    std::map<std::string, double> deadlines;
+
+    /**
+     * How the filters run: "threads" (a thread each) or "coroutines" (coroutines on a shared executor, see
+     * StageExecutor).
+     */
+    std::string stages = "threads";
+
+    /**
+     * The number of threads of the executor of the coroutines, 0 for one per hardware thread.
+     */
+    int executor_threads = 0;
+
+    /**
+     * The delay every output should stay under, from the write of the source frame, in milliseconds: the quality
+     * governor (see QualityGovernor) lowers the quality of the stages to keep it. 0 for full quality always.
+     */
+    double governor = 0;
+
+    /**
+     * When the filters work: "push" (on every new frame of their input) or "pull" (only when a window, a sink or
+     * another filter requests their output; filters nobody reads are parked).
+     */
+    std::string evaluation = "push";
+
+    /**
+     * The output sinks, in addition to the display. Without any, outputs are discarded in headless mode,
+     * which is what a pure throughput run wants.
+     */
+    std::vector<SinkOption> sinks;
+
+    /**
+     * The number of frames each sink can queue before it starts dropping them.
+     */
+    int sink_queue = 8;
+
+    /**
+     * The number of frames a shared-memory sink keeps for its readers.
+     */
+    int shm_slots = 4;
+
+    /**
+     * The address of the stream server: a TCP port on the loopback interface, or "unix:<path>". Empty means none.
+     */
+    std::string stream;
+
+    /**
+     * The quality of the JPEG frames of MJPEG streams, from 0 to 100.
+     */
+    int stream_quality = 80;
+
+    /**
+     * The path the timeline trace (Chrome trace format) is written to, at exit and on the t key. Empty means no tracing.
+     */
+    std::string trace;
+
+    /**
+     * Whether every stage counts hardware events (cycles, instructions, cache references and misses) around its
+     * callback, to tell compute-bound stages from memory-bound ones. Ignored where counters are unavailable.
+     */
+    bool perf_counters = false;
+
+    /**
+     * The path the metrics (Prometheus text format) are written to every metrics_interval. Empty means no file.
+     */
+    std::string metrics;
+
+    /**
+     * The address the metrics are served on, over HTTP: a TCP port on the loopback interface, or "unix:<path>".
+     * Empty means no endpoint.
+     */
+    std::string metrics_listen;
+
+    /**
+     * How often the metrics are refreshed, in seconds.
+     */
+    double metrics_interval = 1;
+
+    /**
+     * The rate at which frames are fetched from the source, in frames per second. 0 means as fast as possible.
+     */
+    int target_fps = 0;
+
+    /**
+     * How long a headless run lasts, in seconds. 0 means until the source ends or the process is interrupted.
+     */
+    double duration = 0;
+
+    /**
+     * How many source frames a headless run processes. 0 means no limit.
+     */
+    long long max_frames = 0;
+};
+
+/**
+ * A function that parses the command line into an Options object.
+ * @param argc The number of arguments, as passed to main.
+ * @param argv The arguments, as passed to main.
+ * @param options A reference to the Options object to fill in.
+ * @return 0 if the arguments are valid, 1 if the usage was requested, -1 if they are invalid.
+ */
+int parse_options(int argc, char **argv, Options &options);
+
+/**
+ * A function that returns the filter names accepted on the command line, mapped to task names (see constants.h).
+ * @return The map of filter names to task names.
+ */
+const std::unordered_map<std::string, std::string> &get_filter_names();
+
+/**
+ * A function that prints the usage of the application.
+ * @param program The name of the executable.
+ */
+void print_usage(const std::string &program);
+
+#endif //VISION_CPP_OPTIONS_H
@@ -0,0 +1,198 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "filter_parameters.h"
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include "../simd/kernel_table.h"
+
+/**
+ * Parses a whole string as an integer within [min, max].
+ * @return 0 on success, -1 otherwise.
+ */
+static int parse_int(const std::string &text, int min, int max, int &value) {
+    try {
+        size_t end = 0;
+        int parsed = std::stoi(text, &end);
+        if (end != text.size() || parsed < min || parsed > max) {
+            return -1;
+        }
+        value = parsed;
+        return 0;
+    } catch (std::exception &) {
+        return -1;
+    }
+}
+
+static int parse_bool(const std::string &text, bool &value) {
+    if (text == "on" || text == "true" || text == "1") {
+        value = true;
+        return 0;
+    }
+    if (text == "off" || text == "false" || text == "0") {
+        value = false;
+        return 0;
+    }
+    return -1;
+}
+
+int BlurParameters::set(const std::string &name, const std::string &value) {
+    if (name == "weights") {
+        std::vector<int> parsed;
+        std::stringstream stream(value);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            int weight;
+            if (parse_int(item, -1024, 1024, weight) != 0) {
+                return -1;
+            }
+            parsed.push_back(weight);
+        }
+        if (parsed.size() % 2 == 0 || static_cast<int>(parsed.size()) > MAX_KERNEL_TAPS) {
+            return -1;
+        }
+        weights = parsed;
+        sigma = 0;
+        return 0;
+    }
+    if (name == "sigma") {
+        try {
+            size_t end = 0;
+            double parsed = std::stod(value, &end);
+            // the kernel would need more than MAX_KERNEL_TAPS taps beyond 10
+            if (end != value.size() || !(parsed >= 0 && parsed <= 10)) {
+                return -1;
+            }
+            sigma = parsed;
+            return 0;
+        } catch (std::exception &) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+void BlurParameters::prepare() {
+    if (sigma <= 0) {
+        kernel = weights;
+    } else {
+        // a sampled Gaussian over 3 sigmas, in integers: the kernels normalise by the sum of the weights
+        int radius = std::max(1, static_cast<int>(std::ceil(3 * sigma)));
+        kernel.clear();
+        for (int x = -radius; x <= radius; x++) {
+            kernel.push_back(static_cast<int>(std::lround(1024 * std::exp(-x * x / (2 * sigma * sigma)))));
+        }
+    }
+    kernel_offset = static_cast<int>(kernel.size()) / 2;
+}
+
+void BlurParameters::describe(std::ostream &out) const {
+    out << "weights=";
+    for (size_t i = 0; i < weights.size(); i++) {
+        out << (i > 0 ? "," : "") << weights[i];
+    }
+    out << " sigma=" << sigma << " (" << kernel.size() << " taps)";
+}
+
+int QuantizeParameters::set(const std::string &name, const std::string &value) {
+    if (name == "levels") {
+        return parse_int(value, 2, 255, levels);
+    }
+    if (name == "blur") {
+        return parse_bool(value, blur);
+    }
+    return -1;
+}
+
+void QuantizeParameters::prepare() {
+}
+
+void QuantizeParameters::describe(std::ostream &out) const {
+    out << "levels=" << levels << " blur=" << (blur ? "on" : "off");
+}
+
+int ThresholdParameters::set(const std::string &parameter, const std::string &text) {
+    if (parameter != name) {
+        return -1;
+    }
+    return parse_int(text, min, max, value);
+}
+
+void ThresholdParameters::prepare() {
+}
+
+void ThresholdParameters::describe(std::ostream &out) const {
+    out << name << "=" << value;
+}
+
+int DenoiseParameters::set(const std::string &name, const std::string &value) {
+    if (name == "frames") {
+        return parse_int(value, 1, MAX_TEMPORAL_FRAMES, frames);
+    }
+    if (name == "threshold") {
+        return parse_int(value, 0, 255, threshold);
+    }
+    return -1;
+}
+
+void DenoiseParameters::prepare() {
+}
+
+void DenoiseParameters::describe(std::ostream &out) const {
+    out << "frames=" << frames << " threshold=" << threshold;
+}
+
+FilterParameters::FilterParameters()
+        : blur(BlurParameters()),
+          quantize(QuantizeParameters()),
+          cartoonize(ThresholdParameters{"threshold", 15, 0, 255}),
+          motion(ThresholdParameters{"threshold", 25, 0, 255}),
+          background(ThresholdParameters{"shift", 5, 0, 8}),
+          denoise(DenoiseParameters()) {
+    blocks["blur"] = &blur;
+    blocks["quantize"] = &quantize;
+    blocks["cartoonize"] = &cartoonize;
+    blocks["motion"] = &motion;
+    blocks["background"] = &background;
+    blocks["denoise"] = &denoise;
+}
+
+int FilterParameters::set(const std::string &key, const std::string &value) {
+    size_t separator = key.find('.');
+    if (separator == std::string::npos) {
+        std::cout << "Parameters are named <filter>.<parameter>: " << key << std::endl;
+        return -1;
+    }
+    auto it = blocks.find(key.substr(0, separator));
+    if (it == blocks.end() || it->second->set(key.substr(separator + 1), value) != 0) {
+        std::cout << "Unknown parameter or invalid value: " << key << "=" << value << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int FilterParameters::apply(const std::string &assignment) {
+    size_t separator = assignment.find('=');
+    if (separator == std::string::npos) {
+        std::cout << "Parameters are set with <filter>.<parameter>=<value>: " << assignment << std::endl;
+        return -1;
+    }
+    return set(assignment.substr(0, separator), assignment.substr(separator + 1));
+}
+
+void FilterParameters::describe(std::ostream &out) {
+    for (auto &pair: blocks) {
+        out << "  " << pair.first << ": ";
+        pair.second->describe(out);
+        out << " (version " << pair.second->get_version() << ")" << std::endl;
+    }
+}
+
+FilterParameters &get_filter_parameters() {
+    // never destroyed: task threads that were told to stop may still read it while static objects are destroyed
+    static auto *parameters = new FilterParameters();
+    return *parameters;
+}
@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_FILTER_PARAMETERS_H
+#define VISION_CPP_FILTER_PARAMETERS_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "parameter_block.h"
+
+/**
+ * The parameters of the blur: either explicit weights, or a Gaussian of the given sigma.
+ */
+struct BlurParameters {
+    std::vector<int> weights = {2, 4, 6, 4, 2}; // weights of the separable kernel, an odd number of taps
+    double sigma = 0; // when above 0, the weights are a Gaussian of this sigma instead
+    std::vector<int> kernel; // derived: the weights used
+    int kernel_offset = 0; // derived: the taps on each side of the centre
+
+    int set(const std::string &name, const std::string &value);
+
+    void prepare();
+
+    void describe(std::ostream &out) const;
+};
+
+/**
+ * The parameters of the quantization.
+ */
+struct QuantizeParameters {
+    int levels = 10; // number of levels per channel, 2 to 255
+    bool blur = true; // whether frames are blurred first
+
+    int set(const std::string &name, const std::string &value);
+
+    void prepare();
+
+    void describe(std::ostream &out) const;
+};
+
+/**
+ * The parameters of the filters that only have a threshold, or another single integer: the edge threshold of the
+ * cartoon, the motion threshold, the weight of the background model.
+ */
+struct ThresholdParameters {
+    std::string name; // name of the parameter
+    int value = 0; // current value
+    int min = 0; // smallest value accepted
+    int max = 255; // largest value accepted
+
+    int set(const std::string &parameter, const std::string &text);
+
+    void prepare();
+
+    void describe(std::ostream &out) const;
+};
+
+/**
+ * The parameters of the temporal denoise.
+ */
+struct DenoiseParameters {
+    int frames = 4; // frames averaged, the current one included, 1 to MAX_TEMPORAL_FRAMES
+    int threshold = 20; // largest change that is treated as noise rather than motion
+
+    int set(const std::string &name, const std::string &value);
+
+    void prepare();
+
+    void describe(std::ostream &out) const;
+};
+
+/**
+ * A class that holds the parameters of every filter, shared by the tasks of every stream. Tasks read their block
+ * through a ParameterBlock::Reader once per frame, so parameters can be changed while they run (see --param and
+ * ParameterConsole).
+ */
+class FilterParameters {
+public:
+    /**
+     * A constructor that creates the blocks with the default parameters (the values the filters always used).
+     */
+    FilterParameters();
+
+    /**
+     * A method that changes one parameter, e.g. "quantize.levels" to "6".
+     * @param key The name of the filter and of the parameter, separated by a dot.
+     * @param value The new value, as text.
+     * @return 0 on success, -1 if the key is unknown or the value invalid.
+     */
+    int set(const std::string &key, const std::string &value);
+
+    /**
+     * A method that parses and applies a "<filter>.<parameter>=<value>" assignment.
+     * @param assignment The assignment.
+     * @return 0 on success, -1 if it is malformed, or as set.
+     */
+    int apply(const std::string &assignment);
+
+    /**
+     * A method that prints every parameter, as filter.name=value lines.
+     * @param out The stream to print to.
+     */
+    void describe(std::ostream &out);
+
+    ParameterBlock<BlurParameters> blur;
+    ParameterBlock<QuantizeParameters> quantize;
+    ParameterBlock<ThresholdParameters> cartoonize;
+    ParameterBlock<ThresholdParameters> motion;
+    ParameterBlock<ThresholdParameters> background;
+    ParameterBlock<DenoiseParameters> denoise;
+
+private:
+    std::map<std::string, ParameterSet *> blocks; // the blocks, by filter name as used on the command line
+};
+
+/**
+ * A function that returns the parameters of the filters of the process.
+ * @return The parameters.
+ */
+FilterParameters &get_filter_parameters();
+
+#endif //VISION_CPP_FILTER_PARAMETERS_H
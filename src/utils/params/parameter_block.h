@@ -0,0 +1,217 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_PARAMETER_BLOCK_H
+#define VISION_CPP_PARAMETER_BLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * The part of a parameter block that does not depend on the type of the parameters, so that blocks of different
+ * filters can be updated by name.
+ */
+class ParameterSet {
+public:
+    virtual ~ParameterSet() = default;
+
+    /**
+     * A method that changes one parameter, and publishes the result to the readers.
+     * @param name The name of the parameter.
+     * @param value The new value, as text.
+     * @return 0 on success, -1 if the name is unknown or the value invalid (nothing is published then).
+     */
+    virtual int set(const std::string &name, const std::string &value) = 0;
+
+    /**
+     * A method that prints the current parameters, as name=value pairs.
+     * @param out The stream to print to.
+     */
+    virtual void describe(std::ostream &out) = 0;
+
+    /**
+     * A method that returns how many times the parameters were published.
+     * @return The version of the parameters, 1 for the initial ones.
+     */
+    virtual uint64_t get_version() const = 0;
+};
+
+/**
+ * A template class that holds the parameters of a filter, so that they can be changed while the filter runs, without
+ * a lock on the filter's side and without restarting its task.
+ * Every update builds a complete new snapshot off the hot path (on the updating thread): the value is parsed and
+ * checked, and the tables derived from it are built, by T::set and T::prepare. The snapshot is then published with a
+ * single atomic store. Readers pick up the latest snapshot when they ask for it, once per frame, so a frame is always
+ * processed with one consistent set of parameters.
+ * Snapshots are reclaimed with one hazard pointer per reader: an old snapshot is deleted once no reader still uses it.
+ * @tparam T The parameters. Copyable, with `int set(const std::string &name, const std::string &value)` (0 on
+ * success), `void prepare()` (builds the derived tables) and `void describe(std::ostream &out) const`.
+ */
+template<typename T>
+class ParameterBlock : public ParameterSet {
+public:
+    /**
+     * A class that reads a parameter block from one thread, e.g. the thread of a task.
+     */
+    class Reader {
+    public:
+        /**
+         * A constructor that registers a reader of a block.
+         * @param block The block. Must outlive the reader.
+         */
+        explicit Reader(ParameterBlock<T> &block);
+
+        /**
+         * A destructor that unregisters the reader, releasing the snapshot it used.
+         */
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+
+        Reader &operator=(const Reader &) = delete;
+
+        /**
+         * A method that returns the latest snapshot of the parameters. Lock-free; call it once per frame.
+         * @return The snapshot, valid until the next call or the destruction of the reader.
+         */
+        const T &get();
+
+    private:
+        friend class ParameterBlock<T>;
+
+        ParameterBlock<T> *block; // block read
+        std::atomic<const T *> hazard{nullptr}; // snapshot in use, which the writers must not delete
+    };
+
+    /**
+     * A constructor that publishes the initial parameters.
+     * @param initial The initial parameters, prepared by the constructor.
+     */
+    explicit ParameterBlock(T initial = T());
+
+    /**
+     * A destructor that deletes the snapshots. No reader may be left.
+     */
+    ~ParameterBlock() override;
+
+    int set(const std::string &name, const std::string &value) override;
+
+    void describe(std::ostream &out) override;
+
+    uint64_t get_version() const override;
+
+    /**
+     * A method that returns a copy of the current parameters.
+     * @return The parameters.
+     */
+    T get_copy();
+
+private:
+    /**
+     * A method that publishes a prepared snapshot, and deletes the old ones no reader uses. The mutex must be held.
+     * @param next The new snapshot.
+     */
+    void publish(const T *next);
+
+    std::atomic<const T *> current; // the latest snapshot
+    std::atomic<uint64_t> version{0}; // number of snapshots published
+    std::mutex mutex; // serialises the writers, protects everything below
+    std::vector<const T *> retired; // old snapshots, deleted once no reader uses them
+    std::vector<Reader *> readers; // the registered readers
+};
+
+template<typename T>
+ParameterBlock<T>::Reader::Reader(ParameterBlock<T> &block) {
+    this->block = &block;
+    std::lock_guard<std::mutex> lock(block.mutex);
+    block.readers.push_back(this);
+}
+
+template<typename T>
+ParameterBlock<T>::Reader::~Reader() {
+    std::lock_guard<std::mutex> lock(block->mutex);
+    hazard.store(nullptr);
+    std::erase(block->readers, this);
+}
+
+template<typename T>
+const T &ParameterBlock<T>::Reader::get() {
+    // announce the snapshot before using it, then check it is still the current one: a writer that replaced it in
+    // between may have missed the announcement and deleted it
+    const T *snapshot = block->current.load();
+    while (true) {
+        hazard.store(snapshot);
+        const T *latest = block->current.load();
+        if (latest == snapshot) {
+            return *snapshot;
+        }
+        snapshot = latest;
+    }
+}
+
+template<typename T>
+ParameterBlock<T>::ParameterBlock(T initial) {
+    initial.prepare();
+    current.store(new T(std::move(initial)));
+    version.store(1);
+}
+
+template<typename T>
+ParameterBlock<T>::~ParameterBlock() {
+    for (const T *snapshot: retired) {
+        delete snapshot;
+    }
+    delete current.load();
+}
+
+template<typename T>
+int ParameterBlock<T>::set(const std::string &name, const std::string &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    T next = *current.load();
+    if (next.set(name, value) != 0) {
+        return -1;
+    }
+    next.prepare();
+    publish(new T(std::move(next)));
+    return 0;
+}
+
+template<typename T>
+void ParameterBlock<T>::describe(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    current.load()->describe(out);
+}
+
+template<typename T>
+uint64_t ParameterBlock<T>::get_version() const {
+    return version.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+T ParameterBlock<T>::get_copy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return *current.load();
+}
+
+template<typename T>
+void ParameterBlock<T>::publish(const T *next) {
+    retired.push_back(current.exchange(next));
+    version.fetch_add(1, std::memory_order_relaxed);
+
+    std::erase_if(retired, [this](const T *snapshot) {
+        for (Reader *reader: readers) {
+            if (reader->hazard.load() == snapshot) {
+                return false;
+            }
+        }
+        delete snapshot;
+        return true;
+    });
+}
+
+#endif //VISION_CPP_PARAMETER_BLOCK_H
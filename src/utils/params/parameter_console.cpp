@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "parameter_console.h"
+
+#include <iostream>
+#include <string>
+
+#ifdef __unix__
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+ParameterConsole::ParameterConsole(FilterParameters &parameters) {
+    this->parameters = &parameters;
+}
+
+ParameterConsole::~ParameterConsole() {
+    stop();
+}
+
+void ParameterConsole::start() {
+    if (running) {
+        return;
+    }
+    running = true;
+    thread = std::thread(&ParameterConsole::read_loop, this);
+    std::cout << "Parameters can be changed on the standard input, e.g. quantize.levels=6 (\"params\" lists them)."
+              << std::endl;
+}
+
+void ParameterConsole::stop() {
+    running = false;
+    if (thread.joinable()) {
+#ifdef __unix__
+        thread.join();
+#else
+        thread.detach(); // blocked in a read that only a new line ends
+#endif
+    }
+}
+
+void ParameterConsole::read_loop() {
+    std::string line;
+    while (running) {
+#ifdef __unix__
+        // wait with a timeout rather than block in a read, so that the console can be stopped
+        pollfd input{STDIN_FILENO, POLLIN, 0};
+        int ready = poll(&input, 1, 200);
+        if (ready == 0) {
+            continue;
+        }
+        if (ready < 0 || (input.revents & POLLIN) == 0) {
+            return;
+        }
+#endif
+        if (!std::getline(std::cin, line)) {
+            return; // end of the input: nothing more to read
+        }
+        if (line.empty()) {
+            continue;
+        }
+        if (line == "params") {
+            parameters->describe(std::cout);
+        } else if (parameters->apply(line) == 0) {
+            std::cout << "Set " << line << std::endl;
+        }
+    }
+}
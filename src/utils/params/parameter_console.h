@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_PARAMETER_CONSOLE_H
+#define VISION_CPP_PARAMETER_CONSOLE_H
+
+#include <atomic>
+#include <thread>
+#include "filter_parameters.h"
+
+/**
+ * A class that reads parameter changes from the standard input on a thread of its own, so that filters can be tuned
+ * while they run, with or without a window. Every line is either "<filter>.<parameter>=<value>", or "params" to
+ * print the current parameters. The tasks pick up a change at their next frame.
+ */
+class ParameterConsole {
+public:
+    /**
+     * A constructor that creates a console for the given parameters. Nothing is read until start is called.
+     * @param parameters The parameters to change.
+     */
+    explicit ParameterConsole(FilterParameters &parameters);
+
+    /**
+     * A destructor that stops the console.
+     */
+    ~ParameterConsole();
+
+    /**
+     * A method that starts reading the standard input.
+     */
+    void start();
+
+    /**
+     * A method that stops reading and waits for the thread, within a fraction of a second.
+     */
+    void stop();
+
+private:
+    /**
+     * The loop of the console thread.
+     */
+    void read_loop();
+
+    FilterParameters *parameters; // parameters changed by the console
+    std::atomic<bool> running{false}; // whether the thread should keep reading
+    std::thread thread; // thread reading the standard input
+};
+
+#endif //VISION_CPP_PARAMETER_CONSOLE_H
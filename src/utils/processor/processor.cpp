@@ -3,79 +3,565 @@
 // SPDX-License-Identifier: MIT
 
 #include "processor.h"
+#include "../memory/frame_allocator.h"
+#include "../trace/trace.h"
 
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+static const std::chrono::microseconds IDLE_WAIT(500); // how long a stage sleeps when its input has not changed
+static const std::chrono::microseconds SLOT_WAIT(10000); // how long a stage waits for a slot before checking it should stop
+static const std::chrono::milliseconds THROTTLE_PERIOD(500); // a throttled stage processes one frame per period
+
+static int64_t steady_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
 ProcessorState::ProcessorState() {
     this->running = true;
+    this->parked = false;
+    this->restart = false;
+    this->runtime = nullptr;
+    this->stream = 0;
+    this->allocator = nullptr;
+    this->deadline = 0;
+    this->executor = nullptr;
+    this->quality = 0;
+    this->pull = false;
+    reset();
+}
+
+ProcessorState::~ProcessorState() = default;
+
+void ProcessorState::reset() {
     this->fps_counter = 0;
     this->frame_time = 0;
+    this->total_frames = 0;
+    this->stale_frames = 0;
+    this->total_frame_time = 0;
+    this->latency.reset();
+    this->counting = false;
+    this->counted_frames = 0;
+    this->counted_pixels = 0;
+    this->cycles = 0;
+    this->instructions = 0;
+    this->cache_references = 0;
+    this->cache_misses = 0;
+    this->missed_deadlines = 0;
+    this->skipped_frames = 0;
+    this->delay = 0;
 }
 
-ProcessorState::~ProcessorState() = default;
+StageStats ProcessorState::snapshot() const {
+    StageStats stats;
+    stats.running = running.load(std::memory_order_relaxed);
+    stats.fps = fps_counter.load(std::memory_order_relaxed);
+    stats.frame_time = frame_time.load(std::memory_order_relaxed);
+    stats.total_frames = total_frames.load(std::memory_order_relaxed);
+    stats.stale_frames = stale_frames.load(std::memory_order_relaxed);
+    stats.total_frame_time = total_frame_time.load(std::memory_order_relaxed);
+    stats.latency = latency.snapshot();
+    stats.counting = counting.load(std::memory_order_relaxed);
+    stats.counted_frames = counted_frames.load(std::memory_order_relaxed);
+    stats.counted_pixels = counted_pixels.load(std::memory_order_relaxed);
+    stats.counters.cycles = cycles.load(std::memory_order_relaxed);
+    stats.counters.instructions = instructions.load(std::memory_order_relaxed);
+    stats.counters.cache_references = cache_references.load(std::memory_order_relaxed);
+    stats.counters.cache_misses = cache_misses.load(std::memory_order_relaxed);
+    stats.deadline = deadline;
+    stats.missed_deadlines = missed_deadlines.load(std::memory_order_relaxed);
+    stats.skipped_frames = skipped_frames.load(std::memory_order_relaxed);
+    stats.delay = delay.load(std::memory_order_relaxed);
+    stats.quality = quality.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ProcessorState::set_parked(bool value, bool restart) {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+        parked = value;
+        // a restart still pending from an earlier park is kept
+        if (value && restart) {
+            this->restart = true;
+        }
+    }
+    park_condition.notify_all();
+    signal.notify();
+}
+
+void ProcessorState::stop() {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+        running = false;
+    }
+    park_condition.notify_all();
+    signal.notify();
+}
+
+bool ProcessorState::wait_while_parked() {
+    std::unique_lock<std::mutex> lock(park_mutex);
+    park_condition.wait(lock, [this] { return !parked || !running; });
+    return running;
+}
+
+void ProcessorState::wait_for_request(WatchChannel<cv::Mat> &output) {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+        requested = false;
+    }
+    int id = output.add_request_waker([this] {
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            requested = true;
+        }
+        park_condition.notify_all();
+    });
+    if (id < 0) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(park_mutex);
+        park_condition.wait(lock, [this] { return requested || parked || !running; });
+    }
+    output.remove_waker(id);
+}
+
+/**
+ * Parks a processor thread while its stage is stopped warm or idle, see ProcessorState::set_parked. The stage leaves
+ * the thread budget while it sleeps. After a warm stop, its statistics start over when it wakes up, as for a new stage.
+ * @param state The state of the processor.
+ * @param name The name of the stage.
+ * @param budget The thread budget, or nullptr.
+ * @param budget_stage The stage in the budget, updated when it is added again.
+ * @return true if the processor should go on, false if it was stopped.
+ */
+static bool park(ProcessorState *state, const std::string &name, ThreadBudget *budget, int &budget_stage) {
+    if (budget != nullptr) {
+        budget->remove_stage(budget_stage);
+    }
+    if (!state->wait_while_parked()) {
+        return false;
+    }
+    if (state->restart.exchange(false)) {
+        state->reset();
+    }
+    if (budget != nullptr) {
+        budget_stage = budget->add_stage(name, state->stream);
+    }
+    return true;
+}
+
+/**
+ * Tells whether a stage without a deadline skips a new frame: while the deadlines of other stages are at risk, it only
+ * processes one frame per THROTTLE_PERIOD.
+ * @param state The state of the processor, which has a runtime.
+ * @param last_run When the stage last processed a frame while throttled, updated when it processes one.
+ * @return true if the frame is skipped.
+ */
+static bool throttle(ProcessorState *state, int64_t &last_run) {
+    Runtime *runtime = state->runtime;
+    if (!runtime->is_deadline_scheduling() || state->deadline > 0 || !runtime->is_deadline_at_risk()) {
+        return false;
+    }
+    int64_t now = steady_now();
+    if (now - last_run >= std::chrono::duration_cast<std::chrono::nanoseconds>(THROTTLE_PERIOD).count()) {
+        last_run = now;
+        return false;
+    }
+    state->skipped_frames.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Returns when the frame a stage is about to process is due, under deadline scheduling.
+ * @param state The state of the processor, which has a runtime.
+ * @param written When the input of the iteration was written, in steady clock nanoseconds.
+ * @return The deadline in steady clock nanoseconds, 0 if the stage has none.
+ */
+static int64_t get_deadline(ProcessorState *state, int64_t written) {
+    if (!state->runtime->is_deadline_scheduling() || state->deadline <= 0 || written <= 0) {
+        return 0;
+    }
+    return written + state->deadline * 1000;
+}
+
+/**
+ * Flags the deadline of a stage at risk when, once it holds its slot, it cannot be expected to finish the frame in time
+ * given its mean frame time, so that the stages without a deadline make way before it is missed.
+ * @param state The state of the processor, which has a runtime.
+ * @param deadline The deadline of the iteration, 0 for none.
+ */
+static void check_slack(ProcessorState *state, int64_t deadline) {
+    long long frames = state->total_frames.load(std::memory_order_relaxed);
+    if (deadline <= 0 || frames == 0) {
+        return;
+    }
+    long long mean_time = state->total_frame_time.load(std::memory_order_relaxed) / frames * 1000;
+    if (steady_now() + mean_time > deadline) {
+        state->runtime->flag_deadline_risk();
+    }
+}
+
+/**
+ * Counts a missed deadline once a stage finished a new frame after it.
+ * @param state The state of the processor, which has a runtime.
+ * @param deadline The deadline of the iteration, 0 for none.
+ */
+static void check_deadline(ProcessorState *state, int64_t deadline) {
+    if (deadline > 0 && steady_now() > deadline) {
+        state->missed_deadlines.fetch_add(1, std::memory_order_relaxed);
+        state->runtime->flag_deadline_risk();
+    }
+}
+
+/**
+ * Tells whether a stage has a reader for its next frame under pull evaluation, and if so, passes the request on to
+ * its inputs. Without pull evaluation, stages always have one.
+ * @param state The state of the processor.
+ * @param output The output channel of the stage.
+ * @param inputs The input channels of the stage.
+ * @return true if the stage should process its next frame, false if it should wait for a request.
+ */
+static bool pull_inputs(ProcessorState *state, WatchChannel<cv::Mat> &output,
+                        std::initializer_list<WatchChannel<cv::Mat> *> inputs) {
+    if (!state->pull) {
+        return true;
+    }
+    if (!output.is_requested()) {
+        return false;
+    }
+    for (WatchChannel<cv::Mat> *input: inputs) {
+        input->request();
+    }
+    return true;
+}
+
+/**
+ * Tells whether a stage skips a new frame because the quality governor told it to (see SKIP_FRAMES): every other one
+ * is skipped.
+ * @param state The state of the processor.
+ * @param skip_next Whether the next new frame is the one skipped, updated.
+ * @return true if the frame is skipped.
+ */
+static bool skip_frame(ProcessorState *state, bool &skip_next) {
+    if ((state->quality.load(std::memory_order_relaxed) & SKIP_FRAMES) == 0) {
+        skip_next = false;
+        return false;
+    }
+    bool skip = skip_next;
+    skip_next = !skip_next;
+    if (skip) {
+        state->skipped_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    return skip;
+}
+
+/**
+ * Records how old the input of a new frame is once the stage is done with it.
+ * @param state The state of the processor.
+ * @param written When the input was written, in steady clock nanoseconds, 0 if unknown.
+ */
+static void record_delay(ProcessorState *state, int64_t written) {
+    if (written > 0) {
+        state->delay.store((steady_now() - written) / 1000, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Writes a frame scaled down by 2 to a channel, for a callback that runs at half resolution.
+ * @param frame The frame, not empty.
+ * @param scaled The channel.
+ */
+static void scale_down(const cv::Mat &frame, WatchChannel<cv::Mat> &scaled) {
+    cv::Mat small;
+    cv::resize(frame, small, cv::Size((frame.cols + 1) / 2, (frame.rows + 1) / 2), 0, 0, cv::INTER_AREA);
+    scaled.write(small);
+}
+
+/**
+ * Writes the output of a callback that ran at half resolution, scaled back up, if the callback wrote one.
+ * @param scaled The channel the callback wrote to.
+ * @param version The version of that channel before the callback.
+ * @param size The size of the output.
+ * @param output The output channel.
+ */
+static void scale_up(WatchChannel<cv::Mat> &scaled, uint64_t version, cv::Size size, WatchChannel<cv::Mat> &output) {
+    if (scaled.get_version() == version) {
+        return;
+    }
+    cv::Mat small;
+    scaled.read(small);
+    cv::Mat frame;
+    cv::resize(small, frame, size, 0, 0, cv::INTER_LINEAR);
+    output.write(frame);
+}
+
+/**
+ * Updates the state of a processor after one iteration of its loop.
+ * Only iterations over a new input count as frames; the others are counted as stale.
+ * @param state The state of the processor.
+ * @param is_new Whether the input had changed since the previous iteration.
+ * @param frame_start When the iteration started.
+ * @param frame_end When the iteration ended.
+ * @param frames_counter The new frames processed since second_start, reset every second.
+ * @param second_start When the current one-second window started.
+ */
+static void record_iteration(ProcessorState *state, bool is_new,
+                             std::chrono::high_resolution_clock::time_point frame_start,
+                             std::chrono::high_resolution_clock::time_point frame_end, int &frames_counter,
+                             std::chrono::high_resolution_clock::time_point &second_start) {
+    if (is_new) {
+        auto duration = frame_end - frame_start;
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        frames_counter++;
+        state->frame_time.store(micros, std::memory_order_relaxed);
+        state->total_frames.fetch_add(1, std::memory_order_relaxed);
+        state->total_frame_time.fetch_add(micros, std::memory_order_relaxed);
+        state->latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    } else {
+        state->stale_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(frame_end - second_start).count() >= 1000) {
+        state->fps_counter.store(frames_counter, std::memory_order_relaxed);
+        frames_counter = 0;
+        second_start = frame_end;
+    }
+}
+
+/**
+ * Adds the hardware events of one iteration over a new frame to the state of a processor.
+ * @param state The state of the processor.
+ * @param counters The counters, started before the callback.
+ * @param output The output channel, to count the pixels of the frame the callback wrote.
+ */
+static void record_counters(ProcessorState *state, PerfCounters &counters, WatchChannel<cv::Mat> &output) {
+    PerfSample sample;
+    if (counters.stop(sample) != 0) {
+        return;
+    }
+    cv::Mat frame;
+    output.read(frame);
+    state->counted_frames.fetch_add(1, std::memory_order_relaxed);
+    state->counted_pixels.fetch_add(static_cast<long long>(frame.total()), std::memory_order_relaxed);
+    state->cycles.fetch_add(sample.cycles, std::memory_order_relaxed);
+    state->instructions.fetch_add(sample.instructions, std::memory_order_relaxed);
+    state->cache_references.fetch_add(sample.cache_references, std::memory_order_relaxed);
+    state->cache_misses.fetch_add(sample.cache_misses, std::memory_order_relaxed);
+}
 
 Processor::Processor(std::string name, ProcessorState *state) {
     this->name = std::move(name);
     this->state = state;
-    this->callback = nullptr;
 }
 
-int Processor::register_callback(void (*callback_input)(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output)) {
-    this->callback = callback_input;
+int Processor::register_callback(
+        std::function<void(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output)> callback_input) {
+    this->callback = std::move(callback_input);
     return 0;
 }
 
+void Processor::process(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output) {
+    if ((this->state->quality.load(std::memory_order_relaxed) & HALF_RESOLUTION) == 0) {
+        this->callback(input, output);
+        return;
+    }
+    cv::Mat frame;
+    input.read(frame);
+    if (frame.empty()) {
+        return;
+    }
+    scale_down(frame, scaled_input);
+    uint64_t version = scaled_output.get_version();
+    this->callback(scaled_input, scaled_output);
+    scale_up(scaled_output, version, frame.size(), output);
+}
+
 int Processor::start(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output) {
 
     if (this->callback == nullptr) {
         std::cout << "Callback not registered." << std::endl;
         return -1;
     }
-    this->state->fps_counter = 0;
-    this->state->frame_time = 0;
+    this->state->reset();
+    trace_set_thread_name(name);
+    const char *span_name = trace_intern(name);
+    set_thread_allocator(this->state->allocator);
+    // counters count the threads that open them, so they are opened here, on the stage thread and its OpenMP team
+    PerfCounters counters;
+    bool counting = perf_counters_enabled() && counters.open() == 0;
+    this->state->counting = counting;
+    // the parallel loops of the callback run on the share of the cores the thread budget gives this stage
+    ThreadBudget *budget = this->state->runtime != nullptr ? this->state->runtime->get_thread_budget() : nullptr;
+    int budget_stage = budget != nullptr ? budget->add_stage(name, this->state->stream) : -1;
 
     int frames_counter = 0;
     auto start = std::chrono::high_resolution_clock::now();
+    uint64_t input_version = 0;
+    int64_t throttled_run = 0;
+    bool skip_next = false;
 
     while (true) {
+        if (this->state->parked && !park(this->state, name, budget, budget_stage)) {
+            return 0;
+        }
         if (!this->state->running) {
+            if (budget != nullptr) {
+                budget->remove_stage(budget_stage);
+            }
             return 0;
         }
-        auto frame_time_start = std::chrono::high_resolution_clock::now();
-        frames_counter++;
-
-        this->callback(input, output);
+        if (!pull_inputs(this->state, output, {&input})) {
+            this->state->wait_for_request(output);
+            continue;
+        }
+        int64_t deadline = 0;
+        if (this->state->runtime != nullptr) {
+            // only compete for a slot once there is a new frame to work on
+            if (input.get_version() == input_version) {
+                std::this_thread::sleep_for(IDLE_WAIT);
+                continue;
+            }
+            if (throttle(this->state, throttled_run) || skip_frame(this->state, skip_next)) {
+                input_version = input.get_version();
+                continue;
+            }
+            deadline = get_deadline(this->state, input.get_last_write());
+            if (!this->state->runtime->acquire(this->state->stream, SLOT_WAIT, deadline)) {
+                continue;
+            }
+            check_slack(this->state, deadline);
+        }
+        uint64_t version = input.get_version();
+        int64_t written = input.get_last_write();
+        bool is_new = version != input_version && version != 0;
+        input_version = version;
 
+        if (budget != nullptr && is_new) {
+            budget->apply(budget_stage);
+        }
+        if (counting && is_new) {
+            counters.start();
+        }
+        auto frame_time_start = std::chrono::high_resolution_clock::now();
+        {
+            TRACE_SCOPE(span_name, version);
+            process(input, output);
+        }
         auto end = std::chrono::high_resolution_clock::now();
-        auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        if (time >= 1000) {
-            this->state->fps_counter = frames_counter;
-            frames_counter = 0;
-            start = std::chrono::high_resolution_clock::now();
+        if (counting && is_new) {
+            record_counters(this->state, counters, output);
         }
 
-        this->state->frame_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - frame_time_start).count();
+        if (is_new) {
+            check_deadline(this->state, deadline);
+            record_delay(this->state, written);
+        }
+        record_iteration(this->state, is_new, frame_time_start, end, frames_counter, start);
+        auto busy_time = std::chrono::duration_cast<std::chrono::microseconds>(end - frame_time_start);
+        if (budget != nullptr && is_new) {
+            budget->record(budget_stage, busy_time);
+        }
+        if (this->state->runtime != nullptr) {
+            this->state->runtime->release(this->state->stream, busy_time);
+        }
     }
 
     return -1;
 }
 
+StageTask Processor::run(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output) {
+    if (this->state->executor == nullptr) {
+        start(input, output);
+        co_return;
+    }
+    if (this->callback == nullptr) {
+        std::cout << "Callback not registered." << std::endl;
+        co_return;
+    }
+    this->state->reset();
+    const char *span_name = trace_intern(name);
+    StageExecutor &executor = *this->state->executor;
+
+    int frames_counter = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t input_version = 0;
+    bool skip_next = false;
+
+    StageSignal &signal = this->state->signal;
+    // the version of the signal is read before the state it guards: a park or a stop after it ends the next wait
+    for (uint64_t signal_seen = signal.get_version(); this->state->running; signal_seen = signal.get_version()) {
+        if (this->state->parked) {
+            co_await executor.next_change(signal, signal_seen);
+            if (!this->state->parked && this->state->restart.exchange(false)) {
+                this->state->reset();
+            }
+            continue;
+        }
+        if (!pull_inputs(this->state, output, {&input})) {
+            co_await executor.next_request(output, signal, signal_seen);
+            continue;
+        }
+        if (!co_await executor.next_frame(input, input_version, signal, signal_seen)) {
+            continue;
+        }
+        uint64_t version = input.get_version();
+        int64_t written = input.get_last_write();
+        input_version = version;
+        if (skip_frame(this->state, skip_next)) {
+            continue;
+        }
+
+        // the coroutine may resume on any thread of the executor
+        set_thread_allocator(this->state->allocator);
+        auto frame_time_start = std::chrono::high_resolution_clock::now();
+        {
+            TRACE_SCOPE(span_name, version);
+            process(input, output);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        record_delay(this->state, written);
+        record_iteration(this->state, true, frame_time_start, end, frames_counter, start);
+    }
+}
+
 Processor::~Processor() = default;
 
 DualInputProcessor::DualInputProcessor(std::string name, ProcessorState *state) {
     this->name = std::move(name);
     this->state = state;
-    this->callback = nullptr;
 }
 
 int DualInputProcessor::register_callback(
-        void (*callback_input)(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2,
-                               WatchChannel<cv::Mat> &output)) {
-    this->callback = callback_input;
+        std::function<void(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2,
+                           WatchChannel<cv::Mat> &output)> callback_input) {
+    this->callback = std::move(callback_input);
     return 0;
 }
 
+void DualInputProcessor::process(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2,
+                                 WatchChannel<cv::Mat> &output) {
+    if ((this->state->quality.load(std::memory_order_relaxed) & HALF_RESOLUTION) == 0) {
+        this->callback(input_1, input_2, output);
+        return;
+    }
+    cv::Mat frame_1, frame_2;
+    input_1.read(frame_1);
+    input_2.read(frame_2);
+    if (frame_1.empty() || frame_2.empty()) {
+        return;
+    }
+    scale_down(frame_1, scaled_input_1);
+    scale_down(frame_2, scaled_input_2);
+    uint64_t version = scaled_output.get_version();
+    this->callback(scaled_input_1, scaled_input_2, scaled_output);
+    scale_up(scaled_output, version, frame_1.size(), output);
+}
+
 int DualInputProcessor::start(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2,
                               WatchChannel<cv::Mat> &output) {
 
@@ -83,33 +569,158 @@ int DualInputProcessor::start(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::M
         std::cout << "Callback not registered." << std::endl;
         return -1;
     }
-    this->state->fps_counter = 0;
-    this->state->frame_time = 0;
+    this->state->reset();
+    trace_set_thread_name(name);
+    const char *span_name = trace_intern(name);
+    set_thread_allocator(this->state->allocator);
+    // counters count the threads that open them, so they are opened here, on the stage thread and its OpenMP team
+    PerfCounters counters;
+    bool counting = perf_counters_enabled() && counters.open() == 0;
+    this->state->counting = counting;
+    // the parallel loops of the callback run on the share of the cores the thread budget gives this stage
+    ThreadBudget *budget = this->state->runtime != nullptr ? this->state->runtime->get_thread_budget() : nullptr;
+    int budget_stage = budget != nullptr ? budget->add_stage(name, this->state->stream) : -1;
 
     int frames_counter = 0;
     auto start = std::chrono::high_resolution_clock::now();
+    uint64_t input_version_1 = 0;
+    uint64_t input_version_2 = 0;
+    int64_t throttled_run = 0;
+    bool skip_next = false;
 
     while (true) {
+        if (this->state->parked && !park(this->state, name, budget, budget_stage)) {
+            return 0;
+        }
         if (!this->state->running) {
+            if (budget != nullptr) {
+                budget->remove_stage(budget_stage);
+            }
             return 0;
         }
-        auto frame_time_start = std::chrono::high_resolution_clock::now();
-        frames_counter++;
-
-        this->callback(input_1, input_2, output);
+        if (!pull_inputs(this->state, output, {&input_1, &input_2})) {
+            this->state->wait_for_request(output);
+            continue;
+        }
+        int64_t deadline = 0;
+        if (this->state->runtime != nullptr) {
+            // only compete for a slot once either input has a new frame to work on
+            if (input_1.get_version() == input_version_1 && input_2.get_version() == input_version_2) {
+                std::this_thread::sleep_for(IDLE_WAIT);
+                continue;
+            }
+            if (throttle(this->state, throttled_run) || skip_frame(this->state, skip_next)) {
+                input_version_1 = input_1.get_version();
+                input_version_2 = input_2.get_version();
+                continue;
+            }
+            // the frame is due after the newer of the two inputs, the one that made it new
+            deadline = get_deadline(this->state, std::max(input_1.get_last_write(), input_2.get_last_write()));
+            if (!this->state->runtime->acquire(this->state->stream, SLOT_WAIT, deadline)) {
+                continue;
+            }
+            check_slack(this->state, deadline);
+        }
+        uint64_t version_1 = input_1.get_version();
+        uint64_t version_2 = input_2.get_version();
+        int64_t written = std::max(input_1.get_last_write(), input_2.get_last_write());
+        // the task needs both inputs, and has work once either of them changed
+        bool is_new = version_1 != 0 && version_2 != 0 &&
+                      (version_1 != input_version_1 || version_2 != input_version_2);
+        input_version_1 = version_1;
+        input_version_2 = version_2;
 
+        if (budget != nullptr && is_new) {
+            budget->apply(budget_stage);
+        }
+        if (counting && is_new) {
+            counters.start();
+        }
+        auto frame_time_start = std::chrono::high_resolution_clock::now();
+        {
+            TRACE_SCOPE(span_name, std::max(version_1, version_2));
+            process(input_1, input_2, output);
+        }
         auto end = std::chrono::high_resolution_clock::now();
-        auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        if (time >= 1000) {
-            this->state->fps_counter = frames_counter;
-            frames_counter = 0;
-            start = std::chrono::high_resolution_clock::now();
+        if (counting && is_new) {
+            record_counters(this->state, counters, output);
         }
 
-        this->state->frame_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - frame_time_start).count();
+        if (is_new) {
+            check_deadline(this->state, deadline);
+            record_delay(this->state, written);
+        }
+        record_iteration(this->state, is_new, frame_time_start, end, frames_counter, start);
+        auto busy_time = std::chrono::duration_cast<std::chrono::microseconds>(end - frame_time_start);
+        if (budget != nullptr && is_new) {
+            budget->record(budget_stage, busy_time);
+        }
+        if (this->state->runtime != nullptr) {
+            this->state->runtime->release(this->state->stream, busy_time);
+        }
     }
 
     return -1;
 }
 
+StageTask DualInputProcessor::run(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2,
+                                  WatchChannel<cv::Mat> &output) {
+    if (this->state->executor == nullptr) {
+        start(input_1, input_2, output);
+        co_return;
+    }
+    if (this->callback == nullptr) {
+        std::cout << "Callback not registered." << std::endl;
+        co_return;
+    }
+    this->state->reset();
+    const char *span_name = trace_intern(name);
+    StageExecutor &executor = *this->state->executor;
+
+    int frames_counter = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t input_version_1 = 0;
+    uint64_t input_version_2 = 0;
+    bool skip_next = false;
+
+    StageSignal &signal = this->state->signal;
+    // the version of the signal is read before the state it guards: a park or a stop after it ends the next wait
+    for (uint64_t signal_seen = signal.get_version(); this->state->running; signal_seen = signal.get_version()) {
+        if (this->state->parked) {
+            co_await executor.next_change(signal, signal_seen);
+            if (!this->state->parked && this->state->restart.exchange(false)) {
+                this->state->reset();
+            }
+            continue;
+        }
+        if (!pull_inputs(this->state, output, {&input_1, &input_2})) {
+            co_await executor.next_request(output, signal, signal_seen);
+            continue;
+        }
+        if (!co_await executor.next_frame(input_1, input_version_1, input_2, input_version_2, signal, signal_seen)) {
+            continue;
+        }
+        uint64_t version_1 = input_1.get_version();
+        uint64_t version_2 = input_2.get_version();
+        int64_t written = std::max(input_1.get_last_write(), input_2.get_last_write());
+        input_version_1 = version_1;
+        input_version_2 = version_2;
+        // the task needs both inputs
+        if (version_1 == 0 || version_2 == 0 || skip_frame(this->state, skip_next)) {
+            continue;
+        }
+
+        // the coroutine may resume on any thread of the executor
+        set_thread_allocator(this->state->allocator);
+        auto frame_time_start = std::chrono::high_resolution_clock::now();
+        {
+            TRACE_SCOPE(span_name, std::max(version_1, version_2));
+            process(input_1, input_2, output);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        record_delay(this->state, written);
+        record_iteration(this->state, true, frame_time_start, end, frames_counter, start);
+    }
+}
+
 DualInputProcessor::~DualInputProcessor() = default;
@@ -5,13 +5,56 @@
 #ifndef VISION_CPP_PROCESSOR_H
 #define VISION_CPP_PROCESSOR_H
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <opencv2/core/mat.hpp>
 #include "../watch_channel.h"
+#include "../runtime/runtime.h"
+#include "../executor/stage_executor.h"
+#include "../executor/stage_task.h"
+#include "../stats/latency_histogram.h"
+#include "../stats/perf_counters.h"
+
+/**
+ * The ways a processor can trade quality for time, set by the quality governor (see QualityGovernor). A processor
+ * applies a combination of them, as a bit mask.
+ */
+enum QualityStep {
+    CHEAP_VARIANT = 1, // a cheaper version of the filter (e.g. a 3-tap blur, an L1 magnitude), where it has one
+    HALF_RESOLUTION = 2, // the filter runs on the input scaled down by 2, and its output is scaled back up
+    SKIP_FRAMES = 4, // every other new frame is skipped
+};
+
+/**
+ * A structure that holds a consistent copy of the statistics of a processor, see ProcessorState::snapshot.
+ */
+struct StageStats {
+    bool running = false; // whether the processor is running
+    int fps = 0; // new frames processed during the last second
+    long long frame_time = 0; // time taken by the last new frame, in microseconds
+    long long total_frames = 0; // new frames processed since the processor was started
+    long long stale_frames = 0; // iterations over an input that had already been processed
+    long long total_frame_time = 0; // time taken by all the new frames, in microseconds
+    LatencySnapshot latency; // distribution of the time taken by the new frames
+    bool counting = false; // whether hardware events are counted (see perf_counters.h)
+    long long counted_frames = 0; // new frames hardware events were counted over
+    long long counted_pixels = 0; // pixels of the frames written by those iterations
+    PerfSample counters; // hardware events of those iterations, on the stage thread and its OpenMP team
+    long long deadline = 0; // time the stage has per frame under deadline scheduling, in microseconds, 0 for none
+    long long missed_deadlines = 0; // new frames finished after their deadline
+    long long skipped_frames = 0; // new frames skipped by throttling, or by SKIP_FRAMES
+    long long delay = 0; // age of the input of the last new frame when it was done, in microseconds
+    int quality = 0; // the quality steps applied, see QualityStep
+};
 
 /**
  * A class that represents the state of a processor.
  * It contains information about the running status, the frames per second and the frame time of the processor.
+ * Every field is written by the processor thread and may be read by any other thread at the same time, so they are
+ * all atomic; snapshot() copies them into a StageStats for reporting.
  */
 class ProcessorState {
 public:
@@ -25,20 +68,168 @@ public:
      */
     ~ProcessorState();
 
+    /**
+     * A method that clears the counters and the latency histogram, when the processor (re)starts.
+     */
+    void reset();
+
+    /**
+     * A method that copies the statistics of the processor. Safe to call from any thread.
+     * @return The statistics.
+     */
+    StageStats snapshot() const;
+
+    /**
+     * A method that sets whether the processor is parked: a parked processor keeps its thread and its state (e.g. a
+     * background model) but sleeps without iterating, until it is unparked or stopped.
+     * @param value true to park the processor, false to wake it up.
+     * @param restart When parking, whether the statistics start over once the processor is woken up, as for a stage
+     * that was stopped and started again; otherwise they carry on. Ignored when waking up.
+     */
+    void set_parked(bool value, bool restart);
+
+    /**
+     * A method that stops the processor, waking it up if it is parked or waiting.
+     */
+    void stop();
+
+    /**
+     * A method that blocks the processor thread while it is parked.
+     * @return true if the processor should go on, false if it was stopped.
+     */
+    bool wait_while_parked();
+
+    /**
+     * A method that blocks the processor thread until its output is requested (see WatchChannel::request), for pull
+     * evaluation, or until it is parked or stopped.
+     * @param output The output channel of the processor.
+     */
+    void wait_for_request(WatchChannel<cv::Mat> &output);
+
     /**
      * A boolean variable that indicates whether the processor is running or not.
      */
-    bool running;
+    std::atomic<bool> running;
+
+    /**
+     * A boolean variable that indicates whether the processor is parked, see set_parked.
+     */
+    std::atomic<bool> parked;
+
+    /**
+     * A boolean variable that indicates whether the statistics start over when the processor is woken up, see
+     * set_parked. Cleared by the processor when it wakes up.
+     */
+    std::atomic<bool> restart;
+
+    /**
+     * An integer variable that counts the number of new frames processed per second by the processor.
+     */
+    std::atomic<int> fps_counter;
+
+    /**
+     * The time taken to process the last new frame, in microseconds.
+     */
+    std::atomic<long long> frame_time;
+
+    /**
+     * A counter of the new frames processed since the processor was started.
+     */
+    std::atomic<long long> total_frames;
+
+    /**
+     * A counter of the iterations that found their input unchanged since the previous iteration.
+     */
+    std::atomic<long long> stale_frames;
+
+    /**
+     * The sum of the time taken by all the new frames processed since the processor was started, in microseconds.
+     */
+    std::atomic<long long> total_frame_time;
+
+    /**
+     * The distribution of the time taken by the new frames.
+     */
+    LatencyHistogram latency;
+
+    /**
+     * Whether the processor counts hardware events: they were enabled and could be opened on its thread.
+     */
+    std::atomic<bool> counting;
+
+    /**
+     * The new frames hardware events were counted over, and the pixels of the frames those iterations wrote.
+     */
+    std::atomic<long long> counted_frames;
+    std::atomic<long long> counted_pixels;
+
+    /**
+     * The hardware events counted over the new frames, see PerfSample.
+     */
+    std::atomic<uint64_t> cycles;
+    std::atomic<uint64_t> instructions;
+    std::atomic<uint64_t> cache_references;
+    std::atomic<uint64_t> cache_misses;
+
+    /**
+     * The time the processor has per frame under deadline scheduling, from the write of its input, in microseconds.
+     * 0 for a stage without a deadline, which is throttled while the deadlines of other stages are at risk.
+     */
+    long long deadline;
+
+    /**
+     * The new frames finished after their deadline, and the new frames skipped by throttling or SKIP_FRAMES.
+     */
+    std::atomic<long long> missed_deadlines;
+    std::atomic<long long> skipped_frames;
+
+    /**
+     * The age of the input of the last new frame when the processor was done with it, in microseconds: the time it
+     * waited for the processor, and the time the processor took.
+     */
+    std::atomic<long long> delay;
+
+    /**
+     * The quality steps the processor applies (see QualityStep), 0 for full quality. Kept across restarts.
+     */
+    std::atomic<int> quality;
+
+    /**
+     * The runtime the processor takes a slot from for every iteration, or nullptr to run freely.
+     * With a runtime, the processor also only iterates when its input has a new frame.
+     */
+    Runtime *runtime;
+
+    /**
+     * The index of the stream the processor belongs to, in its runtime.
+     */
+    int stream;
+
+    /**
+     * The allocator of the frames the processor creates (see frame_allocator.h), or nullptr for OpenCV's default.
+     */
+    cv::MatAllocator *allocator;
+
+    /**
+     * Whether the processor only works on demand: it waits for its output to be requested (see
+     * WatchChannel::is_requested) before it requests a new frame from its inputs and processes it.
+     */
+    bool pull;
 
     /**
-     * An integer variable that counts the number of frames processed per second by the processor.
+     * The executor the processor runs on as a coroutine (see Processor::run), or nullptr for a thread of its own.
      */
-    int fps_counter;
+    StageExecutor *executor;
 
     /**
-     * An integer variable that measures the time taken to process one frame by the processor in milliseconds.
+     * Notified by set_parked and stop, so that the coroutine of the processor does not sleep through them.
      */
-    int frame_time;
+    StageSignal signal;
+
+private:
+    std::mutex park_mutex; // protects the wake-ups of a parked processor, and requested
+    std::condition_variable park_condition; // notified when the processor is unparked, stopped or requested
+    bool requested = false; // whether the output was requested while the processor waited, see wait_for_request
 };
 
 
@@ -64,10 +255,11 @@ public:
      * A method that registers a callback function that defines how the images are processed by the processor.
      * The callback function takes two parameters: a reference to a WatchChannel<cv::Mat> object that provides the input images,
      * and a reference to another WatchChannel<cv::Mat> object that receives the output images.
-     * @param callback A pointer to a function that takes two parameters: a reference to a WatchChannel<cv::Mat> object and another reference to a WatchChannel<cv::Mat> object.
+     * Stateful filters (e.g. a background model) can register a lambda that captures their state.
+     * @param callback A function that takes two parameters: a reference to a WatchChannel<cv::Mat> object and another reference to a WatchChannel<cv::Mat> object.
      * @return An integer value that indicates whether the registration was successful or not. Zero means success, non-zero means failure.
      */
-    int register_callback(void (*callback)(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output));
+    int register_callback(std::function<void(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output)> callback);
 
     /**
      * A method that starts the processing loop of the processor.
@@ -79,7 +271,26 @@ public:
      */
     int start(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output);
 
+    /**
+     * A method that runs the processing loop as a coroutine, to be awaited by the process function of a task.
+     * With an executor in the state, the coroutine suspends while the input has no new frame instead of holding a
+     * thread, and the callback runs on the threads of the executor; without one, this is start, run to the end.
+     * The runtime slots, the thread budget and the hardware counters are per thread, so coroutines do without them:
+     * the executor's threads bound how many callbacks run at once.
+     * @param input A reference to a WatchChannel<cv::Mat> object that provides the input images for the processor.
+     * @param output A reference to another WatchChannel<cv::Mat> object that receives the output images from the processor.
+     * @return The coroutine.
+     */
+    StageTask run(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output);
+
 private:
+    /**
+     * A method that calls the callback, at half resolution when the state says so (see HALF_RESOLUTION).
+     * @param input The input channel.
+     * @param output The output channel.
+     */
+    void process(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output);
+
     /**
      * A string variable that stores the name of the processor.
      */
@@ -91,9 +302,15 @@ private:
     ProcessorState *state;
 
     /**
-     * A pointer to a function that defines how the images are processed by the processor.
+     * A function that defines how the images are processed by the processor.
      */
-    void (*callback)(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output);
+    std::function<void(WatchChannel<cv::Mat> &input, WatchChannel<cv::Mat> &output)> callback;
+
+    /**
+     * The channels the callback reads and writes at half resolution.
+     */
+    WatchChannel<cv::Mat> scaled_input;
+    WatchChannel<cv::Mat> scaled_output;
 };
 
 /**
@@ -118,11 +335,12 @@ public:
      * A method that registers a callback function that defines how the images are processed by the processor.
      * The callback function takes three parameters: two references to WatchChannel<cv::Mat> objects that provide the input images,
      * and a reference to another WatchChannel<cv::Mat> object that receives the output images.
-     * @param callback A pointer to a function that takes three parameters: two references to WatchChannel<cv::Mat> objects and another reference to a WatchChannel<cv::Mat> object.
+     * Stateful filters (e.g. with parameters) can register a lambda that captures their state.
+     * @param callback A function that takes three parameters: two references to WatchChannel<cv::Mat> objects and another reference to a WatchChannel<cv::Mat> object.
      * @return An integer value that indicates whether the registration was successful or not. Zero means success, non-zero means failure.
      */
-    int register_callback(void (*callback)(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2,
-                                           WatchChannel<cv::Mat> &output));
+    int register_callback(std::function<void(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2,
+                                             WatchChannel<cv::Mat> &output)> callback);
 
     /**
      * A method that starts the processing loop of the processor.
@@ -135,7 +353,25 @@ public:
      */
     int start(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2, WatchChannel<cv::Mat> &output);
 
+    /**
+     * A method that runs the processing loop as a coroutine, see Processor::run. The coroutine waits for either
+     * input to have a new frame.
+     * @param input_1 A reference to a WatchChannel<cv::Mat> object that provides the first input images for the processor.
+     * @param input_2 A reference to another WatchChannel<cv::Mat> object that provides the second input images for the processor.
+     * @param output A reference to another WatchChannel<cv::Mat> object that receives the output images from the processor.
+     * @return The coroutine.
+     */
+    StageTask run(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2, WatchChannel<cv::Mat> &output);
+
 private:
+    /**
+     * A method that calls the callback, at half resolution when the state says so (see HALF_RESOLUTION).
+     * @param input_1 The first input channel.
+     * @param input_2 The second input channel.
+     * @param output The output channel.
+     */
+    void process(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2, WatchChannel<cv::Mat> &output);
+
     /**
      * A string variable that stores the name of the processor.
      */
@@ -147,9 +383,17 @@ private:
     ProcessorState *state;
 
     /**
-     * A pointer to a function that defines how the images are processed by the processor.
+     * A function that defines how the images are processed by the processor.
+     */
+    std::function<void(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2, WatchChannel<cv::Mat> &output)>
+            callback;
+
+    /**
+     * The channels the callback reads and writes at half resolution.
      */
-    void (*callback)(WatchChannel<cv::Mat> &input_1, WatchChannel<cv::Mat> &input_2, WatchChannel<cv::Mat> &output);
+    WatchChannel<cv::Mat> scaled_input_1;
+    WatchChannel<cv::Mat> scaled_input_2;
+    WatchChannel<cv::Mat> scaled_output;
 };
 
 
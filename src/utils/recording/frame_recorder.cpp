@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "frame_recorder.h"
+
+#include <cstring>
+#include <iostream>
+#include "raw_format.h"
+
+static const char PADDING[RAW_ALIGNMENT] = {};
+
+FrameRecorder::FrameRecorder(const std::string &path) {
+    buffer.resize(1 << 22);
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "Failed to create recording " << path << "." << std::endl;
+        return;
+    }
+
+    RawFileHeader header{};
+    std::memcpy(header.magic, RAW_MAGIC, sizeof(header.magic));
+    header.version = RAW_VERSION;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(PADDING, static_cast<std::streamsize>(raw_align(sizeof(header)) - sizeof(header)));
+}
+
+FrameRecorder::~FrameRecorder() {
+    file.close();
+}
+
+bool FrameRecorder::is_open() const {
+    return file.is_open();
+}
+
+int FrameRecorder::write(const cv::Mat &frame, uint64_t timestamp, PixelFormat format) {
+    if (!file.is_open() || frame.empty() || frame.dims != 2) {
+        return -1;
+    }
+
+    size_t row_size = frame.cols * frame.elemSize();
+
+    RawFrameHeader header{};
+    header.timestamp = timestamp;
+    header.rows = frame.rows;
+    header.cols = frame.cols;
+    header.type = frame.type();
+    header.format = static_cast<uint32_t>(format);
+    header.step = raw_align(row_size);
+    header.size = header.step * frame.rows;
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(PADDING, static_cast<std::streamsize>(raw_align(sizeof(header)) - sizeof(header)));
+
+    // rows are padded to the alignment, so that every row of the replayed frame starts on a cache line
+    for (int row = 0; row < frame.rows; row++) {
+        file.write(reinterpret_cast<const char *>(frame.ptr(row)), static_cast<std::streamsize>(row_size));
+        file.write(PADDING, static_cast<std::streamsize>(header.step - row_size));
+    }
+
+    if (!file.good()) {
+        std::cout << "Failed to write frame " << frame_count << " to the recording." << std::endl;
+        return -1;
+    }
+    frame_count++;
+    return 0;
+}
+
+long long FrameRecorder::get_frame_count() const {
+    return frame_count;
+}
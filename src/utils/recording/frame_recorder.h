@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_FRAME_RECORDER_H
+#define VISION_CPP_FRAME_RECORDER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+#include "../source/frame_source.h"
+
+/**
+ * A class that dumps frames, uncompressed and with their capture timestamps, into a raw recording file
+ * (see raw_format.h). The recording can be replayed at full speed with ReplaySource, without any decode cost.
+ */
+class FrameRecorder {
+public:
+    /**
+     * A constructor that creates the recording file at the given path and writes its header.
+     * @param path The path of the recording file. An existing file is overwritten.
+     */
+    explicit FrameRecorder(const std::string &path);
+
+    /**
+     * A destructor that flushes and closes the recording file.
+     */
+    ~FrameRecorder();
+
+    /**
+     * A method that tells whether the recording file could be created.
+     * @return true if frames can be written, false otherwise
+     */
+    bool is_open() const;
+
+    /**
+     * A method that appends a frame to the recording.
+     * @param frame The frame to append.
+     * @param timestamp The capture time of the frame, in nanoseconds.
+     * @param format The layout of the frame, so that replays can convert it.
+     * @return 0 if the frame was written, -1 otherwise
+     */
+    int write(const cv::Mat &frame, uint64_t timestamp, PixelFormat format = PixelFormat::BGR);
+
+    /**
+     * A method that returns how many frames have been written so far.
+     * @return The number of frames in the recording.
+     */
+    long long get_frame_count() const;
+
+private:
+    std::ofstream file; // the recording file
+    std::vector<char> buffer; // a large stream buffer, so that frames are written in few system calls
+    long long frame_count = 0; // number of frames written so far
+};
+
+#endif //VISION_CPP_FRAME_RECORDER_H
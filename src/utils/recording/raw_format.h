@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_RAW_FORMAT_H
+#define VISION_CPP_RAW_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Layout of the raw frame recording files.
+ *
+ * A recording is a RawFileHeader followed by any number of records. Every record is a RawFrameHeader followed by
+ * the pixel data of one frame, stored row after row with the stride given in the header. Headers and pixel data all
+ * start on a RAW_ALIGNMENT boundary, so a memory-mapped recording can hand out cv::Mat headers that point straight
+ * into the mapping. Values are stored in the byte order of the machine that recorded them.
+ */
+
+const char RAW_MAGIC[8] = {'F', 'C', 'P', 'P', 'R', 'A', 'W', '1'};
+const uint32_t RAW_VERSION = 1;
+const size_t RAW_ALIGNMENT = 64;
+
+/**
+ * The header at the start of every recording.
+ */
+struct RawFileHeader {
+    char magic[8]; // RAW_MAGIC
+    uint32_t version; // RAW_VERSION
+    uint32_t reserved;
+};
+
+/**
+ * The header in front of every frame.
+ */
+struct RawFrameHeader {
+    uint64_t timestamp; // capture time in nanoseconds, relative to an arbitrary epoch
+    int32_t rows; // frame height
+    int32_t cols; // frame width
+    int32_t type; // OpenCV type of the frame (e.g. CV_8UC3)
+    uint32_t format; // PixelFormat of the frame, 0 (BGR) in recordings made before YUV capture existed
+    uint64_t step; // bytes between the start of two rows
+    uint64_t size; // bytes of pixel data (rows * step)
+};
+
+/**
+ * Rounds a size or an offset up to the next RAW_ALIGNMENT boundary.
+ * @param value The size or offset.
+ * @return The aligned value.
+ */
+inline uint64_t raw_align(uint64_t value) {
+    return (value + RAW_ALIGNMENT - 1) & ~static_cast<uint64_t>(RAW_ALIGNMENT - 1);
+}
+
+#endif //VISION_CPP_RAW_FORMAT_H
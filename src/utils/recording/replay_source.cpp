@@ -0,0 +1,145 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "replay_source.h"
+#include "../source/yuv.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * A function that checks that the header of a recorded frame describes a frame its pixel data can hold, so that a
+ * corrupted recording is never mapped into a cv::Mat reading past its data.
+ * @param header The header of the frame.
+ * @return true if the frame can be replayed.
+ */
+static bool is_valid(const RawFrameHeader &header) {
+    if (header.rows <= 0 || header.cols <= 0 || header.type < 0 || (header.type & ~CV_MAT_TYPE_MASK) != 0 ||
+        CV_MAT_DEPTH(header.type) > CV_16F) {
+        return false;
+    }
+    uint64_t row_size = static_cast<uint64_t>(header.cols) * CV_ELEM_SIZE(header.type);
+    return header.step >= row_size && header.step <= header.size / static_cast<uint64_t>(header.rows);
+}
+
+ReplaySource::ReplaySource(const std::string &path, bool realtime, bool loop) {
+    this->realtime = realtime;
+    this->loop = loop;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Failed to open recording " << path << "." << std::endl;
+        exhausted = true;
+        return;
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0) {
+        std::cout << "Failed to stat recording " << path << "." << std::endl;
+        close(fd);
+        exhausted = true;
+        return;
+    }
+    mapping_size = file_stat.st_size;
+
+    if (mapping_size >= sizeof(RawFileHeader)) {
+        mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+        }
+    }
+    close(fd);
+
+    auto *base = static_cast<const char *>(mapping);
+    if (base == nullptr || std::memcmp(base, RAW_MAGIC, sizeof(RAW_MAGIC)) != 0 ||
+        reinterpret_cast<const RawFileHeader *>(base)->version != RAW_VERSION) {
+        std::cout << "Not a raw recording: " << path << "." << std::endl;
+        exhausted = true;
+        return;
+    }
+    madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+    // index the frames, stopping at the first incomplete one (e.g. a recording that was interrupted)
+    uint64_t offset = raw_align(sizeof(RawFileHeader));
+    while (offset + sizeof(RawFrameHeader) <= mapping_size) {
+        Entry entry{};
+        std::memcpy(&entry.header, base + offset, sizeof(RawFrameHeader));
+        entry.data_offset = offset + raw_align(sizeof(RawFrameHeader));
+        if (entry.data_offset + entry.header.size > mapping_size) {
+            break;
+        }
+        if (!is_valid(entry.header)) {
+            std::cout << "Invalid frame " << entries.size() << " in recording " << path << ", ignoring the rest."
+                      << std::endl;
+            break;
+        }
+        entries.push_back(entry);
+        offset = entry.data_offset + raw_align(entry.header.size);
+    }
+
+    std::cout << "Replaying " << entries.size() << " frames from " << path << "." << std::endl;
+    exhausted = entries.empty();
+}
+
+ReplaySource::~ReplaySource() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+int ReplaySource::read(cv::Mat &frame) {
+    if (exhausted) {
+        return -1;
+    }
+    if (next_entry >= entries.size()) {
+        if (!loop) {
+            exhausted = true;
+            return -1;
+        }
+        next_entry = 0;
+    }
+
+    Entry &entry = entries[next_entry];
+    if (next_entry == 0) {
+        replay_start = std::chrono::steady_clock::now();
+    } else if (realtime) {
+        auto offset = std::chrono::nanoseconds(entry.header.timestamp - entries[0].header.timestamp);
+        std::this_thread::sleep_until(replay_start + offset);
+    }
+    next_entry++;
+
+    cv::Mat recorded(entry.header.rows, entry.header.cols, entry.header.type,
+                     static_cast<char *>(mapping) + entry.data_offset, entry.header.step);
+    format = static_cast<PixelFormat>(entry.header.format);
+    if (native || format == PixelFormat::BGR) {
+        frame = recorded;
+    } else {
+        to_bgr(recorded, format, frame);
+        format = PixelFormat::BGR;
+    }
+    return 0;
+}
+
+void ReplaySource::set_fps(int) {}
+
+void ReplaySource::set_native(bool native) {
+    this->native = native;
+}
+
+PixelFormat ReplaySource::get_format() {
+    return format;
+}
+
+bool ReplaySource::end_of_stream() {
+    return exhausted;
+}
+
+size_t ReplaySource::get_frame_count() const {
+    return entries.size();
+}
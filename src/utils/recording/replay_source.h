@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_REPLAY_SOURCE_H
+#define VISION_CPP_REPLAY_SOURCE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+#include "../source/frame_source.h"
+#include "raw_format.h"
+
+/**
+ * A frame source that replays a raw recording made by FrameRecorder.
+ * The recording is memory-mapped and every frame handed out is a cv::Mat header pointing straight into the mapping,
+ * so replaying costs neither a decode nor a copy. The mapping is private: a filter writing into its input only
+ * touches its own copy of the page, never the file.
+ * Frames are either paced like they were captured (real-time) or handed out as fast as they are asked for.
+ * Frames recorded in a YUV layout are converted to BGR, unless the native layout was asked for.
+ */
+class ReplaySource : public FrameSource {
+public:
+    /**
+     * A constructor that maps the recording at the given path and indexes its frames.
+     * @param path The path of the recording.
+     * @param realtime Whether to pace the frames according to their capture timestamps.
+     * @param loop Whether to start again from the first frame once the last one has been read.
+     */
+    explicit ReplaySource(const std::string &path, bool realtime, bool loop);
+
+    /**
+     * A destructor that unmaps the recording. Frames handed out must not be used after this.
+     */
+    ~ReplaySource() override;
+
+    /**
+     * A method that points the given cv::Mat at the next frame of the recording, waiting for its time in real-time mode.
+     * @param frame a reference to a cv::Mat object that will point into the recording
+     * @return 0 if a frame was read, -1 at the end of the recording (or if it could not be opened)
+     */
+    int read(cv::Mat &frame) override;
+
+    /**
+     * Replays are paced by their timestamps (or not at all), so the requested rate is ignored.
+     * @param fps ignored
+     */
+    void set_fps(int fps) override;
+
+    /**
+     * A method that tells whether every frame has been read and the replay does not loop.
+     * @return true at the end of the recording, false otherwise
+     */
+    bool end_of_stream() override;
+
+    /**
+     * A method that chooses between handing out frames in the layout they were recorded in, or in BGR.
+     * @param native true for the recorded layout, false for BGR
+     */
+    void set_native(bool native) override;
+
+    /**
+     * A method that returns the layout of the last frame read.
+     * @return The pixel layout of the last frame read.
+     */
+    PixelFormat get_format() override;
+
+    /**
+     * A method that returns how many frames the recording holds.
+     * @return The number of complete frames in the recording.
+     */
+    size_t get_frame_count() const;
+
+private:
+    /**
+     * A structure that locates one frame inside the mapping.
+     */
+    struct Entry {
+        RawFrameHeader header; // the frame header
+        uint64_t data_offset; // offset of the pixel data from the start of the mapping
+    };
+
+    void *mapping = nullptr; // start of the memory-mapped recording
+    size_t mapping_size = 0; // size of the mapping in bytes
+    std::vector<Entry> entries; // every complete frame of the recording, in order
+    size_t next_entry = 0; // index of the next frame to hand out
+    bool realtime; // pace frames according to their timestamps
+    bool loop; // restart from the first frame at the end of the recording
+    bool exhausted = false; // set once the last frame was read and the replay does not loop
+    bool native = false; // hand out frames in their recorded layout instead of BGR
+    PixelFormat format = PixelFormat::BGR; // layout of the last frame read
+    std::chrono::steady_clock::time_point replay_start; // when the current pass over the recording started
+};
+
+#endif //VISION_CPP_REPLAY_SOURCE_H
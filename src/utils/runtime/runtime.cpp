@@ -0,0 +1,199 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "runtime.h"
+#include "../trace/trace.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <thread>
+
+static const std::chrono::milliseconds RISK_HOLD(250); // how long deadlines stay at risk after a stage flagged one
+
+static int64_t steady_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Runtime::Runtime(int workers) {
+    if (workers <= 0) {
+        workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    this->workers = workers;
+    this->free_slots = workers;
+}
+
+Runtime::~Runtime() = default;
+
+int Runtime::add_stream(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<StreamEntry> entry(new StreamEntry());
+    entry->name = name;
+    streams.push_back(std::move(entry));
+    return static_cast<int>(streams.size()) - 1;
+}
+
+int Runtime::pick_stream() const {
+    int picked = -1;
+    for (int i = 0; i < static_cast<int>(streams.size()); i++) {
+        if (streams[i]->waiting > 0 && (picked < 0 || streams[i]->virtual_time < streams[picked]->virtual_time)) {
+            picked = i;
+        }
+    }
+    return picked;
+}
+
+bool Runtime::is_next(const Waiter *waiter) const {
+    if (!deadline_scheduling) {
+        return pick_stream() == waiter->stream;
+    }
+    // earliest deadline first; iterations without a deadline only go when no deadline is waiting
+    const Waiter *earliest = nullptr;
+    for (const Waiter *other: waiters) {
+        if (other->deadline > 0 && (earliest == nullptr || other->deadline < earliest->deadline)) {
+            earliest = other;
+        }
+    }
+    if (earliest != nullptr) {
+        return earliest == waiter;
+    }
+    int picked = pick_stream();
+    for (const Waiter *other: waiters) {
+        if (other->stream == picked) {
+            return other == waiter;
+        }
+    }
+    return false;
+}
+
+bool Runtime::acquire(int stream, std::chrono::microseconds timeout) {
+    return acquire(stream, timeout, 0);
+}
+
+bool Runtime::acquire(int stream, std::chrono::microseconds timeout, int64_t deadline) {
+    TRACE_SCOPE("wait for slot");
+    auto wait_start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    StreamEntry &entry = *streams[stream];
+
+    if (entry.waiting == 0 && entry.running == 0) {
+        // coming back from idle: catch up with the least served active stream instead of claiming the idle time
+        long long floor = std::numeric_limits<long long>::max();
+        for (auto &other: streams) {
+            if (other.get() != &entry && (other->waiting > 0 || other->running > 0)) {
+                floor = std::min(floor, other->virtual_time);
+            }
+        }
+        if (floor != std::numeric_limits<long long>::max()) {
+            entry.virtual_time = std::max(entry.virtual_time, floor);
+        }
+    }
+
+    Waiter waiter{stream, deadline};
+    waiters.push_back(&waiter);
+    entry.waiting++;
+    bool granted = condition.wait_for(lock, timeout, [&] {
+        return free_slots > 0 && is_next(&waiter);
+    });
+    entry.waiting--;
+    std::erase(waiters, &waiter);
+
+    if (!granted) {
+        // another stream may be next in line now that this one stopped waiting
+        condition.notify_all();
+        return false;
+    }
+
+    free_slots--;
+    entry.running++;
+    entry.wait_time += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - wait_start).count();
+    if (free_slots > 0) {
+        condition.notify_all();
+    }
+    return true;
+}
+
+void Runtime::release(int stream, std::chrono::microseconds busy_time) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        StreamEntry &entry = *streams[stream];
+        entry.running--;
+        entry.virtual_time += busy_time.count();
+        entry.stage_runs++;
+        entry.busy_time += busy_time.count();
+        free_slots++;
+    }
+    condition.notify_all();
+}
+
+int Runtime::get_workers() const {
+    return workers;
+}
+
+void Runtime::set_thread_budget(ThreadBudget *budget) {
+    thread_budget = budget;
+}
+
+ThreadBudget *Runtime::get_thread_budget() const {
+    return thread_budget;
+}
+
+void Runtime::set_deadline_scheduling(bool enabled) {
+    deadline_scheduling = enabled;
+}
+
+bool Runtime::is_deadline_scheduling() const {
+    return deadline_scheduling;
+}
+
+void Runtime::flag_deadline_risk() {
+    deadline_risks.fetch_add(1, std::memory_order_relaxed);
+    at_risk_until.store(steady_now() + std::chrono::duration_cast<std::chrono::nanoseconds>(RISK_HOLD).count(),
+                        std::memory_order_relaxed);
+}
+
+bool Runtime::is_deadline_at_risk() const {
+    return steady_now() < at_risk_until.load(std::memory_order_relaxed);
+}
+
+int Runtime::get_stream_count() const {
+    return static_cast<int>(streams.size());
+}
+
+const std::string &Runtime::get_stream_name(int stream) const {
+    return streams[stream]->name;
+}
+
+StreamStats Runtime::get_stats(int stream) const {
+    const StreamEntry &entry = *streams[stream];
+    StreamStats stats;
+    stats.stage_runs = entry.stage_runs;
+    stats.busy_time = entry.busy_time;
+    stats.wait_time = entry.wait_time;
+    return stats;
+}
+
+void Runtime::report(std::ostream &out, double elapsed) {
+    long long total_busy = 0;
+    for (int i = 0; i < get_stream_count(); i++) {
+        total_busy += streams[i]->busy_time;
+    }
+
+    out << std::fixed << std::setprecision(2) << "Runtime: " << workers << " workers, "
+        << (elapsed > 0 ? total_busy / 1e6 / elapsed / workers * 100 : 0) << "% busy" << std::endl;
+    for (int i = 0; i < get_stream_count(); i++) {
+        StreamStats stats = get_stats(i);
+        out << "  " << streams[i]->name << ": " << stats.stage_runs << " stage runs, "
+            << (total_busy > 0 ? stats.busy_time * 100.0 / total_busy : 0) << "% of processing, "
+            << (stats.stage_runs > 0 ? stats.wait_time / 1000.0 / stats.stage_runs : 0) << " ms mean wait" << std::endl;
+    }
+    if (deadline_scheduling) {
+        out << "  Deadline scheduling: deadlines flagged at risk " << deadline_risks.load() << " times" << std::endl;
+    }
+    if (thread_budget != nullptr) {
+        thread_budget->report(out);
+    }
+}
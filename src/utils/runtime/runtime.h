@@ -0,0 +1,203 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_RUNTIME_H
+#define VISION_CPP_RUNTIME_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "thread_budget.h"
+
+/**
+ * A structure that holds the counters the runtime keeps for one stream.
+ */
+struct StreamStats {
+    long long stage_runs = 0; // stage iterations that were granted a slot
+    long long busy_time = 0; // time spent running stages, in microseconds
+    long long wait_time = 0; // time stages spent waiting for a slot, in microseconds
+};
+
+/**
+ * A class that shares a fixed number of worker slots between the stages of several streams.
+ * Every stage iteration runs inside a slot (see acquire and release), so however many streams and stages are
+ * running, no more than `workers` iterations compete for the cores at once.
+ * Slots are handed out fairly: when a slot frees up, it goes to the waiting stream that has used the least
+ * processing time so far, so a stream with heavy filters cannot starve the others. A stream that was idle is
+ * not owed the time it did not use, and resumes level with the busiest active stream.
+ * With deadline scheduling, slots go to the waiting stage iteration with the earliest deadline instead, across
+ * streams; iterations without a deadline only get the slots no deadline stage is waiting for, shared fairly as above.
+ * Stages with a deadline flag the runtime when they miss it or are about to, and the stages without one are then
+ * throttled (see Processor) until the deadlines are safe again.
+ * Streams must all be added before their stages start.
+ */
+class Runtime {
+public:
+    /**
+     * A constructor that creates a runtime with the given number of slots.
+     * @param workers The number of stage iterations that may run at once, 0 for one per hardware thread.
+     */
+    explicit Runtime(int workers);
+
+    /**
+     * A destructor that destroys the runtime. No stage may be running.
+     */
+    ~Runtime();
+
+    /**
+     * A method that registers a stream.
+     * @param name A name for the stream, used in reports.
+     * @return The index of the stream, to pass to acquire and release.
+     */
+    int add_stream(const std::string &name);
+
+    /**
+     * A method that waits for a slot for one iteration of a stage of the given stream.
+     * @param stream The index of the stream.
+     * @param timeout How long to wait at most, so that the caller can check whether it should stop.
+     * @return true if a slot was granted (release must be called), false on timeout.
+     */
+    bool acquire(int stream, std::chrono::microseconds timeout);
+
+    /**
+     * A method that waits for a slot for one iteration of a stage that must finish by a deadline.
+     * @param stream The index of the stream.
+     * @param timeout How long to wait at most, so that the caller can check whether it should stop.
+     * @param deadline When the iteration is due, in steady clock nanoseconds, or 0 for none.
+     * @return true if a slot was granted (release must be called), false on timeout.
+     */
+    bool acquire(int stream, std::chrono::microseconds timeout, int64_t deadline);
+
+    /**
+     * A method that gives back a slot and charges the stream for the time it was used.
+     * @param stream The index of the stream.
+     * @param busy_time How long the stage iteration ran.
+     */
+    void release(int stream, std::chrono::microseconds busy_time);
+
+    /**
+     * A method that returns the number of slots.
+     * @return The number of stage iterations that may run at once.
+     */
+    int get_workers() const;
+
+    /**
+     * A method that makes the stages divide the cores of a thread budget for their parallel loops. Must be called
+     * before the stages start.
+     * @param budget The thread budget, or nullptr to let every stage use as many OpenMP threads as it likes.
+     */
+    void set_thread_budget(ThreadBudget *budget);
+
+    /**
+     * A method that returns the thread budget of the stages.
+     * @return The thread budget, or nullptr if there is none.
+     */
+    ThreadBudget *get_thread_budget() const;
+
+    /**
+     * A method that turns earliest-deadline-first scheduling of the slots on or off. Must be called before the stages
+     * start.
+     * @param enabled Whether slots go to the earliest deadline rather than to the least served stream.
+     */
+    void set_deadline_scheduling(bool enabled);
+
+    /**
+     * A method that tells whether slots are scheduled earliest-deadline-first.
+     * @return true with deadline scheduling.
+     */
+    bool is_deadline_scheduling() const;
+
+    /**
+     * A method that records that a stage missed its deadline, or is about to. Deadlines stay at risk for a while.
+     */
+    void flag_deadline_risk();
+
+    /**
+     * A method that tells whether a stage missed its deadline, or was about to, recently.
+     * @return true while the stages without a deadline should be throttled.
+     */
+    bool is_deadline_at_risk() const;
+
+    /**
+     * A method that returns the number of registered streams.
+     * @return The number of streams.
+     */
+    int get_stream_count() const;
+
+    /**
+     * A method that returns the name a stream was registered with.
+     * @param stream The index of the stream.
+     * @return The name of the stream.
+     */
+    const std::string &get_stream_name(int stream) const;
+
+    /**
+     * A method that returns a copy of the counters of a stream. It does not take the lock, so it can be polled
+     * (e.g. by a metrics exporter) without delaying the stages.
+     * @param stream The index of the stream.
+     * @return The counters of the stream.
+     */
+    StreamStats get_stats(int stream) const;
+
+    /**
+     * A method that prints, for every stream, its share of the processing time and how long its stages waited.
+     * @param out The stream to print to.
+     * @param elapsed The duration of the run, in seconds.
+     */
+    void report(std::ostream &out, double elapsed);
+
+private:
+    /**
+     * A structure that holds the scheduling state of one stream.
+     */
+    struct StreamEntry {
+        std::string name; // name of the stream
+        int waiting = 0; // stage iterations waiting for a slot
+        int running = 0; // stage iterations holding a slot
+        long long virtual_time = 0; // processing time charged to the stream, in microseconds
+        std::atomic<long long> stage_runs{0}; // stage iterations that were granted a slot
+        std::atomic<long long> busy_time{0}; // time spent running stages, in microseconds
+        std::atomic<long long> wait_time{0}; // time stages spent waiting for a slot, in microseconds
+    };
+
+    /**
+     * A structure that holds one stage iteration waiting for a slot.
+     */
+    struct Waiter {
+        int stream; // index of the stream of the stage
+        int64_t deadline; // when the iteration is due, in steady clock nanoseconds, 0 for none
+    };
+
+    /**
+     * A method that returns the waiting stream with the least processing time. The mutex must be held.
+     * @return The index of the stream, -1 if no stream is waiting.
+     */
+    int pick_stream() const;
+
+    /**
+     * A method that tells whether a waiting iteration is the next one to get a slot. The mutex must be held.
+     * @param waiter The iteration.
+     * @return true if it goes first.
+     */
+    bool is_next(const Waiter *waiter) const;
+
+    std::mutex mutex; // protects everything below, except the counters of the streams
+    std::condition_variable condition; // signalled when a slot frees up or the waiting streams change
+    std::vector<std::unique_ptr<StreamEntry>> streams; // the registered streams, by index
+    int workers; // number of slots
+    int free_slots; // slots not currently held
+    std::vector<const Waiter *> waiters; // the iterations waiting for a slot
+    bool deadline_scheduling = false; // slots go to the earliest deadline
+    std::atomic<int64_t> at_risk_until{0}; // until when deadlines are at risk, in steady clock nanoseconds
+    std::atomic<long long> deadline_risks{0}; // times a stage flagged its deadline
+    ThreadBudget *thread_budget = nullptr; // cores the parallel loops of the stages divide, may be nullptr
+};
+
+#endif //VISION_CPP_RUNTIME_H
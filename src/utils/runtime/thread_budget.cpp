@@ -0,0 +1,251 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "thread_budget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const std::chrono::milliseconds REBALANCE_INTERVAL(250); // how often widths are recomputed
+static const std::chrono::milliseconds IDLE_AFTER(1000); // how long without a frame before a stage gives its cores back
+static const double SMOOTHING = 0.5; // weight of the last interval in the smoothed cost of a stage
+
+/**
+ * Returns the CPUs the process may run on (its affinity mask, which containers and taskset restrict), in order.
+ */
+static std::vector<int> get_available_cores() {
+    std::vector<int> core_ids;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                core_ids.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (core_ids.empty()) {
+        int count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; cpu++) {
+            core_ids.push_back(cpu);
+        }
+    }
+    return core_ids;
+}
+
+/**
+ * Binds the calling thread to the given CPUs.
+ */
+static void pin_thread(const std::vector<int> &cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu: cpus) {
+        CPU_SET(cpu, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+ThreadBudget::ThreadBudget(int cores, bool pin) {
+    this->core_ids = get_available_cores();
+    this->cores = cores > 0 ? cores : static_cast<int>(core_ids.size());
+    this->pin = pin;
+    this->window_start = std::chrono::steady_clock::now();
+#ifndef __linux__
+    if (pin) {
+        std::cout << "Pinning stages to cores is only supported on Linux." << std::endl;
+        this->pin = false;
+    }
+#endif
+}
+
+ThreadBudget::~ThreadBudget() = default;
+
+int ThreadBudget::add_stage(const std::string &name, int stream) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int stage = -1;
+    for (int i = 0; i < static_cast<int>(stages.size()); i++) {
+        if (stages[i]->name == name && stages[i]->stream == stream && !stages[i]->running) {
+            stage = i;
+            break;
+        }
+    }
+    if (stage < 0) {
+        std::unique_ptr<StageEntry> entry(new StageEntry());
+        entry->name = name;
+        entry->stream = stream;
+        stages.push_back(std::move(entry));
+        stage = static_cast<int>(stages.size()) - 1;
+    }
+
+    StageEntry &entry = *stages[stage];
+    entry.running = true;
+    entry.applied_generation = -1;
+    entry.last_active = std::chrono::steady_clock::now();
+    rebalance(entry.last_active);
+    return stage;
+}
+
+void ThreadBudget::remove_stage(int stage) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stages[stage]->running = false;
+    rebalance(std::chrono::steady_clock::now());
+}
+
+void ThreadBudget::apply(int stage) {
+    int width;
+    std::vector<int> cpus;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        StageEntry &entry = *stages[stage];
+        auto now = std::chrono::steady_clock::now();
+        entry.last_active = now;
+        if (!entry.budget.active) {
+            // back from idle: take a share now rather than run at the idle width until the next rebalance
+            rebalance(now);
+        }
+        if (entry.applied_generation == entry.generation) {
+            return;
+        }
+        entry.applied_generation = entry.generation;
+        width = entry.budget.width;
+        if (pin) {
+            for (int i = 0; i < width; i++) {
+                cpus.push_back(core_ids[(entry.budget.first_core + i) % core_ids.size()]);
+            }
+        }
+    }
+
+#ifdef _OPENMP
+    // the number of threads is a per-thread setting, so it only applies to the parallel loops of this stage
+    omp_set_num_threads(width);
+#endif
+    if (pin) {
+        pin_thread(cpus);
+#ifdef _OPENMP
+        // the team threads were created by this thread, possibly before its cores changed: bind them too
+#pragma omp parallel num_threads(width) default(none) shared(cpus)
+        pin_thread(cpus);
+#endif
+    }
+}
+
+void ThreadBudget::record(int stage, std::chrono::microseconds busy_time) {
+    std::lock_guard<std::mutex> lock(mutex);
+    StageEntry &entry = *stages[stage];
+    // the iteration kept the whole team busy, as far as the budget can tell
+    entry.window_cost += busy_time.count() * entry.budget.width;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - window_start >= REBALANCE_INTERVAL) {
+        rebalance(now);
+    }
+}
+
+void ThreadBudget::rebalance(std::chrono::steady_clock::time_point now) {
+    double seconds = std::chrono::duration<double>(now - window_start).count();
+    window_start = now;
+
+    std::vector<StageEntry *> active;
+    double total_cost = 0;
+    for (auto &entry: stages) {
+        if (seconds > 0) {
+            double rate = entry->window_cost / 1e6 / seconds;
+            entry->budget.cost = entry->budget.cost * (1 - SMOOTHING) + rate * SMOOTHING;
+        }
+        entry->window_cost = 0;
+
+        bool was_active = entry->budget.active;
+        entry->budget.active = entry->running && now - entry->last_active < IDLE_AFTER;
+        if (entry->budget.active != was_active) {
+            entry->generation++;
+        }
+        if (entry->budget.active) {
+            active.push_back(entry.get());
+            total_cost += entry->budget.cost;
+        }
+    }
+    if (active.empty()) {
+        return;
+    }
+
+    // one core each, then the spare cores in proportion to cost, the fractions going to the largest remainders
+    int count = static_cast<int>(active.size());
+    int spare = std::max(0, cores - count);
+    std::vector<int> widths(count, 1);
+    std::vector<std::pair<double, int>> remainders;
+    int given = 0;
+    for (int i = 0; i < count; i++) {
+        double share = total_cost > 0 ? spare * active[i]->budget.cost / total_cost : static_cast<double>(spare) / count;
+        int whole = static_cast<int>(std::floor(share));
+        widths[i] += whole;
+        given += whole;
+        remainders.emplace_back(share - whole, i);
+    }
+    std::sort(remainders.begin(), remainders.end(), [](auto &a, auto &b) { return a.first > b.first; });
+    for (int i = 0; given < spare && i < count; i++, given++) {
+        widths[remainders[i].second]++;
+    }
+
+    // consecutive ranges of cores, wrapping around when there are more stages than cores
+    int first_core = 0;
+    for (int i = 0; i < count; i++) {
+        StageBudget &budget = active[i]->budget;
+        if (budget.width != widths[i] || budget.first_core != first_core) {
+            budget.width = widths[i];
+            budget.first_core = first_core;
+            active[i]->generation++;
+        }
+        first_core = (first_core + widths[i]) % static_cast<int>(core_ids.size());
+    }
+}
+
+int ThreadBudget::get_cores() const {
+    return cores;
+}
+
+int ThreadBudget::get_stage_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<int>(stages.size());
+}
+
+void ThreadBudget::get_stage_name(int stage, std::string &name, int &stream) {
+    std::lock_guard<std::mutex> lock(mutex);
+    name = stages[stage]->name;
+    stream = stages[stage]->stream;
+}
+
+StageBudget ThreadBudget::get_budget(int stage) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stages[stage]->budget;
+}
+
+void ThreadBudget::report(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << std::fixed << std::setprecision(2) << "Thread budget: " << cores << " cores"
+        << (pin ? ", stages pinned" : "") << std::endl;
+    for (auto &entry: stages) {
+        out << "  " << entry->name << " (stream " << entry->stream << "): " << entry->budget.width << " threads"
+            << (entry->budget.active ? "" : " when last active") << ", " << entry->budget.cost << " cores used";
+        if (pin && entry->budget.active) {
+            out << ", cores from " << core_ids[entry->budget.first_core];
+        }
+        out << std::endl;
+    }
+}
@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_THREAD_BUDGET_H
+#define VISION_CPP_THREAD_BUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * A structure that holds a copy of what the thread budget gives one stage.
+ */
+struct StageBudget {
+    bool active = false; // whether the stage processed a frame recently
+    int width = 1; // OpenMP threads the parallel loops of the stage may use
+    double cost = 0; // smoothed cost of the stage, in cores (core-seconds per second)
+    int first_core = 0; // position of the first core of the stage in the budget, when stages are pinned
+};
+
+/**
+ * A class that divides a fixed number of cores between the stages that are processing frames.
+ * Every stage runs the `#pragma omp parallel for` loops of the filters on its own thread, so without a budget each of
+ * them starts a team as wide as the machine and the teams fight over the same cores. Here, every active stage gets
+ * at least one core, and the remaining cores go to the stages in proportion to their measured cost (the CPU time of
+ * their iterations, threads included), so the most expensive stages get the widest teams.
+ * Widths are recomputed every REBALANCE_INTERVAL from the costs of the previous interval, smoothed. A stage that has
+ * not processed a frame for a while gives its cores back. With pinning, every stage also gets its own range of
+ * cores, and its thread and its OpenMP team are bound to it.
+ * A stage calls apply before each iteration (on its own thread: OpenMP widths are per thread) and record after it.
+ */
+class ThreadBudget {
+public:
+    /**
+     * A constructor that creates a budget.
+     * @param cores The number of cores to divide, 0 for every core the process may run on.
+     * @param pin Whether stages are bound to disjoint ranges of cores (Linux only).
+     */
+    ThreadBudget(int cores, bool pin);
+
+    /**
+     * A destructor that destroys the budget. No stage may be running.
+     */
+    ~ThreadBudget();
+
+    /**
+     * A method that registers a stage, from its thread, when it starts. A stage that was registered before under
+     * the same name and stream (e.g. a task restarted) gets its entry back.
+     * @param name The name of the stage.
+     * @param stream The index of the stream the stage belongs to.
+     * @return The index of the stage, to pass to the other methods.
+     */
+    int add_stage(const std::string &name, int stream);
+
+    /**
+     * A method that marks a stage as stopped, so that its cores go to the others at the next rebalance.
+     * @param stage The index of the stage.
+     */
+    void remove_stage(int stage);
+
+    /**
+     * A method that applies the current width (and cores, with pinning) of a stage to the calling thread and its
+     * OpenMP team, if they changed since the previous call. Must be called from the thread of the stage.
+     * @param stage The index of the stage.
+     */
+    void apply(int stage);
+
+    /**
+     * A method that charges a stage for one iteration, and rebalances the budget once the interval is over.
+     * @param stage The index of the stage.
+     * @param busy_time How long the iteration ran.
+     */
+    void record(int stage, std::chrono::microseconds busy_time);
+
+    /**
+     * A method that returns the number of cores the budget divides.
+     * @return The number of cores.
+     */
+    int get_cores() const;
+
+    /**
+     * A method that returns the number of registered stages.
+     * @return The number of stages.
+     */
+    int get_stage_count();
+
+    /**
+     * A method that returns the name and stream a stage was registered with.
+     * @param stage The index of the stage.
+     * @param name A reference to the name to fill in.
+     * @param stream A reference to the stream to fill in.
+     */
+    void get_stage_name(int stage, std::string &name, int &stream);
+
+    /**
+     * A method that returns what the budget currently gives a stage.
+     * @param stage The index of the stage.
+     * @return The budget of the stage.
+     */
+    StageBudget get_budget(int stage);
+
+    /**
+     * A method that prints the width and cost of every stage.
+     * @param out The stream to print to.
+     */
+    void report(std::ostream &out);
+
+private:
+    /**
+     * A structure that holds the state of one stage.
+     */
+    struct StageEntry {
+        std::string name; // name of the stage
+        int stream = 0; // index of the stream of the stage
+        bool running = false; // whether the stage thread is running
+        StageBudget budget; // what the stage gets, as of the last rebalance
+        long long window_cost = 0; // CPU time of the iterations since the last rebalance, in microseconds
+        long long generation = 0; // incremented whenever the budget of the stage changes
+        long long applied_generation = -1; // the generation the stage thread applied last
+        std::chrono::steady_clock::time_point last_active; // when the stage last ran an iteration
+    };
+
+    /**
+     * A method that recomputes the widths and cores of every stage. The mutex must be held.
+     * @param now The current time.
+     */
+    void rebalance(std::chrono::steady_clock::time_point now);
+
+    std::mutex mutex; // protects everything below
+    std::vector<std::unique_ptr<StageEntry>> stages; // the registered stages, by index
+    std::vector<int> core_ids; // the CPUs the process may run on, handed out in this order when pinning
+    int cores; // number of cores divided between the stages
+    bool pin; // whether stages are bound to their cores
+    std::chrono::steady_clock::time_point window_start; // when the current interval started
+};
+
+#endif //VISION_CPP_THREAD_BUDGET_H
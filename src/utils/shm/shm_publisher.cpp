@@ -0,0 +1,100 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "shm_publisher.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+ShmPublisher::ShmPublisher(std::string name, uint32_t slot_count, uint64_t data_capacity) {
+    this->name = std::move(name);
+    slot_count = std::max<uint32_t>(slot_count, 2);
+
+    uint64_t slot_size = shm_align(sizeof(ShmSlotHeader)) + shm_align(data_capacity);
+    mapping_size = shm_align(sizeof(ShmRingHeader)) + slot_size * slot_count;
+
+    // a stale ring left by a crashed publisher is replaced; attached readers keep the old one until they reopen
+    shm_unlink(this->name.c_str());
+    int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(mapping_size)) != 0) {
+        std::cout << "Failed to create shared memory " << this->name << "." << std::endl;
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(this->name.c_str());
+        }
+        return;
+    }
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        shm_unlink(this->name.c_str());
+        std::cout << "Failed to map shared memory " << this->name << "." << std::endl;
+        return;
+    }
+
+    auto *header = new(mapping) ShmRingHeader();
+    header->version = SHM_VERSION;
+    header->slot_count = slot_count;
+    header->slot_size = slot_size;
+    header->data_capacity = shm_align(data_capacity);
+    header->latest.store(0, std::memory_order_relaxed);
+
+    auto *slots = static_cast<uint8_t *>(mapping) + shm_align(sizeof(ShmRingHeader));
+    for (uint32_t i = 0; i < slot_count; i++) {
+        auto *slot = new(slots + i * slot_size) ShmSlotHeader();
+        slot->guard.store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+}
+
+ShmPublisher::~ShmPublisher() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        shm_unlink(name.c_str());
+    }
+}
+
+bool ShmPublisher::is_open() const {
+    return mapping != nullptr;
+}
+
+uint64_t ShmPublisher::publish(const uint8_t *data, size_t source_step, int rows, int cols, int type,
+                               size_t row_size, uint64_t timestamp) {
+    auto *header = static_cast<ShmRingHeader *>(mapping);
+    uint64_t step = shm_align(row_size);
+    if (header == nullptr || step * rows > header->data_capacity) {
+        return 0;
+    }
+
+    uint64_t frame_sequence = sequence + 1;
+    auto *slot_start = static_cast<uint8_t *>(mapping) + shm_align(sizeof(ShmRingHeader)) +
+                       (frame_sequence % header->slot_count) * header->slot_size;
+    auto *slot = reinterpret_cast<ShmSlotHeader *>(slot_start);
+    uint8_t *pixels = slot_start + shm_align(sizeof(ShmSlotHeader));
+
+    slot->guard.store(2 * frame_sequence - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->timestamp.store(timestamp, std::memory_order_relaxed);
+    slot->rows.store(rows, std::memory_order_relaxed);
+    slot->cols.store(cols, std::memory_order_relaxed);
+    slot->type.store(type, std::memory_order_relaxed);
+    slot->step.store(step, std::memory_order_relaxed);
+    for (int row = 0; row < rows; row++) {
+        std::memcpy(pixels + row * step, data + row * source_step, row_size);
+    }
+
+    slot->guard.store(2 * frame_sequence, std::memory_order_release);
+    header->latest.store(frame_sequence, std::memory_order_release);
+    sequence = frame_sequence;
+    return frame_sequence;
+}
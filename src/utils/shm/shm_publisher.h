@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_SHM_PUBLISHER_H
+#define VISION_CPP_SHM_PUBLISHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "shm_ring.h"
+
+/**
+ * A class that creates a shared-memory ring (see shm_ring.h) and publishes frames into it.
+ * There must be a single publisher per ring. The ring is removed when the publisher is destroyed;
+ * readers that are still attached keep their mapping until they close it.
+ */
+class ShmPublisher {
+public:
+    /**
+     * A constructor that creates (or replaces) the ring with the given name.
+     * @param name The POSIX shared-memory name of the ring, e.g. "/filterscpp-cartoonize".
+     * @param slot_count The number of frames the ring holds.
+     * @param data_capacity The maximum bytes of pixel data of a frame.
+     */
+    explicit ShmPublisher(std::string name, uint32_t slot_count, uint64_t data_capacity);
+
+    /**
+     * A destructor that unmaps and removes the ring.
+     */
+    ~ShmPublisher();
+
+    /**
+     * A method that tells whether the ring could be created.
+     * @return true if frames can be published, false otherwise.
+     */
+    bool is_open() const;
+
+    /**
+     * A method that copies a frame into the next slot of the ring and makes it the latest frame.
+     * Rows are stored with a stride rounded up to SHM_ALIGNMENT.
+     * @param data A pointer to the first row of the frame.
+     * @param source_step The bytes between the start of two rows of the frame.
+     * @param rows The frame height.
+     * @param cols The frame width.
+     * @param type The OpenCV type of the frame.
+     * @param row_size The bytes of pixel data in a row (cols * bytes per pixel).
+     * @param timestamp The time the frame was published, in nanoseconds.
+     * @return The sequence number of the frame, or 0 if it does not fit in a slot.
+     */
+    uint64_t publish(const uint8_t *data, size_t source_step, int rows, int cols, int type, size_t row_size,
+                     uint64_t timestamp);
+
+private:
+    std::string name; // shared-memory name of the ring
+    void *mapping = nullptr; // start of the ring
+    size_t mapping_size = 0; // size of the ring in bytes
+    uint64_t sequence = 0; // sequence number of the last published frame
+};
+
+#endif //VISION_CPP_SHM_PUBLISHER_H
@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "shm_reader.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+ShmReader::ShmReader(std::string name) {
+    this->name = std::move(name);
+    open();
+}
+
+ShmReader::~ShmReader() {
+    if (mapping != nullptr) {
+        munmap(const_cast<void *>(mapping), mapping_size);
+    }
+}
+
+int ShmReader::open() {
+    if (mapping != nullptr) {
+        return 0;
+    }
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(ShmRingHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *ring = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) {
+        return -1;
+    }
+
+    auto *header = static_cast<const ShmRingHeader *>(ring);
+    if (std::memcmp(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) != 0 || header->version != SHM_VERSION) {
+        munmap(ring, file_stat.st_size);
+        return -1;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // every slot, with its pixel data, must lie within the mapping, since slots are addressed from the header alone
+    uint64_t slots_size = static_cast<uint64_t>(file_stat.st_size) - shm_align(sizeof(ShmRingHeader));
+    if (header->slot_count == 0 || header->data_capacity > UINT64_MAX - shm_align(sizeof(ShmSlotHeader)) ||
+        header->slot_size < shm_align(sizeof(ShmSlotHeader)) + header->data_capacity ||
+        header->slot_count > slots_size / header->slot_size) {
+        munmap(ring, file_stat.st_size);
+        return -1;
+    }
+
+    mapping = ring;
+    mapping_size = file_stat.st_size;
+    return 0;
+}
+
+bool ShmReader::is_open() const {
+    return mapping != nullptr;
+}
+
+uint64_t ShmReader::get_latest_sequence() const {
+    if (mapping == nullptr) {
+        return 0;
+    }
+    return static_cast<const ShmRingHeader *>(mapping)->latest.load(std::memory_order_acquire);
+}
+
+const ShmSlotHeader *ShmReader::get_slot(uint64_t sequence) const {
+    auto *header = static_cast<const ShmRingHeader *>(mapping);
+    auto *slots = static_cast<const uint8_t *>(mapping) + shm_align(sizeof(ShmRingHeader));
+    return reinterpret_cast<const ShmSlotHeader *>(slots + (sequence % header->slot_count) * header->slot_size);
+}
+
+int ShmReader::read_sequence(ShmFrame &frame, uint64_t sequence) const {
+    const ShmSlotHeader *slot = get_slot(sequence);
+    if (slot->guard.load(std::memory_order_acquire) != 2 * sequence) {
+        return -1;
+    }
+
+    frame.sequence = sequence;
+    frame.timestamp = slot->timestamp.load(std::memory_order_relaxed);
+    frame.rows = slot->rows.load(std::memory_order_relaxed);
+    frame.cols = slot->cols.load(std::memory_order_relaxed);
+    frame.type = slot->type.load(std::memory_order_relaxed);
+    frame.step = slot->step.load(std::memory_order_relaxed);
+    frame.data = reinterpret_cast<const uint8_t *>(slot) + shm_align(sizeof(ShmSlotHeader));
+    auto *header = static_cast<const ShmRingHeader *>(mapping);
+    if (frame.rows < 0 || frame.cols < 0 ||
+        (frame.step > 0 && static_cast<uint64_t>(frame.rows) > header->data_capacity / frame.step)) {
+        return -1;
+    }
+
+    // the metadata is only consistent if the slot was not reused while it was read
+    return is_valid(frame) ? 0 : -1;
+}
+
+int ShmReader::read_latest(ShmFrame &frame) const {
+    uint64_t latest = get_latest_sequence();
+    if (latest == 0) {
+        return -1;
+    }
+    return read_sequence(frame, latest);
+}
+
+int ShmReader::read_next(ShmFrame &frame, uint64_t after) const {
+    uint64_t latest = get_latest_sequence();
+    if (latest <= after) {
+        return -1;
+    }
+
+    auto *header = static_cast<const ShmRingHeader *>(mapping);
+    uint64_t sequence = after + 1;
+    // the slot being written is not readable, so a reader that fell behind restarts a ring behind the latest frame
+    if (latest - sequence + 1 >= header->slot_count) {
+        sequence = latest - header->slot_count + 2;
+    }
+    for (; sequence <= latest; sequence++) {
+        if (read_sequence(frame, sequence) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+bool ShmReader::is_valid(const ShmFrame &frame) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return get_slot(frame.sequence)->guard.load(std::memory_order_relaxed) == 2 * frame.sequence;
+}
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_SHM_READER_H
+#define VISION_CPP_SHM_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "shm_ring.h"
+
+/**
+ * A structure that describes a frame read from a shared-memory ring. The pixels are not copied: data points into
+ * the ring, and stays valid only until the publisher reuses the slot (see ShmReader::is_valid).
+ * With OpenCV, cv::Mat(rows, cols, type, (void *) data, step) wraps it without a copy.
+ */
+struct ShmFrame {
+    uint64_t sequence; // sequence number of the frame, starting at 1
+    uint64_t timestamp; // time the frame was published, in nanoseconds since the steady clock epoch
+    int rows; // frame height
+    int cols; // frame width
+    int type; // OpenCV type of the frame
+    size_t step; // bytes between the start of two rows
+    const uint8_t *data; // first row of the frame, inside the ring
+};
+
+/**
+ * A class that attaches to a shared-memory ring created by the application (see --sink <filter>=shm:<name>)
+ * and reads its frames without copying them. Readers map the ring read-only, so any number of processes can
+ * read it without slowing the publisher down. This class does not depend on OpenCV.
+ *
+ * Typical use:
+ *     ShmReader reader("/filterscpp-cartoonize");
+ *     ShmFrame frame;
+ *     uint64_t last = 0;
+ *     while (...) {
+ *         if (reader.read_next(frame, last) == 0) {
+ *             process(frame.data, ...);
+ *             if (reader.is_valid(frame)) { accept the result } // otherwise the frame was overwritten meanwhile
+ *             last = frame.sequence;
+ *         }
+ *     }
+ */
+class ShmReader {
+public:
+    /**
+     * A constructor that attaches to the ring with the given name, if it exists.
+     * @param name The POSIX shared-memory name of the ring.
+     */
+    explicit ShmReader(std::string name);
+
+    /**
+     * A destructor that unmaps the ring.
+     */
+    ~ShmReader();
+
+    /**
+     * A method that attaches to the ring, if not attached yet. Useful when the reader starts before the publisher.
+     * @return 0 if the reader is attached, -1 if the ring does not exist (yet).
+     */
+    int open();
+
+    /**
+     * A method that tells whether the reader is attached to a ring.
+     * @return true if attached, false otherwise.
+     */
+    bool is_open() const;
+
+    /**
+     * A method that returns the sequence number of the latest complete frame.
+     * @return The sequence number, or 0 if no frame was published yet.
+     */
+    uint64_t get_latest_sequence() const;
+
+    /**
+     * A method that reads the latest complete frame.
+     * @param frame A reference to a ShmFrame where the frame will be described.
+     * @return 0 if a frame was read, -1 if there is none.
+     */
+    int read_latest(ShmFrame &frame) const;
+
+    /**
+     * A method that reads the oldest frame still in the ring that is newer than a given frame.
+     * If the reader fell more than a ring behind, the frames in between are skipped.
+     * @param frame A reference to a ShmFrame where the frame will be described.
+     * @param after The sequence number of the last frame the caller read (0 for none).
+     * @return 0 if a frame was read, -1 if there is no newer frame yet.
+     */
+    int read_next(ShmFrame &frame, uint64_t after) const;
+
+    /**
+     * A method that tells whether a frame is still intact, i.e. its slot has not been reused by the publisher.
+     * Call it after using the pixels: if it returns false, the result computed from them must be discarded.
+     * @param frame The frame, as read by read_latest or read_next.
+     * @return true if the frame was not overwritten, false otherwise.
+     */
+    bool is_valid(const ShmFrame &frame) const;
+
+private:
+    int read_sequence(ShmFrame &frame, uint64_t sequence) const;
+
+    const ShmSlotHeader *get_slot(uint64_t sequence) const;
+
+    std::string name; // shared-memory name of the ring
+    const void *mapping = nullptr; // start of the ring
+    size_t mapping_size = 0; // size of the ring in bytes
+};
+
+#endif //VISION_CPP_SHM_READER_H
@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_SHM_RING_H
+#define VISION_CPP_SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Layout of the POSIX shared-memory rings that frames are published into.
+ *
+ * A ring is a ShmRingHeader followed by slot_count slots of slot_size bytes. Every slot is a ShmSlotHeader
+ * followed by the pixel data of one frame. Frame n (starting at 1) goes into slot n % slot_count.
+ *
+ * Each slot is guarded by a sequence lock: the producer sets the guard to 2n - 1 before it writes frame n into
+ * the slot and to 2n once the frame is complete. Readers never write to the ring, so any number of them can attach
+ * without slowing the producer down: a reader checks the guard before and after using a slot, and if it changed
+ * the frame was overwritten in the meantime and must be discarded.
+ */
+
+const char SHM_MAGIC[8] = {'F', 'C', 'P', 'P', 'S', 'H', 'M', '1'};
+const uint32_t SHM_VERSION = 1;
+const size_t SHM_ALIGNMENT = 64;
+
+/**
+ * The header at the start of every ring.
+ */
+struct alignas(SHM_ALIGNMENT) ShmRingHeader {
+    char magic[8]; // SHM_MAGIC, written last so that readers never see a half-initialised ring
+    uint32_t version; // SHM_VERSION
+    uint32_t slot_count; // number of slots in the ring
+    uint64_t slot_size; // bytes between the start of two slots
+    uint64_t data_capacity; // maximum bytes of pixel data in a slot
+    std::atomic<uint64_t> latest; // sequence number of the latest complete frame, 0 if none
+};
+
+/**
+ * The header in front of every slot.
+ */
+struct alignas(SHM_ALIGNMENT) ShmSlotHeader {
+    std::atomic<uint64_t> guard; // sequence lock: 2n - 1 while frame n is written, 2n once it is complete
+    std::atomic<uint64_t> timestamp; // time the frame was published, in nanoseconds since the steady clock epoch
+    std::atomic<int32_t> rows; // frame height
+    std::atomic<int32_t> cols; // frame width
+    std::atomic<int32_t> type; // OpenCV type of the frame (e.g. CV_8UC3 = 16)
+    std::atomic<uint64_t> step; // bytes between the start of two rows
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory rings need lock-free 64-bit atomics");
+
+/**
+ * Rounds a size up to the next SHM_ALIGNMENT boundary.
+ * @param value The size.
+ * @return The aligned size.
+ */
+inline uint64_t shm_align(uint64_t value) {
+    return (value + SHM_ALIGNMENT - 1) & ~static_cast<uint64_t>(SHM_ALIGNMENT - 1);
+}
+
+#endif //VISION_CPP_SHM_RING_H
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "dispatch.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+
+extern const KernelTable KERNELS_BASELINE;
+#ifdef FILTERS_KERNELS_X86
+extern const KernelTable KERNELS_SSE4;
+extern const KernelTable KERNELS_AVX2;
+extern const KernelTable KERNELS_AVX512;
+#endif
+
+static std::atomic<const KernelTable *> current_kernels{nullptr};
+static std::atomic<Isa> current_isa{Isa::BASELINE};
+static std::once_flag kernels_initialised;
+
+const char *isa_name(Isa isa) {
+    switch (isa) {
+        case Isa::SSE4:
+            return "sse4";
+        case Isa::AVX2:
+            return "avx2";
+        case Isa::AVX512:
+            return "avx512";
+        default:
+            return "baseline";
+    }
+}
+
+int parse_isa(const std::string &name, Isa &isa) {
+    for (Isa candidate: {Isa::BASELINE, Isa::SSE4, Isa::AVX2, Isa::AVX512}) {
+        if (name == isa_name(candidate)) {
+            isa = candidate;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static const KernelTable *table_of(Isa isa) {
+    switch (isa) {
+#ifdef FILTERS_KERNELS_X86
+        case Isa::SSE4:
+            return &KERNELS_SSE4;
+        case Isa::AVX2:
+            return &KERNELS_AVX2;
+        case Isa::AVX512:
+            return &KERNELS_AVX512;
+#endif
+        case Isa::BASELINE:
+            return &KERNELS_BASELINE;
+        default:
+            return nullptr;
+    }
+}
+
+std::vector<Isa> supported_isas() {
+    std::vector<Isa> isas = {Isa::BASELINE};
+#ifdef FILTERS_KERNELS_X86
+    // __builtin_cpu_supports also checks that the OS saves the AVX and AVX-512 registers
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        isas.push_back(Isa::SSE4);
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            isas.push_back(Isa::AVX2);
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+                isas.push_back(Isa::AVX512);
+            }
+        }
+    }
+#endif
+    return isas;
+}
+
+void init_kernels() {
+    std::call_once(kernels_initialised, [] {
+        std::vector<Isa> isas = supported_isas();
+        Isa best = isas.back();
+        Isa chosen = best;
+
+        const char *requested_name = std::getenv("FILTERS_ISA");
+        std::string reason = "detected";
+        if (requested_name != nullptr && *requested_name != '\0') {
+            Isa requested;
+            if (parse_isa(requested_name, requested) != 0) {
+                std::cout << "Unknown FILTERS_ISA " << requested_name << ", expected baseline, sse4, avx2 or avx512."
+                          << std::endl;
+            } else if (requested > best) {
+                std::cout << "FILTERS_ISA " << requested_name << " is not supported by this CPU or build." << std::endl;
+            } else {
+                chosen = requested;
+                reason = "FILTERS_ISA";
+            }
+        }
+
+        current_isa = chosen;
+        current_kernels = table_of(chosen);
+        std::cout << "Kernels: " << isa_name(chosen) << " (" << reason << ", best supported " << isa_name(best) << ")"
+                  << std::endl;
+    });
+}
+
+int set_isa(Isa isa) {
+    init_kernels();
+    for (Isa supported: supported_isas()) {
+        if (supported == isa) {
+            current_isa = isa;
+            current_kernels = table_of(isa);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+Isa get_isa() {
+    init_kernels();
+    return current_isa;
+}
+
+const KernelTable &get_kernels() {
+    const KernelTable *kernels = current_kernels.load(std::memory_order_acquire);
+    if (kernels == nullptr) {
+        init_kernels();
+        kernels = current_kernels.load(std::memory_order_acquire);
+    }
+    return *kernels;
+}
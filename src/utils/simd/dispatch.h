@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_DISPATCH_H
+#define VISION_CPP_DISPATCH_H
+
+#include <string>
+#include <vector>
+#include "kernel_table.h"
+
+/**
+ * The instruction sets the kernels are compiled for, from the oldest to the newest.
+ * BASELINE is whatever the rest of the build targets (SSE2 on x86-64), and the only variant on other architectures.
+ */
+enum class Isa {
+    BASELINE = 0,
+    SSE4 = 1, // SSE4.2
+    AVX2 = 2, // AVX2 and FMA
+    AVX512 = 3, // AVX-512 F, BW, DQ and VL
+};
+
+/**
+ * A function that returns the name of an instruction set, as accepted by parse_isa.
+ * @param isa The instruction set.
+ * @return "baseline", "sse4", "avx2" or "avx512".
+ */
+const char *isa_name(Isa isa);
+
+/**
+ * A function that parses the name of an instruction set.
+ * @param name The name, as returned by isa_name.
+ * @param isa A reference to the instruction set to fill in.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int parse_isa(const std::string &name, Isa &isa);
+
+/**
+ * A function that returns the instruction sets the kernels can use on this CPU: compiled into the binary, and
+ * supported by the CPU and the OS (CPUID and XGETBV).
+ * @return The usable instruction sets, from the oldest to the newest. Never empty: BASELINE is always usable.
+ */
+std::vector<Isa> supported_isas();
+
+/**
+ * A function that picks the kernels once, at startup: the newest supported instruction set, or the one named by the
+ * FILTERS_ISA environment variable (capped to what is supported), and prints the choice. Later calls do nothing.
+ * Called implicitly by the first get_kernels(), but calling it explicitly keeps the log line at the top.
+ */
+void init_kernels();
+
+/**
+ * A function that switches the kernels to another instruction set, e.g. for benchmarks to compare them.
+ * Must not be called while kernels run on other threads.
+ * @param isa The instruction set.
+ * @return 0 on success, -1 if it is not supported.
+ */
+int set_isa(Isa isa);
+
+/**
+ * A function that returns the instruction set of the kernels in use.
+ * @return The instruction set.
+ */
+Isa get_isa();
+
+/**
+ * A function that returns the kernels in use. Cheap enough to call for every frame.
+ * @return The kernel table of the selected instruction set.
+ */
+const KernelTable &get_kernels();
+
+#endif //VISION_CPP_DISPATCH_H
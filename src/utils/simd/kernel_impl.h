@@ -0,0 +1,248 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+// The definitions of the kernel table, compiled once per instruction set: each kernels_<isa>.cpp defines
+// KERNEL_TABLE_NAME and KERNEL_ISA_NAME, includes this file, and is built with the matching -m flags (see
+// CMakeLists.txt). The loops are plain C++ written so that the compiler vectorises them for the target: values are
+// accumulated in short fixed-size blocks, with no calls and no branches in the inner loops.
+//
+// Everything here has internal linkage, and no standard or OpenCV header is included: an inline function from a
+// shared header (std::min, cv::saturate_cast, ...) compiled with AVX-512 enabled could be the copy the linker keeps
+// for the whole program, and crash CPUs without it. Builtins are used for sqrt and rounding for the same reason.
+//
+// Results must stay bit-exact with the original OpenCV-based code: sums are exact integers, normalisation is a double
+// multiplication rounded to nearest even (cvRound), and magnitudes go through double square roots, as before.
+// bench --verify checks every variant against the scalar references.
+
+#include "kernel_table.h"
+
+#if !defined(KERNEL_TABLE_NAME) || !defined(KERNEL_ISA_NAME)
+#error "Define KERNEL_TABLE_NAME and KERNEL_ISA_NAME before including kernel_impl.h"
+#endif
+
+namespace {
+
+const int BLOCK = 256; // values accumulated at once, small enough for the accumulators to stay in L1
+
+inline uint8_t saturate_u8(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+inline int round_to_int(double value) {
+    return static_cast<int>(__builtin_rint(value)); // nearest, ties to even: the default rounding mode, like cvRound
+}
+
+inline int reflect(int index, int max) {
+    if (index < 0) {
+        return -index;
+    }
+    if (index >= max) {
+        return 2 * max - index - 1;
+    }
+    return index;
+}
+
+void partial_kernel_row(const uint8_t *const *rows, int taps, const int *kernel, double inverse_sum,
+                        uint8_t *output, int width) {
+    int sums[BLOCK];
+    for (int start = 0; start < width; start += BLOCK) {
+        int count = width - start < BLOCK ? width - start : BLOCK;
+
+        const uint8_t *first = rows[0] + start;
+        int weight = kernel[0];
+        for (int i = 0; i < count; i++) {
+            sums[i] = first[i] * weight;
+        }
+        for (int tap = 1; tap < taps; tap++) {
+            const uint8_t *row = rows[tap] + start;
+            weight = kernel[tap];
+            for (int i = 0; i < count; i++) {
+                sums[i] += row[i] * weight;
+            }
+        }
+
+        uint8_t *out = output + start;
+        for (int i = 0; i < count; i++) {
+            out[i] = saturate_u8(round_to_int(sums[i] * inverse_sum));
+        }
+    }
+}
+
+void partial_kernel_col(const uint8_t *input, uint8_t *output, int cols, int channels, const int *kernel,
+                        int kernel_offset, double inverse_sum) {
+    // the columns whose taps all fall inside the row are done in blocks; the few at each border one by one
+    int inner_begin = kernel_offset < cols ? kernel_offset : cols;
+    int inner_end = cols - kernel_offset > inner_begin ? cols - kernel_offset : inner_begin;
+
+    for (int col = 0; col < cols; col++) {
+        if (col == inner_begin) {
+            col = inner_end;
+            if (col >= cols) {
+                break;
+            }
+        }
+        for (int channel = 0; channel < channels; channel++) {
+            int sum = 0;
+            for (int tap = -kernel_offset; tap <= kernel_offset; tap++) {
+                sum += input[reflect(col + tap, cols) * channels + channel] * kernel[tap + kernel_offset];
+            }
+            output[col * channels + channel] = saturate_u8(round_to_int(sum * inverse_sum));
+        }
+    }
+
+    int sums[BLOCK];
+    int taps = 2 * kernel_offset + 1;
+    int end = inner_end * channels;
+    for (int start = inner_begin * channels; start < end; start += BLOCK) {
+        int count = end - start < BLOCK ? end - start : BLOCK;
+
+        const uint8_t *first = input + start - kernel_offset * channels;
+        int weight = kernel[0];
+        for (int i = 0; i < count; i++) {
+            sums[i] = first[i] * weight;
+        }
+        for (int tap = 1; tap < taps; tap++) {
+            const uint8_t *shifted = first + tap * channels;
+            weight = kernel[tap];
+            for (int i = 0; i < count; i++) {
+                sums[i] += shifted[i] * weight;
+            }
+        }
+
+        uint8_t *out = output + start;
+        for (int i = 0; i < count; i++) {
+            out[i] = saturate_u8(round_to_int(sums[i] * inverse_sum));
+        }
+    }
+}
+
+void magnitude_gray(const uint8_t *gradient_x, const uint8_t *gradient_y, uint8_t *output, int cols) {
+    for (int i = 0; i < cols; i++) {
+        int x = gradient_x[i];
+        int y = gradient_y[i];
+        int length = round_to_int(__builtin_sqrt(static_cast<double>(x * x + y * y)));
+        output[i] = static_cast<uint8_t>(length > 255 ? 255 : length);
+    }
+}
+
+void magnitude_bgr(const uint8_t *gradient_x, int channels_x, const uint8_t *gradient_y, int channels_y,
+                   uint8_t *output, int cols) {
+    for (int i = 0; i < cols; i++) {
+        int x = gradient_x[i * channels_x];
+        int y = gradient_y[i * channels_y];
+        auto length = static_cast<uint8_t>(static_cast<int>(__builtin_sqrt(static_cast<double>(x * x + y * y))));
+        output[i * 3] = length;
+        output[i * 3 + 1] = length;
+        output[i * 3 + 2] = length;
+    }
+}
+
+void magnitude_l1(const uint8_t *gradient_x, int channels_x, const uint8_t *gradient_y, int channels_y,
+                  uint8_t *output, int output_channels, int cols) {
+    for (int i = 0; i < cols; i++) {
+        int length = gradient_x[i * channels_x] + gradient_y[i * channels_y];
+        auto value = static_cast<uint8_t>(length > 255 ? 255 : length);
+        for (int channel = 0; channel < output_channels; channel++) {
+            output[i * output_channels + channel] = value;
+        }
+    }
+}
+
+void quantize(const uint8_t *input, uint8_t *output, int width, int bins_count) {
+    // value / bins_count as a multiplication: with a 16-bit reciprocal rounded up, the error stays below 1 / bins_count
+    // for every 8-bit value, so the quotient is exact
+    auto reciprocal = static_cast<uint32_t>((65536 + bins_count - 1) / bins_count);
+    auto bins = static_cast<uint32_t>(bins_count);
+    for (int i = 0; i < width; i++) {
+        output[i] = static_cast<uint8_t>(((input[i] * reciprocal) >> 16) * bins);
+    }
+}
+
+void negative(const uint8_t *input, uint8_t *output, int width) {
+    for (int i = 0; i < width; i++) {
+        output[i] = static_cast<uint8_t>(255 - input[i]);
+    }
+}
+
+void bgr_to_gray(const uint8_t *input, uint8_t *output, int cols) {
+    for (int i = 0; i < cols; i++) {
+        const uint8_t *pixel = input + i * 3;
+        output[i] = static_cast<uint8_t>((pixel[0] * 1868 + pixel[1] * 9617 + pixel[2] * 4899 + (1 << 13)) >> 14);
+    }
+}
+
+void cartoonize(const uint8_t *quantized, const uint8_t *magnitude, int magnitude_channels, uint8_t *output,
+                int cols, int threshold) {
+    for (int i = 0; i < cols; i++) {
+        uint8_t keep = magnitude[i * magnitude_channels] > threshold ? 0 : 0xff;
+        output[i * 3] = quantized[i * 3] & keep;
+        output[i * 3 + 1] = quantized[i * 3 + 1] & keep;
+        output[i * 3 + 2] = quantized[i * 3 + 2] & keep;
+    }
+}
+
+void motion_mask(const uint8_t *current, const uint8_t *previous, uint8_t *output, int width, int threshold) {
+    for (int i = 0; i < width; i++) {
+        int difference = current[i] - previous[i];
+        output[i] = difference > threshold || difference < -threshold ? 255 : 0;
+    }
+}
+
+void ema_update(const uint8_t *input, uint16_t *model, uint8_t *output, int width, int shift) {
+    for (int i = 0; i < width; i++) {
+        int value = model[i];
+        value += ((input[i] << 8) - value) >> shift;
+        model[i] = static_cast<uint16_t>(value);
+        output[i] = static_cast<uint8_t>((value + 128) >> 8);
+    }
+}
+
+void temporal_mean(const uint8_t *current, const uint8_t *const *previous, int count, uint8_t *output, int width,
+                   int threshold) {
+    // the rounded division by count + 1 as a multiplication, exact for sums of up to MAX_TEMPORAL_FRAMES values (see
+    // quantize)
+    int frames = count + 1;
+    auto reciprocal = static_cast<uint32_t>((65536 + frames - 1) / frames);
+    auto half = static_cast<uint32_t>(frames / 2);
+
+    uint32_t sums[BLOCK];
+    for (int start = 0; start < width; start += BLOCK) {
+        int block = width - start < BLOCK ? width - start : BLOCK;
+
+        const uint8_t *now = current + start;
+        for (int i = 0; i < block; i++) {
+            sums[i] = now[i] + half;
+        }
+        for (int frame = 0; frame < count; frame++) {
+            const uint8_t *before = previous[frame] + start;
+            for (int i = 0; i < block; i++) {
+                int difference = now[i] - before[i];
+                sums[i] += difference > threshold || difference < -threshold ? now[i] : before[i];
+            }
+        }
+
+        uint8_t *out = output + start;
+        for (int i = 0; i < block; i++) {
+            out[i] = static_cast<uint8_t>((sums[i] * reciprocal) >> 16);
+        }
+    }
+}
+
+} // namespace
+
+extern const KernelTable KERNEL_TABLE_NAME = {
+        KERNEL_ISA_NAME,
+        partial_kernel_row,
+        partial_kernel_col,
+        magnitude_gray,
+        magnitude_bgr,
+        magnitude_l1,
+        quantize,
+        negative,
+        bgr_to_gray,
+        cartoonize,
+        motion_mask,
+        ema_update,
+        temporal_mean,
+};
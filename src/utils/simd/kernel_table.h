@@ -0,0 +1,117 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_KERNEL_TABLE_H
+#define VISION_CPP_KERNEL_TABLE_H
+
+#include <cstdint>
+
+/**
+ * The largest number of taps a partial kernel may have: the rows under the taps are gathered on the stack.
+ */
+const int MAX_KERNEL_TAPS = 63;
+
+/**
+ * The most frames temporal_mean averages, the current one included.
+ */
+const int MAX_TEMPORAL_FRAMES = 8;
+
+/**
+ * The hot loops of filters.h and kernels.h, for one instruction set. Every function processes a single row of 8-bit
+ * pixels (rows are distributed over threads by the callers), and all the variants give exactly the same results.
+ * See kernel_impl.h for the definitions and dispatch.h for how a table is chosen.
+ */
+struct KernelTable {
+    /**
+     * The name of the instruction set the table was compiled for.
+     */
+    const char *name;
+
+    /**
+     * A vertical 1D convolution: output[i] = saturate(round(sum(rows[t][i] * kernel[t]) * inverse_sum)).
+     * Pixels are handled as independent values, so any number of interleaved channels works.
+     * @param rows The input rows under each tap, borders already resolved by the caller.
+     * @param taps The number of taps of the kernel.
+     * @param kernel The weights of the taps.
+     * @param inverse_sum The reciprocal of the sum of the weights (1 if they sum to 0).
+     * @param output The output row.
+     * @param width The number of values in a row (columns times channels).
+     */
+    void (*partial_kernel_row)(const uint8_t *const *rows, int taps, const int *kernel, double inverse_sum,
+                               uint8_t *output, int width);
+
+    /**
+     * A horizontal 1D convolution of one row, with the borders reflected like get_valid_index.
+     * @param input The input row.
+     * @param output The output row.
+     * @param cols The number of pixels in the row.
+     * @param channels The number of interleaved channels.
+     * @param kernel The weights of the 2 * kernel_offset + 1 taps.
+     * @param kernel_offset The number of taps on each side of the centre.
+     * @param inverse_sum The reciprocal of the sum of the weights (1 if they sum to 0).
+     */
+    void (*partial_kernel_col)(const uint8_t *input, uint8_t *output, int cols, int channels, const int *kernel,
+                               int kernel_offset, double inverse_sum);
+
+    /**
+     * The gradient magnitude of single-channel gradients: saturate(round(sqrt(x * x + y * y))).
+     */
+    void (*magnitude_gray)(const uint8_t *gradient_x, const uint8_t *gradient_y, uint8_t *output, int cols);
+
+    /**
+     * The gradient magnitude of the first channel of two gradients, truncated and wrapped to 8 bits, written to the
+     * three channels of the output.
+     */
+    void (*magnitude_bgr)(const uint8_t *gradient_x, int channels_x, const uint8_t *gradient_y, int channels_y,
+                          uint8_t *output, int cols);
+
+    /**
+     * The L1 gradient magnitude of the first channel of two gradients, saturate(x + y), written to every channel of the
+     * output. A cheaper approximation of the magnitude, with no square root.
+     */
+    void (*magnitude_l1)(const uint8_t *gradient_x, int channels_x, const uint8_t *gradient_y, int channels_y,
+                         uint8_t *output, int output_channels, int cols);
+
+    /**
+     * Every value floored to a multiple of bins_count (from 1 to 255).
+     */
+    void (*quantize)(const uint8_t *input, uint8_t *output, int width, int bins_count);
+
+    /**
+     * Every value subtracted from 255.
+     */
+    void (*negative)(const uint8_t *input, uint8_t *output, int width);
+
+    /**
+     * BGR to luma with the BT.601 weights in 14-bit fixed point, rounded, like OpenCV's 8-bit BGR2GRAY.
+     */
+    void (*bgr_to_gray)(const uint8_t *input, uint8_t *output, int cols);
+
+    /**
+     * The 3-channel quantized pixel, or black where the first channel of the magnitude is above the threshold.
+     */
+    void (*cartoonize)(const uint8_t *quantized, const uint8_t *magnitude, int magnitude_channels, uint8_t *output,
+                       int cols, int threshold);
+
+    /**
+     * A motion mask: 255 where the current and the previous value differ by more than the threshold, 0 elsewhere.
+     */
+    void (*motion_mask)(const uint8_t *current, const uint8_t *previous, uint8_t *output, int width, int threshold);
+
+    /**
+     * One step of an exponential moving average, in 8.8 fixed point: model += ((input << 8) - model) >> shift (an
+     * arithmetic shift, so the weight of the new value is 1 / 2^shift), and the output is the model rounded to 8 bits.
+     */
+    void (*ema_update)(const uint8_t *input, uint16_t *model, uint8_t *output, int width, int shift);
+
+    /**
+     * The rounded mean of the current value and the values of count previous frames, where every previous value
+     * that differs from the current one by more than the threshold counts as the current one instead (so that
+     * moving objects do not leave trails). count is at most MAX_TEMPORAL_FRAMES - 1.
+     */
+    void (*temporal_mean)(const uint8_t *current, const uint8_t *const *previous, int count, uint8_t *output, int width,
+                          int threshold);
+};
+
+#endif //VISION_CPP_KERNEL_TABLE_H
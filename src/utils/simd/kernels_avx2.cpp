@@ -0,0 +1,9 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+// The kernel table for AVX2 and FMA (-mavx2 -mfma), see kernel_impl.h. x86-64 builds only.
+
+#define KERNEL_TABLE_NAME KERNELS_AVX2
+#define KERNEL_ISA_NAME "avx2"
+#include "kernel_impl.h"
@@ -0,0 +1,9 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+// The kernel table for AVX-512 F, BW, DQ and VL, with 512-bit vectors preferred, see kernel_impl.h. x86-64 builds only.
+
+#define KERNEL_TABLE_NAME KERNELS_AVX512
+#define KERNEL_ISA_NAME "avx512"
+#include "kernel_impl.h"
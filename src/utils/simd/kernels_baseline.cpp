@@ -0,0 +1,9 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+// The kernel table for the baseline of the build (SSE2 on x86-64), see kernel_impl.h. Always compiled.
+
+#define KERNEL_TABLE_NAME KERNELS_BASELINE
+#define KERNEL_ISA_NAME "baseline"
+#include "kernel_impl.h"
@@ -0,0 +1,9 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+// The kernel table for SSE4.2 (-msse4.2 -mpopcnt), see kernel_impl.h. x86-64 builds only.
+
+#define KERNEL_TABLE_NAME KERNELS_SSE4
+#define KERNEL_ISA_NAME "sse4"
+#include "kernel_impl.h"
@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "file_sink.h"
+
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+/**
+ * Picks the codec of a video file from the extension of its path.
+ */
+static int fourcc_for(const std::string &path) {
+    if (path.ends_with(".avi")) {
+        return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    }
+    return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+}
+
+int FileSink::parse_pattern(const std::string &path, SequencePattern &pattern) {
+    pattern = SequencePattern();
+    bool found = false;
+    std::string *part = &pattern.prefix;
+    for (size_t i = 0; i < path.size(); i++) {
+        if (path[i] != '%') {
+            *part += path[i];
+            continue;
+        }
+        if (i + 1 < path.size() && path[i + 1] == '%') {
+            *part += '%';
+            i++;
+            continue;
+        }
+        size_t end = i + 1;
+        bool zero_padded = end < path.size() && path[end] == '0';
+        if (zero_padded) {
+            end++;
+        }
+        size_t digits = end;
+        while (end < path.size() && std::isdigit(static_cast<unsigned char>(path[end])) && end - digits < 3) {
+            end++;
+        }
+        if (found || end >= path.size() || path[end] != 'd') {
+            std::cout << "Image sequence pattern must hold exactly one %d (e.g. frames/%06d.png): " << path << std::endl;
+            return -1;
+        }
+        found = true;
+        pattern.zero_padded = zero_padded;
+        pattern.width = end > digits ? std::stoi(path.substr(digits, end - digits)) : 0;
+        part = &pattern.suffix;
+        i = end;
+    }
+    if (!found) {
+        std::cout << "Image sequence pattern must hold exactly one %d (e.g. frames/%06d.png): " << path << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+FileSink::FileSink(const std::string &path, double fps, size_t queue_capacity) : Sink(path), queue(queue_capacity) {
+    this->path = path;
+    this->fps = fps;
+    this->is_sequence = path.find('%') != std::string::npos;
+    if (is_sequence) {
+        parse_pattern(path, sequence);
+    }
+    this->encoderThread = std::thread(&FileSink::encode_loop, this);
+}
+
+FileSink::~FileSink() {
+    stop();
+}
+
+void FileSink::stop() {
+    if (stopped) {
+        return;
+    }
+    stopped = true;
+
+    detach();
+    queue.close();
+    encoderThread.join();
+    writer.release();
+}
+
+void FileSink::push(const cv::Mat &frame) {
+    // cv::Mat is reference counted, so queuing a frame does not copy its pixels
+    long long occupancy = static_cast<long long>(queue.size());
+    occupancy_total += occupancy;
+    occupancy_samples++;
+    if (occupancy > occupancy_max) {
+        occupancy_max = occupancy;
+    }
+
+    if (!queue.try_push(frame)) {
+        frames_dropped++;
+    }
+}
+
+void FileSink::encode_loop() {
+    cv::Mat frame;
+    while (queue.pop(frame)) {
+        auto start = std::chrono::steady_clock::now();
+        int result = encode(frame);
+        auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+        if (result != 0) {
+            frames_failed++;
+            continue;
+        }
+        frames_written++;
+        encode_time_total += time;
+        if (time > encode_time_max) {
+            encode_time_max = time;
+        }
+    }
+}
+
+int FileSink::encode(const cv::Mat &frame) {
+    if (frame.empty()) {
+        return -1;
+    }
+
+    if (is_sequence) {
+        std::ostringstream file_name;
+        file_name << sequence.prefix << std::setfill(sequence.zero_padded ? '0' : ' ') << std::setw(sequence.width)
+                  << frames_written.load() << sequence.suffix;
+        return cv::imwrite(file_name.str(), frame) ? 0 : -1;
+    }
+
+    if (!writer.isOpened()) {
+        writer_size = cv::Size(frame.cols, frame.rows);
+        if (!writer.open(path, fourcc_for(path), fps, writer_size, frame.channels() != 1)) {
+            std::cout << "Failed to open " << path << " for writing." << std::endl;
+            return -1;
+        }
+    }
+    if (cv::Size(frame.cols, frame.rows) != writer_size) {
+        return -1;
+    }
+    writer.write(frame);
+    return 0;
+}
+
+SinkStats FileSink::get_stats() const {
+    SinkStats stats;
+    stats.frames_out = frames_written;
+    stats.frames_dropped = frames_dropped + frames_failed;
+    stats.busy_time = encode_time_total;
+    return stats;
+}
+
+void FileSink::report(std::ostream &out) {
+    long long written = frames_written;
+    long long samples = occupancy_samples;
+    out << std::fixed << std::setprecision(2) << name << ": " << written << " written, " << frames_dropped
+        << " dropped, " << frames_failed << " failed, "
+        << (written > 0 ? encode_time_total / 1000.0 / written : 0) << " ms/frame encode (max "
+        << encode_time_max / 1000.0 << " ms), queue " << (samples > 0 ? 1.0 * occupancy_total / samples : 0)
+        << " avg / " << occupancy_max << " max of " << queue.get_capacity() << std::endl;
+}
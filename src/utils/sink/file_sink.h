@@ -0,0 +1,105 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_FILE_SINK_H
+#define VISION_CPP_FILE_SINK_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include "sink.h"
+#include "../bounded_queue.h"
+
+/**
+ * A sink that saves the frames of a channel into a video file (cv::VideoWriter) or an image sequence (cv::imwrite).
+ * Frames are queued by the channel's writer and encoded on the sink's own thread. When the encoder falls behind and
+ * the queue is full, new frames are dropped rather than stalling the filter that produced them.
+ * A path containing a printf-style pattern (e.g. "frames/%06d.png") is written as an image sequence.
+ */
+class FileSink : public Sink {
+public:
+    /**
+     * A constructor that creates the sink and starts its encoder thread. The file is created with the first frame.
+     * @param path The path of the video file, or the pattern of the image sequence.
+     * @param fps The frame rate stored in the video file.
+     * @param queue_capacity The number of frames that can wait for the encoder.
+     */
+    explicit FileSink(const std::string &path, double fps, size_t queue_capacity);
+
+    /**
+     * A structure that holds an image sequence pattern, split around its frame number.
+     */
+    struct SequencePattern {
+        std::string prefix; // the path before the frame number, "%%" already replaced with "%"
+        std::string suffix; // the path after the frame number, "%%" already replaced with "%"
+        int width = 0; // minimum number of digits of the frame number
+        bool zero_padded = false; // whether the frame number is padded with zeros rather than spaces
+    };
+
+    /**
+     * A function that parses an image sequence pattern. The frame number is substituted by the sink itself, the
+     * path is never used as a printf format: the only conversion allowed is a single %d, with an optional 0 flag and
+     * width (e.g. "%06d"), and "%%" stands for "%".
+     * @param path The pattern, e.g. "frames/%06d.png".
+     * @param pattern The parsed pattern.
+     * @return 0 if the pattern has exactly one frame number conversion, -1 otherwise.
+     */
+    static int parse_pattern(const std::string &path, SequencePattern &pattern);
+
+    /**
+     * A destructor that stops the sink, finishing the frames already queued.
+     */
+    ~FileSink() override;
+
+    /**
+     * A method that detaches the sink, encodes the frames already queued and closes the file.
+     */
+    void stop() override;
+
+    /**
+     * A method that prints the frames written and dropped, the encode time and the queue occupancy.
+     * @param out The stream to print to.
+     */
+    void report(std::ostream &out) override;
+
+    /**
+     * A method that returns a copy of the counters of the sink.
+     * @return The counters of the sink.
+     */
+    SinkStats get_stats() const override;
+
+protected:
+    /**
+     * A method that queues a frame for the encoder, or drops it if the queue is full.
+     * @param frame The frame written to the channel.
+     */
+    void push(const cv::Mat &frame) override;
+
+private:
+    void encode_loop();
+
+    int encode(const cv::Mat &frame);
+
+    std::string path; // path of the video file, or pattern of the image sequence
+    double fps; // frame rate of the video file
+    bool is_sequence; // whether frames are written as separate images
+    SequencePattern sequence; // the parsed pattern of the image sequence
+    BoundedQueue<cv::Mat> queue; // frames waiting for the encoder
+    cv::VideoWriter writer; // the video writer, opened with the first frame
+    cv::Size writer_size; // the frame size the video writer was opened with
+    std::thread encoderThread; // the thread that encodes the queued frames
+    bool stopped = false; // whether stop() already ran
+
+    std::atomic<long long> frames_written{0}; // frames encoded successfully
+    std::atomic<long long> frames_dropped{0}; // frames dropped because the queue was full
+    std::atomic<long long> frames_failed{0}; // frames the encoder could not write
+    std::atomic<long long> encode_time_total{0}; // time spent encoding, in microseconds
+    std::atomic<long long> encode_time_max{0}; // longest time spent on one frame, in microseconds
+    std::atomic<long long> occupancy_total{0}; // sum of the queue sizes seen by push()
+    std::atomic<long long> occupancy_samples{0}; // number of queue sizes summed in occupancy_total
+    std::atomic<long long> occupancy_max{0}; // largest queue size seen by push()
+};
+
+#endif //VISION_CPP_FILE_SINK_H
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "shm_sink.h"
+
+#include <chrono>
+#include <iomanip>
+
+ShmSink::ShmSink(const std::string &shm_name, uint32_t slot_count, size_t queue_capacity)
+        : Sink("shm:" + shm_name), queue(queue_capacity) {
+    this->shm_name = shm_name;
+    this->slot_count = slot_count;
+    this->publisherThread = std::thread(&ShmSink::publish_loop, this);
+}
+
+ShmSink::~ShmSink() {
+    stop();
+}
+
+void ShmSink::stop() {
+    if (stopped) {
+        return;
+    }
+    stopped = true;
+
+    detach();
+    queue.close();
+    publisherThread.join();
+}
+
+void ShmSink::push(const cv::Mat &frame) {
+    if (!queue.try_push(frame)) {
+        frames_dropped++;
+    }
+}
+
+void ShmSink::publish_loop() {
+    cv::Mat frame;
+    while (queue.pop(frame)) {
+        if (frame.empty() || frame.dims != 2) {
+            continue;
+        }
+        size_t row_size = frame.cols * frame.elemSize();
+
+        if (publisher == nullptr) {
+            publisher = std::make_unique<ShmPublisher>(shm_name, slot_count, shm_align(row_size) * frame.rows);
+        }
+        if (!publisher->is_open()) {
+            frames_dropped++;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+        uint64_t sequence = publisher->publish(frame.ptr(), frame.step[0], frame.rows, frame.cols, frame.type(),
+                                               row_size, timestamp);
+        if (sequence == 0) {
+            frames_dropped++;
+            continue;
+        }
+        frames_published++;
+        publish_time_total += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+SinkStats ShmSink::get_stats() const {
+    SinkStats stats;
+    stats.frames_out = frames_published;
+    stats.frames_dropped = frames_dropped;
+    stats.busy_time = publish_time_total;
+    return stats;
+}
+
+void ShmSink::report(std::ostream &out) {
+    long long published = frames_published;
+    out << std::fixed << std::setprecision(2) << name << ": " << published << " published, " << frames_dropped
+        << " dropped, " << (published > 0 ? publish_time_total / 1000.0 / published : 0) << " ms/frame copy"
+        << std::endl;
+}
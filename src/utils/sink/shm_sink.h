@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_SHM_SINK_H
+#define VISION_CPP_SHM_SINK_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <opencv2/core/mat.hpp>
+#include "sink.h"
+#include "../bounded_queue.h"
+#include "../shm/shm_publisher.h"
+
+/**
+ * A sink that publishes the frames of a channel into a POSIX shared-memory ring, for other processes to read
+ * with ShmReader. The ring is created with the first frame, with slots sized for it; later frames that are larger
+ * are dropped. Frames are copied into the ring on the sink's own thread, behind a bounded queue.
+ */
+class ShmSink : public Sink {
+public:
+    /**
+     * A constructor that creates the sink and starts its publisher thread.
+     * @param shm_name The POSIX shared-memory name of the ring, e.g. "/filterscpp-cartoonize".
+     * @param slot_count The number of frames the ring holds.
+     * @param queue_capacity The number of frames that can wait for the publisher thread.
+     */
+    explicit ShmSink(const std::string &shm_name, uint32_t slot_count, size_t queue_capacity);
+
+    /**
+     * A destructor that stops the sink and removes the ring.
+     */
+    ~ShmSink() override;
+
+    /**
+     * A method that detaches the sink and publishes the frames already queued.
+     */
+    void stop() override;
+
+    /**
+     * A method that prints the frames published and dropped and the time spent copying them.
+     * @param out The stream to print to.
+     */
+    void report(std::ostream &out) override;
+
+    /**
+     * A method that returns a copy of the counters of the sink.
+     * @return The counters of the sink.
+     */
+    SinkStats get_stats() const override;
+
+protected:
+    /**
+     * A method that queues a frame for the publisher thread, or drops it if the queue is full.
+     * @param frame The frame written to the channel.
+     */
+    void push(const cv::Mat &frame) override;
+
+private:
+    void publish_loop();
+
+    std::string shm_name; // shared-memory name of the ring
+    uint32_t slot_count; // number of slots of the ring
+    BoundedQueue<cv::Mat> queue; // frames waiting for the publisher thread
+    std::unique_ptr<ShmPublisher> publisher; // the ring, created with the first frame
+    std::thread publisherThread; // the thread that copies frames into the ring
+    bool stopped = false; // whether stop() already ran
+
+    std::atomic<long long> frames_published{0}; // frames copied into the ring
+    std::atomic<long long> frames_dropped{0}; // frames dropped because the queue was full or they did not fit
+    std::atomic<long long> publish_time_total{0}; // time spent copying frames, in microseconds
+};
+
+#endif //VISION_CPP_SHM_SINK_H
@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "sink.h"
+
+#include <utility>
+
+Sink::Sink(std::string name) {
+    this->name = std::move(name);
+}
+
+Sink::~Sink() {
+    detach();
+}
+
+int Sink::attach(WatchChannel<cv::Mat> &watchChannel) {
+    if (this->channel != nullptr) {
+        return -1;
+    }
+    this->channel = &watchChannel;
+    this->subscription = watchChannel.subscribe([this](const cv::Mat &frame) { push(frame); });
+    watchChannel.add_consumer();
+    return 0;
+}
+
+void Sink::detach() {
+    if (this->channel == nullptr) {
+        return;
+    }
+    this->channel->unsubscribe(this->subscription);
+    this->channel->remove_consumer();
+    this->channel = nullptr;
+    this->subscription = -1;
+}
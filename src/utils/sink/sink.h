@@ -0,0 +1,88 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_SINK_H
+#define VISION_CPP_SINK_H
+
+#include <ostream>
+#include <string>
+#include <opencv2/core/mat.hpp>
+#include "../watch_channel.h"
+
+/**
+ * A structure that holds a copy of the counters of a sink.
+ */
+struct SinkStats {
+    long long frames_out = 0; // frames consumed (written, published, encoded)
+    long long frames_dropped = 0; // frames dropped or lost instead of being consumed
+    long long busy_time = 0; // time spent consuming frames, in microseconds
+};
+
+/**
+ * A base class for the consumers of a channel's output other than the display (files, other processes, ...).
+ * A sink subscribes to a channel and is handed every frame written to it, on the writer's thread.
+ * Implementations must only queue the frame there and do the actual work on their own thread,
+ * so that a slow sink never stalls the filter producing the frames.
+ */
+class Sink {
+public:
+    /**
+     * A constructor that creates a sink that is not attached to any channel yet.
+     * @param name A string that describes the sink in reports.
+     */
+    explicit Sink(std::string name);
+
+    /**
+     * A destructor that detaches the sink. Derived classes must call detach() themselves before they are destroyed.
+     */
+    virtual ~Sink();
+
+    /**
+     * A method that starts handing the frames written to the given channel to the sink. The sink is a consumer of the
+     * channel, so that a filter evaluated on demand keeps producing frames for it.
+     * @param channel The channel to consume.
+     * @return 0 if the sink was attached, -1 if it is already attached to a channel.
+     */
+    int attach(WatchChannel<cv::Mat> &channel);
+
+    /**
+     * A method that stops handing frames to the sink. Once this returns, push() is no longer running or called.
+     */
+    void detach();
+
+    /**
+     * A method that detaches the sink and finishes the work on the frames it already accepted.
+     */
+    virtual void stop() = 0;
+
+    /**
+     * A method that prints the statistics of the sink (frames consumed, dropped, time spent, ...).
+     * @param out The stream to print to.
+     */
+    virtual void report(std::ostream &out) = 0;
+
+    /**
+     * A method that returns a copy of the counters of the sink. It does not take any lock.
+     * @return The counters of the sink.
+     */
+    virtual SinkStats get_stats() const = 0;
+
+    /**
+     * A string that describes the sink in reports.
+     */
+    std::string name;
+
+protected:
+    /**
+     * A method called with every frame written to the attached channel, on the writer's thread. It must not block.
+     * @param frame The frame written to the channel.
+     */
+    virtual void push(const cv::Mat &frame) = 0;
+
+private:
+    WatchChannel<cv::Mat> *channel = nullptr; // the channel the sink is attached to
+    int subscription = -1; // the identifier of the subscription to the channel
+};
+
+#endif //VISION_CPP_SINK_H
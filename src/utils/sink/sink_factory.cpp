@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "sink_factory.h"
+
+#include "file_sink.h"
+#include "shm_sink.h"
+
+const std::string SHM_PREFIX = "shm:";
+
+std::unique_ptr<Sink> open_sink(const std::string &target, const Options &options) {
+    if (target.starts_with(SHM_PREFIX)) {
+        std::string shm_name = target.substr(SHM_PREFIX.size());
+        if (!shm_name.starts_with("/")) {
+            shm_name = "/" + shm_name;
+        }
+        return std::make_unique<ShmSink>(shm_name, options.shm_slots, options.sink_queue);
+    }
+
+    FileSink::SequencePattern pattern;
+    if (target.find('%') != std::string::npos && FileSink::parse_pattern(target, pattern) != 0) {
+        return nullptr;
+    }
+    double fps = options.target_fps > 0 ? options.target_fps : 30;
+    return std::make_unique<FileSink>(target, fps, options.sink_queue);
+}
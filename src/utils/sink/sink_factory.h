@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_SINK_FACTORY_H
+#define VISION_CPP_SINK_FACTORY_H
+
+#include <memory>
+#include <string>
+#include "sink.h"
+#include "../options/options.h"
+
+/**
+ * A function that creates the sink described by the target of a --sink option.
+ * Targets are video file names, image sequence patterns such as "out/%06d.png",
+ * or "shm:<name>" for a shared-memory ring that other processes read with ShmReader.
+ * @param target The target of the sink.
+ * @param options The command line options, for the settings of the sink (e.g. queue size).
+ * @return A pointer to the created sink, not attached to any channel yet; nullptr if the target is invalid.
+ */
+std::unique_ptr<Sink> open_sink(const std::string &target, const Options &options);
+
+#endif //VISION_CPP_SINK_FACTORY_H
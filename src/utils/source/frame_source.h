@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_FRAME_SOURCE_H
+#define VISION_CPP_FRAME_SOURCE_H
+
+#include <opencv2/core/mat.hpp>
+
+/**
+ * The pixel layouts a source can deliver its frames in.
+ * Sources deliver BGR unless they are asked for their native layout (see FrameSource::set_native).
+ */
+enum class PixelFormat {
+    BGR = 0, // CV_8UC3, blue-green-red
+    GRAY = 1, // CV_8UC1, luminance only
+    YUYV = 2, // CV_8UC2 (rows x cols), interleaved Y and alternating U/V, as most webcams deliver
+    NV12 = 3, // CV_8UC1 (rows * 3 / 2 x cols), a Y plane followed by an interleaved U/V plane at quarter resolution
+    I420 = 4 // CV_8UC1 (rows * 3 / 2 x cols), a Y plane followed by U and V planes at quarter resolution
+};
+
+/**
+ * An interface for anything that can produce frames for the pipeline (a camera, a video file, ...).
+ * The fetch loop only depends on this interface, so sources can be swapped without touching the filters.
+ */
+class FrameSource {
+public:
+    /**
+     * A virtual destructor so that sources can be destroyed through a base pointer.
+     */
+    virtual ~FrameSource() = default;
+
+    /**
+     * A method that reads the next frame from the source.
+     * @param frame a reference to a cv::Mat object where the frame will be stored
+     * @return 0 if a frame was read, -1 otherwise
+     */
+    virtual int read(cv::Mat &frame) = 0;
+
+    /**
+     * A method that asks the source to deliver frames at the given rate, if it supports it.
+     * @param fps an integer that specifies the desired frame rate
+     */
+    virtual void set_fps(int fps) = 0;
+
+    /**
+     * A method that tells whether the source has no more frames to deliver (e.g. the end of a video file).
+     * Live sources never end.
+     * @return true if no more frames will be read, false otherwise
+     */
+    virtual bool end_of_stream() { return false; }
+
+    /**
+     * A method that asks the source to deliver frames in its native layout (e.g. YUYV from a webcam)
+     * instead of converting them to BGR. Sources that cannot do it keep delivering BGR.
+     * @param native true for the native layout, false for BGR
+     */
+    virtual void set_native([[maybe_unused]] bool native) {}
+
+    /**
+     * A method that returns the layout of the frames delivered by read().
+     * @return The pixel layout of the last frame read.
+     */
+    virtual PixelFormat get_format() { return PixelFormat::BGR; }
+};
+
+#endif //VISION_CPP_FRAME_SOURCE_H
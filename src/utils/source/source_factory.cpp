@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "source_factory.h"
+
+#include <algorithm>
+#include "../camera/camera.h"
+#include "../recording/replay_source.h"
+#include "synthetic_source.h"
+
+const std::string REPLAY_PREFIX = "replay:";
+const std::string SYNTHETIC_PREFIX = "synthetic:";
+
+std::unique_ptr<FrameSource> open_source(const std::string &spec, const Options &options) {
+    if (spec.starts_with(REPLAY_PREFIX)) {
+        return std::make_unique<ReplaySource>(spec.substr(REPLAY_PREFIX.size()), options.realtime, options.loop);
+    }
+    if (spec.starts_with(SYNTHETIC_PREFIX)) {
+        std::string scene = spec.substr(SYNTHETIC_PREFIX.size());
+        return std::make_unique<SyntheticSource>(scene, cv::Size(options.width, options.height), options.seed);
+    }
+    bool is_index = !spec.empty() && std::all_of(spec.begin(), spec.end(), ::isdigit);
+    if (is_index) {
+        return std::make_unique<Camera>(std::stoi(spec));
+    }
+    return std::make_unique<Camera>(spec);
+}
@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_SOURCE_FACTORY_H
+#define VISION_CPP_SOURCE_FACTORY_H
+
+#include <memory>
+#include <string>
+#include "frame_source.h"
+#include "../options/options.h"
+
+/**
+ * A function that opens the frame source described by a command line specification.
+ * A number opens the camera device with that index, "replay:<path>" replays a raw recording,
+ * "synthetic:<scene>" generates frames, anything else is opened as a video file or stream URL.
+ * @param spec The source specification.
+ * @param options The command line options, for the settings of the source (e.g. replay pacing).
+ * @return A pointer to the opened source.
+ */
+std::unique_ptr<FrameSource> open_source(const std::string &spec, const Options &options);
+
+#endif //VISION_CPP_SOURCE_FACTORY_H
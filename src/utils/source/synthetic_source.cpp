@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "synthetic_source.h"
+
+#include <iostream>
+#include <thread>
+
+const cv::Size MAX_SYNTHETIC_SIZE(7680, 4320);
+const int SHAPE_COUNT = 24;
+const int NOISE_OFFSET_COUNT = 257; // prime, so that the noise does not visibly repeat with the shapes
+
+/**
+ * Fills an image with a diagonal gradient, different in every channel.
+ */
+static void fill_gradient(cv::Mat &image) {
+    for (int row = 0; row < image.rows; row++) {
+        auto *pixels = image.ptr<cv::Vec3b>(row);
+        for (int col = 0; col < image.cols; col++) {
+            pixels[col] = cv::Vec3b(static_cast<uchar>((col * 255) / std::max(1, image.cols / 2 - 1)),
+                                    static_cast<uchar>((row * 255) / std::max(1, image.rows - 1)),
+                                    static_cast<uchar>(((col + row) * 255) / std::max(1, image.cols / 2 + image.rows)));
+        }
+    }
+}
+
+SyntheticSource::SyntheticSource(const std::string &scene, cv::Size size, uint64_t seed) {
+    this->scene = scene;
+    this->size = cv::Size(std::clamp(size.width, 16, MAX_SYNTHETIC_SIZE.width),
+                          std::clamp(size.height, 16, MAX_SYNTHETIC_SIZE.height));
+    if (scene != "static" && scene != "gradient" && scene != "shapes" && scene != "noise" && scene != "busy") {
+        std::cout << "Unknown synthetic scene " << scene << ", using shapes." << std::endl;
+        this->scene = "shapes";
+    }
+
+    cv::RNG rng(seed);
+    const cv::Size &frame_size = this->size;
+
+    // twice as wide as a frame, so that any horizontal offset below the frame width is a valid window
+    texture.create(frame_size.height, frame_size.width * 2, CV_8UC3);
+    if (this->scene == "noise" || this->scene == "busy") {
+        rng.fill(texture, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+        for (int i = 0; i < NOISE_OFFSET_COUNT; i++) {
+            offsets.emplace_back(rng.uniform(0, frame_size.width), 0);
+        }
+    } else {
+        fill_gradient(texture);
+    }
+
+    int min_side = std::min(frame_size.width, frame_size.height);
+    for (int i = 0; i < SHAPE_COUNT; i++) {
+        Shape shape;
+        shape.origin = cv::Point(rng.uniform(0, frame_size.width), rng.uniform(0, frame_size.height));
+        shape.velocity = cv::Point(rng.uniform(-min_side / 80 - 1, min_side / 80 + 2),
+                                   rng.uniform(-min_side / 80 - 1, min_side / 80 + 2));
+        shape.radius = rng.uniform(min_side / 40 + 1, min_side / 10 + 2);
+        shape.color = cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        shape.is_circle = rng.uniform(0, 2) == 0;
+        shapes.push_back(shape);
+    }
+
+    if (this->scene == "static") {
+        static_frame = texture(cv::Rect(0, 0, frame_size.width, frame_size.height)).clone();
+        draw_shapes(static_frame);
+    }
+}
+
+SyntheticSource::~SyntheticSource() = default;
+
+/**
+ * Wraps a coordinate into [0, limit) and mirrors every other lap, so that shapes bounce off the frame borders.
+ */
+static int bounce(long long position, int limit) {
+    long long lap = 2LL * limit;
+    long long wrapped = ((position % lap) + lap) % lap;
+    return static_cast<int>(wrapped < limit ? wrapped : lap - wrapped - 1);
+}
+
+void SyntheticSource::draw_shapes(cv::Mat &frame) const {
+    // the static scene is drawn once, at frame 0
+    long long index = scene == "static" ? 0 : frame_index;
+    for (const Shape &shape: shapes) {
+        cv::Point center(bounce(shape.origin.x + shape.velocity.x * index, frame.cols),
+                         bounce(shape.origin.y + shape.velocity.y * index, frame.rows));
+        if (shape.is_circle) {
+            cv::circle(frame, center, shape.radius, shape.color, cv::FILLED);
+        } else {
+            cv::rectangle(frame, cv::Point(center.x - shape.radius, center.y - shape.radius),
+                          cv::Point(center.x + shape.radius, center.y + shape.radius), shape.color, cv::FILLED);
+        }
+    }
+}
+
+int SyntheticSource::read(cv::Mat &frame) {
+    if (period.count() > 0) {
+        std::this_thread::sleep_until(next_frame);
+        next_frame = std::max(next_frame + period, std::chrono::steady_clock::now());
+    }
+
+    if (scene == "static") {
+        // consumers only read their input, so every frame can share the same buffer
+        frame = native ? static_yuv_frame : static_frame;
+    } else {
+        cv::Point offset(static_cast<int>(frame_index % size.width), 0);
+        if (!offsets.empty()) {
+            offset = offsets[frame_index % offsets.size()];
+        }
+        frame = texture(cv::Rect(offset.x, offset.y, size.width, size.height)).clone();
+        if (scene != "gradient" && scene != "noise") {
+            draw_shapes(frame);
+        }
+        if (native) {
+            // stands in for the sensor: the conversion is part of generating the frame, not of the pipeline
+            cv::cvtColor(frame, frame, cv::COLOR_BGR2YUV_I420);
+        }
+    }
+
+    frame_index++;
+    return 0;
+}
+
+void SyntheticSource::set_fps(int fps) {
+    period = std::chrono::microseconds(fps > 0 ? 1000000 / fps : 0);
+    next_frame = std::chrono::steady_clock::now();
+}
+
+void SyntheticSource::set_native(bool native) {
+    // I420 needs even dimensions
+    if (native && (size.width % 2 != 0 || size.height % 2 != 0)) {
+        std::cout << "Synthetic YUV frames need an even resolution, using BGR." << std::endl;
+        native = false;
+    }
+    this->native = native;
+    if (native && scene == "static" && static_yuv_frame.empty()) {
+        cv::cvtColor(static_frame, static_yuv_frame, cv::COLOR_BGR2YUV_I420);
+    }
+}
+
+PixelFormat SyntheticSource::get_format() {
+    return native ? PixelFormat::I420 : PixelFormat::BGR;
+}
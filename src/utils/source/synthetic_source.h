@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_SYNTHETIC_SOURCE_H
+#define VISION_CPP_SYNTHETIC_SOURCE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "frame_source.h"
+
+/**
+ * A frame source that generates frames instead of capturing them, for benchmarks and machines without a camera.
+ * The frames only depend on the scene, the resolution, the seed and the frame index, so every run sees exactly the
+ * same input. The scenes range from a frame that never changes to full-frame noise, since the cost of the filters
+ * (and of anything that skips unchanged input) depends a lot on how busy the scene is:
+ * - "static": the same frame every time (gradient and shapes that do not move)
+ * - "gradient": a smooth gradient scrolling across the frame
+ * - "shapes": shapes moving over a gradient
+ * - "noise": uniform noise that changes every frame
+ * - "busy": shapes moving over changing noise
+ * In native mode the frames are delivered in I420, like a camera sensor would deliver YUV.
+ */
+class SyntheticSource : public FrameSource {
+public:
+    /**
+     * A constructor that prepares the scene.
+     * @param scene The name of the scene (see above). Unknown names fall back to "shapes".
+     * @param size The resolution of the frames, up to 8K (7680x4320).
+     * @param seed The seed of the random generator, which decides the noise and the shapes.
+     */
+    explicit SyntheticSource(const std::string &scene, cv::Size size, uint64_t seed);
+
+    /**
+     * A destructor that releases the scene.
+     */
+    ~SyntheticSource() override;
+
+    /**
+     * A method that generates the next frame, waiting for its turn if a frame rate was set.
+     * @param frame a reference to a cv::Mat object where the frame will be stored
+     * @return 0, generating a frame never fails
+     */
+    int read(cv::Mat &frame) override;
+
+    /**
+     * A method that sets the rate at which frames are generated.
+     * @param fps the frame rate, or 0 to generate frames as fast as they are read
+     */
+    void set_fps(int fps) override;
+
+    /**
+     * A method that chooses between I420 (native) and BGR frames.
+     * @param native true for I420, false for BGR
+     */
+    void set_native(bool native) override;
+
+    /**
+     * A method that returns the layout of the generated frames.
+     * @return PixelFormat::I420 in native mode, PixelFormat::BGR otherwise
+     */
+    PixelFormat get_format() override;
+
+private:
+    /**
+     * A structure that describes one moving shape.
+     */
+    struct Shape {
+        cv::Point origin; // position at frame 0
+        cv::Point velocity; // pixels per frame
+        int radius; // half the size of the shape
+        cv::Scalar color; // BGR color
+        bool is_circle; // circle or square
+    };
+
+    void draw_shapes(cv::Mat &frame) const;
+
+    std::string scene; // name of the scene
+    cv::Size size; // resolution of the frames
+    cv::Mat texture; // pre-generated background, larger than a frame so that it can be scrolled
+    cv::Mat static_frame; // the only frame of the static scene
+    cv::Mat static_yuv_frame; // the only frame of the static scene, in I420
+    bool native = false; // deliver I420 frames instead of BGR
+    std::vector<Shape> shapes; // moving shapes of the scene
+    std::vector<cv::Point> offsets; // per-frame offsets into the noise texture, repeating
+    long long frame_index = 0; // index of the next frame
+    std::chrono::microseconds period{0}; // time between two frames, 0 when not paced
+    std::chrono::steady_clock::time_point next_frame; // when the next paced frame is due
+};
+
+#endif //VISION_CPP_SYNTHETIC_SOURCE_H
@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "yuv.h"
+
+#include <opencv2/opencv.hpp>
+
+void luma_view(const cv::Mat &frame, PixelFormat format, cv::Mat &luma) {
+    switch (format) {
+        case PixelFormat::NV12:
+        case PixelFormat::I420:
+            luma = frame.rowRange(0, frame.rows * 2 / 3);
+            break;
+        case PixelFormat::YUYV:
+            cv::extractChannel(frame, luma, 0);
+            break;
+        case PixelFormat::GRAY:
+            luma = frame;
+            break;
+        case PixelFormat::BGR:
+            cv::cvtColor(frame, luma, cv::COLOR_BGR2GRAY);
+            break;
+    }
+}
+
+void to_bgr(const cv::Mat &frame, PixelFormat format, cv::Mat &bgr) {
+    switch (format) {
+        case PixelFormat::NV12:
+            cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_NV12);
+            break;
+        case PixelFormat::I420:
+            cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_I420);
+            break;
+        case PixelFormat::YUYV:
+            cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_YUYV);
+            break;
+        case PixelFormat::GRAY:
+            cv::cvtColor(frame, bgr, cv::COLOR_GRAY2BGR);
+            break;
+        case PixelFormat::BGR:
+            bgr = frame;
+            break;
+    }
+}
@@ -0,0 +1,29 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_YUV_H
+#define VISION_CPP_YUV_H
+
+#include <opencv2/core/mat.hpp>
+#include "frame_source.h"
+
+/**
+ * A function that returns the luminance of a frame, without converting it when the layout allows.
+ * For planar layouts (NV12, I420) the Y plane is returned as a view into the frame, without any copy.
+ * For YUYV the Y samples are extracted in a single pass, and BGR frames are converted to grayscale.
+ * @param frame The frame, in the given layout.
+ * @param format The layout of the frame.
+ * @param luma A reference to a cv::Mat object (CV_8UC1) where the luminance will be stored.
+ */
+void luma_view(const cv::Mat &frame, PixelFormat format, cv::Mat &luma);
+
+/**
+ * A function that converts a frame to BGR, for the stages that need colour.
+ * @param frame The frame, in the given layout.
+ * @param format The layout of the frame.
+ * @param bgr A reference to a cv::Mat object (CV_8UC3) where the converted frame will be stored.
+ */
+void to_bgr(const cv::Mat &frame, PixelFormat format, cv::Mat &bgr);
+
+#endif //VISION_CPP_YUV_H
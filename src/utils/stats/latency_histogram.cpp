@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto &bucket: buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucket_of(uint64_t nanoseconds) {
+    if (nanoseconds < 2 * SUB_BUCKETS) {
+        return static_cast<int>(nanoseconds);
+    }
+    int exponent = std::min(63 - std::countl_zero(nanoseconds), MAX_EXPONENT);
+    int shift = exponent - SUB_BUCKET_BITS;
+    uint64_t sub_bucket = std::min<uint64_t>(nanoseconds >> shift, 2 * SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + static_cast<int>(sub_bucket - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(int bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t sub_bucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (nanoseconds > current && !max.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+LatencySnapshot LatencyHistogram::snapshot() const {
+    LatencySnapshot snapshot;
+    snapshot.counts.resize(BUCKET_COUNT);
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        snapshot.counts[i] = buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+    snapshot.sum = sum.load(std::memory_order_relaxed);
+    snapshot.max = max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void LatencyHistogram::reset() {
+    for (auto &bucket: buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencySnapshot::percentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * count));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::bucket_upper_bound(static_cast<int>(i)), max);
+        }
+    }
+    return max;
+}
+
+double LatencySnapshot::mean() const {
+    return count > 0 ? static_cast<double>(sum) / count : 0;
+}
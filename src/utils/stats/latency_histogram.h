@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_LATENCY_HISTOGRAM_H
+#define VISION_CPP_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A copy of the counts of a LatencyHistogram, taken at one point in time.
+ * The total count is the sum of the copied buckets, so percentiles are always consistent with it.
+ */
+struct LatencySnapshot {
+    std::vector<uint64_t> counts; // number of values in each bucket
+    uint64_t count = 0; // number of values
+    uint64_t sum = 0; // sum of the values, in nanoseconds
+    uint64_t max = 0; // largest value, in nanoseconds
+
+    /**
+     * Returns the value below which the given fraction of the values fall.
+     * @param percentile The fraction, from 0 to 100.
+     * @return The value in nanoseconds (the upper bound of its bucket, at most max), 0 without values.
+     */
+    uint64_t percentile(double percentile) const;
+
+    /**
+     * Returns the mean of the values.
+     * @return The mean in nanoseconds, 0 without values.
+     */
+    double mean() const;
+};
+
+/**
+ * A histogram of durations in the style of HdrHistogram: buckets are linear within each power of two, so every value
+ * is kept with a relative precision of 1/32 (about 3%) from 1 ns to minutes, in a fixed amount of memory.
+ * Recording is lock-free (a few relaxed atomic operations), so the stage threads can record every frame while any
+ * other thread takes snapshots.
+ */
+class LatencyHistogram {
+public:
+    /**
+     * A constructor that creates an empty histogram.
+     */
+    explicit LatencyHistogram();
+
+    /**
+     * A method that records one duration. Safe to call from any thread.
+     * @param nanoseconds The duration, in nanoseconds.
+     */
+    void record(uint64_t nanoseconds);
+
+    /**
+     * A method that copies the counts of the histogram. Safe to call from any thread.
+     * @return The snapshot.
+     */
+    LatencySnapshot snapshot() const;
+
+    /**
+     * A method that empties the histogram. Values recorded concurrently may be kept or lost.
+     */
+    void reset();
+
+    /**
+     * Returns the bucket a value falls in.
+     * @param nanoseconds The value.
+     * @return The index of the bucket.
+     */
+    static int bucket_of(uint64_t nanoseconds);
+
+    /**
+     * Returns the largest value of a bucket.
+     * @param bucket The index of the bucket.
+     * @return The largest value, in nanoseconds.
+     */
+    static uint64_t bucket_upper_bound(int bucket);
+
+    static const int SUB_BUCKET_BITS = 5; // 32 buckets per power of two
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_EXPONENT = 42; // values up to 2^42 ns (more than an hour), larger ones are clamped
+    static const int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets; // number of values in each bucket
+    std::atomic<uint64_t> sum{0}; // sum of the values
+    std::atomic<uint64_t> max{0}; // largest value
+};
+
+#endif //VISION_CPP_LATENCY_HISTOGRAM_H
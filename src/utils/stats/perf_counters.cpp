@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "perf_counters.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<bool> counters_enabled{false};
+static std::atomic<bool> failure_reported{false};
+
+void perf_counters_enable(bool enabled) {
+    counters_enabled = enabled;
+}
+
+bool perf_counters_enabled() {
+    return counters_enabled;
+}
+
+PerfCounters::PerfCounters() = default;
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+void PerfCounters::close() {
+#ifdef __linux__
+    for (Group &group: groups) {
+        for (int i = 0; i < group.opened; i++) {
+            ::close(group.descriptors[i]);
+        }
+    }
+#endif
+    groups.clear();
+    team_width = 0;
+}
+
+#ifdef __linux__
+/**
+ * Opens one hardware event on the calling thread, any CPU, as part of the given group (-1 to lead a new group).
+ */
+static int open_event(uint64_t config, int group) {
+    perf_event_attr attr{};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = group == -1 ? 1 : 0; // the group is enabled and disabled through its leader
+    attr.exclude_kernel = 1; // allowed with perf_event_paranoid up to 2, and the kernel's time isn't the stage's
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+#endif
+
+int PerfCounters::open_group(Group &group) {
+#ifdef __linux__
+    const uint64_t configs[EVENT_COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+    for (int event = 0; event < EVENT_COUNT; event++) {
+        int descriptor = open_event(configs[event], group.opened == 0 ? -1 : group.descriptors[0]);
+        if (descriptor < 0) {
+            if (event == 0) {
+                return -1;
+            }
+            continue;
+        }
+        group.descriptors[group.opened] = descriptor;
+        group.events[group.opened] = event;
+        group.opened++;
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+int PerfCounters::open() {
+    close();
+#ifdef __linux__
+    int width = 1;
+#ifdef _OPENMP
+    width = omp_get_max_threads();
+#endif
+    groups.resize(width);
+    // a descriptor counts the thread that opened it, so every thread of the team opens its own group; the team
+    // threads are kept by the OpenMP runtime, and the parallel loops of the stage run on the same ones afterwards
+    int result = open_group(groups[0]);
+#ifdef _OPENMP
+    if (result == 0 && width > 1) {
+#pragma omp parallel num_threads(width)
+        {
+            int thread = omp_get_thread_num();
+            if (thread > 0) {
+                open_group(groups[thread]);
+            }
+        }
+    }
+#endif
+    if (result != 0) {
+        if (!failure_reported.exchange(true)) {
+            std::cout << "Hardware counters unavailable (" << std::strerror(errno) << "), stages run without them."
+                      << std::endl;
+        }
+        close();
+        return -1;
+    }
+    team_width = width;
+    return 0;
+#else
+    if (!failure_reported.exchange(true)) {
+        std::cout << "Hardware counters are only supported on Linux, stages run without them." << std::endl;
+    }
+    return -1;
+#endif
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+    if (team_width == 0) {
+        return;
+    }
+#ifdef _OPENMP
+    if (omp_get_max_threads() != team_width) {
+        open();
+    }
+#endif
+    for (Group &group: groups) {
+        if (group.opened > 0) {
+            ioctl(group.descriptors[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(group.descriptors[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+#endif
+}
+
+int PerfCounters::stop(PerfSample &sample) {
+#ifdef __linux__
+    if (team_width == 0) {
+        return -1;
+    }
+    for (Group &group: groups) {
+        if (group.opened > 0) {
+            ioctl(group.descriptors[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    uint64_t values[EVENT_COUNT] = {0, 0, 0, 0};
+    for (Group &group: groups) {
+        if (group.opened == 0) {
+            continue;
+        }
+        // PERF_FORMAT_GROUP layout: number of events, time enabled, time running, then one value per event
+        uint64_t buffer[3 + EVENT_COUNT];
+        if (read(group.descriptors[0], buffer, sizeof(buffer)) <
+            static_cast<ssize_t>((3 + group.opened) * sizeof(uint64_t))) {
+            return -1;
+        }
+        uint64_t enabled = buffer[1];
+        uint64_t running = buffer[2];
+        // with more events than hardware counters the kernel time-shares them; extrapolate to the whole interval
+        double scale =
+                running > 0 && running < enabled ? static_cast<double>(enabled) / static_cast<double>(running) : 1;
+        for (int i = 0; i < group.opened; i++) {
+            values[group.events[i]] += static_cast<uint64_t>(static_cast<double>(buffer[3 + i]) * scale);
+        }
+    }
+    sample.cycles = values[0];
+    sample.instructions = values[1];
+    sample.cache_references = values[2];
+    sample.cache_misses = values[3];
+    return 0;
+#else
+    return -1;
+#endif
+}
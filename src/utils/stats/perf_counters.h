@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_PERF_COUNTERS_H
+#define VISION_CPP_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * The hardware events counted over one interval. Events the CPU (or the kernel, or the container) doesn't expose
+ * stay at 0.
+ */
+struct PerfSample {
+    uint64_t cycles = 0; // CPU cycles
+    uint64_t instructions = 0; // instructions retired
+    uint64_t cache_references = 0; // last level cache references
+    uint64_t cache_misses = 0; // last level cache misses
+};
+
+/**
+ * A function that turns the per-stage hardware counters on or off. Off by default; it must be set before the stages
+ * start, since each stage opens its counters when its loop starts.
+ * @param enabled Whether the stages count hardware events.
+ */
+void perf_counters_enable(bool enabled);
+
+/**
+ * A function that tells whether the per-stage hardware counters are on.
+ * @return true if the stages count hardware events.
+ */
+bool perf_counters_enabled();
+
+/**
+ * A class that counts hardware events on the calling thread and the threads of the OpenMP team it starts, with Linux
+ * perf_event_open. Every thread of the team gets its own group, so that all the events of a thread cover exactly the
+ * same instructions, and the groups are summed when the counters are read. Only user-space events are counted.
+ * The team is the one a parallel region of the calling thread gets at its current width (omp_get_max_threads); when
+ * the width changes (e.g. the thread budget moved cores), the groups are opened again on the new team.
+ * Counters are often unavailable (no PMU in a VM, perf_event_paranoid, seccomp in containers); open() then fails and
+ * the stage simply runs without them.
+ */
+class PerfCounters {
+public:
+    /**
+     * A constructor that creates closed counters.
+     */
+    explicit PerfCounters();
+
+    /**
+     * A destructor that closes the counters.
+     */
+    ~PerfCounters();
+
+    /**
+     * A method that opens the counters for the calling thread and every thread of its OpenMP team. It must be called
+     * outside of any parallel region. Events other than cycles that can't be opened are left out, as are team threads
+     * whose cycles can't be counted. The first failure in the process is reported once on the standard output.
+     * @return 0 if at least the cycles of the calling thread can be counted, -1 otherwise.
+     */
+    int open();
+
+    /**
+     * A method that resets the counters and starts counting, after opening them again if the width of the team
+     * changed since they were opened.
+     */
+    void start();
+
+    /**
+     * A method that stops counting and reads the counters of every thread, scaled up if the kernel had to multiplex
+     * them, and sums them.
+     * @param sample A reference to the sample to fill in.
+     * @return 0 if the counters were read, -1 otherwise.
+     */
+    int stop(PerfSample &sample);
+
+private:
+    static const int EVENT_COUNT = 4;
+
+    /**
+     * The events counted on one thread of the team.
+     */
+    struct Group {
+        int descriptors[EVENT_COUNT] = {-1, -1, -1, -1}; // one per event, the first one leads the group
+        int events[EVENT_COUNT] = {0, 0, 0, 0}; // the event (index into PerfSample) of each opened descriptor
+        int opened = 0; // number of descriptors opened
+    };
+
+    /**
+     * A method that opens a group on the calling thread.
+     * @param group The group to open.
+     * @return 0 if at least the cycles can be counted, -1 otherwise.
+     */
+    static int open_group(Group &group);
+
+    /**
+     * A method that closes every group.
+     */
+    void close();
+
+    std::vector<Group> groups; // one per thread of the team, the calling thread first
+    int team_width = 0; // the width of the team the groups were opened for, 0 if closed
+};
+
+#endif //VISION_CPP_PERF_COUNTERS_H
@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "process_usage.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+int read_process_usage(ProcessUsage &usage) {
+    std::ifstream status("/proc/self/status");
+    if (!status.is_open()) {
+        return -1;
+    }
+
+    bool has_resident = false;
+    bool has_threads = false;
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "VmRSS:") {
+            long long kilobytes = 0;
+            fields >> kilobytes;
+            usage.resident_bytes = kilobytes * 1024;
+            has_resident = true;
+        } else if (key == "Threads:") {
+            fields >> usage.threads;
+            has_threads = true;
+        }
+    }
+    return has_resident && has_threads ? 0 : -1;
+}
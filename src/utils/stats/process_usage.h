@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_PROCESS_USAGE_H
+#define VISION_CPP_PROCESS_USAGE_H
+
+/**
+ * The resources the process holds at one point in time.
+ */
+struct ProcessUsage {
+    long long resident_bytes = 0; // resident memory
+    int threads = 0; // threads of the process
+};
+
+/**
+ * A function that reads the resources the process holds, from /proc/self/status.
+ * @param usage A reference to the structure to fill in.
+ * @return 0 on success, -1 if they cannot be read (not Linux, no /proc).
+ */
+int read_process_usage(ProcessUsage &usage);
+
+#endif //VISION_CPP_PROCESS_USAGE_H
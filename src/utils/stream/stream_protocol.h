@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_STREAM_PROTOCOL_H
+#define VISION_CPP_STREAM_PROTOCOL_H
+
+#include <cstdint>
+
+/**
+ * Wire format of the stream server.
+ *
+ * Clients send a plain HTTP request, "GET /<filter>.mjpg" or "GET /<filter>.raw" (e.g. /cartoonize.mjpg, /camera.raw).
+ * MJPEG streams are answered with a multipart/x-mixed-replace response that browsers and players understand.
+ * Raw streams are answered with an application/octet-stream response in which every frame is a RawStreamHeader
+ * followed by rows * step bytes of pixel data.
+ */
+
+const char STREAM_MJPEG_BOUNDARY[] = "frame";
+const char STREAM_RAW_MAGIC[4] = {'F', 'R', 'A', 'W'};
+
+/**
+ * The header in front of every frame of a raw stream.
+ */
+struct RawStreamHeader {
+    char magic[4]; // STREAM_RAW_MAGIC
+    int32_t rows; // frame height
+    int32_t cols; // frame width
+    int32_t type; // OpenCV type of the frame (e.g. CV_8UC3 = 16)
+    uint64_t step; // bytes between the start of two rows
+    uint64_t sequence; // sequence number of the frame in the stream, gaps mean the client skipped frames
+};
+
+#endif //VISION_CPP_STREAM_PROTOCOL_H
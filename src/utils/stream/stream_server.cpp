@@ -0,0 +1,353 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "stream_server.h"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include "stream_protocol.h"
+#include "../net/listener.h"
+
+const auto STREAM_WAIT_TIMEOUT = std::chrono::milliseconds(200);
+
+EncodedStream::EncodedStream(const std::string &name, WatchChannel<cv::Mat> &channel, int jpeg_quality)
+        : Sink(name) {
+    this->channel = &channel;
+    this->jpeg_quality = jpeg_quality;
+    this->encoderThread = std::thread(&EncodedStream::encode_loop, this);
+}
+
+EncodedStream::~EncodedStream() {
+    stop();
+}
+
+void EncodedStream::stop() {
+    {
+        std::lock_guard<std::mutex> clientsGuard(clients_mutex);
+        std::lock_guard<std::mutex> lockGuard(mutex);
+        if (stopped) {
+            return;
+        }
+        stopped = true;
+    }
+    {
+        std::lock_guard<std::mutex> clientsGuard(clients_mutex);
+        detach();
+    }
+    frame_available.notify_all();
+    encoded_available.notify_all();
+    encoderThread.join();
+}
+
+void EncodedStream::add_client(StreamFormat format) {
+    std::lock_guard<std::mutex> clientsGuard(clients_mutex);
+    if (clients[0] + clients[1] == 0) {
+        attach(*channel);
+    }
+    clients[static_cast<int>(format)]++;
+}
+
+void EncodedStream::remove_client(StreamFormat format) {
+    std::lock_guard<std::mutex> clientsGuard(clients_mutex);
+    clients[static_cast<int>(format)]--;
+    if (clients[0] + clients[1] == 0) {
+        detach();
+
+        std::lock_guard<std::mutex> lockGuard(mutex);
+        encoded[0] = nullptr;
+        encoded[1] = nullptr;
+    }
+}
+
+WatchChannel<cv::Mat> *EncodedStream::get_channel() const {
+    return channel;
+}
+
+void EncodedStream::push(const cv::Mat &frame) {
+    {
+        std::lock_guard<std::mutex> lockGuard(mutex);
+        if (has_pending) {
+            frames_superseded++;
+        }
+        pending = frame;
+        has_pending = true;
+    }
+    frame_available.notify_one();
+}
+
+void EncodedStream::encode_loop() {
+    while (true) {
+        cv::Mat frame;
+        bool wanted[2];
+        uint64_t frame_sequence;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_available.wait(lock, [this] { return stopped || has_pending; });
+            if (stopped) {
+                return;
+            }
+            frame = pending;
+            pending = cv::Mat();
+            has_pending = false;
+            wanted[0] = clients[0] > 0;
+            wanted[1] = clients[1] > 0;
+            frame_sequence = sequence + 1;
+        }
+        if (frame.empty()) {
+            continue;
+        }
+
+        // encoded once per format, outside the lock, then shared by every client of that format
+        std::shared_ptr<const std::vector<uchar>> buffers[2];
+        auto start = std::chrono::steady_clock::now();
+        for (int format = 0; format < 2; format++) {
+            if (wanted[format]) {
+                buffers[format] = encode(frame, static_cast<StreamFormat>(format), frame_sequence);
+                frames_encoded++;
+            }
+        }
+        encode_time_total += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lockGuard(mutex);
+            encoded[0] = buffers[0];
+            encoded[1] = buffers[1];
+            sequence = frame_sequence;
+        }
+        encoded_available.notify_all();
+    }
+}
+
+std::shared_ptr<const std::vector<uchar>> EncodedStream::encode(const cv::Mat &frame, StreamFormat format,
+                                                                uint64_t frame_sequence) {
+    auto buffer = std::make_shared<std::vector<uchar>>();
+
+    if (format == StreamFormat::MJPEG) {
+        std::vector<uchar> jpeg;
+        cv::imencode(".jpg", frame, jpeg, {cv::IMWRITE_JPEG_QUALITY, jpeg_quality});
+
+        std::string part_header = std::string("--") + STREAM_MJPEG_BOUNDARY + "\r\nContent-Type: image/jpeg\r\n" +
+                                  "Content-Length: " + std::to_string(jpeg.size()) + "\r\n\r\n";
+        buffer->reserve(part_header.size() + jpeg.size() + 2);
+        buffer->insert(buffer->end(), part_header.begin(), part_header.end());
+        buffer->insert(buffer->end(), jpeg.begin(), jpeg.end());
+        buffer->push_back('\r');
+        buffer->push_back('\n');
+        return buffer;
+    }
+
+    RawStreamHeader header{};
+    std::memcpy(header.magic, STREAM_RAW_MAGIC, sizeof(header.magic));
+    header.rows = frame.rows;
+    header.cols = frame.cols;
+    header.type = frame.type();
+    header.step = frame.cols * frame.elemSize();
+    header.sequence = frame_sequence;
+
+    buffer->resize(sizeof(header) + header.step * frame.rows);
+    std::memcpy(buffer->data(), &header, sizeof(header));
+    for (int row = 0; row < frame.rows; row++) {
+        std::memcpy(buffer->data() + sizeof(header) + row * header.step, frame.ptr(row), header.step);
+    }
+    return buffer;
+}
+
+std::shared_ptr<const std::vector<uchar>> EncodedStream::wait_next(StreamFormat format, uint64_t after,
+                                                                   uint64_t &frame_sequence) {
+    int index = static_cast<int>(format);
+    std::unique_lock<std::mutex> lock(mutex);
+    bool ready = encoded_available.wait_for(lock, STREAM_WAIT_TIMEOUT, [&] {
+        return stopped || (sequence > after && encoded[index] != nullptr);
+    });
+    if (!ready || stopped) {
+        return nullptr;
+    }
+    frame_sequence = sequence;
+    return encoded[index];
+}
+
+SinkStats EncodedStream::get_stats() const {
+    SinkStats stats;
+    stats.frames_out = frames_encoded;
+    stats.frames_dropped = frames_superseded;
+    stats.busy_time = encode_time_total;
+    return stats;
+}
+
+void EncodedStream::report(std::ostream &out) {
+    long long encoded_count = frames_encoded;
+    out << std::fixed << std::setprecision(2) << "Stream " << name << ": " << encoded_count << " encoded, "
+        << (encoded_count > 0 ? encode_time_total / 1000.0 / encoded_count : 0) << " ms/frame encode" << std::endl;
+}
+
+StreamServer::StreamServer(std::string address, int jpeg_quality) {
+    this->address = std::move(address);
+    this->jpeg_quality = jpeg_quality;
+}
+
+StreamServer::~StreamServer() {
+    stop();
+}
+
+void StreamServer::add_stream(const std::string &name, WatchChannel<cv::Mat> &channel) {
+    for (auto &stream: owned_streams) {
+        if (stream->get_channel() == &channel) {
+            streams[name] = stream.get();
+            return;
+        }
+    }
+    owned_streams.push_back(std::make_unique<EncodedStream>(name, channel, jpeg_quality));
+    streams[name] = owned_streams.back().get();
+}
+
+int StreamServer::start() {
+    listen_socket = open_listener(address, 16, "stream server");
+    if (listen_socket < 0) {
+        return -1;
+    }
+
+    running = true;
+    acceptThread = std::thread(&StreamServer::accept_loop, this);
+    std::cout << "Streaming on " << address << std::endl;
+    return 0;
+}
+
+void StreamServer::stop() {
+    if (running.exchange(false)) {
+        close_listener(listen_socket, address);
+        acceptThread.join();
+
+        {
+            std::lock_guard<std::mutex> lockGuard(clients_mutex);
+            for (Client &client: clients) {
+                shutdown(client.socket, SHUT_RDWR);
+            }
+        }
+        for (Client &client: clients) {
+            client.thread.join();
+        }
+        clients.clear();
+    }
+
+    for (auto &stream: owned_streams) {
+        stream->stop();
+    }
+}
+
+void StreamServer::accept_loop() {
+    while (running) {
+        int client_socket = accept(listen_socket, nullptr, nullptr);
+        if (client_socket < 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lockGuard(clients_mutex);
+        // reclaim the threads of the clients that disconnected since the last accept
+        for (auto it = clients.begin(); it != clients.end();) {
+            if (it->done) {
+                it->thread.join();
+                it = clients.erase(it);
+            } else {
+                it++;
+            }
+        }
+
+        Client &client = clients.emplace_back();
+        client.socket = client_socket;
+        client.thread = std::thread(&StreamServer::serve, this, std::ref(client));
+    }
+}
+
+void StreamServer::serve(Client &client) {
+    // a slow client blocks in send on its own thread; the timeout keeps a stalled one from lingering forever
+    timeval timeout{5, 0};
+    setsockopt(client.socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client.socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request = read_request(client.socket);
+
+    // "GET /<name>.<format> HTTP/1.x"
+    std::string path;
+    if (request.starts_with("GET /")) {
+        path = request.substr(5, request.find(' ', 5) - 5);
+    }
+    StreamFormat format = path.ends_with(".raw") ? StreamFormat::RAW : StreamFormat::MJPEG;
+    std::string name = path.substr(0, path.rfind('.'));
+
+    auto it = streams.find(name);
+    if (it == streams.end()) {
+        std::string response = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n\r\nAvailable streams:\n";
+        for (auto &pair: streams) {
+            response += "/" + pair.first + ".mjpg /" + pair.first + ".raw\n";
+        }
+        send_all(client.socket, response.data(), response.size());
+        close(client.socket);
+        client.done = true;
+        return;
+    }
+    EncodedStream *stream = it->second;
+
+    std::string response = format == StreamFormat::MJPEG ?
+                           std::string("HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\nConnection: close\r\n") +
+                           "Content-Type: multipart/x-mixed-replace; boundary=" + STREAM_MJPEG_BOUNDARY + "\r\n\r\n" :
+                           "HTTP/1.0 200 OK\r\nConnection: close\r\nContent-Type: application/octet-stream\r\n\r\n";
+    clients_served++;
+
+    if (send_all(client.socket, response.data(), response.size())) {
+        stream->add_client(format);
+
+        uint64_t last = 0;
+        while (running) {
+            uint64_t sequence = 0;
+            auto buffer = stream->wait_next(format, last, sequence);
+            if (buffer == nullptr) {
+                continue;
+            }
+            if (!send_all(client.socket, buffer->data(), buffer->size())) {
+                break;
+            }
+            frames_sent++;
+            if (last != 0) {
+                frames_skipped += static_cast<long long>(sequence - last - 1);
+            }
+            last = sequence;
+        }
+
+        stream->remove_client(format);
+    }
+
+    close(client.socket);
+    client.done = true;
+}
+
+StreamServerStats StreamServer::get_stats() const {
+    StreamServerStats stats;
+    stats.clients_served = clients_served;
+    stats.frames_sent = frames_sent;
+    stats.frames_skipped = frames_skipped;
+    return stats;
+}
+
+std::vector<const Sink *> StreamServer::get_streams() const {
+    std::vector<const Sink *> result;
+    for (auto &stream: owned_streams) {
+        result.push_back(stream.get());
+    }
+    return result;
+}
+
+void StreamServer::report(std::ostream &out) {
+    out << "Stream server " << address << ": " << clients_served << " clients served, " << frames_sent
+        << " frames sent, " << frames_skipped << " skipped by slow clients" << std::endl;
+    for (auto &stream: owned_streams) {
+        stream->report(out);
+    }
+}
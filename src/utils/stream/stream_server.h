@@ -0,0 +1,224 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_STREAM_SERVER_H
+#define VISION_CPP_STREAM_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+#include "../sink/sink.h"
+#include "../watch_channel.h"
+
+/**
+ * The formats a stream can be served in.
+ */
+enum class StreamFormat {
+    MJPEG, // JPEG frames in a multipart HTTP response
+    RAW // uncompressed frames, see stream_protocol.h
+};
+
+/**
+ * A sink that encodes the frames of one channel for the clients of a StreamServer.
+ * The channel's writer only swaps the latest frame in; the sink's own thread encodes it once per format that has
+ * clients, and every client is handed the same encoded buffer. The sink is only attached to its channel while it
+ * has clients, so an unwatched stream costs nothing.
+ */
+class EncodedStream : public Sink {
+public:
+    /**
+     * A constructor that creates the stream and starts its encoder thread.
+     * @param name The name of the stream in URLs.
+     * @param channel The channel to serve.
+     * @param jpeg_quality The quality of the JPEG encoding, from 0 to 100.
+     */
+    explicit EncodedStream(const std::string &name, WatchChannel<cv::Mat> &channel, int jpeg_quality);
+
+    /**
+     * A destructor that stops the stream.
+     */
+    ~EncodedStream() override;
+
+    /**
+     * A method that detaches the stream and stops its encoder thread, waking up any client waiting for a frame.
+     */
+    void stop() override;
+
+    /**
+     * A method that prints the frames encoded and the time spent encoding them.
+     * @param out The stream to print to.
+     */
+    void report(std::ostream &out) override;
+
+    /**
+     * A method that returns a copy of the counters of the sink.
+     * @return The counters of the sink.
+     */
+    SinkStats get_stats() const override;
+
+    /**
+     * A method that registers a client, attaching the stream to its channel if it is the first one.
+     * @param format The format the client reads.
+     */
+    void add_client(StreamFormat format);
+
+    /**
+     * A method that unregisters a client, detaching the stream from its channel if it was the last one.
+     * @param format The format the client reads.
+     */
+    void remove_client(StreamFormat format);
+
+    /**
+     * A method that waits for a frame newer than the given one, encoded in the given format.
+     * Frames encoded while the client was busy are skipped: the client always gets the latest one.
+     * @param format The format the client reads.
+     * @param after The sequence number of the last frame the client got.
+     * @param sequence A reference to a variable where the sequence number of the frame will be stored.
+     * @return The encoded frame, or nullptr if none arrived within a short timeout or the stream stopped.
+     */
+    std::shared_ptr<const std::vector<uchar>> wait_next(StreamFormat format, uint64_t after, uint64_t &sequence);
+
+    /**
+     * A method that returns the channel served by the stream.
+     * @return A pointer to the channel.
+     */
+    WatchChannel<cv::Mat> *get_channel() const;
+
+protected:
+    /**
+     * A method that replaces the frame waiting for the encoder with the new one.
+     * @param frame The frame written to the channel.
+     */
+    void push(const cv::Mat &frame) override;
+
+private:
+    void encode_loop();
+
+    std::shared_ptr<const std::vector<uchar>> encode(const cv::Mat &frame, StreamFormat format, uint64_t frame_sequence);
+
+    WatchChannel<cv::Mat> *channel; // the channel served
+    int jpeg_quality; // JPEG quality, from 0 to 100
+    std::thread encoderThread; // the thread that encodes the frames
+    bool stopped = false; // whether the stream was stopped
+
+    // attaching and detaching wait for a push in progress, so they must not hold the mutex push() takes
+    std::mutex clients_mutex; // synchronizes attaching, detaching and the client counts
+    std::atomic<int> clients[2] = {0, 0}; // number of clients per format
+
+    std::mutex mutex; // synchronizes the fields below
+    std::condition_variable frame_available; // signalled when a frame is pushed or the stream stops
+    std::condition_variable encoded_available; // signalled when a frame is encoded or the stream stops
+    cv::Mat pending; // the latest frame pushed, waiting for the encoder
+    bool has_pending = false; // whether pending holds a frame not encoded yet
+    uint64_t sequence = 0; // sequence number of the latest encoded frame
+    std::shared_ptr<const std::vector<uchar>> encoded[2]; // the latest encoded frame per format
+
+    std::atomic<long long> frames_encoded{0}; // frames encoded, counting each format once
+    std::atomic<long long> encode_time_total{0}; // time spent encoding, in microseconds
+    std::atomic<long long> frames_superseded{0}; // frames replaced by a newer one before they were encoded
+};
+
+/**
+ * A structure that holds a copy of the counters of a stream server.
+ */
+struct StreamServerStats {
+    long long clients_served = 0; // clients that requested a valid stream
+    long long frames_sent = 0; // frames sent to all clients
+    long long frames_skipped = 0; // frames clients skipped because they were busy sending
+};
+
+/**
+ * A class that serves channels to local clients over TCP (bound to the loopback interface) or a Unix socket.
+ * Each client is served by its own thread with the latest encoded frame of its stream, so a slow client only
+ * skips frames: it never delays the other clients, the encoder or the filters.
+ */
+class StreamServer {
+public:
+    /**
+     * A constructor that creates a server that is not listening yet.
+     * @param address A TCP port (e.g. "8080", bound to 127.0.0.1) or "unix:<path>" for a Unix socket.
+     * @param jpeg_quality The quality of the JPEG encoding, from 0 to 100.
+     */
+    explicit StreamServer(std::string address, int jpeg_quality);
+
+    /**
+     * A destructor that stops the server.
+     */
+    ~StreamServer();
+
+    /**
+     * A method that makes a channel available to clients under the given name. Must be called before start().
+     * Several names can refer to the same channel; it is encoded once.
+     * @param name The name of the stream in URLs, e.g. "cartoonize" for /cartoonize.mjpg.
+     * @param channel The channel to serve.
+     */
+    void add_stream(const std::string &name, WatchChannel<cv::Mat> &channel);
+
+    /**
+     * A method that starts listening for clients.
+     * @return 0 if the server is listening, -1 otherwise.
+     */
+    int start();
+
+    /**
+     * A method that disconnects every client and stops listening.
+     */
+    void stop();
+
+    /**
+     * A method that prints the clients served, the frames sent and skipped, and the encoding statistics.
+     * @param out The stream to print to.
+     */
+    void report(std::ostream &out);
+
+    /**
+     * A method that returns a copy of the counters of the server. It does not take any lock.
+     * @return The counters of the server.
+     */
+    StreamServerStats get_stats() const;
+
+    /**
+     * A method that returns the streams of the server, one per channel served, e.g. to read their counters.
+     * @return The streams, in the order they were added.
+     */
+    std::vector<const Sink *> get_streams() const;
+
+private:
+    /**
+     * A structure that holds the state of one connected client.
+     */
+    struct Client {
+        int socket; // the connection
+        std::thread thread; // the thread serving the client
+        std::atomic<bool> done{false}; // set once the client is disconnected
+    };
+
+    void accept_loop();
+
+    void serve(Client &client);
+
+    std::string address; // TCP port or "unix:<path>"
+    int jpeg_quality; // JPEG quality, from 0 to 100
+    int listen_socket = -1; // the listening socket
+    std::atomic<bool> running{false}; // whether the server accepts and serves clients
+    std::thread acceptThread; // the thread accepting clients
+    std::map<std::string, EncodedStream *> streams; // streams by URL name
+    std::vector<std::unique_ptr<EncodedStream>> owned_streams; // one stream per channel
+    std::mutex clients_mutex; // synchronizes the list of clients
+    std::list<Client> clients; // connected clients, and disconnected ones not joined yet
+
+    std::atomic<long long> clients_served{0}; // clients that requested a valid stream
+    std::atomic<long long> frames_sent{0}; // frames sent to all clients
+    std::atomic<long long> frames_skipped{0}; // frames clients skipped because they were busy sending
+};
+
+#endif //VISION_CPP_STREAM_SERVER_H
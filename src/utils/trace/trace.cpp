@@ -0,0 +1,147 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+std::atomic<bool> trace_enabled_flag{false};
+
+static const size_t TRACE_CAPACITY = 1 << 14; // spans kept per thread, a power of two
+
+/**
+ * One finished span.
+ */
+struct TraceEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t duration;
+    uint64_t arg;
+};
+
+/**
+ * The ring buffer of one thread. Only the owning thread writes; head is published with release semantics so that
+ * trace_dump can read the slots below it.
+ */
+struct TraceBuffer {
+    int thread_id = 0; // id of the thread in the trace
+    std::string thread_name; // name of the thread, protected by the registry mutex
+    std::vector<TraceEvent> events = std::vector<TraceEvent>(TRACE_CAPACITY); // the ring
+    std::atomic<uint64_t> head{0}; // number of spans ever written
+};
+
+/**
+ * Every buffer ever created, kept until exit so that the spans of finished threads can still be dumped.
+ */
+static std::mutex registry_mutex;
+static std::vector<std::unique_ptr<TraceBuffer>> registry;
+static std::unordered_set<std::string> interned_names;
+
+static thread_local TraceBuffer *thread_buffer = nullptr;
+
+static TraceBuffer *get_thread_buffer() {
+    if (thread_buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(std::make_unique<TraceBuffer>());
+        thread_buffer = registry.back().get();
+        thread_buffer->thread_id = static_cast<int>(registry.size());
+    }
+    return thread_buffer;
+}
+
+void trace_enable(bool enabled) {
+    trace_enabled_flag.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t trace_now() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()) | 1;
+}
+
+const char *trace_intern(const std::string &name) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    return interned_names.insert(name).first->c_str();
+}
+
+void trace_set_thread_name(const std::string &name) {
+    TraceBuffer *buffer = get_thread_buffer();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffer->thread_name = name;
+}
+
+void trace_record(const char *name, uint64_t start, uint64_t end, uint64_t arg) {
+    TraceBuffer *buffer = get_thread_buffer();
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[index & (TRACE_CAPACITY - 1)] = {name, start, end - start, arg};
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+static void write_string(std::ostream &out, const std::string &value) {
+    out << '"';
+    for (char c: value) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << (static_cast<unsigned char>(c) < 0x20 ? ' ' : c);
+    }
+    out << '"';
+}
+
+int trace_dump(const std::string &path) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cout << "Failed to write the trace to " << path << "." << std::endl;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    size_t event_count = 0;
+    bool first = true;
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (auto &buffer: registry) {
+        if (!buffer->thread_name.empty()) {
+            file << (first ? "" : ",\n") << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": "
+                 << buffer->thread_id << ", \"args\": {\"name\": ";
+            write_string(file, buffer->thread_name);
+            file << "}}";
+            first = false;
+        }
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+        std::vector<TraceEvent> events;
+        for (uint64_t i = begin; i < head; i++) {
+            events.push_back(buffer->events[i & (TRACE_CAPACITY - 1)]);
+        }
+        // the owner kept writing while we copied: drop the slots it may have overwritten
+        uint64_t new_head = buffer->head.load(std::memory_order_acquire);
+        uint64_t valid_from = new_head >= TRACE_CAPACITY ? new_head - TRACE_CAPACITY + 1 : 0;
+
+        for (uint64_t i = std::max(begin, valid_from); i < head; i++) {
+            const TraceEvent &event = events[i - begin];
+            file << (first ? "" : ",\n") << "{\"ph\": \"X\", \"name\": ";
+            write_string(file, event.name);
+            file << ", \"pid\": 1, \"tid\": " << buffer->thread_id << ", \"ts\": " << event.start / 1000.0
+                 << ", \"dur\": " << event.duration / 1000.0;
+            if (event.arg != 0) {
+                file << ", \"args\": {\"frame\": " << event.arg << "}";
+            }
+            file << "}";
+            first = false;
+            event_count++;
+        }
+    }
+    file << "\n]}\n";
+
+    std::cout << "Wrote " << event_count << " trace events to " << path << "." << std::endl;
+    return 0;
+}
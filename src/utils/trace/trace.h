@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: 2023 Dheshan Mohandass (L4TTiCe)
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VISION_CPP_TRACE_H
+#define VISION_CPP_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * Lightweight timeline tracing, exported in the Chrome trace format (chrome://tracing, ui.perfetto.dev).
+ *
+ * Code marks the spans it wants to see with TRACE_SCOPE("name"). When tracing is enabled, each span is appended to
+ * a ring buffer owned by the calling thread (no lock, no allocation), and trace_dump writes the most recent spans of
+ * every thread as JSON. When tracing is disabled, a span costs one relaxed load and one well-predicted branch.
+ * Span names must outlive the trace: use string literals, or trace_intern for names built at runtime.
+ */
+
+/**
+ * The switch checked by every span. Use trace_enable to change it.
+ */
+extern std::atomic<bool> trace_enabled_flag;
+
+/**
+ * Tells whether spans are being recorded.
+ * @return true while tracing is enabled.
+ */
+inline bool trace_enabled() {
+    return trace_enabled_flag.load(std::memory_order_relaxed);
+}
+
+/**
+ * Starts or stops recording spans. Spans already recorded are kept.
+ * @param enabled true to record spans.
+ */
+void trace_enable(bool enabled);
+
+/**
+ * Returns the current time on the trace clock.
+ * @return The time in nanoseconds since an arbitrary epoch, never 0.
+ */
+uint64_t trace_now();
+
+/**
+ * Returns a copy of a name that lives as long as the process, to name spans built at runtime (e.g. task names).
+ * @param name The name.
+ * @return A pointer to the copy. The same name always gives the same pointer.
+ */
+const char *trace_intern(const std::string &name);
+
+/**
+ * Names the calling thread in the trace.
+ * @param name The name of the thread.
+ */
+void trace_set_thread_name(const std::string &name);
+
+/**
+ * Appends a finished span to the ring buffer of the calling thread. Usually called by TraceScope.
+ * @param name The name of the span, which must outlive the trace.
+ * @param start When the span started, from trace_now.
+ * @param end When the span ended, from trace_now.
+ * @param arg A number shown with the span (e.g. the version of the frame), 0 for none.
+ */
+void trace_record(const char *name, uint64_t start, uint64_t end, uint64_t arg);
+
+/**
+ * Writes the spans of every thread (the most recent ones, when a ring buffer wrapped) as a Chrome trace.
+ * Can be called at any time, while other threads keep recording.
+ * @param path The path of the JSON file.
+ * @return 0 if the file was written, -1 otherwise.
+ */
+int trace_dump(const std::string &path);
+
+/**
+ * A span that lasts from its construction to its destruction.
+ */
+class TraceScope {
+public:
+    /**
+     * A constructor that starts the span, if tracing is enabled.
+     * @param name The name of the span, which must outlive the trace.
+     * @param arg A number shown with the span, 0 for none.
+     */
+    explicit TraceScope(const char *name, uint64_t arg = 0)
+            : name(name), arg(arg), start(trace_enabled() ? trace_now() : 0) {}
+
+    /**
+     * A destructor that records the span, if it was started.
+     */
+    ~TraceScope() {
+        if (start != 0) {
+            trace_record(name, start, trace_now(), arg);
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name; // name of the span
+    uint64_t arg; // number shown with the span
+    uint64_t start; // when the span started, 0 if tracing was disabled
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+/**
+ * Records a span from this line to the end of the enclosing block, e.g. TRACE_SCOPE("sobel_x").
+ */
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(__VA_ARGS__)
+
+#endif //VISION_CPP_TRACE_H
@@ -5,13 +5,22 @@
 #ifndef VISION_CPP_WATCH_CHANNEL_H
 #define VISION_CPP_WATCH_CHANNEL_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <mutex>
+#include "trace/trace.h"
 
 /**
  * A template class that implements a thread-safe channel for data exchange.
  * A channel is a one-way communication mechanism that allows one thread to send data to another thread.
  * The channel has a buffer of size one, which means it can store only one data item at a time.
  * The channel supports read and write operations, which are synchronized using a mutex.
+ * Subscribers can also be notified of every write, e.g. so that a sink can queue each frame without polling.
+ * Every write increments the version of the channel, so that readers can tell whether the data changed since their last read.
+ * Readers can also ask for a newer item (request, or as a consumer of every item), for writers that produce on demand.
  * @tparam T The type of data that the channel can hold.
  */
 template<typename T>
@@ -35,6 +44,27 @@ public:
     */
     int read(T &output);
 
+    /**
+    * Reads the data from the channel along with its version, atomically.
+    * @param output A reference to a variable of type T where the data will be stored.
+    * @param data_version A reference to a variable where the version of the data will be stored.
+    * @return 0 if the read operation is successful, or a non-zero error code otherwise.
+    */
+    int read(T &output, uint64_t &data_version);
+
+    /**
+    * Returns the version of the data in the channel, without taking the lock.
+    * The version starts at 0 (nothing written yet) and is incremented by every write.
+    * @return The current version of the channel.
+    */
+    uint64_t get_version() const;
+
+    /**
+    * Returns when the channel was last written, without taking the lock.
+    * @return The steady clock time of the last write in nanoseconds, or 0 if nothing was written yet.
+    */
+    int64_t get_last_write() const;
+
     /**
     * Writes the data to the channel from the input parameter.
     * This operation blocks until the channel has some space to write.
@@ -43,9 +73,99 @@ public:
     */
     int write(T &input);
 
+    /**
+    * Releases the data held by the channel, e.g. the last frame of a task that was stopped, without counting as a write:
+    * the version is unchanged and subscribers are not notified.
+    */
+    void clear();
+
+    /**
+    * Registers a function that is called, on the writer's thread, with every item written to the channel.
+    * The function must be cheap (e.g. hand the item to another thread), since it delays the writer.
+    * @param subscriber The function to call on every write.
+    * @return An identifier to pass to unsubscribe.
+    */
+    int subscribe(std::function<void(const T &)> subscriber);
+
+    /**
+    * Removes a function registered with subscribe. Once this returns, the function is not running and won't be called again.
+    * @param id The identifier returned by subscribe.
+    */
+    void unsubscribe(int id);
+
+    /**
+    * Registers a function that is called once, on the writer's thread, by the next write after the given version, e.g.
+    * to resume a coroutine waiting for a new item. It must be cheap, like a subscriber.
+    * @param seen_version The last version the caller saw.
+    * @param waker The function to call.
+    * @return An identifier to pass to remove_waker, or -1 if the channel is already past seen_version: the function
+    * is then not registered, and the caller has a new item to read.
+    */
+    int add_waker(uint64_t seen_version, std::function<void()> waker);
+
+    /**
+    * Removes a function registered with add_waker or add_request_waker that was not called yet. It may still be
+    * running, or about to be.
+    * @param id The identifier returned by add_waker or add_request_waker.
+    */
+    void remove_waker(int id);
+
+    /**
+    * Registers a function that is called once, on the reader's thread, by the next request (or add_consumer), e.g. to
+    * wake up a writer that only produces on demand. It must be cheap, like a subscriber.
+    * @param waker The function to call.
+    * @return An identifier to pass to remove_waker, or -1 if the channel is already requested: the function is then
+    * not registered, and the caller should produce the next item.
+    */
+    int add_request_waker(std::function<void()> waker);
+
+    /**
+    * Records that a reader wants a newer item than the one in the channel, for writers that only produce on demand (see
+    * is_requested), and wakes the writer if it waits for a request. An atomic store, and an atomic load while nobody
+    * waits, cheap enough to call on every read.
+    */
+    void request();
+
+    /**
+    * Returns when request was last called, without taking the lock.
+    * @return The steady clock time of the last request in nanoseconds, or 0 if there was none.
+    */
+    int64_t get_last_request() const;
+
+    /**
+    * Registers a consumer of every item written, e.g. a sink: while there is one, the channel is always requested.
+    */
+    void add_consumer();
+
+    /**
+    * Unregisters a consumer registered with add_consumer.
+    */
+    void remove_consumer();
+
+    /**
+    * Tells whether a reader wants a newer item: a consumer is registered, or request was called since the last write.
+    * @return true if the writer should produce the next item.
+    */
+    bool is_requested() const;
+
 private:
+    /**
+    * Calls and removes the functions registered with add_request_waker.
+    */
+    void wake_requesters();
+
     T data; // The buffer that holds the data
     std::mutex mutex; // The mutex that synchronizes the read and write operations
+    std::atomic<uint64_t> version{0}; // The number of writes so far
+    std::atomic<int64_t> lastWrite{0}; // The steady clock time of the last write, in nanoseconds
+    std::atomic<int64_t> lastRequest{0}; // The steady clock time of the last request, in nanoseconds
+    std::atomic<int> consumers{0}; // The number of consumers of every item
+    std::mutex subscribersMutex; // The mutex that synchronizes the subscribers with the notifications
+    std::map<int, std::function<void(const T &)>> subscribers; // The functions called on every write
+    std::map<int, std::function<void()>> wakers; // The functions called by the next write only
+    std::map<int, std::function<void()>> requestWakers; // The functions called by the next request only
+    std::atomic<int> requestWaiters{0}; // The number of request wakers, so that request only locks when there are some
+    int nextSubscriberId = 0; // The identifier of the next subscriber
 };
 
 template<typename T>
@@ -56,16 +176,154 @@ WatchChannel<T>::~WatchChannel() = default;
 
 template<typename T>
 int WatchChannel<T>::read(T &output) {
+    TRACE_SCOPE("channel read");
     std::lock_guard<std::mutex> lockGuard(mutex);
     output = this->data;
     return 0;
 }
 
 template<typename T>
-int WatchChannel<T>::write(T &input) {
+int WatchChannel<T>::read(T &output, uint64_t &data_version) {
+    TRACE_SCOPE("channel read");
     std::lock_guard<std::mutex> lockGuard(mutex);
-    this->data = input;
+    output = this->data;
+    data_version = this->version.load(std::memory_order_relaxed);
     return 0;
 }
 
+template<typename T>
+uint64_t WatchChannel<T>::get_version() const {
+    return version.load(std::memory_order_acquire);
+}
+
+template<typename T>
+int64_t WatchChannel<T>::get_last_write() const {
+    return lastWrite.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+int WatchChannel<T>::write(T &input) {
+    TRACE_SCOPE("channel write");
+    {
+        std::lock_guard<std::mutex> lockGuard(mutex);
+        this->data = input;
+        this->version.fetch_add(1, std::memory_order_release);
+    }
+    lastWrite.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> subscribersGuard(subscribersMutex);
+    for (auto &pair: subscribers) {
+        pair.second(input);
+    }
+    // a waker registered after the version moved on is refused by add_waker, so none is missed
+    std::map<int, std::function<void()>> woken;
+    woken.swap(wakers);
+    for (auto &pair: woken) {
+        pair.second();
+    }
+    return 0;
+}
+
+template<typename T>
+void WatchChannel<T>::clear() {
+    std::lock_guard<std::mutex> lockGuard(mutex);
+    this->data = T();
+}
+
+template<typename T>
+int WatchChannel<T>::subscribe(std::function<void(const T &)> subscriber) {
+    std::lock_guard<std::mutex> subscribersGuard(subscribersMutex);
+    int id = nextSubscriberId++;
+    subscribers[id] = std::move(subscriber);
+    return id;
+}
+
+template<typename T>
+void WatchChannel<T>::unsubscribe(int id) {
+    std::lock_guard<std::mutex> subscribersGuard(subscribersMutex);
+    subscribers.erase(id);
+}
+
+template<typename T>
+int WatchChannel<T>::add_waker(uint64_t seen_version, std::function<void()> waker) {
+    std::lock_guard<std::mutex> subscribersGuard(subscribersMutex);
+    if (version.load(std::memory_order_acquire) != seen_version) {
+        return -1;
+    }
+    int id = nextSubscriberId++;
+    wakers[id] = std::move(waker);
+    return id;
+}
+
+template<typename T>
+void WatchChannel<T>::remove_waker(int id) {
+    std::lock_guard<std::mutex> subscribersGuard(subscribersMutex);
+    wakers.erase(id);
+    if (requestWakers.erase(id) > 0) {
+        requestWaiters.fetch_sub(1);
+    }
+}
+
+template<typename T>
+int WatchChannel<T>::add_request_waker(std::function<void()> waker) {
+    std::lock_guard<std::mutex> subscribersGuard(subscribersMutex);
+    // counted before the request is checked, and request stores before it checks the count (all sequentially
+    // consistent): either this sees the request, or the request sees this waker
+    requestWaiters.fetch_add(1);
+    int64_t requested = lastRequest.load();
+    if (consumers.load() > 0 || (requested > 0 && requested >= lastWrite.load())) {
+        requestWaiters.fetch_sub(1);
+        return -1;
+    }
+    int id = nextSubscriberId++;
+    requestWakers[id] = std::move(waker);
+    return id;
+}
+
+template<typename T>
+void WatchChannel<T>::request() {
+    lastRequest.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    if (requestWaiters.load() > 0) {
+        wake_requesters();
+    }
+}
+
+template<typename T>
+void WatchChannel<T>::wake_requesters() {
+    std::lock_guard<std::mutex> subscribersGuard(subscribersMutex);
+    std::map<int, std::function<void()>> woken;
+    woken.swap(requestWakers);
+    requestWaiters.fetch_sub(static_cast<int>(woken.size()));
+    for (auto &pair: woken) {
+        pair.second();
+    }
+}
+
+template<typename T>
+int64_t WatchChannel<T>::get_last_request() const {
+    return lastRequest.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+void WatchChannel<T>::add_consumer() {
+    consumers.fetch_add(1);
+    if (requestWaiters.load() > 0) {
+        wake_requesters();
+    }
+}
+
+template<typename T>
+void WatchChannel<T>::remove_consumer() {
+    consumers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool WatchChannel<T>::is_requested() const {
+    int64_t requested = lastRequest.load(std::memory_order_relaxed);
+    return consumers.load(std::memory_order_relaxed) > 0 ||
+           (requested > 0 && requested >= lastWrite.load(std::memory_order_relaxed));
+}
+
 #endif //VISION_CPP_WATCH_CHANNEL_H